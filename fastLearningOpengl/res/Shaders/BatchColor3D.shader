@@ -1,45 +1,40 @@
 #shader vertex
 #version 330 core
+#pragma keywords INSTANCED NO_TEXTURE TEXTURE_ARRAY DEPTH_ONLY HEAVY_SHADING
 
-layout(location = 0) in vec4 position;
-layout(location = 1) in vec2 texcoord;
-layout(location = 2) in vec4 color;
-layout(location = 3) in float texidx;
+#include "include/BatchVertex.glsl"
 
+#ifdef INSTANCED
+layout(location = 4) in mat4 a_Model; // per instance, takes locations 4 to 7
+#else
 uniform mat4 model;
+#endif
 uniform mat4 view;
 uniform mat4 projection;
 
-out     vec4 v_Color;
-out     vec2 v_TexCoord;
-out     float v_TexIndex;
+// the DEPTH_ONLY variant lays down the depth the shading pass then tests GL_EQUAL against, both
+// have to compute bit identical positions
+invariant gl_Position;
 
 void main()
 {
+#ifdef INSTANCED
+	gl_Position = projection * view * a_Model * position;
+#else
 	gl_Position = projection * view * model * position;
-	v_Color = color;
-	v_TexCoord = texcoord;
-	v_TexIndex = texidx;
+#endif
+	PassBatchVertex();
 }
 
 
 #shader fragment
 #version 330 core
 
-layout(location = 0) out vec4 color;
-
-uniform sampler2D u_Textures[2];
-in vec4 v_Color;
-in vec2 v_TexCoord;
-in float v_TexIndex;
-
+#if defined(DEPTH_ONLY)
+// depth prepass, color writes are masked off and nothing is shaded
 void main()
 {
-	int index = int(v_TexIndex);
-	// non-constant expressions are forbidden in GLSL 1.30 (GLSL 4.0 supports)
-	//color = texture(u_Textures[index], v_TexCoord);
-	switch (index) {
-	case 0: color = texture(u_Textures[0], v_TexCoord); break;
-	case 1: color = texture(u_Textures[1], v_TexCoord); break;
-	}
-}
\ No newline at end of file
+}
+#else
+#include "include/BatchFragment.glsl"
+#endif
@@ -0,0 +1,67 @@
+#shader vertex
+#version 330 core
+#pragma keywords THRESHOLD BLUR LUMINANCE BLOOM OVERLAY
+
+#include "include/Fullscreen.glsl"
+
+
+#shader fragment
+#version 330 core
+
+// the full screen passes of the render graph test, one keyword each:
+//   THRESHOLD  what's brighter than u_Threshold, usually into a half size target
+//   BLUR       9 taps of a gaussian along u_Direction (in texels), run once across and once down
+//   LUMINANCE  a false color view of u_Source's luminance, blue (dark) to red (over 1)
+//   (none)     the composite: u_Source, plus BLOOM u_Bloom * u_BloomStrength, plus OVERLAY u_Overlay
+//              in the lower right corner
+
+layout(location = 0) out vec4 color;
+
+in vec2 v_TexCoord;
+
+uniform sampler2D u_Source;
+#if defined(THRESHOLD)
+uniform float u_Threshold;
+#elif defined(BLUR)
+uniform vec2 u_Direction;
+#endif
+#ifdef BLOOM
+uniform sampler2D u_Bloom;
+uniform float u_BloomStrength;
+#endif
+#ifdef OVERLAY
+uniform sampler2D u_Overlay;
+#endif
+
+const vec3 LUMA = vec3(0.2126, 0.7152, 0.0722);
+
+void main()
+{
+#if defined(THRESHOLD)
+	vec3 rgb = texture(u_Source, v_TexCoord).rgb;
+	color = vec4(max(rgb - u_Threshold, 0.0), 1.0);
+#elif defined(BLUR)
+	const float weights[5] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
+	vec2 offset = u_Direction / vec2(textureSize(u_Source, 0));
+	vec3 rgb = texture(u_Source, v_TexCoord).rgb * weights[0];
+	for (int i = 1; i < 5; i++) {
+		rgb += texture(u_Source, v_TexCoord + offset * float(i)).rgb * weights[i];
+		rgb += texture(u_Source, v_TexCoord - offset * float(i)).rgb * weights[i];
+	}
+	color = vec4(rgb, 1.0);
+#elif defined(LUMINANCE)
+	float luminance = clamp(dot(texture(u_Source, v_TexCoord).rgb, LUMA), 0.0, 2.0);
+	color = vec4(clamp(luminance - 1.0, 0.0, 1.0), 1.0 - abs(luminance - 1.0), clamp(1.0 - luminance, 0.0, 1.0), 1.0);
+#else
+	vec3 rgb = texture(u_Source, v_TexCoord).rgb;
+#ifdef BLOOM
+	rgb += texture(u_Bloom, v_TexCoord).rgb * u_BloomStrength;
+#endif
+#ifdef OVERLAY
+	vec2 corner = (v_TexCoord - vec2(0.7, 0.0)) / 0.3;
+	if (corner.x >= 0.0 && corner.y <= 1.0)
+		rgb = texture(u_Overlay, corner).rgb;
+#endif
+	color = vec4(rgb, 1.0);
+#endif
+}
@@ -0,0 +1,80 @@
+// GpuCuller: mat4 instances in, the visible ones packed into another buffer.
+// Compute on GL 4.3, which also counts them into the indirect draw arguments. Otherwise the vertex
+// stage tests one instance per point and the geometry stage only passes on the visible ones to
+// transform feedback
+
+#shader compute
+#version 430 core
+
+layout(local_size_x = 64) in;
+
+layout(std430, binding = 0) readonly buffer Instances { mat4 u_Instances[]; };
+layout(std430, binding = 1) writeonly buffer Visible { mat4 u_Visible[]; };
+// DrawElementsIndirectCommand, instanceCount starts at 0
+layout(std430, binding = 2) buffer DrawArgs
+{
+	uint u_IndexCount;
+	uint u_InstanceCount;
+	uint u_FirstIndex;
+	int u_BaseVertex;
+	uint u_BaseInstance;
+};
+
+uniform uint u_Count;
+
+#include "include/Cull.glsl"
+
+void main()
+{
+	uint instance = gl_GlobalInvocationID.x;
+	if (instance >= u_Count)
+		return;
+	mat4 model = u_Instances[instance];
+	if (IsVisible(model))
+		u_Visible[atomicAdd(u_InstanceCount, 1u)] = model;
+}
+
+
+#shader vertex
+#version 330 core
+
+layout(location = 0) in mat4 a_Instance; // locations 0 to 3
+
+out mat4 v_Instance;
+out float v_Visible;
+
+#include "include/Cull.glsl"
+
+void main()
+{
+	v_Instance = a_Instance;
+	v_Visible = IsVisible(a_Instance) ? 1.0 : 0.0;
+}
+
+
+#shader geometry
+#version 330 core
+
+layout(points) in;
+layout(points, max_vertices = 1) out;
+
+in mat4 v_Instance[];
+in float v_Visible[];
+
+// captured interleaved, which is the mat4 layout again
+out vec4 o_Column0;
+out vec4 o_Column1;
+out vec4 o_Column2;
+out vec4 o_Column3;
+
+void main()
+{
+	if (v_Visible[0] == 0.0)
+		return;
+	o_Column0 = v_Instance[0][0];
+	o_Column1 = v_Instance[0][1];
+	o_Column2 = v_Instance[0][2];
+	o_Column3 = v_Instance[0][3];
+	EmitVertex();
+	EndPrimitive();
+}
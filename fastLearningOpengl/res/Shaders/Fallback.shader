@@ -0,0 +1,41 @@
+#shader vertex
+#version 330 core
+#pragma keywords FALLBACK_MVP FALLBACK_MODEL_VIEW_PROJECTION FALLBACK_INSTANCED
+// drawn in place of a shader that is still compiling. The define picks which transform
+// uniforms the real shader has, so the tests can keep setting theirs
+layout(location = 0) in vec4 position;
+
+#if defined(FALLBACK_INSTANCED)
+layout(location = 4) in mat4 a_Model;
+uniform mat4 view;
+uniform mat4 projection;
+#elif defined(FALLBACK_MODEL_VIEW_PROJECTION)
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+#elif defined(FALLBACK_MVP)
+uniform mat4 u_MVP;
+#endif
+
+void main()
+{
+#if defined(FALLBACK_INSTANCED)
+    gl_Position = projection * view * a_Model * position;
+#elif defined(FALLBACK_MODEL_VIEW_PROJECTION)
+    gl_Position = projection * view * model * position;
+#elif defined(FALLBACK_MVP)
+    gl_Position = u_MVP * position;
+#else
+    gl_Position = position;
+#endif
+}
+
+#shader fragment
+#version 330 core
+
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(0.8, 0.2, 0.8, 1.0);
+}
@@ -0,0 +1,62 @@
+#shader vertex
+#version 330 core
+#pragma keywords INDIRECT
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texcoord;
+
+#ifdef INDIRECT
+// model and color per draw, see IndirectDraw.h
+layout(location = 3) in float a_DrawID; // advances per instance, starts at the command's baseInstance
+uniform int u_DrawIDOffset;             // the draw index when there's no baseInstance
+uniform samplerBuffer u_DrawData;
+flat out vec4 v_Color;
+#else
+uniform mat4 model;
+#endif
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 v_Normal;
+out vec2 v_TexCoord;
+
+void main()
+{
+#ifdef INDIRECT
+	int texel = (int(a_DrawID) + u_DrawIDOffset) * 5;
+	mat4 model = mat4(texelFetch(u_DrawData, texel), texelFetch(u_DrawData, texel + 1),
+	                  texelFetch(u_DrawData, texel + 2), texelFetch(u_DrawData, texel + 3));
+	v_Color = texelFetch(u_DrawData, texel + 4);
+#endif
+	gl_Position = projection * view * model * position;
+	v_Normal = mat3(model) * normal;
+	v_TexCoord = texcoord;
+}
+
+
+#shader fragment
+#version 330 core
+
+layout(location = 0) out vec4 color;
+
+#ifdef INDIRECT
+flat in vec4 v_Color;
+#else
+uniform vec4 u_Color;
+#endif
+uniform vec3 u_LightDir;
+
+in vec3 v_Normal;
+in vec2 v_TexCoord;
+
+void main()
+{
+#ifdef INDIRECT
+	vec4 baseColor = v_Color;
+#else
+	vec4 baseColor = u_Color;
+#endif
+	float diffuse = max(dot(normalize(v_Normal), -u_LightDir), 0.0);
+	color = vec4(baseColor.rgb * (0.2 + 0.8 * diffuse), baseColor.a);
+}
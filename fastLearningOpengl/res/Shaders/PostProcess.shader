@@ -0,0 +1,110 @@
+#shader vertex
+#version 330 core
+#pragma keywords TONEMAP FXAA COLOR_GRADE
+
+#include "include/Fullscreen.glsl"
+
+
+#shader fragment
+#version 330 core
+
+// every full screen pass of PostProcess, one variant per group of fused passes. The variant reads
+// u_Source once per pixel (or the FXAA taps around it) and runs the passes it was built with in
+// chain order, so fused passes never write an intermediate target:
+//   FXAA         antialiasing from the luma edges of u_Source, needs its neighbours: only ever the
+//                first pass of a variant
+//   TONEMAP      u_Exposure, then a filmic curve from HDR to [0, 1]
+//   COLOR_GRADE  contrast around middle grey, saturation and a tint
+// Without any, it's a plain copy: the upscale of a scene rendered at a lower resolution.
+// u_Source is only rendered into its lower left part, u_UvRect says which
+
+layout(location = 0) out vec4 color;
+
+in vec2 v_TexCoord;
+
+uniform sampler2D u_Source;
+uniform vec4 u_UvRect; // xy: the rendered part of u_Source, zw: half a texel inside it, so the filter doesn't reach past
+#ifdef TONEMAP
+uniform float u_Exposure;
+#endif
+#ifdef COLOR_GRADE
+uniform float u_Contrast;
+uniform float u_Saturation;
+uniform vec3 u_Tint;
+#endif
+
+const vec3 LUMA = vec3(0.299, 0.587, 0.114);
+
+vec3 Source(vec2 uv)
+{
+	return texture(u_Source, min(uv, u_UvRect.zw)).rgb;
+}
+
+#ifdef FXAA
+// the compact FXAA (Lottes): the luma of the four diagonal neighbours gives the edge direction,
+// two and four taps along it are blended, the wider blend is dropped if it overshoots the local range
+vec3 Fxaa(vec2 uv)
+{
+	const float REDUCE_MIN = 1.0 / 128.0;
+	const float REDUCE_MUL = 1.0 / 8.0;
+	const float SPAN_MAX = 8.0;
+	vec2 texel = 1.0 / vec2(textureSize(u_Source, 0));
+
+	vec3 rgbM = Source(uv);
+	float lumaNW = dot(Source(uv + vec2(-1.0, -1.0) * texel), LUMA);
+	float lumaNE = dot(Source(uv + vec2(1.0, -1.0) * texel), LUMA);
+	float lumaSW = dot(Source(uv + vec2(-1.0, 1.0) * texel), LUMA);
+	float lumaSE = dot(Source(uv + vec2(1.0, 1.0) * texel), LUMA);
+	float lumaM = dot(rgbM, LUMA);
+	float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+	float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+	// flat areas keep the center, most of the screen stops at five taps
+	if (lumaMax - lumaMin < max(0.0312, lumaMax * 0.125))
+		return rgbM;
+
+	vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+	float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * (0.25 * REDUCE_MUL), REDUCE_MIN);
+	float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+	dir = clamp(dir * rcpDirMin, vec2(-SPAN_MAX), vec2(SPAN_MAX)) * texel;
+
+	vec3 rgbA = 0.5 * (Source(uv + dir * (1.0 / 3.0 - 0.5)) + Source(uv + dir * (2.0 / 3.0 - 0.5)));
+	vec3 rgbB = rgbA * 0.5 + 0.25 * (Source(uv - dir * 0.5) + Source(uv + dir * 0.5));
+	float lumaB = dot(rgbB, LUMA);
+	return (lumaB < lumaMin || lumaB > lumaMax) ? rgbA : rgbB;
+}
+#endif
+
+#ifdef TONEMAP
+// Narkowicz's fit of the ACES curve
+vec3 Tonemap(vec3 rgb)
+{
+	rgb *= u_Exposure;
+	return clamp((rgb * (2.51 * rgb + 0.03)) / (rgb * (2.43 * rgb + 0.59) + 0.14), 0.0, 1.0);
+}
+#endif
+
+#ifdef COLOR_GRADE
+vec3 ColorGrade(vec3 rgb)
+{
+	rgb = (rgb - 0.18) * u_Contrast + 0.18;
+	rgb = mix(vec3(dot(rgb, LUMA)), rgb, u_Saturation);
+	return max(rgb * u_Tint, 0.0);
+}
+#endif
+
+void main()
+{
+	vec2 uv = v_TexCoord * u_UvRect.xy;
+#ifdef FXAA
+	vec3 rgb = Fxaa(uv);
+#else
+	vec3 rgb = Source(uv);
+#endif
+#ifdef TONEMAP
+	rgb = Tonemap(rgb);
+#endif
+#ifdef COLOR_GRADE
+	rgb = ColorGrade(rgb);
+#endif
+	color = vec4(rgb, 1.0);
+}
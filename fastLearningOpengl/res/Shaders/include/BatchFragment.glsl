@@ -0,0 +1,45 @@
+// the fragment stage of every batch shader. The texture source is picked when the variant is
+// built, not per fragment:
+//   NO_TEXTURE     the vertex color only
+//   TEXTURE_ARRAY  layer v_TexIndex of u_TextureArray
+//   (neither)      u_Textures[v_TexIndex], two slots
+// HEAVY_SHADING adds u_ShadingLoops iterations of arithmetic on top, a stand-in for an expensive
+// material so fragment bound scenes can be benchmarked
+
+layout(location = 0) out vec4 color;
+
+in vec4 v_Color;
+in vec2 v_TexCoord;
+in float v_TexIndex;
+
+#if defined(TEXTURE_ARRAY)
+uniform sampler2DArray u_TextureArray;
+#elif !defined(NO_TEXTURE)
+uniform sampler2D u_Textures[2];
+#endif
+#ifdef HEAVY_SHADING
+uniform int u_ShadingLoops;
+#endif
+
+void main()
+{
+#if defined(NO_TEXTURE)
+	color = v_Color;
+#elif defined(TEXTURE_ARRAY)
+	color = texture(u_TextureArray, vec3(v_TexCoord, v_TexIndex));
+#else
+	int index = int(v_TexIndex);
+	// non-constant expressions are forbidden in GLSL 1.30 (GLSL 4.0 supports)
+	//color = texture(u_Textures[index], v_TexCoord);
+	switch (index) {
+	case 0: color = texture(u_Textures[0], v_TexCoord); break;
+	case 1: color = texture(u_Textures[1], v_TexCoord); break;
+	}
+#endif
+#ifdef HEAVY_SHADING
+	vec3 shaded = color.rgb;
+	for (int i = 0; i < u_ShadingLoops; i++)
+		shaded = shaded * 0.99 + sin(shaded * 3.1 + float(i)) * 0.01;
+	color.rgb = shaded;
+#endif
+}
@@ -0,0 +1,17 @@
+// the batch vertex layout, see the Batching tests
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 texcoord;
+layout(location = 2) in vec4 color;
+layout(location = 3) in float texidx;
+
+out     vec4 v_Color;
+out     vec2 v_TexCoord;
+out     float v_TexIndex;
+
+void PassBatchVertex()
+{
+	v_Color = color;
+	v_TexCoord = texcoord;
+	v_TexIndex = texidx;
+}
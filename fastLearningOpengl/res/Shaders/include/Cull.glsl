@@ -0,0 +1,18 @@
+// frustum test of an instance's bounding sphere, shared by both GpuCuller paths.
+// Matches GpuCuller::CullOnCpu, which is the reference for it
+
+uniform vec4 u_FrustumPlanes[6]; // normal pointing inside in xyz, distance in w (normalized)
+uniform vec4 u_LocalSphere;      // center and radius in the instance's object space
+
+bool IsVisible(mat4 model)
+{
+	vec3 center = (model * vec4(u_LocalSphere.xyz, 1.0)).xyz;
+	// the largest axis scale keeps the sphere conservative under non uniform scaling
+	float scale2 = max(max(dot(model[0].xyz, model[0].xyz), dot(model[1].xyz, model[1].xyz)), dot(model[2].xyz, model[2].xyz));
+	float radius = u_LocalSphere.w * sqrt(scale2);
+	for (int plane = 0; plane < 6; plane++) {
+		if (dot(u_FrustumPlanes[plane].xyz, center) + u_FrustumPlanes[plane].w < -radius)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,11 @@
+// the vertex stage of full screen passes, drawn with Renderer::DrawFullscreen: vertices 0, 1, 2 make
+// one triangle through (-1, -1), (3, -1) and (-1, 3), which covers the viewport
+
+out vec2 v_TexCoord;
+
+void main()
+{
+	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	v_TexCoord = corner;
+	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,92 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<std::size_t> s_totalAllocations{0};
+    std::atomic<std::size_t> s_totalBytes{0};
+    std::size_t s_frameStartAllocations = 0;
+    std::size_t s_frameStartBytes = 0;
+    std::size_t s_frameAllocations = 0;
+    std::size_t s_frameBytes = 0;
+}
+
+#ifdef TRACK_ALLOCATIONS
+
+static void* CountedAllocate(std::size_t size, std::size_t alignment = 0)
+{
+    s_totalAllocations.fetch_add(1, std::memory_order_relaxed);
+    s_totalBytes.fetch_add(size, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+    void* ptr = nullptr;
+    if (alignment > alignof(std::max_align_t)) {
+        if (posix_memalign(&ptr, alignment, size) != 0)
+            ptr = nullptr;
+    } else {
+        ptr = std::malloc(size);
+    }
+    return ptr;
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* ptr = CountedAllocate(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size)
+{
+    if (void* ptr = CountedAllocate(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return CountedAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return CountedAllocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void* ptr = CountedAllocate(size, std::size_t(alignment)))
+        return ptr;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    if (void* ptr = CountedAllocate(size, std::size_t(alignment)))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+#endif
+
+namespace AllocationCounter
+{
+    std::size_t GetTotalAllocations() { return s_totalAllocations.load(std::memory_order_relaxed); }
+    std::size_t GetTotalBytes() { return s_totalBytes.load(std::memory_order_relaxed); }
+
+    void BeginFrame()
+    {
+        s_frameStartAllocations = GetTotalAllocations();
+        s_frameStartBytes = GetTotalBytes();
+    }
+
+    void EndFrame()
+    {
+        s_frameAllocations = GetTotalAllocations() - s_frameStartAllocations;
+        s_frameBytes = GetTotalBytes() - s_frameStartBytes;
+    }
+
+    std::size_t GetFrameAllocations() { return s_frameAllocations; }
+    std::size_t GetFrameBytes() { return s_frameBytes; }
+}
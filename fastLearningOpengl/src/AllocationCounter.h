@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// counts global operator new calls when the app is built with TRACK_ALLOCATIONS (Debug builds, or the
+// CMake option).
+// the main loop brackets every frame with BeginFrame/EndFrame; the goal is zero allocations per frame
+// once a test has warmed up. Without TRACK_ALLOCATIONS everything here reads zero
+namespace AllocationCounter
+{
+    constexpr bool IsEnabled()
+    {
+#ifdef TRACK_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    std::size_t GetTotalAllocations(); // since startup, from every thread
+    std::size_t GetTotalBytes();
+
+    void BeginFrame();
+    void EndFrame();
+    std::size_t GetFrameAllocations(); // of the last finished frame
+    std::size_t GetFrameBytes();
+}
@@ -0,0 +1,361 @@
+#include "Allocators.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+static std::size_t AlignUp(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+LinearArena::LinearArena(std::size_t initialSize)
+{
+    m_blocks.reserve(8);
+    m_blocks.push_back({static_cast<unsigned char*>(::operator new(initialSize)), initialSize});
+}
+
+LinearArena::~LinearArena()
+{
+    for (const Block& block : m_blocks)
+        ::operator delete(block.data);
+}
+
+void* LinearArena::Allocate(std::size_t size, std::size_t alignment)
+{
+    assert((alignment & (alignment - 1)) == 0 && "alignment has to be a power of two");
+
+    Block* block = &m_blocks.back();
+    std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block->data);
+    std::size_t start = AlignUp(base + m_offset, alignment) - base;
+    if (start + size > block->size) {
+        // out of space this frame: chain a block, Reset() will fold it into the first one
+        std::size_t blockSize = std::max(block->size * 2, size + alignment);
+        m_blocks.push_back({static_cast<unsigned char*>(::operator new(blockSize)), blockSize});
+        block = &m_blocks.back();
+        base = reinterpret_cast<std::uintptr_t>(block->data);
+        m_offset = 0;
+        start = AlignUp(base, alignment) - base;
+    }
+
+    m_usedThisFrame += start - m_offset + size;
+    m_offset = start + size;
+    return block->data + start;
+}
+
+void LinearArena::Reset()
+{
+    m_highWater = std::max(m_highWater, m_usedThisFrame);
+    if (m_blocks.size() > 1) {
+        // one block that fits the busiest frame so far
+        std::size_t total = 0;
+        for (const Block& block : m_blocks) {
+            total += block.size;
+            ::operator delete(block.data);
+        }
+        m_blocks.clear();
+        m_blocks.push_back({static_cast<unsigned char*>(::operator new(total)), total});
+    }
+    m_offset = 0;
+    m_usedThisFrame = 0;
+}
+
+PoolAllocator::PoolAllocator(std::size_t blockSize, std::size_t blocksPerChunk)
+    : m_blockSize(AlignUp(std::max(blockSize, sizeof(FreeBlock)), alignof(std::max_align_t))),
+      m_blocksPerChunk(blocksPerChunk)
+{
+}
+
+PoolAllocator::~PoolAllocator()
+{
+    assert(m_liveBlocks == 0 && "pool destroyed with blocks still in use");
+    for (unsigned char* chunk : m_chunks)
+        ::operator delete(chunk);
+}
+
+void PoolAllocator::Grow()
+{
+    auto* chunk = static_cast<unsigned char*>(::operator new(m_blockSize * m_blocksPerChunk));
+    m_chunks.push_back(chunk);
+    // thread the new blocks onto the free list, lowest address first
+    for (std::size_t i = m_blocksPerChunk; i-- > 0;) {
+        auto* block = reinterpret_cast<FreeBlock*>(chunk + i * m_blockSize);
+        block->next = m_freeList;
+        m_freeList = block;
+    }
+}
+
+void* PoolAllocator::Allocate()
+{
+    if (!m_freeList)
+        Grow();
+    FreeBlock* block = m_freeList;
+    m_freeList = block->next;
+    m_liveBlocks++;
+    return block;
+}
+
+void PoolAllocator::Free(void* block)
+{
+    if (!block)
+        return;
+    auto* freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = m_freeList;
+    m_freeList = freeBlock;
+    m_liveBlocks--;
+}
+
+namespace FrameAllocator
+{
+    LinearArena& Get()
+    {
+        static LinearArena arena(1024 * 1024);
+        return arena;
+    }
+}
+
+namespace
+{
+    unsigned int HighestBit(std::uint32_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse(&index, value);
+        return unsigned(index);
+#else
+        return 31u - unsigned(__builtin_clz(value));
+#endif
+    }
+
+    unsigned int LowestBit(std::uint32_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return unsigned(index);
+#else
+        return unsigned(__builtin_ctz(value));
+#endif
+    }
+}
+
+TlsfAllocator::TlsfAllocator(std::uint32_t size)
+{
+    Reset(size);
+}
+
+void TlsfAllocator::Mapping(std::uint32_t size, unsigned int& fl, unsigned int& sl)
+{
+    // sizes under SL_COUNT get a class each, above that a power of two is split into SL_COUNT classes
+    if (size < SL_COUNT) {
+        fl = 0;
+        sl = size;
+    } else {
+        unsigned int msb = HighestBit(size);
+        fl = msb - SL_LOG + 1;
+        sl = (size >> (msb - SL_LOG)) - SL_COUNT;
+    }
+}
+
+std::int32_t TlsfAllocator::NewBlock(std::uint32_t offset, std::uint32_t size)
+{
+    std::int32_t index;
+    if (!m_unusedBlocks.empty()) {
+        index = m_unusedBlocks.back();
+        m_unusedBlocks.pop_back();
+    } else {
+        index = std::int32_t(m_blocks.size());
+        m_blocks.emplace_back();
+    }
+    m_blocks[index] = {offset, size, NONE, NONE, NONE, NONE, false};
+    return index;
+}
+
+void TlsfAllocator::InsertFree(std::int32_t block)
+{
+    Block& b = m_blocks[block];
+    unsigned int fl, sl;
+    Mapping(b.size, fl, sl);
+    b.free = true;
+    b.prevFree = NONE;
+    b.nextFree = m_freeHeads[fl][sl];
+    if (b.nextFree != NONE)
+        m_blocks[b.nextFree].prevFree = block;
+    m_freeHeads[fl][sl] = block;
+    m_flBitmap |= 1u << fl;
+    m_slBitmaps[fl] |= 1u << sl;
+    m_freeBlockCount++;
+}
+
+void TlsfAllocator::RemoveFree(std::int32_t block)
+{
+    Block& b = m_blocks[block];
+    unsigned int fl, sl;
+    Mapping(b.size, fl, sl);
+    if (b.prevFree != NONE)
+        m_blocks[b.prevFree].nextFree = b.nextFree;
+    else
+        m_freeHeads[fl][sl] = b.nextFree;
+    if (b.nextFree != NONE)
+        m_blocks[b.nextFree].prevFree = b.prevFree;
+    if (m_freeHeads[fl][sl] == NONE) {
+        m_slBitmaps[fl] &= ~(1u << sl);
+        if (m_slBitmaps[fl] == 0)
+            m_flBitmap &= ~(1u << fl);
+    }
+    b.free = false;
+    m_freeBlockCount--;
+}
+
+std::int32_t TlsfAllocator::FindFree(std::uint32_t size) const
+{
+    // rounded up to the next class, so any block of the class found is big enough
+    std::uint32_t rounded = size;
+    if (size >= SL_COUNT) {
+        std::uint32_t round = (1u << (HighestBit(size) - SL_LOG)) - 1;
+        rounded = size > 0xFFFFFFFFu - round ? 0xFFFFFFFFu : size + round;
+    }
+    unsigned int fl, sl;
+    Mapping(rounded, fl, sl);
+    std::uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+    if (slMap == 0) {
+        std::uint32_t flMap = fl + 1 < FL_COUNT ? m_flBitmap & (~0u << (fl + 1)) : 0;
+        if (flMap != 0) {
+            fl = LowestBit(flMap);
+            slMap = m_slBitmaps[fl];
+        }
+    }
+    if (slMap != 0)
+        return m_freeHeads[fl][LowestBit(slMap)];
+
+    // nothing in the bigger classes, but the request's own class may still hold a block that fits
+    // (an almost full range, or Defragment packing everything back to back)
+    Mapping(size, fl, sl);
+    for (std::int32_t block = m_freeHeads[fl][sl]; block != NONE; block = m_blocks[block].nextFree) {
+        if (m_blocks[block].size >= size)
+            return block;
+    }
+    return NONE;
+}
+
+TlsfAllocator::Allocation TlsfAllocator::Allocate(std::uint32_t size)
+{
+    size = std::max(size, 1u);
+    std::int32_t block = FindFree(size);
+    if (block == NONE)
+        return {};
+    RemoveFree(block);
+
+    // the rest of the block stays free as its own block
+    if (m_blocks[block].size > size) {
+        std::int32_t rest = NewBlock(m_blocks[block].offset + size, m_blocks[block].size - size);
+        Block& b = m_blocks[block];
+        Block& r = m_blocks[rest];
+        r.prevPhysical = block;
+        r.nextPhysical = b.nextPhysical;
+        if (b.nextPhysical != NONE)
+            m_blocks[b.nextPhysical].prevPhysical = rest;
+        else
+            m_lastBlock = rest;
+        b.nextPhysical = rest;
+        b.size = size;
+        InsertFree(rest);
+    }
+    m_used += size;
+    m_allocationCount++;
+    return {m_blocks[block].offset, std::uint32_t(block)};
+}
+
+void TlsfAllocator::Free(const Allocation& allocation)
+{
+    if (!allocation.IsValid())
+        return;
+    std::int32_t block = std::int32_t(allocation.block);
+    assert(!m_blocks[block].free && m_blocks[block].offset == allocation.offset);
+    m_used -= m_blocks[block].size;
+    m_allocationCount--;
+
+    // merge with the free neighbours, the survivor is always the lower one
+    std::int32_t next = m_blocks[block].nextPhysical;
+    if (next != NONE && m_blocks[next].free) {
+        RemoveFree(next);
+        m_blocks[block].size += m_blocks[next].size;
+        m_blocks[block].nextPhysical = m_blocks[next].nextPhysical;
+        if (m_blocks[next].nextPhysical != NONE)
+            m_blocks[m_blocks[next].nextPhysical].prevPhysical = block;
+        else
+            m_lastBlock = block;
+        m_unusedBlocks.push_back(next);
+    }
+    std::int32_t previous = m_blocks[block].prevPhysical;
+    if (previous != NONE && m_blocks[previous].free) {
+        RemoveFree(previous);
+        m_blocks[previous].size += m_blocks[block].size;
+        m_blocks[previous].nextPhysical = m_blocks[block].nextPhysical;
+        if (m_blocks[block].nextPhysical != NONE)
+            m_blocks[m_blocks[block].nextPhysical].prevPhysical = previous;
+        else
+            m_lastBlock = previous;
+        m_unusedBlocks.push_back(block);
+        block = previous;
+    }
+    InsertFree(block);
+}
+
+void TlsfAllocator::Grow(std::uint32_t newSize)
+{
+    if (newSize <= m_size)
+        return;
+    std::uint32_t extra = newSize - m_size;
+    if (m_lastBlock != NONE && m_blocks[m_lastBlock].free) {
+        RemoveFree(m_lastBlock);
+        m_blocks[m_lastBlock].size += extra;
+        InsertFree(m_lastBlock);
+    } else {
+        std::int32_t block = NewBlock(m_size, extra);
+        m_blocks[block].prevPhysical = m_lastBlock;
+        if (m_lastBlock != NONE)
+            m_blocks[m_lastBlock].nextPhysical = block;
+        m_lastBlock = block;
+        InsertFree(block);
+    }
+    m_size = newSize;
+}
+
+void TlsfAllocator::Reset(std::uint32_t size)
+{
+    m_blocks.clear();
+    m_unusedBlocks.clear();
+    m_flBitmap = 0;
+    std::fill(std::begin(m_slBitmaps), std::end(m_slBitmaps), 0u);
+    for (auto& heads : m_freeHeads)
+        std::fill(std::begin(heads), std::end(heads), NONE);
+    m_lastBlock = NONE;
+    m_size = 0;
+    m_used = 0;
+    m_freeBlockCount = 0;
+    m_allocationCount = 0;
+    Grow(size);
+}
+
+std::uint32_t TlsfAllocator::GetLargestFree() const
+{
+    if (m_flBitmap == 0)
+        return 0;
+    // every block of the highest non-empty class beats all the others, only that list is searched
+    unsigned int fl = HighestBit(m_flBitmap);
+    unsigned int sl = HighestBit(m_slBitmaps[fl]);
+    std::uint32_t largest = 0;
+    for (std::int32_t block = m_freeHeads[fl][sl]; block != NONE; block = m_blocks[block].nextFree)
+        largest = std::max(largest, m_blocks[block].size);
+    return largest;
+}
+
+float TlsfAllocator::GetFragmentation() const
+{
+    std::uint32_t free = GetFree();
+    return free == 0 ? 0.0f : 1.0f - float(GetLargestFree()) / float(free);
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// bump allocator: allocation is a pointer increment, everything is released at once by Reset().
+// if a frame needs more than the current block, extra blocks are chained and on the next Reset
+// they are merged into one block big enough for the whole frame, so steady state never touches the heap
+class LinearArena
+{
+private:
+    struct Block
+    {
+        unsigned char* data;
+        std::size_t size;
+    };
+
+    std::vector<Block> m_blocks; // the last one is the one being filled
+    std::size_t m_offset = 0;
+    std::size_t m_usedThisFrame = 0;
+    std::size_t m_highWater = 0;
+
+public:
+    LinearArena(std::size_t initialSize);
+    ~LinearArena();
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+    void Reset();
+
+    inline std::size_t GetCapacity() const { return m_blocks.empty() ? 0 : m_blocks.front().size; }
+    inline std::size_t GetUsed() const { return m_usedThisFrame; }
+    inline std::size_t GetHighWater() const { return m_highWater; }
+};
+
+// fixed size blocks with an intrusive free list, grows a chunk at a time and never gives memory back
+class PoolAllocator
+{
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    std::size_t m_blockSize;
+    std::size_t m_blocksPerChunk;
+    std::vector<unsigned char*> m_chunks;
+    FreeBlock* m_freeList = nullptr;
+    std::size_t m_liveBlocks = 0;
+
+    void Grow();
+
+public:
+    PoolAllocator(std::size_t blockSize, std::size_t blocksPerChunk = 256);
+    ~PoolAllocator();
+    PoolAllocator(const PoolAllocator&) = delete;
+    PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+    void* Allocate();
+    void Free(void* block);
+
+    inline std::size_t GetBlockSize() const { return m_blockSize; }
+    inline std::size_t GetLiveBlocks() const { return m_liveBlocks; }
+    inline std::size_t GetCapacity() const { return m_chunks.size() * m_blocksPerChunk; }
+};
+
+// two level segregated fit over a range of units (bytes, vertices, indices...). It never touches the
+// range itself, so it can hand out pieces of a GPU buffer. Free blocks sit in lists per size class,
+// 16 classes per power of two, and two levels of bitmaps find a big enough one without searching:
+// Allocate and Free are O(1), neighbours are merged on Free
+class TlsfAllocator
+{
+public:
+    static constexpr std::uint32_t InvalidOffset = 0xFFFFFFFFu;
+
+    struct Allocation
+    {
+        std::uint32_t offset = InvalidOffset;
+        std::uint32_t block = 0; // what Free needs, stays valid until then
+        inline bool IsValid() const { return offset != InvalidOffset; }
+    };
+
+private:
+    static constexpr unsigned int SL_LOG = 4;
+    static constexpr unsigned int SL_COUNT = 1u << SL_LOG;
+    static constexpr unsigned int FL_COUNT = 32 - SL_LOG + 1;
+    static constexpr std::int32_t NONE = -1;
+
+    struct Block
+    {
+        std::uint32_t offset;
+        std::uint32_t size;
+        std::int32_t prevPhysical; // neighbours in the range
+        std::int32_t nextPhysical;
+        std::int32_t prevFree;     // neighbours in the size class list
+        std::int32_t nextFree;
+        bool free;
+    };
+
+    std::vector<Block> m_blocks;
+    std::vector<std::int32_t> m_unusedBlocks; // recycled entries of m_blocks
+    std::uint32_t m_flBitmap = 0;
+    std::uint32_t m_slBitmaps[FL_COUNT] = {};
+    std::int32_t m_freeHeads[FL_COUNT][SL_COUNT];
+    std::int32_t m_lastBlock = NONE; // the one ending the range, Grow extends it
+    std::uint32_t m_size = 0;
+    std::uint32_t m_used = 0;
+    std::uint32_t m_freeBlockCount = 0;
+    std::uint32_t m_allocationCount = 0;
+
+    static void Mapping(std::uint32_t size, unsigned int& fl, unsigned int& sl);
+    std::int32_t NewBlock(std::uint32_t offset, std::uint32_t size);
+    void InsertFree(std::int32_t block);
+    void RemoveFree(std::int32_t block);
+    std::int32_t FindFree(std::uint32_t size) const;
+
+public:
+    explicit TlsfAllocator(std::uint32_t size = 0);
+
+    // InvalidOffset if no free block is big enough
+    Allocation Allocate(std::uint32_t size);
+    void Free(const Allocation& allocation);
+    // more room at the end, allocations stay where they are
+    void Grow(std::uint32_t newSize);
+    // everything free again, as one block of size
+    void Reset(std::uint32_t size);
+
+    inline std::uint32_t GetAllocationSize(const Allocation& allocation) const { return m_blocks[allocation.block].size; }
+    inline std::uint32_t GetSize() const { return m_size; }
+    inline std::uint32_t GetUsed() const { return m_used; }
+    inline std::uint32_t GetFree() const { return m_size - m_used; }
+    inline std::uint32_t GetFreeBlockCount() const { return m_freeBlockCount; }
+    inline std::uint32_t GetAllocationCount() const { return m_allocationCount; }
+    std::uint32_t GetLargestFree() const;
+    // 0 when all free space is one block, towards 1 the more it's scattered
+    float GetFragmentation() const;
+};
+
+// STL adapter for LinearArena, deallocate is a no-op (memory comes back on Reset)
+template<typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    LinearArena* arena;
+
+    ArenaAllocator(LinearArena& a) noexcept : arena(&a) {}
+    template<typename U> ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(arena->Allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, std::size_t) noexcept {}
+
+    template<typename U> bool operator==(const ArenaAllocator<U>& other) const noexcept { return arena == other.arena; }
+    template<typename U> bool operator!=(const ArenaAllocator<U>& other) const noexcept { return arena != other.arena; }
+};
+
+// STL adapter for PoolAllocator, meant for node based containers (list, map, set) where every
+// allocation is a single node. Bulk allocations fall back to the global heap
+template<typename T>
+class PoolStlAllocator
+{
+public:
+    using value_type = T;
+
+    PoolAllocator* pool;
+
+    PoolStlAllocator(PoolAllocator& p) noexcept : pool(&p) {}
+    template<typename U> PoolStlAllocator(const PoolStlAllocator<U>& other) noexcept : pool(other.pool) {}
+
+    T* allocate(std::size_t n)
+    {
+        if (n == 1 && sizeof(T) <= pool->GetBlockSize() && alignof(T) <= alignof(std::max_align_t))
+            return static_cast<T*>(pool->Allocate());
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        if (n == 1 && sizeof(T) <= pool->GetBlockSize() && alignof(T) <= alignof(std::max_align_t))
+            pool->Free(p);
+        else
+            ::operator delete(p);
+    }
+
+    template<typename U> bool operator==(const PoolStlAllocator<U>& other) const noexcept { return pool == other.pool; }
+    template<typename U> bool operator!=(const PoolStlAllocator<U>& other) const noexcept { return pool != other.pool; }
+};
+
+// per frame scratch memory of the render thread, reset by the main loop after every frame.
+// anything allocated from it must not outlive the frame and it must not be used from other threads
+namespace FrameAllocator
+{
+    LinearArena& Get();
+    inline void Reset() { Get().Reset(); }
+}
+
+template<typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+// empty vector backed by the frame arena
+template<typename T>
+inline FrameVector<T> MakeFrameVector(std::size_t reserve = 0)
+{
+    FrameVector<T> vector{ArenaAllocator<T>(FrameAllocator::Get())};
+    vector.reserve(reserve);
+    return vector;
+}
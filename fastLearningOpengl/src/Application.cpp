@@ -1,10 +1,27 @@
 #include <iostream>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <chrono>
+#include <memory>
 #include <string>
+#include <vector>
 
 #define IMGUI_IMPL_OPENGL_LOADER_GLAD
 #include "Renderer.h"
+#include "Allocators.h"
+#include "AllocationCounter.h"
+#include "ProgramCache.h"
+#include "ShaderLibrary.h"
+#include "ShaderCompiler.h"
+#include "ShaderPreprocessor.h"
+#include "UploadQueue.h"
+#include "IndirectDraw.h"
+#include "FrameClock.h"
+#include "FramePacer.h"
+#include "Input.h"
+#include "DynamicResolution.h"
+#include "PostProcess.h"
+#include "RenderTargetPool.h"
 #define DEBUG
 
 #include "imgui/imgui.h"
@@ -17,18 +34,18 @@
 #include "tests/TestBatchingDynamic.h"
 #include "tests/TestBatchingDynamic3D.h"
 #include "tests/TestCamera.h" // Added for TestCameraSuite
-
-float g_deltaTime = 0.0f; // Time between current frame and last frame
-float g_lastFrame = 0.0f; // Time of last frame
+#include "tests/TestMesh.h"
+#include "tests/TestJobSystem.h"
+#include "tests/TestTransforms.h"
+#include "tests/TestMeshPool.h"
+#include "tests/TestRenderGraph.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-// Modified processInput to pass key directly
-void processInput(GLFWwindow *window, test::Test* currentTest, float deltaTime);
 
 int main(){
 
     glfwInit();
-    glfwWindowHint(GLFW_SAMPLES, 4); // 4x antialiasing (MSAA)
+    // no multisampled window: the scene renders offscreen, antialiasing is PostProcess's (MSAA 4x or FXAA)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -46,7 +63,6 @@ int main(){
     // make the window's context current
     glfwMakeContextCurrent(window);
 
-    glfwSwapInterval(1); // enable vsync
     #ifdef __APPLE__
         gladLoadGL();
     #else
@@ -59,6 +75,8 @@ int main(){
         return -1;
     }
     glCall(glViewport(0, 0, 960, 540));
+    // vsync, and at most 2 frames queued ahead of the GPU
+    Pacing::Get().Initialize(window);
     glfwSetFramebufferSizeCallback(window,framebuffer_size_callback);
 
     // tools version
@@ -68,6 +86,43 @@ int main(){
     std::cout << "GPU: " << glGetString(GL_VENDOR) << std::endl;
 
 
+    ShaderCompiler::Initialize(window);
+
+    // every shader the tests use, submitted together so the compiles overlap instead of each test
+    // paying for its own when it opens. The defines give the fallback the same transform uniforms
+    struct ShaderWarmup
+    {
+        const char* path;
+        std::vector<std::string> defines;
+        std::vector<std::string> fallbackDefines;
+    };
+    const ShaderWarmup shaderWarmup[] = {
+        {"res/Shaders/BasicLegacy.shader", {}, {}},
+        {"res/Shaders/BatchColor.shader", {}, {"FALLBACK_MVP"}},
+        {"res/Shaders/BatchColor3D.shader", {}, {"FALLBACK_MODEL_VIEW_PROJECTION"}},
+        {"res/Shaders/BatchColor3D.shader", {"INSTANCED"}, {"FALLBACK_INSTANCED"}},
+        {"res/Shaders/BatchColor3D.shader", {"DEPTH_ONLY"}, {}},
+        {"res/Shaders/Mesh.shader", {}, {"FALLBACK_MODEL_VIEW_PROJECTION"}},
+        {"res/Shaders/Mesh.shader", {"INDIRECT"}, {}},
+        {"res/Shaders/PostProcess.shader", {}, {}},
+        {"res/Shaders/PostProcess.shader", {"FXAA"}, {}},
+    };
+    // edits under res/Shaders are recompiled in the background and swapped in while the app runs.
+    // The app runs on the copy of res next to it, so the build passes in the directory that's edited
+#ifdef SHADER_SOURCE_DIR
+    Shaders::Get().EnableHotReload("res/Shaders", SHADER_SOURCE_DIR);
+#else
+    Shaders::Get().EnableHotReload("res/Shaders");
+#endif
+    auto warmupStart = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<Shader>> warmupShaders;
+    for (const ShaderWarmup& warmup : shaderWarmup)
+        warmupShaders.push_back(Shaders::Get().GetAsync(warmup.path, warmup.defines, warmup.fallbackDefines));
+    const double warmupSubmitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - warmupStart).count();
+    double warmupReadyMs = 0.0;
+    const std::size_t warmupCount = warmupShaders.size();
+
+
     glCall(glEnable(GL_BLEND));
     glCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
 
@@ -82,6 +137,8 @@ int main(){
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
     // io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;         // IF using Docking Branch
 
+    // first, ImGui's callbacks chain to the input system's
+    Input::Get().Install(window);
     // Setup Platform/Renderer backends
     ImGui_ImplGlfw_InitForOpenGL(window, true);          // Second param install_callback=true will install GLFW callbacks and chain to existing ones.
     ImGui_ImplOpenGL3_Init(nullptr);
@@ -98,6 +155,11 @@ int main(){
 
 
 
+    // the tests draw into its scene target, it finishes the frame into the window
+    auto postProcess = std::make_unique<PostProcess>();
+    // on: the scene renders at a scale picked from the GPU time
+    std::unique_ptr<DynamicResolution> dynamicResolution;
+
     test::Test* currentTest = nullptr;
     test::TestMenu* testMenu = new test::TestMenu(currentTest);
     currentTest = testMenu;
@@ -108,17 +170,50 @@ int main(){
     testMenu->RegisterTest<test::BatchingDynamic>("Batching Dynamic");
     testMenu->RegisterTest<test::BatchingDynamic3D>("Batching Dynamic 3D");
     testMenu->RegisterTest<test::TestCameraSuite>("Camera Test Suite");
+    testMenu->RegisterTest<test::TestMesh>("Mesh Loading");
+    testMenu->RegisterTest<test::TestJobSystem>("Job System");
+    testMenu->RegisterTest<test::TestTransforms>("SIMD Transforms");
+    testMenu->RegisterTest<test::TestMeshPool>("Mesh Pool");
+    testMenu->RegisterTest<test::TestRenderGraph>("Render Graph");
 
 
     // render loops
     while(!glfwWindowShouldClose(window)){
-        // Calculate delta time for consistent movement speed
-        float currentFrame = static_cast<float>(glfwGetTime());
-        g_deltaTime = currentFrame - g_lastFrame;
-        g_lastFrame = currentFrame;
+        // waits out the frames in flight first, so the input polled next is as fresh as it can be
+        FramePacer& pacer = Pacing::Get();
+        pacer.BeginFrame();
+        glfwPollEvents();
+        pacer.MarkInput();
 
-        // Pass currentTest and deltaTime to processInput
-        processInput(window, currentTest, g_deltaTime); 
+        AllocationCounter::BeginFrame();
+        RenderTargets::Get().BeginFrame();
+        Shaders::Get().Update();
+
+        if (!warmupShaders.empty()) {
+            bool finished = true;
+            for (const std::shared_ptr<Shader>& shader : warmupShaders) {
+                shader->IsReady(); // polls, a failed one stops being pending too
+                finished = finished && !shader->IsPending();
+            }
+            if (finished) {
+                warmupReadyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - warmupStart).count();
+                std::cout << "Info (SHADER COMPILER): " << warmupCount << " shaders ready after " << warmupReadyMs << " ms" << std::endl;
+                // parked in the library until a test picks them up
+                warmupShaders.clear();
+            }
+        }
+
+        // the only place the time advances, tests read it from the clock
+        FrameClock& clock = Time::Get();
+        const unsigned int steps = clock.BeginFrame();
+
+        // what the callbacks queued during glfwPollEvents, as events: nothing polls key state
+        Input::Get().Dispatch([&](const InputEvent& event) {
+            if (event.action == InputAction::Quit && event.pressed)
+                glfwSetWindowShouldClose(window, true);
+            else if (currentTest)
+                currentTest->OnEvent(event);
+        });
         
         glCall(glClearColor(0.1f, 0.1f, 0.1f, 1.0f));
 
@@ -131,8 +226,19 @@ int main(){
         // ImGui::ShowDemoWindow(); 
 
         if (currentTest){
-            currentTest->OnUpdate(g_deltaTime); // Pass delta time to current test's OnUpdate
+            // the simulation catches up in fixed steps, the rest runs once per frame and interpolates
+            for (unsigned int step = 0; step < steps; step++)
+                currentTest->OnFixedUpdate(clock.GetStep());
+            currentTest->OnUpdate(clock.GetFrameDelta()); // Pass delta time to current test's OnUpdate
+            // whatever the test queued goes up within the budget, before anything draws with it
+            Uploads::Get().Execute();
+            int windowWidth = 0, windowHeight = 0;
+            glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
+            postProcess->BeginScene(windowWidth, windowHeight, dynamicResolution ? dynamicResolution->GetScale() : 1.0f);
             currentTest->OnRender();
+            postProcess->EndScene(renderer);
+            if (dynamicResolution)
+                dynamicResolution->Update(pacer.GetStats().gpuFrameMs);
             ImGui::Begin("Tests");
             if (currentTest != testMenu){
                 if (ImGui::Button("<-")){
@@ -142,6 +248,68 @@ int main(){
             }
             currentTest->OnImGuiRender();
             ImGui::End();
+
+            // everything that isn't the test's: each subsystem draws its own section
+            ImGui::Begin("Settings");
+            if (ImGui::CollapsingHeader("Memory")) {
+                if (AllocationCounter::IsEnabled())
+                    ImGui::Text("Heap allocations last frame: %zu (%zu bytes)", AllocationCounter::GetFrameAllocations(), AllocationCounter::GetFrameBytes());
+                ImGui::Text("Frame arena: %zu / %zu KB, peak %zu KB", FrameAllocator::Get().GetUsed() / 1024,
+                            FrameAllocator::Get().GetCapacity() / 1024, FrameAllocator::Get().GetHighWater() / 1024);
+            }
+            if (ImGui::CollapsingHeader("Shaders")) {
+                const ProgramCacheStats& shaderStats = ProgramCache::GetStats();
+                ImGui::Text("Shader loads: %u warm (%.2f ms avg), %u cold (%.2f ms avg)", shaderStats.warmLoads,
+                            shaderStats.warmLoads ? shaderStats.warmMs / shaderStats.warmLoads : 0.0, shaderStats.coldLoads,
+                            shaderStats.coldLoads ? shaderStats.coldMs / shaderStats.coldLoads : 0.0);
+                if (ProgramCache::IsAvailable()) {
+                    bool cacheEnabled = ProgramCache::IsEnabled();
+                    if (ImGui::Checkbox("Program binary cache", &cacheEnabled))
+                        ProgramCache::SetEnabled(cacheEnabled);
+                    ImGui::SameLine();
+                    if (ImGui::Button("Clear cache"))
+                        ProgramCache::Clear();
+                } else {
+                    ImGui::Text("Program binary cache: not supported by the driver");
+                }
+                const ShaderLibraryStats& libraryStats = Shaders::Get().GetStats();
+                if (warmupShaders.empty())
+                    ImGui::Text("Shader warmup: %zu submitted in %.2f ms, all ready after %.1f ms (%s)", warmupCount, warmupSubmitMs,
+                                warmupReadyMs, ShaderCompiler::GetModeName());
+                else
+                    ImGui::Text("Shader warmup: %zu submitted in %.2f ms, compiling (%s)", warmupCount, warmupSubmitMs,
+                                ShaderCompiler::GetModeName());
+                ImGui::Text("Shader library: %zu in use, %zu / %zu released kept, %u hits, %u misses", Shaders::Get().GetLiveCount(),
+                            Shaders::Get().GetCachedCount(), Shaders::Get().GetCacheCapacity(), libraryStats.hits, libraryStats.misses);
+                if (Shaders::Get().IsHotReloading())
+                    ImGui::Text("Shader hot reload: on, %u programs reloaded", libraryStats.reloads);
+                const ShaderPreprocessorStats preprocessorStats = ShaderPreprocessor::GetStats();
+                ImGui::Text("Shader preprocessor: %u expanded (%.2f ms), %u from cache", preprocessorStats.misses, preprocessorStats.expandMs,
+                            preprocessorStats.hits);
+            }
+            if (ImGui::CollapsingHeader("Uploads"))
+                Uploads::Get().DrawImGui();
+            if (ImGui::CollapsingHeader("Frame pacing"))
+                pacer.DrawImGui();
+            if (ImGui::CollapsingHeader("Time and input")) {
+                clock.DrawImGui();
+                const InputStats& inputStats = Input::Get().GetStats();
+                ImGui::Text("Input: %u events last frame, queued up to %.2f ms, %u dropped", inputStats.events, inputStats.maxDelayMs,
+                            inputStats.dropped);
+            }
+            if (ImGui::CollapsingHeader("Resolution and post processing")) {
+                bool dynamicEnabled = dynamicResolution != nullptr;
+                if (ImGui::Checkbox("Dynamic resolution", &dynamicEnabled)) {
+                    if (dynamicEnabled)
+                        dynamicResolution = std::make_unique<DynamicResolution>();
+                    else
+                        dynamicResolution.reset();
+                }
+                if (dynamicResolution)
+                    dynamicResolution->DrawImGui();
+                postProcess->DrawImGui();
+            }
+            ImGui::End();
         } else {
             ImGui::Begin("Tests");
             ImGui::Text("No test selected");
@@ -152,11 +320,31 @@ int main(){
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        pacer.EndFrame();
+        pacer.Present();
+
+        // everything allocated from the frame arena this frame is released here
+        FrameAllocator::Reset();
+        AllocationCounter::EndFrame();
     }
 
 
+    // the tests hold their shaders through the library, both go before the context does
+    if (currentTest != testMenu)
+        delete currentTest;
+    delete testMenu;
+    postProcess.reset();
+    dynamicResolution.reset();
+    warmupShaders.clear();
+    Shaders::Get().Clear();
+    Uploads::Get().Release();
+    IndirectDraw::Release();
+    RenderTargets::Get().Release();
+    Renderer::ReleaseShared();
+    Pacing::Get().Release();
+    // after the library, a shader deleted mid compile leaves its program to the compiler thread
+    ShaderCompiler::Shutdown();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -168,28 +356,3 @@ int main(){
 void framebuffer_size_callback(GLFWwindow* window, int width, int height){
     glCall(glViewport(0,0,width,height));
 }
-
-// Modified processInput to accept currentTest and deltaTime
-// It will now call TestCameraSuite::ProcessKeyboard if appropriate
-void processInput(GLFWwindow *window, test::Test* currentTest, float deltaTime) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, true);
-    }
-
-    if (auto* cameraTest = dynamic_cast<test::TestCameraSuite*>(currentTest)) {
-        // Define a lambda to check and process each key
-        auto handle_key = [&](int key) {
-            if (glfwGetKey(window, key) == GLFW_PRESS) {
-                cameraTest->ProcessKeyboard(key, deltaTime);
-            }
-        };
-
-        handle_key(GLFW_KEY_W);
-        handle_key(GLFW_KEY_S);
-        handle_key(GLFW_KEY_A);
-        handle_key(GLFW_KEY_D);
-        handle_key(GLFW_KEY_SPACE);      // For moving up
-        handle_key(GLFW_KEY_LEFT_SHIFT); // For moving down
-        // Add other keys if TestCameraSuite::ProcessKeyboard handles them
-    }
-}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "BatchBuilder.h"
+
+#include "JobSystem.h"
+#include "Renderer.h"
+#include "VertexBufferLayout.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // below this many sprites per partition the job overhead isn't worth it
+    constexpr unsigned int MinSpritesPerPartition = 1024;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    unsigned int CountVisible(const Sprite* sprites, unsigned int begin, unsigned int end, const glm::vec4& cullRect,
+                              std::uint8_t* visible)
+    {
+        unsigned int count = 0;
+        for (unsigned int i = begin; i < end; i++) {
+            const Sprite& sprite = sprites[i];
+            float radius = sprite.size * 0.70711f; // bounding circle of the rotated quad
+            bool inside = sprite.color[3] > 0.0f &&
+                          sprite.position[0] + radius >= cullRect.x && sprite.position[0] - radius <= cullRect.z &&
+                          sprite.position[1] + radius >= cullRect.y && sprite.position[1] - radius <= cullRect.w;
+            visible[i] = inside;
+            count += inside;
+        }
+        return count;
+    }
+
+    // writes at most maxQuads quads, returns how many were written
+    unsigned int WriteQuads(const Sprite* sprites, unsigned int begin, unsigned int end, const std::uint8_t* visible,
+                            BatchVertex* out, unsigned int maxQuads)
+    {
+        static const float corners[4][2] = {{-0.5f, -0.5f}, {0.5f, -0.5f}, {0.5f, 0.5f}, {-0.5f, 0.5f}};
+        unsigned int written = 0;
+        for (unsigned int i = begin; i < end && written < maxQuads; i++) {
+            if (!visible[i])
+                continue;
+            const Sprite& sprite = sprites[i];
+            float c = std::cos(sprite.rotation) * sprite.size;
+            float s = std::sin(sprite.rotation) * sprite.size;
+            // build every vertex in full before storing it, the mapped memory is write-combined
+            for (int corner = 0; corner < 4; corner++) {
+                BatchVertex vertex;
+                vertex.position[0] = sprite.position[0] + corners[corner][0] * c - corners[corner][1] * s;
+                vertex.position[1] = sprite.position[1] + corners[corner][0] * s + corners[corner][1] * c;
+                vertex.position[2] = 0.0f;
+                vertex.texCoords[0] = corners[corner][0] + 0.5f;
+                vertex.texCoords[1] = corners[corner][1] + 0.5f;
+                std::copy(sprite.color, sprite.color + 4, vertex.color);
+                vertex.textureID = sprite.textureID;
+                out[written * 4 + corner] = vertex;
+            }
+            written++;
+        }
+        return written;
+    }
+}
+
+BatchBuilder::BatchBuilder(unsigned int maxQuads)
+    : m_maxQuads(maxQuads)
+{
+    m_vao = std::make_unique<VertexArray>();
+    m_vao->Bind();
+    m_vertexBuffer = std::make_unique<VertexBuffer>(nullptr, unsigned(maxQuads * 4 * sizeof(BatchVertex)), true);
+
+    VertexBufferLayout layout;
+    layout.Push<float>(3); // position
+    layout.Push<float>(2); // texture coordinates
+    layout.Push<float>(4); // color
+    layout.Push<float>(1); // texture id
+    m_vao->AddBuffer(*m_vertexBuffer, layout);
+
+    std::vector<unsigned int> indices(std::size_t(maxQuads) * 6);
+    for (unsigned int quad = 0; quad < maxQuads; quad++) {
+        const unsigned int base = quad * 4;
+        const unsigned int pattern[6] = {base, base + 1, base + 2, base + 2, base + 3, base};
+        std::copy(pattern, pattern + 6, indices.begin() + quad * 6);
+    }
+    m_indexBuffer = std::make_unique<ElementIndexBuffer>(indices.data(), unsigned(indices.size()));
+    m_vao->Unbind();
+}
+
+void BatchBuilder::Build(const Sprite* sprites, unsigned int count, const glm::vec4& cullRect, JobSystem* jobs,
+                         unsigned int partitionCount)
+{
+    auto start = Clock::now();
+    if (partitionCount == 0)
+        partitionCount = jobs ? jobs->GetThreadCount() * 4 : 1;
+    partitionCount = std::max(1u, std::min(partitionCount, count / MinSpritesPerPartition));
+    if (!jobs)
+        partitionCount = 1;
+
+    m_stats = BatchBuildStats();
+    m_stats.spriteCount = count;
+    m_stats.partitionCount = partitionCount;
+    m_visible.resize(count);
+    m_partitionOffsets.assign(partitionCount + 1, 0);
+    m_ranges.resize(partitionCount);
+
+    auto partitionBegin = [=](unsigned int partition) {
+        return unsigned((std::uint64_t(count) * partition) / partitionCount);
+    };
+
+    // pass 1: cull and count per partition
+    auto countPartitions = [&](std::size_t first, std::size_t last) {
+        for (std::size_t partition = first; partition < last; partition++)
+            m_partitionOffsets[partition + 1] = CountVisible(sprites, partitionBegin(unsigned(partition)),
+                                                             partitionBegin(unsigned(partition) + 1), cullRect, m_visible.data());
+    };
+    if (jobs)
+        jobs->ParallelFor(partitionCount, 1, countPartitions);
+    else
+        countPartitions(0, partitionCount);
+
+    // exclusive prefix sum, partitions past the end of the buffer get clipped
+    for (unsigned int partition = 0; partition < partitionCount; partition++)
+        m_partitionOffsets[partition + 1] = std::min(m_maxQuads, m_partitionOffsets[partition] + m_partitionOffsets[partition + 1]);
+    m_quadCount = m_partitionOffsets[partitionCount];
+    m_stats.countMs = MillisecondsSince(start);
+
+    // pass 2: every partition writes its own region of the mapped buffer
+    auto writeStart = Clock::now();
+    if (m_quadCount > 0) {
+        auto* vertices = static_cast<BatchVertex*>(m_vertexBuffer->Map(0, unsigned(m_quadCount * 4 * sizeof(BatchVertex))));
+        auto writePartitions = [&](std::size_t first, std::size_t last) {
+            for (std::size_t partition = first; partition < last; partition++) {
+                unsigned int offset = m_partitionOffsets[partition];
+                unsigned int quads = m_partitionOffsets[partition + 1] - offset;
+                WriteQuads(sprites, partitionBegin(unsigned(partition)), partitionBegin(unsigned(partition) + 1),
+                           m_visible.data(), vertices + offset * 4, quads);
+            }
+        };
+        if (vertices) {
+            if (jobs)
+                jobs->ParallelFor(partitionCount, 1, writePartitions);
+            else
+                writePartitions(0, partitionCount);
+            m_vertexBuffer->Unmap();
+        } else {
+            std::cout << "Error (BATCH): could not map the vertex buffer" << std::endl;
+            std::fill(m_partitionOffsets.begin(), m_partitionOffsets.end(), 0);
+            m_quadCount = 0;
+        }
+    }
+
+    for (unsigned int partition = 0; partition < partitionCount; partition++) {
+        unsigned int offset = m_partitionOffsets[partition];
+        m_ranges[partition] = {offset * 6, (m_partitionOffsets[partition + 1] - offset) * 6};
+    }
+
+    m_stats.quadCount = m_quadCount;
+    m_stats.writeMs = MillisecondsSince(writeStart);
+    m_stats.totalMs = MillisecondsSince(start);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "glm/glm.hpp"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+#include "ElementIndexBuffer.h"
+
+class JobSystem;
+
+// one textured, rotated quad. position is the center
+struct Sprite
+{
+    float position[2];
+    float size;
+    float rotation; // radians
+    float color[4];
+    float textureID;
+};
+
+// same layout as the BatchColor shader expects
+struct BatchVertex
+{
+    float position[3];
+    float texCoords[2];
+    float color[4];
+    float textureID;
+};
+
+// indices of one partition in the batch
+struct BatchRange
+{
+    unsigned int firstIndex;
+    unsigned int indexCount;
+};
+
+struct BatchBuildStats
+{
+    unsigned int spriteCount = 0;
+    unsigned int quadCount = 0; // sprites that passed culling and fit the buffer
+    unsigned int partitionCount = 0;
+    double countMs = 0.0;  // culling + prefix sum
+    double writeMs = 0.0;  // vertex generation into the mapped buffer
+    double totalMs = 0.0;
+};
+
+// turns sprites into quads in a streaming vertex buffer. The sprites are split into partitions:
+// the first pass culls and counts per partition, a prefix sum over the counts gives every partition
+// its own region of the buffer, and the second pass writes the vertices straight into the mapped
+// buffer. Partitions never share memory, so neither pass needs a lock. The indices are static
+// (quad i uses vertices 4i..4i+3), so a partition's index range follows from its offset
+class BatchBuilder
+{
+private:
+    std::unique_ptr<VertexArray> m_vao;
+    std::unique_ptr<VertexBuffer> m_vertexBuffer;
+    std::unique_ptr<ElementIndexBuffer> m_indexBuffer;
+    unsigned int m_maxQuads;
+    unsigned int m_quadCount = 0;
+
+    std::vector<std::uint8_t> m_visible;          // per sprite, from the count pass
+    std::vector<unsigned int> m_partitionOffsets; // partitionCount + 1, in quads
+    std::vector<BatchRange> m_ranges;
+    BatchBuildStats m_stats;
+
+public:
+    BatchBuilder(unsigned int maxQuads);
+
+    // cullRect is (minX, minY, maxX, maxY) in sprite space. Without a job system everything
+    // runs on the calling thread as one partition. partitionCount 0 picks 4 per thread.
+    // has to be called on the GL thread, the job system only writes to the mapped memory
+    void Build(const Sprite* sprites, unsigned int count, const glm::vec4& cullRect, JobSystem* jobs,
+               unsigned int partitionCount = 0);
+
+    inline const VertexArray& GetVertexArray() const { return *m_vao; }
+    inline const ElementIndexBuffer& GetIndexBuffer() const { return *m_indexBuffer; }
+    inline unsigned int GetQuadCount() const { return m_quadCount; }
+    inline unsigned int GetIndexCount() const { return m_quadCount * 6; }
+    inline unsigned int GetMaxQuads() const { return m_maxQuads; }
+    inline const std::vector<BatchRange>& GetRanges() const { return m_ranges; }
+    inline const BatchBuildStats& GetStats() const { return m_stats; }
+};
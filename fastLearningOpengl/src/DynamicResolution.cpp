@@ -0,0 +1,57 @@
+#include "DynamicResolution.h"
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr unsigned int SETTLE_FRAMES = 4; // the GPU time lags a frame or two behind a change
+    constexpr float SCALE_STEP = 0.05f;       // small steps would thrash between neighbouring sizes
+}
+
+void DynamicResolution::Update(double gpuMs)
+{
+    m_stats.gpuMs = gpuMs;
+    m_stats.scale = m_scale;
+    if (!m_automatic || gpuMs <= 0.0 || ++m_framesSinceChange < SETTLE_FRAMES)
+        return;
+
+    // a band around the target, inside it the scale stays put
+    const double ratio = m_targetMs / gpuMs;
+    if (ratio > 0.95 && ratio < 1.15)
+        return;
+    // the fragment work goes with the pixel count, the square of the scale. Big jumps are clamped,
+    // not everything the GPU does scales with the resolution
+    float wanted = m_scale * float(std::sqrt(ratio));
+    wanted = std::clamp(wanted, m_scale * 0.85f, m_scale * 1.1f);
+    wanted = std::round(wanted / SCALE_STEP) * SCALE_STEP;
+    // outside the band at least one step is taken, rounding back to the same scale would stick
+    if (std::fabs(wanted - m_scale) < SCALE_STEP * 0.5f)
+        wanted = m_scale + (ratio < 1.0 ? -SCALE_STEP : SCALE_STEP);
+    wanted = std::clamp(wanted, m_minScale, m_maxScale);
+    if (std::fabs(wanted - m_scale) < 0.001f)
+        return;
+    m_scale = wanted;
+    m_framesSinceChange = 0;
+    m_stats.changes++;
+    m_stats.scale = m_scale;
+}
+
+void DynamicResolution::DrawImGui()
+{
+    ImGui::Checkbox("Scale from GPU time", &m_automatic);
+    if (m_automatic) {
+        float targetMs = float(m_targetMs);
+        if (ImGui::SliderFloat("Target GPU time (ms)", &targetMs, 1.0f, 33.0f))
+            SetTargetMs(targetMs);
+        float minScale = m_minScale;
+        if (ImGui::SliderFloat("Minimum scale", &minScale, 0.25f, 1.0f))
+            SetMinScale(minScale);
+    } else {
+        float scale = m_scale;
+        if (ImGui::SliderFloat("Resolution scale", &scale, m_minScale, 1.0f))
+            SetScale(scale);
+    }
+    ImGui::Text("Scale %.2f, %u changes", m_scale, m_stats.changes);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+struct DynamicResolutionStats
+{
+    float scale = 1.0f;          // of the window's width and height
+    double gpuMs = 0.0;          // what the last Update saw
+    unsigned int changes = 0;    // scale changes, all time
+};
+
+// picks the resolution scale of the scene from the GPU frame time, so fragment bound scenes hold the
+// target frame time. PostProcess renders at that scale into part of its full size target (changing
+// it costs no reallocation) and stretches the result over the window
+class DynamicResolution
+{
+private:
+    bool m_automatic = true;
+    float m_scale = 1.0f;
+    float m_minScale = 0.5f;
+    float m_maxScale = 1.0f;
+    double m_targetMs = 8.0;
+    unsigned int m_framesSinceChange = 0;
+    DynamicResolutionStats m_stats;
+
+public:
+    // once per frame with the GPU time of a finished frame (a frame or two old)
+    void Update(double gpuMs);
+
+    inline void SetAutomatic(bool automatic) { m_automatic = automatic; }
+    inline void SetScale(float scale) { m_scale = scale < m_minScale ? m_minScale : (scale > m_maxScale ? m_maxScale : scale); }
+    inline void SetMinScale(float scale) { m_minScale = scale; SetScale(m_scale); }
+    inline void SetTargetMs(double ms) { m_targetMs = ms; }
+    inline bool IsAutomatic() const { return m_automatic; }
+    inline float GetScale() const { return m_scale; }
+    inline float GetMinScale() const { return m_minScale; }
+    inline double GetTargetMs() const { return m_targetMs; }
+    inline const DynamicResolutionStats& GetStats() const { return m_stats; }
+
+    // its settings and stats, drawn into the application's Settings window
+    void DrawImGui();
+};
@@ -0,0 +1,164 @@
+#include "Ecs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+namespace ComponentType
+{
+    unsigned int Next()
+    {
+        static std::atomic<unsigned int> s_next{0};
+        return s_next.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::uint32_t ComponentPoolBase::Insert(Entity entity)
+{
+    const std::uint32_t slot = Registry::GetIndex(entity);
+    if (slot >= m_sparse.size())
+        m_sparse.resize(std::max<std::size_t>(slot + 1, m_sparse.size() * 2), Missing);
+    m_sparse[slot] = std::uint32_t(m_entities.size());
+    m_entities.push_back(entity);
+    return m_sparse[slot];
+}
+
+void ComponentPoolBase::Erase(Entity entity)
+{
+    // the derived pool has already moved the last component into the hole, do the same with the entity
+    const std::uint32_t slot = Registry::GetIndex(entity);
+    const std::uint32_t dense = m_sparse[slot];
+    const Entity last = m_entities.back();
+    m_entities[dense] = last;
+    m_sparse[Registry::GetIndex(last)] = dense;
+    m_entities.pop_back();
+    m_sparse[slot] = Missing;
+}
+
+void ComponentPoolBase::Reserve(std::size_t count)
+{
+    m_entities.reserve(count);
+    if (m_sparse.size() < count)
+        m_sparse.resize(count, Missing);
+}
+
+std::uint32_t ComponentPoolBase::GetDenseIndex(Entity entity) const
+{
+    const std::uint32_t slot = Registry::GetIndex(entity);
+    if (slot >= m_sparse.size())
+        return Missing;
+    const std::uint32_t dense = m_sparse[slot];
+    // a stale handle finds its slot taken by a newer generation
+    return dense != Missing && m_entities[dense] == entity ? dense : Missing;
+}
+
+Entity Registry::Create()
+{
+    m_aliveCount++;
+    if (!m_freeSlots.empty()) {
+        const std::uint32_t slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        // the generation was bumped when the slot was freed
+        return m_slots[slot];
+    }
+    assert(m_slots.size() < IndexMask && "out of entity slots");
+    const Entity entity = Entity(m_slots.size());
+    m_slots.push_back(entity);
+    return entity;
+}
+
+void Registry::Destroy(Entity entity)
+{
+    if (!IsAlive(entity))
+        return;
+    for (auto& pool : m_pools) {
+        if (pool)
+            pool->Remove(entity);
+    }
+    const std::uint32_t slot = GetIndex(entity);
+    const std::uint32_t generation = (GetGeneration(entity) + 1) & 0xFF;
+    m_slots[slot] = (generation << IndexBits) | slot;
+    m_freeSlots.push_back(slot);
+    m_aliveCount--;
+}
+
+bool Registry::IsAlive(Entity entity) const
+{
+    const std::uint32_t slot = GetIndex(entity);
+    if (entity == Null || slot >= m_slots.size() || m_slots[slot] != entity)
+        return false;
+    // a free slot already holds the next generation, so a matching handle can only be a live one
+    return true;
+}
+
+void Registry::Reserve(std::size_t count)
+{
+    m_slots.reserve(count);
+    for (auto& pool : m_pools) {
+        if (pool)
+            pool->Reserve(count);
+    }
+}
+
+bool SystemScheduler::Conflicts(const System& a, const System& b)
+{
+    auto overlaps = [](const std::vector<unsigned int>& x, const std::vector<unsigned int>& y) {
+        return std::any_of(x.begin(), x.end(), [&y](unsigned int id) { return std::find(y.begin(), y.end(), id) != y.end(); });
+    };
+    return overlaps(a.writes, b.writes) || overlaps(a.writes, b.reads) || overlaps(a.reads, b.writes);
+}
+
+void SystemScheduler::Add(const std::string& name, std::vector<unsigned int> reads, std::vector<unsigned int> writes, Function update)
+{
+    System system;
+    system.name = name;
+    system.update = std::move(update);
+    system.reads = std::move(reads);
+    system.writes = std::move(writes);
+    for (const System& earlier : m_systems) {
+        if (Conflicts(system, earlier))
+            system.stage = std::max(system.stage, earlier.stage + 1);
+    }
+    m_stageCount = std::max(m_stageCount, system.stage + 1);
+    m_systems.push_back(std::move(system));
+}
+
+void SystemScheduler::Run(Registry& registry, JobSystem& jobs)
+{
+    auto frameStart = Clock::now();
+    for (unsigned int stage = 0; stage < m_stageCount; stage++) {
+        JobCounter counter;
+        System* inlineSystem = nullptr;
+        for (System& system : m_systems) {
+            if (system.stage != stage)
+                continue;
+            // the first system of a stage runs right here, the others go to the workers
+            if (!inlineSystem) {
+                inlineSystem = &system;
+                continue;
+            }
+            jobs.Run([system = &system, registry = &registry, jobs = &jobs]() {
+                auto start = Clock::now();
+                system->update(*registry, *jobs);
+                system->lastMs = MillisecondsSince(start);
+            }, &counter);
+        }
+        if (inlineSystem) {
+            auto start = Clock::now();
+            inlineSystem->update(registry, jobs);
+            inlineSystem->lastMs = MillisecondsSince(start);
+        }
+        jobs.Wait(counter);
+    }
+    m_lastMs = MillisecondsSince(frameStart);
+}
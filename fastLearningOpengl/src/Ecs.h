@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "JobSystem.h"
+
+// entity handle: slot index in the low 24 bits, generation in the high 8, so the handle of a
+// destroyed entity doesn't match whatever gets created in its slot later
+using Entity = std::uint32_t;
+
+namespace ComponentType
+{
+    unsigned int Next();
+
+    // small dense id per component type, used to index the registry's pools
+    template<typename T>
+    unsigned int Id()
+    {
+        static const unsigned int id = Next();
+        return id;
+    }
+}
+
+// sparse set: components sit in one contiguous array in insertion order (dense), the sparse array
+// maps an entity's slot index to its position there. Removal moves the last component into the hole
+class ComponentPoolBase
+{
+protected:
+    static constexpr std::uint32_t Missing = 0xFFFFFFFF;
+
+    std::vector<std::uint32_t> m_sparse; // entity slot -> dense index
+    std::vector<Entity> m_entities;      // dense, parallel to the component array
+
+    std::uint32_t Insert(Entity entity);
+    void Erase(Entity entity);
+
+public:
+    virtual ~ComponentPoolBase() = default;
+    virtual void Remove(Entity entity) = 0;
+    virtual void Reserve(std::size_t count);
+
+    // Missing when the entity doesn't have the component
+    std::uint32_t GetDenseIndex(Entity entity) const;
+    inline bool Has(Entity entity) const { return GetDenseIndex(entity) != Missing; }
+    inline std::size_t GetSize() const { return m_entities.size(); }
+    inline const Entity* GetEntities() const { return m_entities.data(); }
+};
+
+template<typename T>
+class ComponentPool : public ComponentPoolBase
+{
+private:
+    std::vector<T> m_components;
+
+public:
+    template<typename... Args>
+    T& Emplace(Entity entity, Args&&... args)
+    {
+        assert(!Has(entity) && "entity already has this component");
+        Insert(entity);
+        m_components.push_back(T{std::forward<Args>(args)...});
+        return m_components.back();
+    }
+
+    void Remove(Entity entity) override
+    {
+        std::uint32_t dense = GetDenseIndex(entity);
+        if (dense == Missing)
+            return;
+        m_components[dense] = std::move(m_components.back());
+        m_components.pop_back();
+        Erase(entity);
+    }
+
+    void Reserve(std::size_t count) override
+    {
+        ComponentPoolBase::Reserve(count);
+        m_components.reserve(count);
+    }
+
+    inline T& Get(Entity entity)
+    {
+        assert(Has(entity));
+        return m_components[GetDenseIndex(entity)];
+    }
+
+    inline T* TryGet(Entity entity)
+    {
+        std::uint32_t dense = GetDenseIndex(entity);
+        return dense == Missing ? nullptr : &m_components[dense];
+    }
+
+    // the components in dense order, GetEntities() says whose they are
+    inline T* GetData() { return m_components.data(); }
+};
+
+// iterates the entities that have all of Ts. The smallest pool drives the loop and the other
+// components are looked up by entity, for entities created together that lookup walks the other
+// arrays in order as well
+template<typename... Ts>
+class View
+{
+private:
+    std::tuple<ComponentPool<Ts>*...> m_pools;
+    const ComponentPoolBase* m_driver;
+
+    template<typename Function>
+    void EachRange(std::size_t begin, std::size_t end, const Function& function) const
+    {
+        const Entity* entities = m_driver->GetEntities();
+        for (std::size_t i = begin; i < end; i++) {
+            const Entity entity = entities[i];
+            std::tuple<Ts*...> components(std::get<ComponentPool<Ts>*>(m_pools)->TryGet(entity)...);
+            if (((std::get<Ts*>(components) != nullptr) && ...))
+                function(entity, *std::get<Ts*>(components)...);
+        }
+    }
+
+public:
+    explicit View(ComponentPool<Ts>&... pools)
+        : m_pools(&pools...)
+    {
+        const ComponentPoolBase* candidates[] = {&pools...};
+        m_driver = candidates[0];
+        for (const ComponentPoolBase* pool : candidates) {
+            if (pool->GetSize() < m_driver->GetSize())
+                m_driver = pool;
+        }
+    }
+
+    // upper bound of the entities visited
+    inline std::size_t GetSize() const { return m_driver->GetSize(); }
+
+    // function(Entity, Ts&...)
+    template<typename Function>
+    void Each(const Function& function) const { EachRange(0, GetSize(), function); }
+
+    // the same split over the job system. function runs on several threads at once, so it may only
+    // write to the components it was handed (and other state owned by that entity)
+    template<typename Function>
+    void ParallelEach(JobSystem& jobs, std::size_t grainSize, const Function& function) const
+    {
+        jobs.ParallelFor(GetSize(), grainSize, [this, &function](std::size_t begin, std::size_t end) {
+            EachRange(begin, end, function);
+        });
+    }
+};
+
+class Registry
+{
+public:
+    static constexpr Entity Null = 0xFFFFFFFF;
+    static constexpr unsigned int IndexBits = 24;
+    static constexpr std::uint32_t IndexMask = (1u << IndexBits) - 1;
+
+    static inline std::uint32_t GetIndex(Entity entity) { return entity & IndexMask; }
+    static inline std::uint32_t GetGeneration(Entity entity) { return entity >> IndexBits; }
+
+private:
+    std::vector<Entity> m_slots;            // the live handle of every slot (or the last one, for free slots)
+    std::vector<std::uint32_t> m_freeSlots;
+    std::vector<std::unique_ptr<ComponentPoolBase>> m_pools; // by ComponentType::Id
+    std::size_t m_aliveCount = 0;
+
+public:
+    Registry() = default;
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    Entity Create();
+    // removes all of its components too
+    void Destroy(Entity entity);
+    bool IsAlive(Entity entity) const;
+    void Reserve(std::size_t count);
+
+    // pools are created on first use, which is not thread safe: touch every component type on the
+    // main thread (Emplace, GetPool) before systems ask for views of it from jobs
+    template<typename T>
+    ComponentPool<T>& GetPool()
+    {
+        const unsigned int id = ComponentType::Id<T>();
+        if (id >= m_pools.size())
+            m_pools.resize(id + 1);
+        if (!m_pools[id])
+            m_pools[id] = std::make_unique<ComponentPool<T>>();
+        return static_cast<ComponentPool<T>&>(*m_pools[id]);
+    }
+
+    template<typename T, typename... Args>
+    T& Emplace(Entity entity, Args&&... args)
+    {
+        assert(IsAlive(entity));
+        return GetPool<T>().Emplace(entity, std::forward<Args>(args)...);
+    }
+
+    template<typename T> inline T& Get(Entity entity) { return GetPool<T>().Get(entity); }
+    template<typename T> inline T* TryGet(Entity entity) { return GetPool<T>().TryGet(entity); }
+    template<typename T> inline bool Has(Entity entity) { return GetPool<T>().Has(entity); }
+    template<typename T> inline void Remove(Entity entity) { GetPool<T>().Remove(entity); }
+
+    template<typename... Ts>
+    View<Ts...> GetView() { return View<Ts...>(GetPool<Ts>()...); }
+
+    inline std::size_t GetEntityCount() const { return m_aliveCount; }
+};
+
+// runs systems once per frame. Every system declares the component types it reads and writes;
+// systems that don't conflict share a stage and run as parallel jobs, a conflicting one goes into
+// a later stage than the systems it conflicts with, so declaration order is kept where it matters.
+// a system is free to split its own work further (View::ParallelEach)
+class SystemScheduler
+{
+public:
+    using Function = std::function<void(Registry& registry, JobSystem& jobs)>;
+
+    struct System
+    {
+        std::string name;
+        Function update;
+        std::vector<unsigned int> reads;
+        std::vector<unsigned int> writes;
+        unsigned int stage = 0;
+        double lastMs = 0.0;
+    };
+
+    template<typename... Ts>
+    static std::vector<unsigned int> Components() { return {ComponentType::Id<Ts>()...}; }
+
+private:
+    std::vector<System> m_systems;
+    unsigned int m_stageCount = 0;
+    double m_lastMs = 0.0;
+
+    static bool Conflicts(const System& a, const System& b);
+
+public:
+    void Add(const std::string& name, std::vector<unsigned int> reads, std::vector<unsigned int> writes, Function update);
+    void Run(Registry& registry, JobSystem& jobs);
+
+    inline const std::vector<System>& GetSystems() const { return m_systems; }
+    inline unsigned int GetStageCount() const { return m_stageCount; }
+    inline double GetLastMs() const { return m_lastMs; }
+};
@@ -23,4 +23,11 @@ void ElementIndexBuffer::Bind() const
 void ElementIndexBuffer::Unbind() const
 {
     glCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+}
+
+void ElementIndexBuffer::BufferSubData(const unsigned int* indices, unsigned int count, unsigned int firstIndex)
+{
+    assert(firstIndex + count <= m_Count);
+    glCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_RendererID));
+    glCall(glBufferSubData(GL_COPY_WRITE_BUFFER, firstIndex * sizeof(unsigned int), count * sizeof(unsigned int), indices));
 }
\ No newline at end of file
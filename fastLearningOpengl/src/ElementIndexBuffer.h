@@ -11,5 +11,9 @@ class ElementIndexBuffer{
         void Bind() const; 
         void Unbind() const; 
 
+        // count indices from firstIndex on. Doesn't touch the element array binding, so no vertex array changes
+        void BufferSubData(const unsigned int* indices, unsigned int count, unsigned int firstIndex = 0);
+
         inline unsigned int GetCount() const { return m_Count; }
+        inline unsigned int GetRendererID() const { return m_RendererID; }
 };
\ No newline at end of file
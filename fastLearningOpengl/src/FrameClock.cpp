@@ -0,0 +1,76 @@
+#include "FrameClock.h"
+#include "imgui/imgui.h"
+
+#include <algorithm>
+
+unsigned int FrameClock::BeginFrame()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (m_mode == ClockMode::Deterministic)
+        m_frameNs = m_deterministicFrameNs;
+    else
+        m_frameNs = m_started ? std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_lastFrame).count() : 0;
+    m_lastFrame = now;
+    m_started = true;
+    m_frames++;
+
+    m_accumulatorNs += m_frameNs;
+    std::int64_t due = m_accumulatorNs / m_stepNs;
+    m_accumulatorNs -= due * m_stepNs;
+    m_stepsThisFrame = unsigned(std::min<std::int64_t>(due, m_maxSteps));
+    m_droppedSteps += std::uint64_t(due - m_stepsThisFrame);
+    m_steps += m_stepsThisFrame;
+    m_simulationNs += std::int64_t(m_stepsThisFrame) * m_stepNs;
+    return m_stepsThisFrame;
+}
+
+void FrameClock::Reset()
+{
+    m_started = false;
+    m_frameNs = 0;
+    m_accumulatorNs = 0;
+    m_steps = 0;
+    m_simulationNs = 0;
+    m_frames = 0;
+    m_stepsThisFrame = 0;
+    m_droppedSteps = 0;
+}
+
+void FrameClock::SetMode(ClockMode mode)
+{
+    m_mode = mode;
+    Reset();
+}
+
+double FrameClock::GetRenderTime() const
+{
+    if (m_steps == 0)
+        return 0.0;
+    return double(m_simulationNs - m_stepNs + m_accumulatorNs) * 1e-9;
+}
+
+void FrameClock::DrawImGui()
+{
+    // deterministic: every frame is 1/60 s whatever it really took, a benchmark run sees the same
+    // steps and times every time. Switching modes restarts the time at 0
+    bool deterministic = m_mode == ClockMode::Deterministic;
+    if (ImGui::Checkbox("Deterministic clock", &deterministic))
+        SetMode(deterministic ? ClockMode::Deterministic : ClockMode::Real);
+    ImGui::SameLine();
+    if (ImGui::Button("Restart time"))
+        Reset();
+    int stepRate = int(1000000000 / m_stepNs);
+    if (ImGui::SliderInt("Fixed steps per second", &stepRate, 10, 1000))
+        SetStep(1000000000 / stepRate);
+    ImGui::Text("Clock (%s): %.3f s, %u steps this frame, alpha %.2f, %llu steps dropped", GetModeName(), GetSimulationTime(),
+                m_stepsThisFrame, GetAlpha(), (unsigned long long)m_droppedSteps);
+}
+
+namespace Time
+{
+    FrameClock& Get()
+    {
+        static FrameClock s_clock;
+        return s_clock;
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+enum class ClockMode
+{
+    Real,         // frames advance by the wall clock time between them
+    Deterministic // every frame advances by the same set time, for reproducible benchmark runs
+};
+
+// the application's time. The simulation runs in fixed steps (Test::OnFixedUpdate), as many per frame
+// as the frame time pays for, and rendering interpolates between the last two steps with GetAlpha.
+// Everything is counted in integer nanoseconds, so a deterministic run does exactly the same steps
+// and sees exactly the same times every time, whatever the frame rate really was.
+// Tests read the time from here, never from glfwGetTime
+class FrameClock
+{
+public:
+    static constexpr std::int64_t DefaultStepNs = 1000000000 / 120;
+    static constexpr unsigned int DefaultMaxSteps = 8;
+
+private:
+    ClockMode m_mode = ClockMode::Real;
+    std::int64_t m_stepNs = DefaultStepNs;
+    std::int64_t m_deterministicFrameNs = 1000000000 / 60;
+    unsigned int m_maxSteps = DefaultMaxSteps;
+
+    std::chrono::steady_clock::time_point m_lastFrame;
+    bool m_started = false;
+    std::int64_t m_frameNs = 0;
+    std::int64_t m_accumulatorNs = 0; // frame time not yet simulated, less than a step after BeginFrame
+    std::uint64_t m_steps = 0;         // since Reset
+    std::int64_t m_simulationNs = 0;   // the steps added up with the size each had when it was taken
+    std::uint64_t m_frames = 0;
+    unsigned int m_stepsThisFrame = 0;
+    std::uint64_t m_droppedSteps = 0;  // over m_maxSteps in a frame, skipped so a slow frame can't snowball
+
+public:
+    // once per frame before anything reads the time, returns how many fixed steps are due
+    unsigned int BeginFrame();
+    // back to time 0 with nothing accumulated, the next frame starts a fresh run
+    void Reset();
+
+    void SetMode(ClockMode mode); // resets
+    inline ClockMode GetMode() const { return m_mode; }
+    inline const char* GetModeName() const { return m_mode == ClockMode::Real ? "real" : "deterministic"; }
+    inline void SetStep(std::int64_t nanoseconds) { m_stepNs = nanoseconds > 0 ? nanoseconds : 1; }
+    inline void SetDeterministicFrame(std::int64_t nanoseconds) { m_deterministicFrameNs = nanoseconds > 0 ? nanoseconds : 1; }
+    inline void SetMaxSteps(unsigned int steps) { m_maxSteps = steps > 0 ? steps : 1; }
+
+    inline float GetStep() const { return float(double(m_stepNs) * 1e-9); }
+    inline std::int64_t GetStepNs() const { return m_stepNs; }
+    inline std::int64_t GetDeterministicFrameNs() const { return m_deterministicFrameNs; }
+    inline float GetFrameDelta() const { return float(double(m_frameNs) * 1e-9); }
+    // where rendering is between the previous step (0) and the last one (1)
+    inline float GetAlpha() const { return float(double(m_accumulatorNs) / double(m_stepNs)); }
+    // seconds at the last step. Changing the step size only changes the steps from then on
+    inline double GetSimulationTime() const { return double(m_simulationNs) * 1e-9; }
+    // seconds to animate with while rendering: the previous step's time plus alpha, one step behind the
+    // simulation like every interpolated state
+    double GetRenderTime() const;
+    inline std::uint64_t GetStepCount() const { return m_steps; }
+    inline std::uint64_t GetFrameCount() const { return m_frames; }
+    inline unsigned int GetStepsThisFrame() const { return m_stepsThisFrame; }
+    inline std::uint64_t GetDroppedSteps() const { return m_droppedSteps; }
+
+    // its settings and stats, drawn into the application's Settings window
+    void DrawImGui();
+};
+
+// the application wide clock, the main loop calls BeginFrame
+namespace Time
+{
+    FrameClock& Get();
+}
@@ -0,0 +1,184 @@
+#include "FramePacer.h"
+#include "Renderer.h"
+#include "imgui/imgui.h"
+
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    std::int64_t NowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+}
+
+void FramePacer::Initialize(GLFWwindow* window)
+{
+    m_window = window;
+    m_adaptiveSupported = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+    for (Frame& frame : m_frames) {
+        glCall(glGenQueries(1, &frame.startQuery));
+        glCall(glGenQueries(1, &frame.endQuery));
+    }
+    SetPresentMode(m_mode);
+}
+
+void FramePacer::Release()
+{
+    for (Frame& frame : m_frames) {
+        if (frame.fence) {
+            glCall(glDeleteSync(frame.fence));
+            frame.fence = nullptr;
+        }
+        if (frame.startQuery) {
+            glCall(glDeleteQueries(1, &frame.startQuery));
+            glCall(glDeleteQueries(1, &frame.endQuery));
+            frame.startQuery = frame.endQuery = 0;
+        }
+    }
+}
+
+bool FramePacer::IsSupported(PresentMode mode) const
+{
+    return mode != PresentMode::AdaptiveVsync || m_adaptiveSupported;
+}
+
+const char* FramePacer::GetPresentModeName(PresentMode mode)
+{
+    switch (mode) {
+    case PresentMode::VsyncOff:      return "vsync off";
+    case PresentMode::Vsync:         return "vsync";
+    case PresentMode::AdaptiveVsync: return "adaptive vsync";
+    }
+    return "";
+}
+
+void FramePacer::SetPresentMode(PresentMode mode)
+{
+    if (!IsSupported(mode)) {
+        std::cout << "Error (FRAME PACER): " << GetPresentModeName(mode) << " isn't supported, staying with "
+                  << GetPresentModeName(m_mode) << std::endl;
+        return;
+    }
+    m_mode = mode;
+    glfwSwapInterval(mode == PresentMode::VsyncOff ? 0 : mode == PresentMode::Vsync ? 1 : -1);
+    m_stats.maxLatencyMs = 0.0;
+}
+
+void FramePacer::SetMaxFramesInFlight(unsigned int frames)
+{
+    m_maxFramesInFlight = std::min(frames, MaxFramesInFlight);
+    m_stats.maxLatencyMs = 0.0;
+}
+
+void FramePacer::Retire(Frame& frame)
+{
+    GLuint64 start = 0, end = 0;
+    glCall(glGetQueryObjectui64v(frame.startQuery, GL_QUERY_RESULT, &start));
+    glCall(glGetQueryObjectui64v(frame.endQuery, GL_QUERY_RESULT, &end));
+    glCall(glDeleteSync(frame.fence));
+    frame.fence = nullptr;
+
+    m_stats.gpuFrameMs = double(end - start) / 1e6;
+    m_stats.gpuIdleMs = m_lastGpuEnd != 0 && start > m_lastGpuEnd ? double(start - m_lastGpuEnd) / 1e6 : 0.0;
+    m_lastGpuEnd = end;
+    double latencyMs = double(std::int64_t(end) + m_gpuToCpuNs - frame.inputNs) / 1e6;
+    if (latencyMs > 0.0) {
+        m_stats.latencyMs = m_stats.latencyMs == 0.0 ? latencyMs : m_stats.latencyMs * 0.9 + latencyMs * 0.1;
+        m_stats.maxLatencyMs = std::max(m_stats.maxLatencyMs, latencyMs);
+    }
+    m_retired++;
+}
+
+void FramePacer::BeginFrame()
+{
+    auto start = Clock::now();
+    // finished ones go without waiting, then the oldest are waited for until few enough are left.
+    // The ring is full at Slots - 1 even without a limit, the slot of this frame has to be free
+    const unsigned int limit = m_maxFramesInFlight > 0 ? m_maxFramesInFlight : Slots - 1;
+    while (m_retired < m_frame) {
+        Frame& oldest = m_frames[m_retired % Slots];
+        const bool mustWait = m_frame - m_retired > limit - 1;
+        glCall(GLenum status = glClientWaitSync(oldest.fence, GL_SYNC_FLUSH_COMMANDS_BIT, mustWait ? 1000000000 : 0));
+        if (status == GL_TIMEOUT_EXPIRED && !mustWait)
+            break;
+        if (status == GL_WAIT_FAILED || status == GL_TIMEOUT_EXPIRED) {
+            std::cout << "Error (FRAME PACER): waiting for frame " << m_retired << " failed" << std::endl;
+            glCall(glDeleteSync(oldest.fence));
+            oldest.fence = nullptr;
+            m_retired++;
+            continue;
+        }
+        Retire(oldest);
+    }
+    m_stats.cpuWaitMs = MillisecondsSince(start);
+    m_stats.framesInFlight = unsigned(m_frame - m_retired);
+
+    // the GL clock against the CPU's, every frame since they drift apart
+    GLint64 gpuNow = 0;
+    glCall(glGetInteger64v(GL_TIMESTAMP, &gpuNow));
+    m_gpuToCpuNs = NowNs() - std::int64_t(gpuNow);
+
+    Frame& frame = m_frames[m_frame % Slots];
+    frame.inputNs = NowNs();
+    glCall(glQueryCounter(frame.startQuery, GL_TIMESTAMP));
+}
+
+void FramePacer::MarkInput()
+{
+    m_frames[m_frame % Slots].inputNs = NowNs();
+}
+
+void FramePacer::EndFrame()
+{
+    Frame& frame = m_frames[m_frame % Slots];
+    glCall(glQueryCounter(frame.endQuery, GL_TIMESTAMP));
+    glCall(frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    m_frame++;
+}
+
+void FramePacer::Present()
+{
+    auto start = Clock::now();
+    glfwSwapBuffers(m_window);
+    m_stats.swapMs = MillisecondsSince(start);
+}
+
+void FramePacer::DrawImGui()
+{
+    const PresentMode presentModes[] = {PresentMode::VsyncOff, PresentMode::Vsync, PresentMode::AdaptiveVsync};
+    if (ImGui::BeginCombo("Present mode", GetPresentModeName(m_mode))) {
+        for (PresentMode mode : presentModes) {
+            if (!IsSupported(mode))
+                continue;
+            if (ImGui::Selectable(GetPresentModeName(mode), mode == m_mode))
+                SetPresentMode(mode);
+        }
+        ImGui::EndCombo();
+    }
+    int framesInFlight = int(m_maxFramesInFlight);
+    if (ImGui::SliderInt("Frames in flight (0 = driver)", &framesInFlight, 0, int(MaxFramesInFlight)))
+        SetMaxFramesInFlight(unsigned(framesInFlight));
+    ImGui::Text("CPU waits: %.2f ms on the fence, %.2f ms in swap; %u frames in flight", m_stats.cpuWaitMs, m_stats.swapMs,
+                m_stats.framesInFlight);
+    ImGui::Text("GPU: %.2f ms busy, %.2f ms idle before it; input to GPU done %.1f ms (max %.1f)", m_stats.gpuFrameMs,
+                m_stats.gpuIdleMs, m_stats.latencyMs, m_stats.maxLatencyMs);
+}
+
+namespace Pacing
+{
+    FramePacer& Get()
+    {
+        static FramePacer s_pacer;
+        return s_pacer;
+    }
+}
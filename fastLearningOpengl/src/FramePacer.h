@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <glad/glad.h>
+
+struct GLFWwindow;
+
+enum class PresentMode
+{
+    VsyncOff,     // swap interval 0, tears, the lowest latency
+    Vsync,        // swap interval 1
+    AdaptiveVsync // swap interval -1: waits for the blank unless the frame is late, then tears instead of stalling
+};
+
+struct FramePacingStats
+{
+    double cpuWaitMs = 0.0;      // this frame, blocked on the frames-in-flight fence
+    double swapMs = 0.0;         // last frame, inside glfwSwapBuffers (vsync and driver queueing show up here)
+    double gpuFrameMs = 0.0;     // GPU time between the start and end timestamps of the last finished frame
+    double gpuIdleMs = 0.0;      // the GPU's gap between that frame and the one before it, starved by the CPU
+    double latencyMs = 0.0;      // input sampled to the GPU done rendering it, averaged; present adds up to a refresh on top
+    double maxLatencyMs = 0.0;   // since the settings last changed
+    unsigned int framesInFlight = 0; // submitted and not finished, when this frame began
+};
+
+// paces the main loop against the GPU. Every frame ends with a fence; BeginFrame waits until no more
+// than the set number of frames are still unfinished, so the CPU can't queue up frames the GPU will
+// only show much later (each queued frame is a frame of input latency). Input is sampled right after
+// that wait. Timestamp queries at both ends of a frame give the GPU's busy and idle time, converted
+// to the CPU clock they give the latency from input to finished frame
+class FramePacer
+{
+public:
+    static constexpr unsigned int MaxFramesInFlight = 4;
+
+private:
+    // one more than the limit: the frame being recorded is never one of those waited on
+    static constexpr unsigned int Slots = MaxFramesInFlight + 1;
+    struct Frame
+    {
+        GLsync fence = nullptr;
+        unsigned int startQuery = 0;
+        unsigned int endQuery = 0;
+        std::int64_t inputNs = 0; // CPU clock, when input for the frame was sampled
+    };
+
+    GLFWwindow* m_window = nullptr;
+    PresentMode m_mode = PresentMode::Vsync;
+    bool m_adaptiveSupported = false;
+    unsigned int m_maxFramesInFlight = 2; // 0 leaves it to the driver
+    Frame m_frames[Slots];
+    std::uint64_t m_frame = 0;        // being recorded, m_frames[m_frame % Slots]
+    std::uint64_t m_retired = 0;      // all frames before it are finished
+    std::int64_t m_gpuToCpuNs = 0;    // added to a GL timestamp gives the CPU clock
+    std::uint64_t m_lastGpuEnd = 0;
+    FramePacingStats m_stats;
+
+    void Retire(Frame& frame);
+
+public:
+    // the window's context has to be current. Sets the present mode on it
+    void Initialize(GLFWwindow* window);
+    // deletes the fences and queries, before the context goes away
+    void Release();
+
+    // first thing in the frame: waits for old frames, then starts the GPU timestamp
+    void BeginFrame();
+    // right after the input of this frame was polled
+    void MarkInput();
+    // last thing before the swap
+    void EndFrame();
+    // glfwSwapBuffers, timed
+    void Present();
+
+    void SetPresentMode(PresentMode mode);
+    inline PresentMode GetPresentMode() const { return m_mode; }
+    bool IsSupported(PresentMode mode) const;
+    static const char* GetPresentModeName(PresentMode mode);
+    void SetMaxFramesInFlight(unsigned int frames);
+    inline unsigned int GetMaxFramesInFlight() const { return m_maxFramesInFlight; }
+    inline const FramePacingStats& GetStats() const { return m_stats; }
+
+    // its settings and stats, drawn into the application's Settings window
+    void DrawImGui();
+};
+
+// the application's pacer, the main loop drives it
+namespace Pacing
+{
+    FramePacer& Get();
+}
@@ -0,0 +1,203 @@
+#include "Framebuffer.h"
+#include "Renderer.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    // any format / type pair that matches the internal format, no data is passed
+    void TextureUploadFormat(GLenum internalFormat, GLenum& format, GLenum& type)
+    {
+        switch (internalFormat) {
+        case GL_DEPTH24_STENCIL8:   format = GL_DEPTH_STENCIL;   type = GL_UNSIGNED_INT_24_8; break;
+        case GL_DEPTH_COMPONENT16:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH_COMPONENT32F: format = GL_DEPTH_COMPONENT; type = GL_FLOAT; break;
+        case GL_R11F_G11F_B10F:     format = GL_RGB;             type = GL_FLOAT; break;
+        default:                    format = GL_RGBA;            type = GL_FLOAT; break;
+        }
+    }
+
+    unsigned int CreateTexture(GLenum internalFormat, unsigned int width, unsigned int height)
+    {
+        GLint previous = 0;
+        glCall(glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous));
+        unsigned int texture = 0;
+        GLenum format, type;
+        TextureUploadFormat(internalFormat, format, type);
+        glCall(glGenTextures(1, &texture));
+        glCall(glBindTexture(GL_TEXTURE_2D, texture));
+        glCall(glTexImage2D(GL_TEXTURE_2D, 0, GLint(internalFormat), GLsizei(width), GLsizei(height), 0, format, type, nullptr));
+        glCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        glCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        glCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        glCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        glCall(glBindTexture(GL_TEXTURE_2D, GLuint(previous)));
+        return texture;
+    }
+
+    unsigned int CreateRenderbuffer(GLenum internalFormat, unsigned int samples, unsigned int width, unsigned int height)
+    {
+        unsigned int renderbuffer = 0;
+        glCall(glGenRenderbuffers(1, &renderbuffer));
+        glCall(glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer));
+        glCall(glRenderbufferStorageMultisample(GL_RENDERBUFFER, GLsizei(samples > 1 ? samples : 0), internalFormat, GLsizei(width),
+                                                GLsizei(height)));
+        glCall(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+        return renderbuffer;
+    }
+}
+
+Framebuffer::Framebuffer(const FramebufferSpec& spec)
+    : m_Spec(spec)
+{
+    m_Spec.width = std::max(1u, m_Spec.width);
+    m_Spec.height = std::max(1u, m_Spec.height);
+    m_Spec.samples = std::max(1u, m_Spec.samples);
+    Create();
+}
+
+Framebuffer::~Framebuffer()
+{
+    Destroy();
+}
+
+void Framebuffer::Create()
+{
+    // binding GL_FRAMEBUFFER replaces both the draw and the read binding, each is put back
+    GLint previousDraw = 0, previousRead = 0;
+    glCall(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousDraw));
+    glCall(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousRead));
+    glCall(glGenFramebuffers(1, &m_RendererID));
+    glCall(glBindFramebuffer(GL_FRAMEBUFFER, m_RendererID));
+
+    const bool multisampled = m_Spec.samples > 1;
+    if (m_Spec.colorFormat) {
+        m_ColorIsTexture = !multisampled;
+        if (m_ColorIsTexture) {
+            m_ColorAttachment = CreateTexture(m_Spec.colorFormat, m_Spec.width, m_Spec.height);
+            glCall(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_ColorAttachment, 0));
+        } else {
+            m_ColorAttachment = CreateRenderbuffer(m_Spec.colorFormat, m_Spec.samples, m_Spec.width, m_Spec.height);
+            glCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColorAttachment));
+        }
+    } else {
+        glCall(glDrawBuffer(GL_NONE));
+        glCall(glReadBuffer(GL_NONE));
+    }
+    if (m_Spec.depthFormat) {
+        const GLenum attachment = m_Spec.depthFormat == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        m_DepthIsTexture = m_Spec.sampleableDepth && !multisampled;
+        if (m_DepthIsTexture) {
+            m_DepthAttachment = CreateTexture(m_Spec.depthFormat, m_Spec.width, m_Spec.height);
+            glCall(glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, m_DepthAttachment, 0));
+        } else {
+            m_DepthAttachment = CreateRenderbuffer(m_Spec.depthFormat, m_Spec.samples, m_Spec.width, m_Spec.height);
+            glCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, m_DepthAttachment));
+        }
+    }
+    if (!IsComplete())
+        std::cout << "Error (FRAMEBUFFER): " << m_Spec.width << "x" << m_Spec.height << " with " << m_Spec.samples
+                  << " samples is incomplete" << std::endl;
+    glCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GLuint(previousDraw)));
+    glCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, GLuint(previousRead)));
+}
+
+void Framebuffer::Destroy()
+{
+    if (m_ColorAttachment) {
+        if (m_ColorIsTexture) {
+            glCall(glDeleteTextures(1, &m_ColorAttachment));
+        } else {
+            glCall(glDeleteRenderbuffers(1, &m_ColorAttachment));
+        }
+    }
+    if (m_DepthAttachment) {
+        if (m_DepthIsTexture) {
+            glCall(glDeleteTextures(1, &m_DepthAttachment));
+        } else {
+            glCall(glDeleteRenderbuffers(1, &m_DepthAttachment));
+        }
+    }
+    if (m_RendererID) {
+        glCall(glDeleteFramebuffers(1, &m_RendererID));
+    }
+    m_RendererID = m_ColorAttachment = m_DepthAttachment = 0;
+}
+
+bool Framebuffer::IsComplete() const
+{
+    GLint previousDraw = 0, previousRead = 0;
+    glCall(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousDraw));
+    glCall(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousRead));
+    glCall(glBindFramebuffer(GL_FRAMEBUFFER, m_RendererID));
+    glCall(GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    glCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GLuint(previousDraw)));
+    glCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, GLuint(previousRead)));
+    return status == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void Framebuffer::Bind() const
+{
+    glCall(glBindFramebuffer(GL_FRAMEBUFFER, m_RendererID));
+    glCall(glViewport(0, 0, GLsizei(m_Spec.width), GLsizei(m_Spec.height)));
+}
+
+void Framebuffer::BindDefault(int width, int height)
+{
+    glCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    glCall(glViewport(0, 0, width, height));
+}
+
+void Framebuffer::Resize(unsigned int width, unsigned int height)
+{
+    width = std::max(1u, width);
+    height = std::max(1u, height);
+    if (width == m_Spec.width && height == m_Spec.height)
+        return;
+    Destroy();
+    m_Spec.width = width;
+    m_Spec.height = height;
+    Create();
+}
+
+void Framebuffer::ResolveTo(const Framebuffer& target, unsigned int width, unsigned int height) const
+{
+    glCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_RendererID));
+    glCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.m_RendererID));
+    // a multisample resolve has to keep the rectangle and can't filter
+    glCall(glBlitFramebuffer(0, 0, GLint(width), GLint(height), 0, 0, GLint(width), GLint(height), GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    glCall(glBindFramebuffer(GL_FRAMEBUFFER, target.m_RendererID));
+}
+
+void Framebuffer::ResolveToDefault(unsigned int width, unsigned int height) const
+{
+    glCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_RendererID));
+    glCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+    glCall(glBlitFramebuffer(0, 0, GLint(width), GLint(height), 0, 0, GLint(width), GLint(height), GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    glCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+std::size_t Framebuffer::GetBytesPerPixel(GLenum format)
+{
+    switch (format) {
+    case 0:                     return 0;
+    case GL_RGBA16F:            return 8;
+    case GL_RGBA32F:            return 16;
+    case GL_DEPTH_COMPONENT16:  return 2;
+    case GL_DEPTH_COMPONENT24:  return 3;
+    default:                    return 4; // RGBA8, R11F_G11F_B10F, DEPTH24_STENCIL8, DEPTH_COMPONENT32F
+    }
+}
+
+std::size_t Framebuffer::GetMemoryBytes(const FramebufferSpec& spec)
+{
+    return std::size_t(spec.width) * spec.height * std::max(1u, spec.samples) *
+           (GetBytesPerPixel(spec.colorFormat) + GetBytesPerPixel(spec.depthFormat));
+}
+
+std::size_t Framebuffer::GetMemoryBytes() const
+{
+    return GetMemoryBytes(m_Spec);
+}
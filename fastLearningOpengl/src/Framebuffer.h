@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <glad/glad.h>
+
+struct FramebufferSpec
+{
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int samples = 1;            // more than 1 makes the attachments multisampled renderbuffers
+    GLenum colorFormat = GL_RGBA8;       // 0 for none
+    GLenum depthFormat = GL_DEPTH24_STENCIL8; // 0 for none
+    bool sampleableDepth = false;        // a depth texture instead of a renderbuffer (single sampled only)
+};
+
+// an offscreen render target. Single sampled color is a texture that can be sampled afterwards,
+// multisampled attachments are renderbuffers that get resolved into a single sampled framebuffer
+class Framebuffer
+{
+private:
+    unsigned int m_RendererID = 0;
+    unsigned int m_ColorAttachment = 0;
+    unsigned int m_DepthAttachment = 0;
+    bool m_ColorIsTexture = false;
+    bool m_DepthIsTexture = false;
+    FramebufferSpec m_Spec;
+
+    void Create();
+    void Destroy();
+
+public:
+    explicit Framebuffer(const FramebufferSpec& spec);
+    ~Framebuffer();
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    // binds it for drawing, the viewport covers all of it
+    void Bind() const;
+    // the window's framebuffer again
+    static void BindDefault(int width, int height);
+    // new attachments of that size, the contents are lost. Nothing happens if the size is the same
+    void Resize(unsigned int width, unsigned int height);
+    // color of [0, width) x [0, height) into the same rectangle of target, resolving the samples
+    void ResolveTo(const Framebuffer& target, unsigned int width, unsigned int height) const;
+    // the same into the window's framebuffer (which must not be multisampled), it stays bound. Only for
+    // a single sampled source: a multisample resolve needs identical formats, the window's is RGBA8
+    void ResolveToDefault(unsigned int width, unsigned int height) const;
+
+    // 0 if there is none or it's a renderbuffer
+    inline unsigned int GetColorTexture() const { return m_ColorIsTexture ? m_ColorAttachment : 0; }
+    inline unsigned int GetDepthTexture() const { return m_DepthIsTexture ? m_DepthAttachment : 0; }
+    inline unsigned int GetRendererID() const { return m_RendererID; }
+    inline unsigned int GetWidth() const { return m_Spec.width; }
+    inline unsigned int GetHeight() const { return m_Spec.height; }
+    inline unsigned int GetSamples() const { return m_Spec.samples; }
+    inline const FramebufferSpec& GetSpec() const { return m_Spec; }
+    // what the attachments take, from their formats (the driver may pad)
+    std::size_t GetMemoryBytes() const;
+    bool IsComplete() const;
+
+    static std::size_t GetBytesPerPixel(GLenum format);
+    static std::size_t GetMemoryBytes(const FramebufferSpec& spec);
+};
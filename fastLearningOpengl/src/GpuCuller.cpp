@@ -0,0 +1,320 @@
+#include "GpuCuller.h"
+#include "Renderer.h"
+#include "IndirectDraw.h"
+#include "ShaderPreprocessor.h"
+#include "VertexBufferLayout.h"
+#include "GLFW/glfw3.h" // glfwGetProcAddress, glad stops at 4.1
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// compute shaders and storage buffers are 4.3, the barriers 4.2. Not in the 4.1 glad
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+
+namespace
+{
+    typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint x, GLuint y, GLuint z);
+    typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+
+    PFNGLDISPATCHCOMPUTEPROC s_dispatchCompute = nullptr;
+    PFNGLMEMORYBARRIERPROC s_memoryBarrier = nullptr;
+
+    const char* CullShaderPath = "res/Shaders/CullInstances.shader";
+    constexpr unsigned int GroupSize = 64; // local_size_x of the compute stage
+    const char* FeedbackVaryings[] = {"o_Column0", "o_Column1", "o_Column2", "o_Column3"};
+
+    bool LinkProgram(unsigned int program)
+    {
+        glCall(glLinkProgram(program));
+        GLint linked = GL_FALSE;
+        glCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+        if (linked == GL_TRUE)
+            return true;
+        GLint length = 0;
+        glCall(glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length));
+        std::vector<char> message(std::size_t(length) + 1, '\0');
+        glCall(glGetProgramInfoLog(program, length, nullptr, message.data()));
+        std::cout << "Error (GPU CULLING): link failed" << std::endl << message.data() << std::endl;
+        return false;
+    }
+
+    // 0 if a stage doesn't compile or the link fails
+    unsigned int BuildProgram(const std::vector<std::pair<unsigned int, const std::string*>>& stages, bool feedback)
+    {
+        unsigned int program = glCreateProgram();
+        std::vector<unsigned int> shaders;
+        bool ok = true;
+        for (const auto& stage : stages) {
+            unsigned int shader = stage.second->empty() ? 0 : Shader::CompileShader(stage.first, *stage.second);
+            ok = ok && shader != 0;
+            if (shader) {
+                glCall(glAttachShader(program, shader));
+                shaders.push_back(shader);
+            }
+        }
+        if (ok && feedback) {
+            glCall(glTransformFeedbackVaryings(program, 4, FeedbackVaryings, GL_INTERLEAVED_ATTRIBS));
+        }
+        ok = ok && LinkProgram(program);
+        for (unsigned int shader : shaders) {
+            glCall(glDeleteShader(shader));
+        }
+        if (!ok) {
+            glCall(glDeleteProgram(program));
+            return 0;
+        }
+        return program;
+    }
+
+    bool SphereVisible(const glm::mat4& model, const glm::vec4& localSphere, const glm::vec4 planes[6])
+    {
+        // the same steps as IsVisible in res/Shaders/include/Cull.glsl
+        glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(localSphere), 1.0f));
+        float scale2 = std::max(std::max(glm::dot(glm::vec3(model[0]), glm::vec3(model[0])), glm::dot(glm::vec3(model[1]), glm::vec3(model[1]))),
+                                glm::dot(glm::vec3(model[2]), glm::vec3(model[2])));
+        float radius = localSphere.w * std::sqrt(scale2);
+        for (int plane = 0; plane < 6; plane++) {
+            if (glm::dot(glm::vec3(planes[plane]), center) + planes[plane].w < -radius)
+                return false;
+        }
+        return true;
+    }
+}
+
+GpuCuller::GpuCuller(unsigned int maxInstances)
+    : m_maxInstances(maxInstances)
+{
+    std::shared_ptr<const PreprocessedShader> preprocessed = ShaderPreprocessor::Load(CullShaderPath);
+    ShaderProgramSource source = ShaderPreprocessor::Specialize(*preprocessed, CullShaderPath, {});
+
+    GLint major = 0, minor = 0;
+    glCall(glGetIntegerv(GL_MAJOR_VERSION, &major));
+    glCall(glGetIntegerv(GL_MINOR_VERSION, &minor));
+    if (major > 4 || (major == 4 && minor >= 3)) {
+        s_dispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)glfwGetProcAddress("glDispatchCompute");
+        s_memoryBarrier = (PFNGLMEMORYBARRIERPROC)glfwGetProcAddress("glMemoryBarrier");
+        if (s_dispatchCompute && s_memoryBarrier)
+            m_program = BuildProgram({{GL_COMPUTE_SHADER, &source.ComputeSource}}, false);
+        if (m_program)
+            m_mode = Mode::Compute;
+    }
+    if (!m_program) {
+        m_program = BuildProgram({{GL_VERTEX_SHADER, &source.VertexSource}, {GL_GEOMETRY_SHADER, &source.GeometrySource}}, true);
+        m_mode = Mode::TransformFeedback;
+    }
+    if (!m_program) {
+        std::cout << "Error (GPU CULLING): no cull program, nothing gets culled" << std::endl;
+        return;
+    }
+    std::cout << "Info (GPU CULLING): " << GetModeName() << ", up to " << maxInstances << " instances" << std::endl;
+
+    // the packed matrices are read as instance attributes, nothing else
+    m_visible = std::make_unique<VertexBuffer>(nullptr, unsigned(std::size_t(maxInstances) * sizeof(glm::mat4)));
+    for (Frame& frame : m_frames) {
+        glCall(glGenQueries(1, &frame.timeQuery));
+    }
+    if (m_mode == Mode::Compute) {
+        glCall(glGenBuffers(1, &m_drawArgs));
+        glCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_drawArgs));
+        glCall(glBufferData(GL_COPY_WRITE_BUFFER, sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW));
+        for (Frame& frame : m_frames) {
+            glCall(glGenBuffers(1, &frame.countBuffer));
+            glCall(glBindBuffer(GL_COPY_WRITE_BUFFER, frame.countBuffer));
+            glCall(glBufferData(GL_COPY_WRITE_BUFFER, sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_READ));
+        }
+    } else {
+        glCall(glGenQueries(1, &m_feedbackQuery));
+    }
+}
+
+GpuCuller::~GpuCuller()
+{
+    for (Frame& frame : m_frames) {
+        if (frame.timeQuery) {
+            glCall(glDeleteQueries(1, &frame.timeQuery));
+        }
+        if (frame.countBuffer) {
+            glCall(glDeleteBuffers(1, &frame.countBuffer));
+        }
+    }
+    if (m_feedbackQuery) {
+        glCall(glDeleteQueries(1, &m_feedbackQuery));
+    }
+    if (m_drawArgs) {
+        glCall(glDeleteBuffers(1, &m_drawArgs));
+    }
+    if (m_program) {
+        glCall(glDeleteProgram(m_program));
+    }
+}
+
+void GpuCuller::CollectFrame(Frame& frame, bool wait)
+{
+    if (!frame.pending)
+        return;
+    if (!wait) {
+        GLuint available = GL_FALSE;
+        glCall(glGetQueryObjectuiv(frame.timeQuery, GL_QUERY_RESULT_AVAILABLE, &available));
+        if (!available)
+            return;
+    }
+    GLuint64 nanoseconds = 0;
+    glCall(glGetQueryObjectui64v(frame.timeQuery, GL_QUERY_RESULT, &nanoseconds));
+    m_stats.gpuMs = double(nanoseconds) / 1e6;
+    if (m_mode == Mode::Compute) {
+        // done once the query is, the copy came before its end
+        DrawElementsIndirectCommand args = {};
+        glCall(glBindBuffer(GL_COPY_READ_BUFFER, frame.countBuffer));
+        glCall(glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(args), &args));
+        m_stats.visible = args.instanceCount;
+    }
+    frame.pending = false;
+}
+
+void GpuCuller::Cull(const VertexBuffer& instances, unsigned int count, const glm::mat4& viewProjection, const glm::vec4& localSphere,
+                     unsigned int indexCount)
+{
+    if (!m_program)
+        return;
+    count = std::min(count, m_maxInstances);
+    m_stats.tested = count;
+    m_indexCount = indexCount;
+
+    // the previous frame's readbacks if they're there already, the one before that is surely done
+    CollectFrame(m_frames[m_frame ^ 1], false);
+    Frame& frame = m_frames[m_frame];
+    CollectFrame(frame, true);
+    m_frame ^= 1;
+
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(viewProjection, planes);
+    glCall(glUseProgram(m_program));
+    glCall(glUniform4fv(glGetUniformLocation(m_program, "u_FrustumPlanes"), 6, &planes[0].x));
+    glCall(glUniform4f(glGetUniformLocation(m_program, "u_LocalSphere"), localSphere.x, localSphere.y, localSphere.z, localSphere.w));
+
+    glCall(glBeginQuery(GL_TIME_ELAPSED, frame.timeQuery));
+    if (m_mode == Mode::Compute) {
+        const DrawElementsIndirectCommand args = {indexCount, 0, 0, 0, 0};
+        glCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_drawArgs));
+        glCall(glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(args), &args));
+        glCall(glUniform1ui(glGetUniformLocation(m_program, "u_Count"), count));
+        glCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instances.GetRendererID()));
+        glCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_visible->GetRendererID()));
+        glCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_drawArgs));
+        glCall(s_dispatchCompute((count + GroupSize - 1) / GroupSize, 1, 1));
+        // the draw reads the matrices as attributes and the count as indirect arguments, the copy reads the count
+        glCall(s_memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT));
+        glCall(glBindBuffer(GL_COPY_READ_BUFFER, m_drawArgs));
+        glCall(glBindBuffer(GL_COPY_WRITE_BUFFER, frame.countBuffer));
+        glCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(DrawElementsIndirectCommand)));
+        for (unsigned int binding = 0; binding < 3; binding++) {
+            glCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0));
+        }
+    } else {
+        // a point per matrix, the four columns as attributes 0 to 3
+        if (!m_feedbackVao || m_feedbackSource != instances.GetRendererID()) {
+            m_feedbackVao = std::make_unique<VertexArray>();
+            VertexBufferLayout layout;
+            for (int column = 0; column < 4; column++)
+                layout.Push<float>(4);
+            m_feedbackVao->AddBuffer(instances, layout);
+            m_feedbackSource = instances.GetRendererID();
+        }
+        m_feedbackVao->Bind();
+        glCall(glEnable(GL_RASTERIZER_DISCARD));
+        glCall(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_visible->GetRendererID()));
+        glCall(glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, m_feedbackQuery));
+        glCall(glBeginTransformFeedback(GL_POINTS));
+        glCall(glDrawArrays(GL_POINTS, 0, GLsizei(count)));
+        glCall(glEndTransformFeedback());
+        glCall(glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN));
+        glCall(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0));
+        glCall(glDisable(GL_RASTERIZER_DISCARD));
+        m_feedbackVao->Unbind();
+    }
+    glCall(glEndQuery(GL_TIME_ELAPSED));
+    frame.pending = true;
+
+    if (m_mode == Mode::TransformFeedback) {
+        // 3.3 can't feed a query result into a draw, the CPU has to wait for it here
+        glCall(glGetQueryObjectuiv(m_feedbackQuery, GL_QUERY_RESULT, &m_visibleCount));
+        m_stats.visible = m_visibleCount;
+    }
+}
+
+void GpuCuller::Draw(const Renderer& renderer, const VertexArray& va, const ElementIndexBuffer& ib, const Shader& shader) const
+{
+    if (!m_program || !shader.GetActiveProgram())
+        return;
+    if (m_mode == Mode::TransformFeedback) {
+        if (m_visibleCount > 0)
+            renderer.DrawInstanced(va, ib, shader, m_visibleCount);
+        return;
+    }
+    shader.Bind();
+    va.Bind();
+    ib.Bind();
+    glCall(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_drawArgs));
+    glCall(glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr));
+    glCall(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+}
+
+void GpuCuller::ReadVisible(std::vector<glm::mat4>& visible)
+{
+    visible.clear();
+    if (!m_program)
+        return;
+    unsigned int count = m_visibleCount;
+    if (m_mode == Mode::Compute) {
+        DrawElementsIndirectCommand args = {};
+        glCall(glBindBuffer(GL_COPY_READ_BUFFER, m_drawArgs));
+        glCall(glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(args), &args));
+        count = args.instanceCount;
+    }
+    visible.resize(count);
+    glCall(glBindBuffer(GL_COPY_READ_BUFFER, m_visible->GetRendererID()));
+    glCall(glGetBufferSubData(GL_COPY_READ_BUFFER, 0, GLsizeiptr(count * sizeof(glm::mat4)), visible.data()));
+}
+
+void GpuCuller::ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+{
+    // rows of the matrix, clip space is -w <= x, y, z <= w (Gribb and Hartmann)
+    glm::vec4 rows[4];
+    for (int row = 0; row < 4; row++)
+        rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+    planes[4] = rows[3] + rows[2];
+    planes[5] = rows[3] - rows[2];
+    for (int plane = 0; plane < 6; plane++)
+        planes[plane] /= glm::length(glm::vec3(planes[plane]));
+}
+
+unsigned int GpuCuller::CullOnCpu(const glm::mat4* instances, unsigned int count, const glm::mat4& viewProjection,
+                                  const glm::vec4& localSphere, std::vector<glm::mat4>* visible)
+{
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(viewProjection, planes);
+    unsigned int visibleCount = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        if (!SphereVisible(instances[i], localSphere, planes))
+            continue;
+        visibleCount++;
+        if (visible)
+            visible->push_back(instances[i]);
+    }
+    return visibleCount;
+}
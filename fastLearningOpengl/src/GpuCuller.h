@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "glm/glm.hpp"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+
+class Renderer;
+class Shader;
+class ElementIndexBuffer;
+
+struct GpuCullStats
+{
+    unsigned int tested = 0;
+    unsigned int visible = 0; // of a recent frame (compute: read back a frame or two late, no stall)
+    double gpuMs = 0.0;       // the cull pass alone, from a timer query of a recent frame
+};
+
+// frustum culling of instanced draws on the GPU. The instances are a buffer of mat4 model matrices
+// sharing one bounding sphere in object space; the visible ones are packed into GetVisibleBuffer
+// and drawn from there, so the CPU never touches per instance visibility.
+// GL 4.3 uses a compute shader that also counts the survivors straight into the indirect draw
+// arguments. Before that transform feedback packs them, and the count is a query the CPU waits for
+// before the draw (the cull pass is short, but it is a sync point)
+class GpuCuller
+{
+public:
+    enum class Mode
+    {
+        Compute,
+        TransformFeedback
+    };
+
+private:
+    // a cull pass whose readbacks may not be finished yet
+    struct Frame
+    {
+        unsigned int timeQuery = 0;
+        unsigned int countBuffer = 0; // compute: copy of the draw arguments
+        bool pending = false;
+    };
+
+    Mode m_mode = Mode::TransformFeedback;
+    unsigned int m_program = 0;
+    unsigned int m_maxInstances;
+    std::unique_ptr<VertexBuffer> m_visible;
+    unsigned int m_drawArgs = 0;           // DrawElementsIndirectCommand, compute only
+    unsigned int m_feedbackQuery = 0;      // primitives written, transform feedback only
+    std::unique_ptr<VertexArray> m_feedbackVao; // the instance buffer as a point per matrix
+    unsigned int m_feedbackSource = 0;     // the buffer m_feedbackVao reads
+    unsigned int m_indexCount = 0;
+    unsigned int m_visibleCount = 0;       // transform feedback: of this frame
+    Frame m_frames[2];
+    unsigned int m_frame = 0;
+    GpuCullStats m_stats;
+
+    void CollectFrame(Frame& frame, bool wait);
+
+public:
+    explicit GpuCuller(unsigned int maxInstances);
+    ~GpuCuller();
+    GpuCuller(const GpuCuller&) = delete;
+    GpuCuller& operator=(const GpuCuller&) = delete;
+
+    // tests the first count matrices of instances against the frustum of viewProjection.
+    // localSphere is center (xyz) and radius (w) in object space, indexCount is what Draw draws per instance
+    void Cull(const VertexBuffer& instances, unsigned int count, const glm::mat4& viewProjection, const glm::vec4& localSphere,
+              unsigned int indexCount);
+    // the visible instances of the last Cull; va takes its per instance matrices from GetVisibleBuffer
+    void Draw(const Renderer& renderer, const VertexArray& va, const ElementIndexBuffer& ib, const Shader& shader) const;
+
+    // waits for the last Cull and reads the visible matrices back (in the GPU's order), for validation
+    void ReadVisible(std::vector<glm::mat4>& visible);
+
+    inline bool IsValid() const { return m_program != 0; }
+    inline Mode GetMode() const { return m_mode; }
+    inline const char* GetModeName() const { return m_mode == Mode::Compute ? "compute shader" : "transform feedback"; }
+    inline const VertexBuffer& GetVisibleBuffer() const { return *m_visible; }
+    inline const GpuCullStats& GetStats() const { return m_stats; }
+
+    // planes with the normal pointing inside, normalized, left right bottom top near far
+    static void ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+    // the reference: the same test on the CPU, returns the visible count and appends them to visible if given
+    static unsigned int CullOnCpu(const glm::mat4* instances, unsigned int count, const glm::mat4& viewProjection,
+                                  const glm::vec4& localSphere, std::vector<glm::mat4>* visible);
+};
@@ -0,0 +1,186 @@
+#include "IndirectDraw.h"
+#include "Renderer.h"
+#include "VertexBuffer.h"
+#include "VertexBufferLayout.h"
+#include "GLFW/glfw3.h" // glfwGetProcAddress, glad stops at 4.1
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // 4.3, not in the 4.1 glad
+    typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+    constexpr unsigned int TexelsPerDraw = sizeof(IndirectDrawData) / (4 * sizeof(float));
+
+    bool s_detected = false;
+    IndirectDraw::Mode s_mode = IndirectDraw::Mode::Loop;
+    bool s_forceLoop = false;
+    PFNGLMULTIDRAWELEMENTSINDIRECTPROC s_multiDrawElementsIndirect = nullptr;
+    GLint s_maxBufferTexels = 65536; // the GL 3.3 minimum
+    std::unique_ptr<VertexBuffer> s_drawIds;
+    bool s_reportedOverflow = false;
+
+    void Detect()
+    {
+        s_detected = true;
+        GLint major = 0, minor = 0;
+        glCall(glGetIntegerv(GL_MAJOR_VERSION, &major));
+        glCall(glGetIntegerv(GL_MINOR_VERSION, &minor));
+        glCall(glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &s_maxBufferTexels));
+
+        // baseInstance comes with 4.2, multi draw indirect with 4.3
+        const bool core43 = major > 4 || (major == 4 && minor >= 3);
+        if (core43 || (glHasExtension("GL_ARB_multi_draw_indirect") && glHasExtension("GL_ARB_base_instance"))) {
+            s_multiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)glfwGetProcAddress("glMultiDrawElementsIndirect");
+            if (s_multiDrawElementsIndirect)
+                s_mode = IndirectDraw::Mode::MultiDrawIndirect;
+        }
+        std::cout << "Info (INDIRECT DRAW): " << IndirectDraw::GetModeName() << ", up to "
+                  << s_maxBufferTexels / TexelsPerDraw << " draws per list" << std::endl;
+    }
+}
+
+namespace IndirectDraw
+{
+    Mode GetMode()
+    {
+        if (!s_detected)
+            Detect();
+        return s_forceLoop ? Mode::Loop : s_mode;
+    }
+
+    const char* GetModeName()
+    {
+        return GetMode() == Mode::MultiDrawIndirect ? "glMultiDrawElementsIndirect" : "glDrawElementsBaseVertex loop";
+    }
+
+    void SetForceLoop(bool force)
+    {
+        s_forceLoop = force;
+    }
+
+    bool IsLoopForced()
+    {
+        return s_forceLoop;
+    }
+
+    void AddDrawIdAttribute(VertexArray& va)
+    {
+        if (!s_drawIds) {
+            std::vector<float> ids(MaxDraws);
+            for (unsigned int i = 0; i < MaxDraws; i++)
+                ids[i] = float(i); // exact, far below 2^24
+            s_drawIds = std::make_unique<VertexBuffer>(ids.data(), unsigned(ids.size() * sizeof(float)));
+        }
+        VertexBufferLayout layout;
+        layout.Push<float>(1, 1);
+        va.AddBuffer(*s_drawIds, layout);
+    }
+
+    void Release()
+    {
+        s_drawIds.reset();
+    }
+}
+
+IndirectDrawList::~IndirectDrawList()
+{
+    if (m_dataTexture) {
+        glCall(glDeleteTextures(1, &m_dataTexture));
+    }
+    if (m_dataBuffer) {
+        glCall(glDeleteBuffers(1, &m_dataBuffer));
+    }
+    if (m_commandBuffer) {
+        glCall(glDeleteBuffers(1, &m_commandBuffer));
+    }
+}
+
+void IndirectDrawList::Clear()
+{
+    m_commands.clear();
+    m_data.clear();
+}
+
+void IndirectDrawList::Add(unsigned int indexCount, unsigned int firstIndex, int baseVertex, const glm::mat4& model, const glm::vec4& color)
+{
+    // longer lists go out in batches of MaxDraws, u_DrawIDOffset adds the batch start
+    m_commands.push_back({indexCount, 1, firstIndex, baseVertex, unsigned(m_commands.size() % IndirectDraw::MaxDraws)});
+    m_data.push_back({model, color});
+}
+
+void IndirectDrawList::Draw(const VertexArray& va, const ElementIndexBuffer& ib, Shader& shader, unsigned int textureSlot)
+{
+    m_uploadMs = m_submitMs = 0.0;
+    if (m_commands.empty() || !shader.GetActiveProgram())
+        return;
+    const IndirectDraw::Mode mode = IndirectDraw::GetMode();
+
+    std::size_t drawCount = m_commands.size();
+    if (drawCount * TexelsPerDraw > std::size_t(s_maxBufferTexels)) {
+        drawCount = std::size_t(s_maxBufferTexels) / TexelsPerDraw;
+        if (!s_reportedOverflow)
+            std::cout << "Error (INDIRECT DRAW): " << m_commands.size() << " draws don't fit the buffer texture, only "
+                      << drawCount << " are drawn" << std::endl;
+        s_reportedOverflow = true;
+    }
+
+    // orphaned every frame, the GPU can still be reading last frame's lists
+    auto start = Clock::now();
+    if (!m_dataBuffer) {
+        glCall(glGenBuffers(1, &m_dataBuffer));
+        glCall(glGenTextures(1, &m_dataTexture));
+        // the texture refers to the buffer object, it follows the buffer through every orphan
+        glCall(glActiveTexture(GL_TEXTURE0 + textureSlot));
+        glCall(glBindTexture(GL_TEXTURE_BUFFER, m_dataTexture));
+        glCall(glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_dataBuffer));
+    }
+    glCall(glBindBuffer(GL_TEXTURE_BUFFER, m_dataBuffer));
+    glCall(glBufferData(GL_TEXTURE_BUFFER, GLsizeiptr(drawCount * sizeof(IndirectDrawData)), m_data.data(), GL_STREAM_DRAW));
+    glCall(glBindBuffer(GL_TEXTURE_BUFFER, 0));
+    if (mode == IndirectDraw::Mode::MultiDrawIndirect) {
+        if (!m_commandBuffer) {
+            glCall(glGenBuffers(1, &m_commandBuffer));
+        }
+        glCall(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer));
+        glCall(glBufferData(GL_DRAW_INDIRECT_BUFFER, GLsizeiptr(drawCount * sizeof(DrawElementsIndirectCommand)), m_commands.data(), GL_STREAM_DRAW));
+    }
+    m_uploadMs = MillisecondsSince(start);
+
+    start = Clock::now();
+    glCall(glActiveTexture(GL_TEXTURE0 + textureSlot));
+    glCall(glBindTexture(GL_TEXTURE_BUFFER, m_dataTexture));
+    shader.Bind();
+    shader.SetUniform1i("u_DrawData", int(textureSlot));
+
+    va.Bind();
+    ib.Bind();
+    if (mode == IndirectDraw::Mode::MultiDrawIndirect) {
+        for (std::size_t first = 0; first < drawCount; first += IndirectDraw::MaxDraws) {
+            shader.SetUniform1i("u_DrawIDOffset", int(first));
+            glCall(s_multiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(first * sizeof(DrawElementsIndirectCommand)),
+                                               GLsizei(std::min<std::size_t>(drawCount - first, IndirectDraw::MaxDraws)), 0));
+        }
+        glCall(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+    } else {
+        // everything is bound already, only the draw ID changes between the calls
+        for (std::size_t i = 0; i < drawCount; i++) {
+            const DrawElementsIndirectCommand& command = m_commands[i];
+            shader.SetUniform1i("u_DrawIDOffset", int(i));
+            glCall(glDrawElementsBaseVertex(GL_TRIANGLES, GLsizei(command.count), GL_UNSIGNED_INT,
+                                            (const void*)(std::size_t(command.firstIndex) * sizeof(unsigned int)), command.baseVertex));
+        }
+    }
+    m_submitMs = MillisecondsSince(start);
+}
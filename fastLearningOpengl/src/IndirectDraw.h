@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+class Shader;
+class VertexArray;
+class ElementIndexBuffer;
+
+// the layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+    std::uint32_t count;
+    std::uint32_t instanceCount;
+    std::uint32_t firstIndex;
+    std::int32_t baseVertex;
+    std::uint32_t baseInstance; // the draw's index in the list, it's what selects the draw ID
+};
+
+// what a draw of the INDIRECT shader variants fetches from u_DrawData (5 RGBA32F texels per draw)
+struct IndirectDrawData
+{
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+// a draw can't see its own index without GL 4.6 (gl_DrawID), so every indexed vertex array used for
+// indirect draws gets a per instance float attribute counting 0, 1, 2, ... With baseInstance = draw
+// index that attribute is the draw ID. The 3.3 fallback has no baseInstance, the attribute reads 0
+// there and u_DrawIDOffset carries the index instead, so both paths share one shader
+namespace IndirectDraw
+{
+    enum class Mode
+    {
+        MultiDrawIndirect, // GL 4.3 or ARB_multi_draw_indirect: the whole list is one call
+        Loop               // one glDrawElementsBaseVertex per command, no binds in between
+    };
+
+    // draw IDs the attribute counts up to, bigger lists are split into calls of this many
+    constexpr unsigned int MaxDraws = 65536;
+
+    // detected on first use, on the GL thread
+    Mode GetMode();
+    const char* GetModeName();
+    // the fallback on a driver that wouldn't need it, for comparisons
+    void SetForceLoop(bool force);
+    bool IsLoopForced();
+
+    // appends the draw ID attribute to the vertex array: the location after its last one
+    void AddDrawIdAttribute(VertexArray& va);
+    // deletes the shared draw ID buffer, call before the GL context goes away
+    void Release();
+}
+
+// commands and per draw data built on the CPU every frame, uploaded and drawn in one go
+class IndirectDrawList
+{
+private:
+    std::vector<DrawElementsIndirectCommand> m_commands;
+    std::vector<IndirectDrawData> m_data;
+    unsigned int m_commandBuffer = 0;
+    unsigned int m_dataBuffer = 0;
+    unsigned int m_dataTexture = 0; // buffer texture over m_dataBuffer
+    double m_uploadMs = 0.0;
+    double m_submitMs = 0.0;
+
+public:
+    IndirectDrawList() = default;
+    ~IndirectDrawList();
+    IndirectDrawList(const IndirectDrawList&) = delete;
+    IndirectDrawList& operator=(const IndirectDrawList&) = delete;
+
+    void Clear();
+    void Add(unsigned int indexCount, unsigned int firstIndex, int baseVertex, const glm::mat4& model, const glm::vec4& color);
+
+    // shader is an INDIRECT variant, the buffer texture goes to textureSlot. Every command indexes
+    // ib and reads va, which needs the draw ID attribute
+    void Draw(const VertexArray& va, const ElementIndexBuffer& ib, Shader& shader, unsigned int textureSlot = 0);
+
+    inline std::size_t GetDrawCount() const { return m_commands.size(); }
+    inline double GetUploadMs() const { return m_uploadMs; }
+    inline double GetSubmitMs() const { return m_submitMs; }
+};
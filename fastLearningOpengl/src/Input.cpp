@@ -0,0 +1,93 @@
+#include "Input.h"
+
+#include <GLFW/glfw3.h>
+
+namespace
+{
+    void KeyCallback(GLFWwindow*, int key, int, int action, int mods)
+    {
+        InputEvent event;
+        event.type = InputEventType::Key;
+        event.pressed = action != GLFW_RELEASE;
+        event.repeat = action == GLFW_REPEAT;
+        event.code = key;
+        event.mods = mods;
+        Input::Get().Push(event);
+    }
+
+    void MouseButtonCallback(GLFWwindow*, int button, int action, int mods)
+    {
+        InputEvent event;
+        event.type = InputEventType::MouseButton;
+        event.pressed = action != GLFW_RELEASE;
+        event.code = button;
+        event.mods = mods;
+        Input::Get().Push(event);
+    }
+
+    void CursorPosCallback(GLFWwindow*, double x, double y)
+    {
+        InputEvent event;
+        event.type = InputEventType::CursorMove;
+        event.x = float(x);
+        event.y = float(y);
+        Input::Get().Push(event);
+    }
+
+    void ScrollCallback(GLFWwindow*, double x, double y)
+    {
+        InputEvent event;
+        event.type = InputEventType::Scroll;
+        event.x = float(x);
+        event.y = float(y);
+        Input::Get().Push(event);
+    }
+}
+
+InputSystem::InputSystem()
+{
+    Bind(GLFW_KEY_W, InputAction::MoveForward);
+    Bind(GLFW_KEY_S, InputAction::MoveBack);
+    Bind(GLFW_KEY_A, InputAction::MoveLeft);
+    Bind(GLFW_KEY_D, InputAction::MoveRight);
+    Bind(GLFW_KEY_SPACE, InputAction::MoveUp);
+    Bind(GLFW_KEY_LEFT_SHIFT, InputAction::MoveDown);
+    Bind(GLFW_KEY_ESCAPE, InputAction::Quit);
+}
+
+void InputSystem::Install(GLFWwindow* window)
+{
+    glfwSetKeyCallback(window, KeyCallback);
+    glfwSetMouseButtonCallback(window, MouseButtonCallback);
+    glfwSetCursorPosCallback(window, CursorPosCallback);
+    glfwSetScrollCallback(window, ScrollCallback);
+}
+
+void InputSystem::Bind(int key, InputAction action)
+{
+    if (key >= 0 && key < KeyCount)
+        m_keyActions[key] = action;
+}
+
+InputAction InputSystem::GetBinding(int key) const
+{
+    // GLFW_KEY_UNKNOWN is -1
+    return key >= 0 && key < KeyCount ? m_keyActions[key] : InputAction::None;
+}
+
+void InputSystem::Push(const InputEvent& event)
+{
+    InputEvent stamped = event;
+    stamped.timeNs = NowNs();
+    if (!m_queue.TryPush(stamped))
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+namespace Input
+{
+    InputSystem& Get()
+    {
+        static InputSystem s_input;
+        return s_input;
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "SpscQueue.h"
+
+struct GLFWwindow;
+
+// what a key means, the tests react to actions instead of key codes
+enum class InputAction : std::uint8_t
+{
+    None,
+    MoveForward,
+    MoveBack,
+    MoveLeft,
+    MoveRight,
+    MoveUp,
+    MoveDown,
+    Quit,
+    Count
+};
+
+enum class InputEventType : std::uint8_t
+{
+    Key,
+    MouseButton,
+    CursorMove,
+    Scroll
+};
+
+struct InputEvent
+{
+    InputEventType type = InputEventType::Key;
+    InputAction action = InputAction::None; // keys only, from the action map when dispatched
+    bool pressed = false;                   // keys and buttons: press or repeat, false on release
+    bool repeat = false;
+    int code = 0;                           // GLFW key or mouse button
+    int mods = 0;
+    float x = 0.0f, y = 0.0f;               // cursor position or scroll offset
+    std::int64_t timeNs = 0;                // InputSystem::NowNs when GLFW delivered it
+};
+
+struct InputStats
+{
+    unsigned int events = 0;        // dispatched last frame
+    unsigned int dropped = 0;       // the queue was full, all time
+    double maxDelayMs = 0.0;        // delivered to dispatched, the worst event last frame
+};
+
+// event driven input: the GLFW callbacks only push into a lock-free single producer / single consumer
+// ring, Dispatch drains it once per frame, maps keys to actions and hands every event to the handler.
+// Nothing polls key state. The ring is the thread boundary, the consumer doesn't have to be the
+// thread GLFW delivers on; events carry their own time, so a consumer can act on when a key really
+// went down instead of on which frame noticed it
+class InputSystem
+{
+public:
+    static constexpr int KeyCount = 512; // above GLFW_KEY_LAST
+
+private:
+    SpscQueue<InputEvent, 1024> m_queue;
+    std::array<InputAction, KeyCount> m_keyActions{};
+    std::atomic<unsigned int> m_dropped{0};
+    std::int64_t m_dispatchNs = 0;
+    InputStats m_stats;
+
+public:
+    InputSystem(); // WASD, space and left shift move, escape quits
+
+    // sets the window's key, mouse and scroll callbacks. Before ImGui_ImplGlfw_InitForOpenGL, which
+    // chains its own to them
+    void Install(GLFWwindow* window);
+
+    void Bind(int key, InputAction action);
+    InputAction GetBinding(int key) const;
+
+    // GLFW callbacks, the producer side
+    void Push(const InputEvent& event);
+
+    // the consumer side, handler gets every queued event in order
+    template<typename Handler>
+    unsigned int Dispatch(Handler&& handler)
+    {
+        m_dispatchNs = NowNs();
+        m_stats.events = 0;
+        m_stats.maxDelayMs = 0.0;
+        InputEvent event;
+        while (m_queue.TryPop(event)) {
+            if (event.type == InputEventType::Key)
+                event.action = GetBinding(event.code);
+            double delayMs = double(m_dispatchNs - event.timeNs) / 1e6;
+            m_stats.maxDelayMs = delayMs > m_stats.maxDelayMs ? delayMs : m_stats.maxDelayMs;
+            m_stats.events++;
+            handler(static_cast<const InputEvent&>(event));
+        }
+        m_stats.dropped = m_dropped.load(std::memory_order_relaxed);
+        return m_stats.events;
+    }
+
+    // when the last Dispatch started, the "now" to measure held keys up to
+    inline std::int64_t GetDispatchNs() const { return m_dispatchNs; }
+    inline const InputStats& GetStats() const { return m_stats; }
+
+    static std::int64_t NowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+// the application's input, installed on the main window
+namespace Input
+{
+    InputSystem& Get();
+}
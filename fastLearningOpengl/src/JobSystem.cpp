@@ -0,0 +1,241 @@
+#include "JobSystem.h"
+
+// which system and slot the current thread belongs to, threads that aren't workers are slot 0 of their owner
+static thread_local const JobSystem* t_system = nullptr;
+static thread_local unsigned int t_threadIndex = 0;
+
+// spins (yielding) this many times without finding work before a worker goes to sleep
+static constexpr int IdleSpinCount = 64;
+
+JobDeque::JobDeque()
+    : m_buffer(new std::atomic<Job*>[Capacity])
+{
+    for (std::size_t i = 0; i < Capacity; i++)
+        m_buffer[i].store(nullptr, std::memory_order_relaxed);
+}
+
+// the orderings follow Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models",
+// with the fences folded into seq_cst loads/stores (ThreadSanitizer doesn't understand standalone fences).
+// every store to bottom is a release so a thief that reads any of them also sees the job it published
+bool JobDeque::Push(Job* job)
+{
+    std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    std::int64_t top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= std::int64_t(Capacity))
+        return false;
+    m_buffer[bottom & (Capacity - 1)].store(job, std::memory_order_relaxed);
+    m_bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+Job* JobDeque::Pop()
+{
+    std::int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_seq_cst);
+    std::int64_t top = m_top.load(std::memory_order_seq_cst);
+    if (top > bottom) {
+        // was empty
+        m_bottom.store(bottom + 1, std::memory_order_release);
+        return nullptr;
+    }
+
+    Job* job = m_buffer[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        // last one, race the thieves for it
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        m_bottom.store(bottom + 1, std::memory_order_release);
+    }
+    return job;
+}
+
+Job* JobDeque::Steal()
+{
+    std::int64_t top = m_top.load(std::memory_order_seq_cst);
+    std::int64_t bottom = m_bottom.load(std::memory_order_seq_cst);
+    if (top >= bottom)
+        return nullptr;
+
+    Job* job = m_buffer[top & (Capacity - 1)].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr; // another thief or the owner was faster
+    return job;
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+    : m_ownerThread(std::this_thread::get_id())
+{
+    for (unsigned int i = 0; i <= workerCount; i++) {
+        auto state = std::make_unique<ThreadState>();
+        state->jobs.reset(new Job[MaxJobsPerThread]);
+        state->randomState = 0x9E3779B9u * (i + 1);
+        m_threads.push_back(std::move(state));
+    }
+    m_workers.reserve(workerCount);
+    for (unsigned int i = 1; i <= workerCount; i++)
+        m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_quit.store(true);
+    }
+    m_wakeUp.notify_all();
+    for (std::thread& worker : m_workers)
+        worker.join();
+}
+
+unsigned int JobSystem::GetThreadIndex() const
+{
+    if (t_system == this)
+        return t_threadIndex;
+    assert(std::this_thread::get_id() == m_ownerThread && "jobs can only be used from the creating thread and the workers");
+    return 0;
+}
+
+Job* JobSystem::Allocate()
+{
+    unsigned int index = GetThreadIndex();
+    ThreadState& thread = *m_threads[index];
+    Job* job = &thread.jobs[thread.nextJob++ & (MaxJobsPerThread - 1)];
+
+    // the ring wrapped around onto a job that is still queued or running, help until it's done
+    while (job->inUse.load(std::memory_order_acquire)) {
+        if (Job* other = FindJob(index))
+            Execute(other);
+        else
+            std::this_thread::yield();
+    }
+
+    job->inUse.store(true, std::memory_order_relaxed);
+    job->function = nullptr;
+    job->counter = nullptr;
+    job->unfinished.store(1, std::memory_order_relaxed);
+    job->dependentCount = 0;
+    return job;
+}
+
+void JobSystem::AddDependency(Job* job, Job* dependency)
+{
+    assert(dependency->dependentCount < Job::MaxDependents && "too many jobs depend on this one");
+    dependency->dependents[dependency->dependentCount++] = job;
+    job->unfinished.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JobSystem::Run(Job* job, JobCounter* counter)
+{
+    if (counter)
+        counter->m_value.fetch_add(1, std::memory_order_relaxed);
+    job->counter = counter;
+    // whoever drops the count to zero (this or the last dependency) queues it
+    if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        Push(job);
+}
+
+void JobSystem::Push(Job* job)
+{
+    ThreadState& thread = *m_threads[GetThreadIndex()];
+    m_queuedJobs.fetch_add(1);
+    if (!thread.deque.Push(job)) {
+        // deque is full, no point in queueing more
+        m_queuedJobs.fetch_sub(1);
+        Execute(job);
+        return;
+    }
+
+    if (m_sleepingWorkers.load() > 0) {
+        // taking the lock makes sure the worker is either still checking m_queuedJobs or already waiting
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wakeUp.notify_one();
+    }
+}
+
+Job* JobSystem::FindJob(unsigned int index)
+{
+    ThreadState& thread = *m_threads[index];
+    Job* job = thread.deque.Pop();
+    if (!job) {
+        // steal from the others, starting at a random victim so thieves spread out
+        const unsigned int threadCount = GetThreadCount();
+        thread.randomState ^= thread.randomState << 13;
+        thread.randomState ^= thread.randomState >> 17;
+        thread.randomState ^= thread.randomState << 5;
+        unsigned int start = thread.randomState % threadCount;
+        for (unsigned int i = 0; i < threadCount && !job; i++) {
+            unsigned int victim = (start + i) % threadCount;
+            if (victim != index)
+                job = m_threads[victim]->deque.Steal();
+        }
+    }
+    if (job)
+        m_queuedJobs.fetch_sub(1);
+    return job;
+}
+
+void JobSystem::Execute(Job* job)
+{
+    job->function(*job);
+    Finish(job);
+}
+
+void JobSystem::Finish(Job* job)
+{
+    for (unsigned int i = 0; i < job->dependentCount; i++) {
+        Job* dependent = job->dependents[i];
+        if (dependent->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            Push(dependent);
+    }
+
+    JobCounter* counter = job->counter;
+    job->inUse.store(false, std::memory_order_release);
+    // the waiter may return (and destroy the counter) right after this
+    if (counter)
+        counter->m_value.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+    unsigned int index = GetThreadIndex();
+    while (!counter.IsDone()) {
+        if (Job* job = FindJob(index))
+            Execute(job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::WorkerLoop(unsigned int index)
+{
+    t_system = this;
+    t_threadIndex = index;
+
+    int idleSpins = 0;
+    while (!m_quit.load(std::memory_order_relaxed)) {
+        if (Job* job = FindJob(index)) {
+            Execute(job);
+            idleSpins = 0;
+            continue;
+        }
+        if (++idleSpins < IdleSpinCount) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepingWorkers.fetch_add(1);
+        m_wakeUp.wait(lock, [this] { return m_queuedJobs.load() > 0 || m_quit.load(); });
+        m_sleepingWorkers.fetch_sub(1);
+        idleSpins = 0;
+    }
+}
+
+namespace Jobs
+{
+    JobSystem& Get()
+    {
+        static JobSystem system(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return system;
+    }
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// counts the unfinished jobs that were started with it, Wait() returns once it hits zero
+class JobCounter
+{
+private:
+    std::atomic<int> m_value{0};
+    friend class JobSystem;
+
+public:
+    inline bool IsDone() const { return m_value.load(std::memory_order_acquire) == 0; }
+};
+
+struct Job
+{
+    static constexpr std::size_t DataSize = 64;
+    static constexpr unsigned int MaxDependents = 4;
+
+    void (*function)(Job& job) = nullptr;
+    JobCounter* counter = nullptr;
+    std::atomic<int> unfinished{0};  // 1 for Run() plus one per unfinished dependency
+    std::atomic<bool> inUse{false};  // cleared once the job ran, the owner's ring can reuse it then
+    unsigned int dependentCount = 0;
+    Job* dependents[MaxDependents] = {};
+    alignas(std::max_align_t) unsigned char data[DataSize];
+
+    // the lambda/functor stored in data
+    template<typename T>
+    inline T& GetData() { return *reinterpret_cast<T*>(data); }
+};
+
+// Chase-Lev work stealing deque of job pointers with a fixed capacity.
+// only the owning thread pushes and pops (LIFO, at the bottom), any thread may steal (FIFO, at the top)
+class JobDeque
+{
+private:
+    static constexpr std::size_t Capacity = 4096;
+
+    alignas(64) std::atomic<std::int64_t> m_top{0};
+    alignas(64) std::atomic<std::int64_t> m_bottom{0};
+    std::unique_ptr<std::atomic<Job*>[]> m_buffer;
+
+public:
+    JobDeque();
+
+    bool Push(Job* job); // false when full
+    Job* Pop();
+    Job* Steal();
+};
+
+// fixed set of worker threads, each with its own deque, idle workers steal from the others.
+// jobs are allocated from a per thread ring, so starting one never touches the heap.
+// only the thread that created the system and its own workers may create, run and wait for jobs
+// (the creating thread takes part as thread 0 while it waits)
+class JobSystem
+{
+public:
+    static constexpr unsigned int MaxJobsPerThread = 4096;
+
+private:
+    struct alignas(64) ThreadState
+    {
+        JobDeque deque;
+        std::unique_ptr<Job[]> jobs;
+        unsigned int nextJob = 0;
+        unsigned int randomState = 0;
+    };
+
+    std::vector<std::unique_ptr<ThreadState>> m_threads; // [0] is the creating thread
+    std::vector<std::thread> m_workers;
+    std::thread::id m_ownerThread;
+
+    std::atomic<int> m_queuedJobs{0};
+    std::atomic<int> m_sleepingWorkers{0};
+    std::atomic<bool> m_quit{false};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeUp;
+
+    unsigned int GetThreadIndex() const;
+    void WorkerLoop(unsigned int index);
+    Job* FindJob(unsigned int index);
+    void Execute(Job* job);
+    void Push(Job* job);
+    void Finish(Job* job);
+
+    template<typename Function>
+    static void Invoke(Job& job) { job.GetData<Function>()(); }
+
+    template<typename Function>
+    struct RangeTask
+    {
+        JobSystem* system;
+        const Function* function;
+        JobCounter* counter;
+        std::size_t begin, end, grainSize;
+
+        void operator()() const
+        {
+            // split until a grain is left, one half becomes a new (stealable) job
+            std::size_t first = begin, last = end;
+            while (last - first > grainSize) {
+                std::size_t middle = first + (last - first) / 2;
+                system->Run(RangeTask{system, function, counter, middle, last, grainSize}, counter);
+                last = middle;
+            }
+            (*function)(first, last);
+        }
+    };
+
+public:
+    // workerCount threads are started in addition to the creating thread
+    explicit JobSystem(unsigned int workerCount);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // the function is copied into the job, it has to be trivially copyable and fit Job::DataSize
+    // (lambdas capturing pointers, references and small values are)
+    template<typename Function>
+    Job* Create(const Function& function)
+    {
+        static_assert(sizeof(Function) <= Job::DataSize, "job data too large");
+        static_assert(std::is_trivially_copyable<Function>::value && std::is_trivially_destructible<Function>::value,
+                      "job data has to be trivially copyable");
+        Job* job = Allocate();
+        job->function = &Invoke<Function>;
+        new (job->data) Function(function);
+        return job;
+    }
+
+    // job won't start before dependency finished. Both must be created but not yet run
+    void AddDependency(Job* job, Job* dependency);
+    // counter, when given, is incremented now and decremented once the job finished
+    void Run(Job* job, JobCounter* counter = nullptr);
+
+    template<typename Function>
+    void Run(const Function& function, JobCounter* counter = nullptr) { Run(Create(function), counter); }
+
+    // runs other jobs until the counter is done, so it's fine to call from inside a job
+    void Wait(const JobCounter& counter);
+
+    // function(begin, end) over [0, count) in chunks of at most grainSize, returns when all are done.
+    // grainSize 0 picks roughly 8 chunks per thread
+    template<typename Function>
+    void ParallelFor(std::size_t count, std::size_t grainSize, const Function& function)
+    {
+        if (count == 0)
+            return;
+        if (grainSize == 0)
+            grainSize = std::max<std::size_t>(1, count / (GetThreadCount() * 8));
+        JobCounter counter;
+        Run(RangeTask<Function>{this, &function, &counter, 0, count, grainSize}, &counter);
+        Wait(counter);
+    }
+
+    inline unsigned int GetThreadCount() const { return unsigned(m_threads.size()); }
+    inline unsigned int GetWorkerCount() const { return unsigned(m_workers.size()); }
+
+private:
+    Job* Allocate();
+};
+
+// the application wide job system, one worker per hardware thread besides the main thread.
+// created on first use, which has to happen on the main thread
+namespace Jobs
+{
+    JobSystem& Get();
+}
@@ -0,0 +1,70 @@
+#include "LodSelector.h"
+
+#include <algorithm>
+
+LodSelector::LodSelector()
+    : m_bucketOffsets(MaxMeshLods + 1, 0)
+{
+}
+
+void LodSelector::SetMesh(const Mesh& mesh)
+{
+    m_lodErrors.clear();
+    m_lodTriangles.clear();
+    for (unsigned int lod = 0; lod < mesh.GetLodCount(); lod++) {
+        m_lodErrors.push_back(mesh.GetLod(lod).error);
+        m_lodTriangles.push_back(mesh.GetTriangleCount(lod));
+    }
+    m_currentLod.clear();
+}
+
+void LodSelector::Select(const glm::vec3* centers, const float* scales, unsigned int count, const glm::vec3& cameraPos,
+                         float pixelsPerUnit, float thresholdPixels, float hysteresis)
+{
+    const unsigned int lodCount = unsigned(m_lodErrors.size());
+    m_stats = LodSelectionStats();
+    m_stats.objectCount = count;
+    std::fill(m_bucketOffsets.begin(), m_bucketOffsets.end(), 0);
+    m_sortedObjects.resize(count);
+    if (lodCount == 0)
+        return;
+
+    // new objects start at the finest level
+    m_currentLod.resize(count, 0);
+
+    const float coarserThreshold = thresholdPixels * (1.0f - hysteresis);
+    const float finerThreshold = thresholdPixels * (1.0f + hysteresis);
+
+    for (unsigned int i = 0; i < count; i++) {
+        glm::vec3 toCamera = centers[i] - cameraPos;
+        float distance = std::max(glm::length(toCamera), 1e-3f);
+        // projected pixel error of one unit of object space error at this distance
+        float pixelScale = scales[i] * pixelsPerUnit / distance;
+
+        unsigned int lod = std::min<unsigned int>(m_currentLod[i], lodCount - 1);
+        if (m_lodErrors[lod] * pixelScale > finerThreshold) {
+            while (lod > 0 && m_lodErrors[lod] * pixelScale > thresholdPixels)
+                lod--;
+        } else {
+            while (lod + 1 < lodCount && m_lodErrors[lod + 1] * pixelScale <= coarserThreshold)
+                lod++;
+        }
+        m_currentLod[i] = std::uint8_t(lod);
+        m_bucketOffsets[lod + 1]++;
+    }
+
+    // counting sort of the objects into per LOD buckets
+    for (unsigned int lod = 0; lod < MaxMeshLods; lod++)
+        m_bucketOffsets[lod + 1] += m_bucketOffsets[lod];
+    unsigned int fill[MaxMeshLods];
+    std::copy(m_bucketOffsets.begin(), m_bucketOffsets.begin() + MaxMeshLods, fill);
+    for (unsigned int i = 0; i < count; i++)
+        m_sortedObjects[fill[m_currentLod[i]]++] = i;
+
+    for (unsigned int lod = 0; lod < lodCount; lod++) {
+        unsigned int objects = GetObjectCount(lod);
+        m_stats.objectsPerLod[lod] = objects;
+        m_stats.trianglesDrawn += objects * m_lodTriangles[lod];
+    }
+    m_stats.trianglesFull = count * m_lodTriangles[0];
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Mesh.h"
+
+struct LodSelectionStats
+{
+    unsigned int objectCount = 0;
+    unsigned int trianglesFull = 0;  // what drawing everything at LOD 0 would cost
+    unsigned int trianglesDrawn = 0;
+    unsigned int objectsPerLod[MaxMeshLods] = {};
+};
+
+// picks a LOD per object from the projected (pixel) error of each level.
+// objects are processed as flat arrays in one pass and then bucketed per level,
+// so the draw loop walks one LOD (one index range) at a time
+class LodSelector
+{
+private:
+    std::vector<float> m_lodErrors;          // object space error per level
+    std::vector<unsigned int> m_lodTriangles;
+    std::vector<std::uint8_t> m_currentLod;  // per object, kept between frames for the hysteresis
+    std::vector<unsigned int> m_bucketOffsets; // MaxMeshLods + 1 prefix sums into m_sortedObjects
+    std::vector<unsigned int> m_sortedObjects;
+    LodSelectionStats m_stats;
+
+public:
+    LodSelector();
+
+    void SetMesh(const Mesh& mesh);
+
+    // centers are world space, scales convert the mesh's object space error to world space.
+    // pixelsPerUnit is viewportHeight / (2 * tan(fovY / 2)), i.e. the projected size of one unit at distance one.
+    // an object switches to a coarser level once that level is below threshold * (1 - hysteresis) pixels
+    // and back to a finer one once its current level is above threshold * (1 + hysteresis)
+    void Select(const glm::vec3* centers, const float* scales, unsigned int count, const glm::vec3& cameraPos,
+                float pixelsPerUnit, float thresholdPixels, float hysteresis);
+
+    inline unsigned int GetLodCount() const { return unsigned(m_lodErrors.size()); }
+    // objects using the given LOD, valid until the next Select
+    inline const unsigned int* GetObjects(unsigned int lod) const { return m_sortedObjects.data() + m_bucketOffsets[lod]; }
+    inline unsigned int GetObjectCount(unsigned int lod) const { return m_bucketOffsets[lod + 1] - m_bucketOffsets[lod]; }
+    inline unsigned int GetLod(unsigned int object) const { return m_currentLod[object]; }
+    inline const LodSelectionStats& GetStats() const { return m_stats; }
+};
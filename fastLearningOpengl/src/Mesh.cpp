@@ -0,0 +1,136 @@
+#include "Mesh.h"
+#include "Renderer.h"
+#include "VertexBufferLayout.h"
+#include "IndirectDraw.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::uint32_t AlignUp(std::uint32_t value, std::uint32_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// every LOD's index range inside the index buffer, and every index it draws inside the vertex buffer
+static bool LodsInRange(const MeshLod* lods, std::uint32_t lodCount, const unsigned int* indices, std::uint32_t indexCount,
+                        std::uint32_t vertexCount)
+{
+    for (std::uint32_t lod = 0; lod < lodCount; lod++) {
+        if (lods[lod].indexCount == 0 || std::uint64_t(lods[lod].indexOffset) + lods[lod].indexCount > indexCount)
+            return false;
+        const unsigned int* first = indices + lods[lod].indexOffset;
+        if (std::any_of(first, first + lods[lod].indexCount, [&](unsigned int index) { return index >= vertexCount; }))
+            return false;
+    }
+    return true;
+}
+
+Mesh::Mesh(const std::string& path)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Error (MESH): could not open " << path << std::endl;
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(MeshFileHeader)) {
+        std::cout << "Error (MESH): " << path << " is too small to be a mesh" << std::endl;
+        close(fd);
+        return;
+    }
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file alive
+    if (mapping == MAP_FAILED) {
+        std::cout << "Error (MESH): mmap failed for " << path << std::endl;
+        return;
+    }
+
+    const auto* bytes = static_cast<const unsigned char*>(mapping);
+    const auto* header = reinterpret_cast<const MeshFileHeader*>(bytes);
+    std::size_t vertexBytes = std::size_t(header->vertexCount) * header->vertexStride;
+    std::size_t indexBytes = std::size_t(header->indexCount) * sizeof(unsigned int);
+
+    if (std::memcmp(header->magic, "MESH", 4) != 0 || header->version != MeshFileVersion
+        || header->vertexStride != sizeof(MeshVertex)
+        || header->vertexOffset + vertexBytes > std::size_t(st.st_size)
+        || header->indexOffset + indexBytes > std::size_t(st.st_size)
+        || header->indexOffset % sizeof(unsigned int) != 0 // LodsInRange reads the indices in place
+        || header->lodCount == 0 || header->lodCount > MaxMeshLods
+        || sizeof(MeshFileHeader) + header->lodCount * sizeof(MeshLod) > header->vertexOffset
+        || !LodsInRange(reinterpret_cast<const MeshLod*>(bytes + sizeof(MeshFileHeader)), header->lodCount,
+                        reinterpret_cast<const unsigned int*>(bytes + header->indexOffset), header->indexCount, header->vertexCount)) {
+        std::cout << "Error (MESH): " << path << " has an unsupported header, re-import it" << std::endl;
+        munmap(mapping, st.st_size);
+        return;
+    }
+
+    m_vertexCount = header->vertexCount;
+    const auto* lods = reinterpret_cast<const MeshLod*>(bytes + sizeof(MeshFileHeader));
+    m_lods.assign(lods, lods + header->lodCount);
+    m_boundsMin = glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+    m_boundsMax = glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+
+    // the driver copies straight out of the page cache, no intermediate buffers
+    m_vao = std::make_unique<VertexArray>();
+    m_vertexBuffer = std::make_unique<VertexBuffer>(bytes + header->vertexOffset, unsigned(vertexBytes));
+
+    VertexBufferLayout layout;
+    layout.Push<float>(3); // position
+    layout.Push<float>(3); // normal
+    layout.Push<float>(2); // texture coordinates
+    m_vao->AddBuffer(*m_vertexBuffer, layout);
+    IndirectDraw::AddDrawIdAttribute(*m_vao); // location 3
+
+    m_indexBuffer = std::make_unique<ElementIndexBuffer>(bytes + header->indexOffset, header->indexCount);
+    m_vao->Unbind();
+
+    munmap(mapping, st.st_size);
+
+    m_loadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+Mesh::~Mesh()
+{
+}
+
+bool Mesh::WriteBinary(const std::string& path, const MeshData& data)
+{
+    MeshFileHeader header = {};
+    std::memcpy(header.magic, "MESH", 4);
+    header.version = MeshFileVersion;
+    header.vertexCount = unsigned(data.vertices.size());
+    header.indexCount = unsigned(data.indices.size());
+    header.vertexStride = sizeof(MeshVertex);
+    header.lodCount = unsigned(data.lods.size());
+    header.vertexOffset = AlignUp(sizeof(MeshFileHeader) + header.lodCount * sizeof(MeshLod), 16);
+    header.indexOffset = AlignUp(header.vertexOffset + header.vertexCount * header.vertexStride, 16);
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = data.boundsMin[i];
+        header.boundsMax[i] = data.boundsMax[i];
+    }
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+        std::cout << "Error (MESH): could not write " << path << std::endl;
+        return false;
+    }
+
+    const char padding[16] = {};
+    std::size_t tableEnd = sizeof(header) + data.lods.size() * sizeof(MeshLod);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(data.lods.data()), data.lods.size() * sizeof(MeshLod));
+    stream.write(padding, header.vertexOffset - tableEnd);
+    stream.write(reinterpret_cast<const char*>(data.vertices.data()), data.vertices.size() * sizeof(MeshVertex));
+    stream.write(padding, header.indexOffset - (header.vertexOffset + header.vertexCount * header.vertexStride));
+    stream.write(reinterpret_cast<const char*>(data.indices.data()), data.indices.size() * sizeof(unsigned int));
+    return bool(stream);
+}
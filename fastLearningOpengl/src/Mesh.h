@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+#include "ElementIndexBuffer.h"
+
+// vertex format of every imported mesh
+struct MeshVertex
+{
+    float position[3];
+    float normal[3];
+    float texCoords[2];
+};
+
+constexpr unsigned int MaxMeshLods = 5;
+
+// one level of detail: a range of the shared index buffer
+struct MeshLod
+{
+    std::uint32_t indexOffset; // in indices, not bytes
+    std::uint32_t indexCount;
+    float error;               // object space distance error compared to LOD 0
+    std::uint32_t reserved;
+};
+
+// CPU side mesh, what the importer produces and what gets serialized
+struct MeshData
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<unsigned int> indices; // all LODs back to back, LOD 0 first
+    std::vector<MeshLod> lods;
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+};
+
+// binary .mesh layout: header, LOD table, then the vertex block and the index block (both 16 byte aligned)
+// so a mapped file can be handed to glBufferData without any parsing or copying
+struct MeshFileHeader
+{
+    char magic[4];             // "MESH"
+    std::uint32_t version;
+    std::uint32_t vertexCount;
+    std::uint32_t indexCount;
+    std::uint32_t vertexStride;
+    std::uint32_t vertexOffset; // byte offset of the vertex block from the start of the file
+    std::uint32_t indexOffset;  // byte offset of the index block
+    std::uint32_t lodCount;     // MeshLod entries right after the header
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+constexpr std::uint32_t MeshFileVersion = 2;
+
+// GPU mesh loaded from a binary .mesh file
+class Mesh
+{
+private:
+    std::unique_ptr<VertexArray> m_vao;
+    std::unique_ptr<VertexBuffer> m_vertexBuffer;
+    std::unique_ptr<ElementIndexBuffer> m_indexBuffer;
+    unsigned int m_vertexCount = 0;
+    std::vector<MeshLod> m_lods;
+    glm::vec3 m_boundsMin{0.0f};
+    glm::vec3 m_boundsMax{0.0f};
+    double m_loadTimeMs = 0.0;
+
+public:
+    Mesh(const std::string& path); // mmaps the file and uploads it straight from the mapping
+    ~Mesh();
+
+    static bool WriteBinary(const std::string& path, const MeshData& data);
+
+    inline bool IsValid() const { return m_indexBuffer != nullptr; }
+    inline const VertexArray& GetVertexArray() const { return *m_vao; }
+    inline const ElementIndexBuffer& GetIndexBuffer() const { return *m_indexBuffer; }
+    inline unsigned int GetVertexCount() const { return m_vertexCount; }
+    inline unsigned int GetTriangleCount(unsigned int lod = 0) const { return lod < m_lods.size() ? m_lods[lod].indexCount / 3 : 0; }
+    inline unsigned int GetLodCount() const { return unsigned(m_lods.size()); }
+    inline const MeshLod& GetLod(unsigned int lod) const { return m_lods[lod]; }
+    inline const glm::vec3& GetBoundsMin() const { return m_boundsMin; }
+    inline const glm::vec3& GetBoundsMax() const { return m_boundsMax; }
+    inline float GetBoundingRadius() const { return glm::length(m_boundsMax - m_boundsMin) * 0.5f; }
+    inline double GetLoadTimeMs() const { return m_loadTimeMs; }
+};
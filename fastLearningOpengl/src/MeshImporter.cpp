@@ -0,0 +1,264 @@
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+#include <sys/stat.h>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // LOD generation stops before a level would go below this
+    constexpr size_t MinLodTriangles = 32;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // one face corner as written in the file, 0 based, -1 when the attribute is missing
+    struct Corner
+    {
+        int position, texCoord, normal;
+        bool operator==(const Corner& other) const
+        {
+            return position == other.position && texCoord == other.texCoord && normal == other.normal;
+        }
+    };
+
+    struct CornerHash
+    {
+        std::size_t operator()(const Corner& c) const
+        {
+            std::size_t h = std::size_t(c.position) * 73856093u;
+            h ^= std::size_t(c.texCoord) * 19349663u;
+            h ^= std::size_t(c.normal) * 83492791u;
+            return h;
+        }
+    };
+
+    // OBJ indices are 1 based, negative ones count back from the current end
+    int ResolveIndex(long index, std::size_t count)
+    {
+        if (index > 0)
+            return int(index - 1);
+        if (index < 0)
+            return int(long(count) + index);
+        return -1;
+    }
+}
+
+bool MeshImporter::ImportObj(const std::string& path, MeshData& out)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        std::cout << "Error (MESH): could not open " << path << std::endl;
+        return false;
+    }
+    std::string file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+    std::unordered_map<Corner, unsigned int, CornerHash> corners;
+    std::vector<unsigned int> face;
+
+    out.vertices.clear();
+    out.indices.clear();
+
+    const char* cursor = file.c_str();
+    while (*cursor) {
+        const char* lineEnd = std::strchr(cursor, '\n');
+        if (!lineEnd)
+            lineEnd = cursor + std::strlen(cursor);
+
+        if (cursor[0] == 'v' && cursor[1] == ' ') {
+            char* next;
+            float x = std::strtof(cursor + 2, &next);
+            float y = std::strtof(next, &next);
+            float z = std::strtof(next, &next);
+            positions.emplace_back(x, y, z);
+        } else if (cursor[0] == 'v' && cursor[1] == 't') {
+            char* next;
+            float u = std::strtof(cursor + 3, &next);
+            float v = std::strtof(next, &next);
+            texCoords.emplace_back(u, v);
+        } else if (cursor[0] == 'v' && cursor[1] == 'n') {
+            char* next;
+            float x = std::strtof(cursor + 3, &next);
+            float y = std::strtof(next, &next);
+            float z = std::strtof(next, &next);
+            normals.emplace_back(x, y, z);
+        } else if (cursor[0] == 'f' && cursor[1] == ' ') {
+            face.clear();
+            const char* p = cursor + 2;
+            while (p < lineEnd) {
+                while (p < lineEnd && (*p == ' ' || *p == '\t' || *p == '\r'))
+                    p++;
+                if (p >= lineEnd)
+                    break;
+
+                char* next;
+                Corner corner = {-1, -1, -1};
+                corner.position = ResolveIndex(std::strtol(p, &next, 10), positions.size());
+                p = next;
+                if (*p == '/') {
+                    p++;
+                    if (*p != '/') {
+                        corner.texCoord = ResolveIndex(std::strtol(p, &next, 10), texCoords.size());
+                        p = next;
+                    }
+                    if (*p == '/') {
+                        corner.normal = ResolveIndex(std::strtol(p + 1, &next, 10), normals.size());
+                        p = next;
+                    }
+                }
+                if (corner.position < 0 || corner.position >= int(positions.size())) {
+                    std::cout << "Error (MESH): bad face index in " << path << std::endl;
+                    return false;
+                }
+
+                // deduplicate: identical position/uv/normal triples share one vertex
+                auto inserted = corners.emplace(corner, unsigned(out.vertices.size()));
+                if (inserted.second) {
+                    MeshVertex vertex = {};
+                    const glm::vec3& position = positions[corner.position];
+                    vertex.position[0] = position.x;
+                    vertex.position[1] = position.y;
+                    vertex.position[2] = position.z;
+                    if (corner.texCoord >= 0 && corner.texCoord < int(texCoords.size())) {
+                        vertex.texCoords[0] = texCoords[corner.texCoord].x;
+                        vertex.texCoords[1] = texCoords[corner.texCoord].y;
+                    }
+                    if (corner.normal >= 0 && corner.normal < int(normals.size())) {
+                        vertex.normal[0] = normals[corner.normal].x;
+                        vertex.normal[1] = normals[corner.normal].y;
+                        vertex.normal[2] = normals[corner.normal].z;
+                    }
+                    out.vertices.push_back(vertex);
+                }
+                face.push_back(inserted.first->second);
+            }
+            // polygons are triangulated as fans
+            for (size_t i = 2; i < face.size(); i++) {
+                out.indices.push_back(face[0]);
+                out.indices.push_back(face[i - 1]);
+                out.indices.push_back(face[i]);
+            }
+        }
+
+        cursor = *lineEnd ? lineEnd + 1 : lineEnd;
+    }
+
+    if (out.indices.empty()) {
+        std::cout << "Error (MESH): " << path << " has no faces" << std::endl;
+        return false;
+    }
+
+    // files without normals get smooth area weighted ones
+    if (normals.empty()) {
+        std::vector<glm::vec3> accumulated(out.vertices.size(), glm::vec3(0.0f));
+        for (size_t i = 0; i < out.indices.size(); i += 3) {
+            const float* a = out.vertices[out.indices[i + 0]].position;
+            const float* b = out.vertices[out.indices[i + 1]].position;
+            const float* c = out.vertices[out.indices[i + 2]].position;
+            glm::vec3 n = glm::cross(glm::vec3(b[0] - a[0], b[1] - a[1], b[2] - a[2]),
+                                     glm::vec3(c[0] - a[0], c[1] - a[1], c[2] - a[2]));
+            for (int k = 0; k < 3; k++)
+                accumulated[out.indices[i + k]] += n;
+        }
+        for (size_t v = 0; v < out.vertices.size(); v++) {
+            glm::vec3 n = glm::length(accumulated[v]) > 0.0f ? glm::normalize(accumulated[v]) : glm::vec3(0.0f, 1.0f, 0.0f);
+            out.vertices[v].normal[0] = n.x;
+            out.vertices[v].normal[1] = n.y;
+            out.vertices[v].normal[2] = n.z;
+        }
+    }
+
+    out.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    out.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (const auto& vertex : out.vertices) {
+        glm::vec3 p(vertex.position[0], vertex.position[1], vertex.position[2]);
+        out.boundsMin = glm::min(out.boundsMin, p);
+        out.boundsMax = glm::max(out.boundsMax, p);
+    }
+    return true;
+}
+
+MeshImportStats MeshImporter::Import(const std::string& objPath, const std::string& meshPath)
+{
+    MeshImportStats stats;
+    stats.sourcePath = objPath;
+    stats.meshPath = meshPath;
+
+    MeshData data;
+    auto start = Clock::now();
+    if (!ImportObj(objPath, data))
+        return stats;
+    stats.importTimeMs = MillisecondsSince(start);
+    stats.acmrBefore = MeshOptimizer::ComputeACMR(data.indices, unsigned(data.vertices.size()));
+
+    start = Clock::now();
+    std::vector<unsigned int> clusters;
+    MeshOptimizer::OptimizeVertexCache(data.indices, unsigned(data.vertices.size()), clusters);
+    MeshOptimizer::OptimizeOverdraw(data.indices, clusters, data.vertices);
+    MeshOptimizer::OptimizeVertexFetch(data.vertices, data.indices);
+    stats.optimizeTimeMs = MillisecondsSince(start);
+    stats.acmrAfter = MeshOptimizer::ComputeACMR(data.indices, unsigned(data.vertices.size()));
+
+    // each LOD halves the triangle count of the previous one and indexes the same vertices
+    start = Clock::now();
+    data.lods.push_back({0, unsigned(data.indices.size()), 0.0f, 0});
+    std::vector<unsigned int> lodIndices = data.indices;
+    float lodError = 0.0f;
+    while (data.lods.size() < MaxMeshLods && lodIndices.size() / 3 >= 2 * MinLodTriangles) {
+        float error;
+        std::vector<unsigned int> simplified = MeshSimplifier::Simplify(data.vertices, lodIndices, lodIndices.size() / 6 * 3, error);
+        if (simplified.size() * 10 > lodIndices.size() * 9)
+            break; // mostly locked seams/borders, nothing left to gain
+        MeshOptimizer::OptimizeVertexCache(simplified, unsigned(data.vertices.size()), clusters);
+        lodError += error; // errors are measured against the previous level, so accumulate
+        data.lods.push_back({unsigned(data.indices.size()), unsigned(simplified.size()), lodError, 0});
+        data.indices.insert(data.indices.end(), simplified.begin(), simplified.end());
+        lodIndices.swap(simplified);
+    }
+    stats.lodTimeMs = MillisecondsSince(start);
+    stats.lodCount = unsigned(data.lods.size());
+
+    start = Clock::now();
+    stats.success = Mesh::WriteBinary(meshPath, data);
+    stats.writeTimeMs = MillisecondsSince(start);
+
+    stats.vertexCount = unsigned(data.vertices.size());
+    stats.triangleCount = data.lods[0].indexCount / 3;
+    std::cout << "Imported " << objPath << ": " << stats.vertexCount << " vertices, " << stats.triangleCount
+              << " triangles, " << stats.lodCount << " LODs, ACMR " << stats.acmrBefore << " -> " << stats.acmrAfter << std::endl;
+    return stats;
+}
+
+bool MeshImporter::IsUpToDate(const std::string& objPath, const std::string& meshPath)
+{
+    struct stat meshStat, objStat;
+    if (stat(meshPath.c_str(), &meshStat) != 0 || stat(objPath.c_str(), &objStat) != 0)
+        return false;
+    if (meshStat.st_mtime < objStat.st_mtime)
+        return false;
+
+    // files from an older importer version have to be regenerated
+    MeshFileHeader header = {};
+    std::ifstream stream(meshPath, std::ios::binary);
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    return stream && std::memcmp(header.magic, "MESH", 4) == 0 && header.version == MeshFileVersion;
+}
+
+std::future<MeshImportStats> MeshImporter::ImportAsync(const std::string& objPath, const std::string& meshPath)
+{
+    return std::async(std::launch::async, &MeshImporter::Import, objPath, meshPath);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <future>
+#include <string>
+#include "Mesh.h"
+
+// timings and cache statistics of one import, shown by the mesh test
+struct MeshImportStats
+{
+    std::string sourcePath;
+    std::string meshPath;
+    bool success = false;
+    unsigned int vertexCount = 0;   // after deduplication
+    unsigned int triangleCount = 0; // of LOD 0
+    unsigned int lodCount = 0;
+    double importTimeMs = 0.0;      // parse + deduplicate
+    double optimizeTimeMs = 0.0;    // vertex cache, overdraw and vertex fetch passes
+    double lodTimeMs = 0.0;         // simplification of the lower LODs
+    double writeTimeMs = 0.0;
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
+};
+
+class MeshImporter
+{
+public:
+    // parses a Wavefront OBJ (triangles and polygons, v/vt/vn) and welds identical corners into one vertex
+    static bool ImportObj(const std::string& path, MeshData& out);
+
+    // import + optimize + LOD generation + serialize to meshPath, synchronously
+    static MeshImportStats Import(const std::string& objPath, const std::string& meshPath);
+
+    // same, on a worker thread so the render loop keeps going
+    static std::future<MeshImportStats> ImportAsync(const std::string& objPath, const std::string& meshPath);
+
+    // true when meshPath exists, is newer than objPath and can be loaded as is
+    static bool IsUpToDate(const std::string& objPath, const std::string& meshPath);
+};
@@ -0,0 +1,194 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace MeshOptimizer
+{
+
+float ComputeACMR(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+    if (indices.size() < 3)
+        return 0.0f;
+
+    // FIFO cache: a vertex is resident while fewer than cacheSize misses happened since it was loaded
+    std::vector<unsigned int> loadedAt(vertexCount, 0);
+    unsigned int misses = 0;
+    for (unsigned int index : indices) {
+        if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize) {
+            misses++;
+            loadedAt[index] = misses;
+        }
+    }
+    return float(misses) / float(indices.size() / 3);
+}
+
+void OptimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount,
+                         std::vector<unsigned int>& clusters, unsigned int cacheSize)
+{
+    const unsigned int triangleCount = unsigned(indices.size() / 3);
+    clusters.clear();
+    if (triangleCount == 0)
+        return;
+
+    // vertex -> triangle adjacency in CSR form
+    std::vector<unsigned int> liveCount(vertexCount, 0);
+    for (unsigned int index : indices)
+        liveCount[index]++;
+    std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+    for (unsigned int v = 0; v < vertexCount; v++)
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveCount[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    {
+        std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (unsigned int t = 0; t < triangleCount; t++)
+            for (unsigned int k = 0; k < 3; k++)
+                adjacency[fill[indices[t * 3 + k]]++] = t;
+    }
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    deadEnd.reserve(indices.size());
+
+    unsigned int timestamp = cacheSize + 1;
+    unsigned int cursor = 1;
+    int fanning = 0;
+    clusters.push_back(0);
+
+    while (fanning >= 0) {
+        candidates.clear();
+        for (unsigned int a = adjacencyOffset[fanning]; a < adjacencyOffset[fanning + 1]; a++) {
+            unsigned int t = adjacency[a];
+            if (emitted[t])
+                continue;
+            for (unsigned int k = 0; k < 3; k++) {
+                unsigned int v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveCount[v]--;
+                if (timestamp - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = timestamp;
+                    timestamp++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // pick the candidate that will still be in the cache after its remaining triangles are emitted
+        int next = -1;
+        int best = -1;
+        for (unsigned int v : candidates) {
+            if (liveCount[v] == 0)
+                continue;
+            int priority = 0;
+            if (timestamp - cacheTime[v] + 2 * liveCount[v] <= cacheSize)
+                priority = int(timestamp - cacheTime[v]);
+            if (priority > best) {
+                best = priority;
+                next = int(v);
+            }
+        }
+
+        if (next == -1) {
+            // dead end: fall back to recently used vertices, then to the lowest unprocessed one
+            while (!deadEnd.empty()) {
+                unsigned int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveCount[v] > 0) {
+                    next = int(v);
+                    break;
+                }
+            }
+            while (next == -1 && cursor < vertexCount) {
+                if (liveCount[cursor] > 0)
+                    next = int(cursor);
+                cursor++;
+            }
+            if (next != -1 && clusters.back() != output.size() / 3)
+                clusters.push_back(unsigned(output.size() / 3));
+        }
+        fanning = next;
+    }
+
+    indices.swap(output);
+}
+
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<unsigned int>& clusters,
+                      const std::vector<MeshVertex>& vertices)
+{
+    const unsigned int triangleCount = unsigned(indices.size() / 3);
+    if (clusters.size() < 2)
+        return;
+
+    auto position = [&](unsigned int index) {
+        const float* p = vertices[index].position;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    glm::vec3 meshCenter(0.0f);
+    for (const auto& vertex : vertices)
+        meshCenter += glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]);
+    meshCenter /= float(vertices.size());
+
+    // clusters whose area weighted normal points away from the mesh center are likely to occlude the rest
+    std::vector<float> sortKey(clusters.size());
+    for (size_t c = 0; c < clusters.size(); c++) {
+        unsigned int begin = clusters[c];
+        unsigned int end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (unsigned int t = begin; t < end; t++) {
+            glm::vec3 a = position(indices[t * 3 + 0]);
+            glm::vec3 b = position(indices[t * 3 + 1]);
+            glm::vec3 c2 = position(indices[t * 3 + 2]);
+            glm::vec3 n = glm::cross(b - a, c2 - a);
+            float triangleArea = glm::length(n);
+            centroid += (a + b + c2) * (triangleArea / 3.0f);
+            normal += n;
+            area += triangleArea;
+        }
+        if (area > 0.0f)
+            centroid /= area;
+        float normalLength = glm::length(normal);
+        sortKey[c] = normalLength > 0.0f ? glm::dot(centroid - meshCenter, normal / normalLength) : 0.0f;
+    }
+
+    std::vector<unsigned int> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (unsigned int c : order) {
+        unsigned int begin = clusters[c];
+        unsigned int end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        output.insert(output.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+    }
+    indices.swap(output);
+}
+
+void OptimizeVertexFetch(std::vector<MeshVertex>& vertices, std::vector<unsigned int>& indices)
+{
+    constexpr unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<MeshVertex> output;
+    output.reserve(vertices.size());
+
+    for (unsigned int& index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = unsigned(output.size());
+            output.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    // vertices no triangle references are dropped here
+    vertices.swap(output);
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include "Mesh.h"
+
+// offline index/vertex reordering for meshes coming out of the importer
+// (all of these run on the import worker threads, never on the render thread)
+namespace MeshOptimizer
+{
+    // cache size the optimizer targets, also used when reporting ACMR
+    constexpr unsigned int VertexCacheSize = 16;
+
+    // average cache miss ratio: transformed vertices per triangle for a FIFO post-transform cache.
+    // 3.0 is the worst case, ~0.5-0.7 is what a well ordered regular mesh gets
+    float ComputeACMR(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize = VertexCacheSize);
+
+    // Tipsify (Sander et al. 2007) triangle reordering for the post-transform vertex cache.
+    // fills clusters with the start triangle of every cluster (split where the fan has to skip a dead end)
+    void OptimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount,
+                             std::vector<unsigned int>& clusters, unsigned int cacheSize = VertexCacheSize);
+
+    // reorders the clusters produced above so outward facing ones come first (less overdraw from most views)
+    void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<unsigned int>& clusters,
+                          const std::vector<MeshVertex>& vertices);
+
+    // reorders the vertices in first-use order so the vertex fetch walks memory linearly
+    void OptimizeVertexFetch(std::vector<MeshVertex>& vertices, std::vector<unsigned int>& indices);
+}
@@ -0,0 +1,166 @@
+#include "MeshPool.h"
+#include "IndirectDraw.h"
+#include "Renderer.h"
+#include "VertexBufferLayout.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+MeshPool::MeshPool(std::uint32_t vertexCapacity, std::uint32_t indexCapacity)
+    : m_vertexAllocator(vertexCapacity), m_indexAllocator(indexCapacity)
+{
+    Rebuild(vertexCapacity, {}, indexCapacity, {});
+}
+
+void MeshPool::Rebuild(std::uint32_t vertexCapacity, const std::vector<Move>& vertexMoves, std::uint32_t indexCapacity, const std::vector<Move>& indexMoves)
+{
+    // creating an index buffer binds it, which would land in whatever vertex array is bound
+    glCall(glBindVertexArray(0));
+    auto vertexBuffer = std::make_unique<VertexBuffer>(nullptr, unsigned(vertexCapacity * sizeof(MeshVertex)));
+    auto indexBuffer = std::make_unique<ElementIndexBuffer>(nullptr, indexCapacity);
+
+    // the old contents move on the GPU, nothing comes back to the CPU
+    if (m_vertexBuffer) {
+        glCall(glBindBuffer(GL_COPY_READ_BUFFER, m_vertexBuffer->GetRendererID()));
+        glCall(glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer->GetRendererID()));
+        for (const Move& move : vertexMoves) {
+            glCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(move.from * sizeof(MeshVertex)),
+                                       GLintptr(move.to * sizeof(MeshVertex)), GLsizeiptr(move.count * sizeof(MeshVertex))));
+        }
+    }
+    if (m_indexBuffer) {
+        glCall(glBindBuffer(GL_COPY_READ_BUFFER, m_indexBuffer->GetRendererID()));
+        glCall(glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer->GetRendererID()));
+        for (const Move& move : indexMoves) {
+            glCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(move.from * sizeof(unsigned int)),
+                                       GLintptr(move.to * sizeof(unsigned int)), GLsizeiptr(move.count * sizeof(unsigned int))));
+        }
+    }
+
+    // VertexArray keeps counting attributes per AddBuffer, a new buffer gets a new vertex array
+    m_vao = std::make_unique<VertexArray>();
+    VertexBufferLayout layout;
+    layout.Push<float>(3); // position
+    layout.Push<float>(3); // normal
+    layout.Push<float>(2); // texture coordinates
+    m_vao->AddBuffer(*vertexBuffer, layout);
+    IndirectDraw::AddDrawIdAttribute(*m_vao); // location 3
+    indexBuffer->Bind(); // recorded in the vertex array
+    m_vao->Unbind();
+
+    m_vertexBuffer = std::move(vertexBuffer);
+    m_indexBuffer = std::move(indexBuffer);
+}
+
+MeshPool::Handle MeshPool::Add(const MeshVertex* vertices, std::uint32_t vertexCount, const unsigned int* indices, std::uint32_t indexCount)
+{
+    TlsfAllocator::Allocation vertexRange = m_vertexAllocator.Allocate(vertexCount);
+    TlsfAllocator::Allocation indexRange = m_indexAllocator.Allocate(indexCount);
+    if (!vertexRange.IsValid() || !indexRange.IsValid()) {
+        m_vertexAllocator.Free(vertexRange);
+        m_indexAllocator.Free(indexRange);
+
+        // twice the size (or enough for this mesh), everything already in there keeps its place
+        std::uint32_t oldVertices = m_vertexAllocator.GetSize(), oldIndices = m_indexAllocator.GetSize();
+        std::uint32_t newVertices = std::max(oldVertices * 2, oldVertices + vertexCount);
+        std::uint32_t newIndices = std::max(oldIndices * 2, oldIndices + indexCount);
+        if (vertexRange.IsValid())
+            newVertices = oldVertices;
+        if (indexRange.IsValid())
+            newIndices = oldIndices;
+        Rebuild(newVertices, {{0, 0, oldVertices}}, newIndices, {{0, 0, oldIndices}});
+        m_vertexAllocator.Grow(newVertices);
+        m_indexAllocator.Grow(newIndices);
+        m_stats.grows++;
+
+        vertexRange = m_vertexAllocator.Allocate(vertexCount);
+        indexRange = m_indexAllocator.Allocate(indexCount);
+        assert(vertexRange.IsValid() && indexRange.IsValid());
+    }
+
+    m_vertexBuffer->BufferSubData(vertices, unsigned(vertexCount * sizeof(MeshVertex)), unsigned(vertexRange.offset * sizeof(MeshVertex)));
+    m_indexBuffer->BufferSubData(indices, indexCount, indexRange.offset);
+
+    Handle handle;
+    if (!m_freeHandles.empty()) {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    } else {
+        handle = Handle(m_entries.size());
+        m_entries.emplace_back();
+    }
+    m_entries[handle] = {vertexRange, indexRange, vertexCount, indexCount, true};
+    return handle;
+}
+
+void MeshPool::Remove(Handle handle)
+{
+    Entry& entry = m_entries[handle];
+    assert(entry.live);
+    m_vertexAllocator.Free(entry.vertices);
+    m_indexAllocator.Free(entry.indices);
+    entry.live = false;
+    m_freeHandles.push_back(handle);
+}
+
+void MeshPool::Defragment()
+{
+    auto start = Clock::now();
+    // in buffer order, so the GPU copies read front to back
+    std::vector<Handle> live;
+    for (Handle handle = 0; handle < Handle(m_entries.size()); handle++) {
+        if (m_entries[handle].live)
+            live.push_back(handle);
+    }
+    std::sort(live.begin(), live.end(), [&](Handle a, Handle b) { return m_entries[a].vertices.offset < m_entries[b].vertices.offset; });
+
+    // a fresh allocator hands out the blocks back to back
+    m_vertexAllocator.Reset(m_vertexAllocator.GetSize());
+    m_indexAllocator.Reset(m_indexAllocator.GetSize());
+    std::vector<Move> vertexMoves, indexMoves;
+    vertexMoves.reserve(live.size());
+    indexMoves.reserve(live.size());
+    for (Handle handle : live) {
+        Entry& entry = m_entries[handle];
+        TlsfAllocator::Allocation vertices = m_vertexAllocator.Allocate(entry.vertexCount);
+        TlsfAllocator::Allocation indices = m_indexAllocator.Allocate(entry.indexCount);
+        vertexMoves.push_back({entry.vertices.offset, vertices.offset, entry.vertexCount});
+        indexMoves.push_back({entry.indices.offset, indices.offset, entry.indexCount});
+        entry.vertices = vertices;
+        entry.indices = indices;
+    }
+    Rebuild(m_vertexAllocator.GetSize(), vertexMoves, m_indexAllocator.GetSize(), indexMoves);
+
+    m_stats.defragmentations++;
+    m_stats.lastDefragmentMs = MillisecondsSince(start);
+}
+
+void MeshPool::Draw(const Renderer& renderer, Handle handle, const Shader& shader) const
+{
+    const Entry& entry = m_entries[handle];
+    renderer.Draw(*m_vao, *m_indexBuffer, shader, entry.indexCount, entry.indices.offset, int(entry.vertices.offset));
+}
+
+MeshPoolStats MeshPool::GetStats() const
+{
+    MeshPoolStats stats = m_stats;
+    stats.meshes = unsigned(m_entries.size() - m_freeHandles.size());
+    stats.vertexCapacity = m_vertexAllocator.GetSize();
+    stats.verticesUsed = m_vertexAllocator.GetUsed();
+    stats.indexCapacity = m_indexAllocator.GetSize();
+    stats.indicesUsed = m_indexAllocator.GetUsed();
+    stats.vertexFragmentation = m_vertexAllocator.GetFragmentation();
+    stats.indexFragmentation = m_indexAllocator.GetFragmentation();
+    stats.freeBlocks = m_vertexAllocator.GetFreeBlockCount() + m_indexAllocator.GetFreeBlockCount();
+    return stats;
+}
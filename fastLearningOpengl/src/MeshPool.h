@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Allocators.h"
+#include "Mesh.h"
+
+class Renderer;
+class Shader;
+
+struct MeshPoolStats
+{
+    unsigned int meshes = 0;
+    std::uint32_t vertexCapacity = 0;
+    std::uint32_t verticesUsed = 0;
+    std::uint32_t indexCapacity = 0;
+    std::uint32_t indicesUsed = 0;
+    float vertexFragmentation = 0.0f; // see TlsfAllocator::GetFragmentation
+    float indexFragmentation = 0.0f;
+    std::uint32_t freeBlocks = 0;     // vertex and index ranges together
+    unsigned int grows = 0;
+    unsigned int defragmentations = 0;
+    double lastDefragmentMs = 0.0;
+};
+
+// many small meshes (MeshVertex layout) in one vertex buffer and one index buffer, suballocated with
+// TlsfAllocator in vertices and indices. Every mesh keeps its own 0 based indices and is drawn with
+// its base vertex, so all of them share one vertex array: no buffer or vertex array switch per mesh.
+// The buffers double when full (a GPU copy), Defragment packs the meshes to the front again
+class MeshPool
+{
+public:
+    using Handle = unsigned int;
+    static constexpr Handle InvalidHandle = 0xFFFFFFFFu;
+
+private:
+    struct Entry
+    {
+        TlsfAllocator::Allocation vertices;
+        TlsfAllocator::Allocation indices;
+        std::uint32_t vertexCount = 0;
+        std::uint32_t indexCount = 0;
+        bool live = false;
+    };
+
+    std::unique_ptr<VertexArray> m_vao;
+    std::unique_ptr<VertexBuffer> m_vertexBuffer;
+    std::unique_ptr<ElementIndexBuffer> m_indexBuffer;
+    TlsfAllocator m_vertexAllocator;
+    TlsfAllocator m_indexAllocator;
+    std::vector<Entry> m_entries;
+    std::vector<Handle> m_freeHandles;
+    MeshPoolStats m_stats;
+
+    // replaces the buffers with ones of the given capacity, copying count vertices / indices from the
+    // old ones per (from, to) pair
+    struct Move
+    {
+        std::uint32_t from;
+        std::uint32_t to;
+        std::uint32_t count;
+    };
+    void Rebuild(std::uint32_t vertexCapacity, const std::vector<Move>& vertexMoves, std::uint32_t indexCapacity, const std::vector<Move>& indexMoves);
+
+public:
+    MeshPool(std::uint32_t vertexCapacity = 64 * 1024, std::uint32_t indexCapacity = 256 * 1024);
+
+    Handle Add(const MeshVertex* vertices, std::uint32_t vertexCount, const unsigned int* indices, std::uint32_t indexCount);
+    void Remove(Handle handle);
+    // moves every mesh to the front of the buffers, handles stay valid
+    void Defragment();
+
+    void Draw(const Renderer& renderer, Handle handle, const Shader& shader) const;
+
+    inline const VertexArray& GetVertexArray() const { return *m_vao; }
+    inline const ElementIndexBuffer& GetIndexBuffer() const { return *m_indexBuffer; }
+    inline int GetBaseVertex(Handle handle) const { return int(m_entries[handle].vertices.offset); }
+    inline std::uint32_t GetFirstIndex(Handle handle) const { return m_entries[handle].indices.offset; }
+    inline std::uint32_t GetIndexCount(Handle handle) const { return m_entries[handle].indexCount; }
+    MeshPoolStats GetStats() const;
+};
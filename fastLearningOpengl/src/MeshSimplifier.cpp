@@ -0,0 +1,233 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    // symmetric 4x4 plane quadric, weight is the total area that went into it
+    struct Quadric
+    {
+        double a2 = 0, ab = 0, ac = 0, ad = 0;
+        double b2 = 0, bc = 0, bd = 0;
+        double c2 = 0, cd = 0;
+        double d2 = 0;
+        double weight = 0;
+
+        void AddPlane(double a, double b, double c, double d, double w)
+        {
+            a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+            b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+            c2 += w * c * c; cd += w * c * d;
+            d2 += w * d * d;
+            weight += w;
+        }
+
+        void Add(const Quadric& q)
+        {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+            b2 += q.b2; bc += q.bc; bd += q.bd;
+            c2 += q.c2; cd += q.cd;
+            d2 += q.d2;
+            weight += q.weight;
+        }
+
+        // area weighted mean squared distance of p to the accumulated planes
+        double Error(const glm::vec3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                     + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                     + c2 * z * z + 2 * cd * z
+                     + d2;
+            return weight > 0 ? std::fabs(e) / weight : 0.0;
+        }
+    };
+
+    struct Collapse
+    {
+        unsigned int from, to;
+        double cost;
+    };
+
+    glm::vec3 Position(const MeshVertex& v)
+    {
+        return glm::vec3(v.position[0], v.position[1], v.position[2]);
+    }
+
+    struct PositionHash
+    {
+        std::size_t operator()(const glm::vec3& p) const
+        {
+            unsigned int bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            return std::size_t(bits[0]) * 73856093u ^ std::size_t(bits[1]) * 19349663u ^ std::size_t(bits[2]) * 83492791u;
+        }
+    };
+}
+
+namespace MeshSimplifier
+{
+
+std::vector<unsigned int> Simplify(const std::vector<MeshVertex>& vertices, const std::vector<unsigned int>& indices,
+                                   size_t targetIndexCount, float& resultError)
+{
+    const unsigned int vertexCount = unsigned(vertices.size());
+    std::vector<unsigned int> result(indices);
+    resultError = 0.0f;
+
+    // weld by position so seams are seen as one topological vertex
+    std::vector<unsigned int> wedge(vertexCount);
+    std::vector<unsigned int> wedgeSize(vertexCount, 0);
+    {
+        std::unordered_map<glm::vec3, unsigned int, PositionHash> firstAt;
+        for (unsigned int v = 0; v < vertexCount; v++) {
+            wedge[v] = firstAt.emplace(Position(vertices[v]), v).first->second;
+            wedgeSize[wedge[v]]++;
+        }
+    }
+
+    // seams (several attribute sets at one position) and open borders must not move
+    std::vector<bool> locked(vertexCount, false);
+    for (unsigned int v = 0; v < vertexCount; v++)
+        if (wedgeSize[wedge[v]] > 1)
+            locked[v] = true;
+    {
+        std::unordered_map<unsigned long long, int> edgeUse;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                unsigned int a = wedge[result[i + k]], b = wedge[result[i + (k + 1) % 3]];
+                unsigned long long key = (unsigned long long)std::min(a, b) << 32 | std::max(a, b);
+                edgeUse[key]++;
+            }
+        }
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                unsigned int a = result[i + k], b = result[i + (k + 1) % 3];
+                unsigned int wa = wedge[a], wb = wedge[b];
+                unsigned long long key = (unsigned long long)std::min(wa, wb) << 32 | std::max(wa, wb);
+                if (edgeUse[key] == 1)
+                    locked[a] = locked[b] = true;
+            }
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        glm::vec3 p0 = Position(vertices[result[i + 0]]);
+        glm::vec3 p1 = Position(vertices[result[i + 1]]);
+        glm::vec3 p2 = Position(vertices[result[i + 2]]);
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        float area = glm::length(n);
+        if (area <= 0.0f)
+            continue;
+        n /= area;
+        float d = -glm::dot(n, p0);
+        for (int k = 0; k < 3; k++)
+            quadrics[result[i + k]].AddPlane(n.x, n.y, n.z, d, area * 0.5);
+    }
+
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> adjacencyOffset(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<bool> touched(vertexCount);
+    std::vector<unsigned int> remap(vertexCount);
+    double worstCost = 0.0;
+
+    // each pass performs a batch of independent collapses, cheapest first
+    while (result.size() > targetIndexCount) {
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                unsigned int a = result[i + k], b = result[i + (k + 1) % 3];
+                Quadric q = quadrics[a];
+                q.Add(quadrics[b]);
+                if (!locked[a])
+                    collapses.push_back({a, b, q.Error(Position(vertices[b]))});
+                if (!locked[b])
+                    collapses.push_back({b, a, q.Error(Position(vertices[a]))});
+            }
+        }
+        if (collapses.empty())
+            break;
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+        for (unsigned int index : result)
+            adjacencyOffset[index + 1]++;
+        for (unsigned int v = 0; v < vertexCount; v++)
+            adjacencyOffset[v + 1] += adjacencyOffset[v];
+        adjacency.resize(result.size());
+        {
+            std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (size_t i = 0; i < result.size(); i++)
+                adjacency[fill[result[i]]++] = unsigned(i / 3);
+        }
+
+        std::fill(touched.begin(), touched.end(), false);
+        for (unsigned int v = 0; v < vertexCount; v++)
+            remap[v] = v;
+
+        // a collapse removes about two triangles
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t collapseBudget = std::max<size_t>(1, (trianglesToRemove + 1) / 2);
+        size_t performed = 0;
+
+        for (const Collapse& c : collapses) {
+            if (performed >= collapseBudget)
+                break;
+            if (touched[c.from] || touched[c.to])
+                continue;
+
+            // reject collapses that would fold a triangle over
+            bool flips = false;
+            glm::vec3 target = Position(vertices[c.to]);
+            for (unsigned int a = adjacencyOffset[c.from]; a < adjacencyOffset[c.from + 1] && !flips; a++) {
+                const unsigned int* tri = &result[adjacency[a] * 3];
+                if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+                    continue;
+                glm::vec3 p[3], q[3];
+                for (int k = 0; k < 3; k++) {
+                    p[k] = Position(vertices[tri[k]]);
+                    q[k] = tri[k] == c.from ? target : p[k];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                flips = glm::dot(before, after) <= 0.0f;
+            }
+            if (flips)
+                continue;
+
+            remap[c.from] = c.to;
+            quadrics[c.to].Add(quadrics[c.from]);
+            worstCost = std::max(worstCost, c.cost);
+            performed++;
+
+            // keep the neighbourhood fixed for the rest of this pass so the flip checks above stay valid
+            for (unsigned int v : {c.from, c.to})
+                for (unsigned int a = adjacencyOffset[v]; a < adjacencyOffset[v + 1]; a++)
+                    for (int k = 0; k < 3; k++)
+                        touched[result[adjacency[a] * 3 + k]] = true;
+        }
+        if (performed == 0)
+            break;
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a == b || b == c || c == a)
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    resultError = float(std::sqrt(worstCost));
+    return result;
+}
+
+}
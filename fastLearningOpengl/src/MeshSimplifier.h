@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vector>
+#include "Mesh.h"
+
+// offline LOD generation, runs on the import worker threads next to MeshOptimizer
+namespace MeshSimplifier
+{
+    // quadric error edge collapse (Garland & Heckbert) restricted to the existing vertices,
+    // so every LOD can index into the same vertex buffer. UV/normal seams and open borders are locked.
+    // returns the new index list; resultError is the object space distance error of the worst collapse
+    std::vector<unsigned int> Simplify(const std::vector<MeshVertex>& vertices, const std::vector<unsigned int>& indices,
+                                       size_t targetIndexCount, float& resultError);
+}
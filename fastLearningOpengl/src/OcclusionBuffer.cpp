@@ -0,0 +1,313 @@
+#include "OcclusionBuffer.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define OCCLUSION_SSE2
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define OCCLUSION_NEON
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // corners of a box, bit 0 picks x, bit 1 y, bit 2 z from max instead of min
+    constexpr unsigned char BoxTriangles[12][3] = {
+        {0, 1, 3}, {0, 3, 2}, {4, 6, 7}, {4, 7, 5}, // -z, +z
+        {0, 4, 5}, {0, 5, 1}, {2, 3, 7}, {2, 7, 6}, // -y, +y
+        {0, 2, 6}, {0, 6, 4}, {1, 5, 7}, {1, 7, 3}, // -x, +x
+    };
+    constexpr float MinClipW = 1e-5f;
+
+    void TransformCorners(const glm::mat4& modelViewProjection, const glm::vec3& min, const glm::vec3& max, glm::vec4 corners[8])
+    {
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 local((corner & 1) ? max.x : min.x, (corner & 2) ? max.y : min.y, (corner & 4) ? max.z : min.z);
+            corners[corner] = modelViewProjection * glm::vec4(local, 1.0f);
+        }
+    }
+
+    // the rasterizer's inner loop written once against a lane type, a step covers Width pixels of a row
+#if defined(OCCLUSION_SSE2)
+    struct Lanes
+    {
+        static constexpr unsigned int Width = 4;
+        __m128 v;
+        static Lanes Load(const float* p) { return {_mm_loadu_ps(p)}; }
+        static Lanes Broadcast(float x) { return {_mm_set1_ps(x)}; }
+        static Lanes Ramp() { return {_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f)}; }
+        void Store(float* p) const { _mm_storeu_ps(p, v); }
+        friend Lanes operator+(Lanes a, Lanes b) { return {_mm_add_ps(a.v, b.v)}; }
+        friend Lanes operator*(Lanes a, Lanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+        friend Lanes Min(Lanes a, Lanes b) { return {_mm_min_ps(a.v, b.v)}; }
+        // a where all three edge values are >= 0, b elsewhere
+        friend Lanes SelectInside(Lanes e0, Lanes e1, Lanes e2, Lanes a, Lanes b)
+        {
+            const __m128 zero = _mm_setzero_ps();
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0.v, zero), _mm_cmpge_ps(e1.v, zero)), _mm_cmpge_ps(e2.v, zero));
+            return {_mm_or_ps(_mm_and_ps(inside, a.v), _mm_andnot_ps(inside, b.v))};
+        }
+    };
+#elif defined(OCCLUSION_NEON)
+    struct Lanes
+    {
+        static constexpr unsigned int Width = 4;
+        float32x4_t v;
+        static Lanes Load(const float* p) { return {vld1q_f32(p)}; }
+        static Lanes Broadcast(float x) { return {vdupq_n_f32(x)}; }
+        static Lanes Ramp() { const float ramp[4] = {0.0f, 1.0f, 2.0f, 3.0f}; return {vld1q_f32(ramp)}; }
+        void Store(float* p) const { vst1q_f32(p, v); }
+        friend Lanes operator+(Lanes a, Lanes b) { return {vaddq_f32(a.v, b.v)}; }
+        friend Lanes operator*(Lanes a, Lanes b) { return {vmulq_f32(a.v, b.v)}; }
+        friend Lanes Min(Lanes a, Lanes b) { return {vminq_f32(a.v, b.v)}; }
+        friend Lanes SelectInside(Lanes e0, Lanes e1, Lanes e2, Lanes a, Lanes b)
+        {
+            const float32x4_t zero = vdupq_n_f32(0.0f);
+            uint32x4_t inside = vandq_u32(vandq_u32(vcgeq_f32(e0.v, zero), vcgeq_f32(e1.v, zero)), vcgeq_f32(e2.v, zero));
+            return {vbslq_f32(inside, a.v, b.v)};
+        }
+    };
+#endif
+
+    struct Scalar
+    {
+        static constexpr unsigned int Width = 1;
+        float v;
+        static Scalar Load(const float* p) { return {*p}; }
+        static Scalar Broadcast(float x) { return {x}; }
+        static Scalar Ramp() { return {0.0f}; }
+        void Store(float* p) const { *p = v; }
+        friend Scalar operator+(Scalar a, Scalar b) { return {a.v + b.v}; }
+        friend Scalar operator*(Scalar a, Scalar b) { return {a.v * b.v}; }
+        friend Scalar Min(Scalar a, Scalar b) { return {std::min(a.v, b.v)}; }
+        friend Scalar SelectInside(Scalar e0, Scalar e1, Scalar e2, Scalar a, Scalar b)
+        {
+            return e0.v >= 0.0f && e1.v >= 0.0f && e2.v >= 0.0f ? a : b;
+        }
+    };
+
+#if defined(OCCLUSION_SSE2) || defined(OCCLUSION_NEON)
+    using RasterLanes = Lanes;
+#else
+    using RasterLanes = Scalar;
+#endif
+
+    // value(x, y) = a * x + b * y + c at pixel centers
+    struct Plane
+    {
+        float a, b, c;
+    };
+
+    template<typename T>
+    void RasterizeRows(float* depth, unsigned int width, int minX, int maxX, int minY, int maxY, const Plane edges[3], const Plane& z)
+    {
+        minX -= minX % int(T::Width); // the rows are a multiple of Width long, so steps never run past one
+        const T ramp = T::Ramp();
+        for (int y = minY; y <= maxY; y++) {
+            const float py = float(y) + 0.5f;
+            T rows[4];
+            for (int plane = 0; plane < 3; plane++)
+                rows[plane] = T::Broadcast(edges[plane].b * py + edges[plane].c);
+            rows[3] = T::Broadcast(z.b * py + z.c);
+            float* row = depth + std::size_t(y) * width;
+            for (int x = minX; x <= maxX; x += int(T::Width)) {
+                const T px = T::Broadcast(float(x) + 0.5f) + ramp;
+                T e0 = T::Broadcast(edges[0].a) * px + rows[0];
+                T e1 = T::Broadcast(edges[1].a) * px + rows[1];
+                T e2 = T::Broadcast(edges[2].a) * px + rows[2];
+                T pixelDepth = T::Broadcast(z.a) * px + rows[3];
+                T old = T::Load(row + x);
+                SelectInside(e0, e1, e2, Min(old, pixelDepth), old).Store(row + x);
+            }
+        }
+    }
+}
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height)
+{
+    width = std::max(4u, (width + 3) & ~3u);
+    height = std::max(1u, height);
+    // down to 1x1, every level rounds up so the last texel of an odd row still has a parent
+    for (;;) {
+        m_widths.push_back(width);
+        m_heights.push_back(height);
+        m_levels.emplace_back(std::size_t(width) * height, 1.0f);
+        if (width == 1 && height == 1)
+            break;
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+}
+
+const char* OcclusionBuffer::GetSimdName()
+{
+#if defined(OCCLUSION_SSE2)
+    return "SSE2";
+#elif defined(OCCLUSION_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+void OcclusionBuffer::Begin(const glm::mat4& viewProjection)
+{
+    m_viewProjection = viewProjection;
+    std::fill(m_levels[0].begin(), m_levels[0].end(), 1.0f);
+    m_stats = {};
+}
+
+void OcclusionBuffer::AddOccluder(const glm::mat4& model, const glm::vec3& min, const glm::vec3& max)
+{
+    auto start = Clock::now();
+    glm::vec4 clip[8];
+    TransformCorners(m_viewProjection * model, min, max, clip);
+    // no clipping: a box reaching behind the near plane just isn't an occluder, which only costs culling
+    glm::vec3 window[8];
+    for (int corner = 0; corner < 8; corner++) {
+        if (clip[corner].w < MinClipW || clip[corner].z < -clip[corner].w)
+            return;
+        glm::vec3 ndc = glm::vec3(clip[corner]) / clip[corner].w;
+        window[corner] = glm::vec3((ndc.x * 0.5f + 0.5f) * float(m_widths[0]), (ndc.y * 0.5f + 0.5f) * float(m_heights[0]), ndc.z * 0.5f + 0.5f);
+    }
+    for (const auto& triangle : BoxTriangles)
+        RasterizeTriangle(window[triangle[0]], window[triangle[1]], window[triangle[2]]);
+    m_stats.occluders++;
+    m_stats.rasterMs += MillisecondsSince(start);
+}
+
+void OcclusionBuffer::RasterizeTriangle(const glm::vec3& v0, const glm::vec3& in1, const glm::vec3& in2)
+{
+    // both windings, the depth test keeps the nearest faces anyway
+    float area = (in1.x - v0.x) * (in2.y - v0.y) - (in1.y - v0.y) * (in2.x - v0.x);
+    if (std::fabs(area) < 1e-8f)
+        return;
+    const glm::vec3& v1 = area > 0.0f ? in1 : in2;
+    const glm::vec3& v2 = area > 0.0f ? in2 : in1;
+    area = std::fabs(area);
+
+    const int width = int(m_widths[0]), height = int(m_heights[0]);
+    int minX = std::max(0, int(std::floor(std::min({v0.x, v1.x, v2.x}))));
+    int maxX = std::min(width - 1, int(std::floor(std::max({v0.x, v1.x, v2.x}))));
+    int minY = std::max(0, int(std::floor(std::min({v0.y, v1.y, v2.y}))));
+    int maxY = std::min(height - 1, int(std::floor(std::max({v0.y, v1.y, v2.y}))));
+    if (minX > maxX || minY > maxY)
+        return;
+
+    // edge ab is >= 0 on the inside, and divided by the area it's the weight of the third vertex
+    auto edge = [](const glm::vec3& a, const glm::vec3& b) {
+        Plane plane{a.y - b.y, b.x - a.x, 0.0f};
+        plane.c = -(plane.a * a.x + plane.b * a.y);
+        return plane;
+    };
+    const Plane edges[3] = {edge(v1, v2), edge(v2, v0), edge(v0, v1)};
+    const float inverseArea = 1.0f / area;
+    const Plane z{(edges[0].a * v0.z + edges[1].a * v1.z + edges[2].a * v2.z) * inverseArea,
+                  (edges[0].b * v0.z + edges[1].b * v1.z + edges[2].b * v2.z) * inverseArea,
+                  (edges[0].c * v0.z + edges[1].c * v1.z + edges[2].c * v2.z) * inverseArea};
+    RasterizeRows<RasterLanes>(m_levels[0].data(), m_widths[0], minX, maxX, minY, maxY, edges, z);
+}
+
+void OcclusionBuffer::BuildPyramid()
+{
+    auto start = Clock::now();
+    for (std::size_t level = 1; level < m_levels.size(); level++) {
+        const std::vector<float>& source = m_levels[level - 1];
+        const unsigned int sourceWidth = m_widths[level - 1], sourceHeight = m_heights[level - 1];
+        std::vector<float>& target = m_levels[level];
+        for (unsigned int y = 0; y < m_heights[level]; y++) {
+            const unsigned int y0 = y * 2, y1 = std::min(y0 + 1, sourceHeight - 1);
+            for (unsigned int x = 0; x < m_widths[level]; x++) {
+                const unsigned int x0 = x * 2, x1 = std::min(x0 + 1, sourceWidth - 1);
+                target[y * m_widths[level] + x] = std::max(std::max(source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1]),
+                                                           std::max(source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1]));
+            }
+        }
+    }
+    m_stats.pyramidMs = MillisecondsSince(start);
+}
+
+OcclusionResult OcclusionBuffer::Test(const glm::mat4& model, const glm::vec3& min, const glm::vec3& max, float* screenArea) const
+{
+    if (screenArea)
+        *screenArea = 0.0f;
+    glm::vec4 clip[8];
+    TransformCorners(m_viewProjection * model, min, max, clip);
+    glm::vec3 low(1e30f), high(-1e30f);
+    for (int corner = 0; corner < 8; corner++) {
+        // reaches behind the camera, its rectangle is unbounded
+        if (clip[corner].w < MinClipW)
+            return OcclusionResult::Visible;
+        glm::vec3 ndc = glm::vec3(clip[corner]) / clip[corner].w;
+        low = glm::min(low, ndc);
+        high = glm::max(high, ndc);
+    }
+    if (high.x < -1.0f || low.x > 1.0f || high.y < -1.0f || low.y > 1.0f || high.z < -1.0f || low.z > 1.0f)
+        return OcclusionResult::OutsideFrustum;
+
+    low = glm::max(low, glm::vec3(-1.0f));
+    high = glm::min(high, glm::vec3(1.0f));
+    if (screenArea)
+        *screenArea = (high.x - low.x) * (high.y - low.y) * 0.25f;
+
+    const int width = int(m_widths[0]), height = int(m_heights[0]);
+    int x0 = std::min(width - 1, int((low.x * 0.5f + 0.5f) * float(width)));
+    int x1 = std::min(width - 1, int((high.x * 0.5f + 0.5f) * float(width)));
+    int y0 = std::min(height - 1, int((low.y * 0.5f + 0.5f) * float(height)));
+    int y1 = std::min(height - 1, int((high.y * 0.5f + 0.5f) * float(height)));
+    unsigned int level = 0;
+    while (level + 1 < m_levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+        level++;
+
+    float farthest = 0.0f;
+    const std::vector<float>& depth = m_levels[level];
+    for (int y = y0 >> level; y <= y1 >> level; y++) {
+        for (int x = x0 >> level; x <= x1 >> level; x++)
+            farthest = std::max(farthest, depth[std::size_t(y) * m_widths[level] + x]);
+    }
+    const float nearest = low.z * 0.5f + 0.5f;
+    return nearest > farthest ? OcclusionResult::Occluded : OcclusionResult::Visible;
+}
+
+void OcclusionBuffer::TestBoxes(const glm::mat4* models, unsigned int count, const glm::vec3& min, const glm::vec3& max,
+                                OcclusionResult* results, JobSystem* jobs)
+{
+    auto start = Clock::now();
+    std::mutex mutex;
+    auto testRange = [&](std::size_t begin, std::size_t end) {
+        unsigned int outside = 0, occluded = 0;
+        double occludedArea = 0.0;
+        for (std::size_t i = begin; i < end; i++) {
+            float area = 0.0f;
+            results[i] = Test(models[i], min, max, &area);
+            outside += results[i] == OcclusionResult::OutsideFrustum ? 1 : 0;
+            if (results[i] == OcclusionResult::Occluded) {
+                occluded++;
+                occludedArea += area;
+            }
+        }
+        // once per chunk
+        std::lock_guard<std::mutex> lock(mutex);
+        m_stats.outsideFrustum += outside;
+        m_stats.occluded += occluded;
+        m_stats.occludedScreenArea += occludedArea;
+    };
+    if (jobs)
+        jobs->ParallelFor(count, 8192, testRange);
+    else
+        testRange(0, count);
+    m_stats.tested += count;
+    m_stats.testMs += MillisecondsSince(start);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+class JobSystem;
+
+enum class OcclusionResult : std::uint8_t
+{
+    Visible,
+    Occluded,       // entirely behind the rasterized occluders
+    OutsideFrustum
+};
+
+struct OcclusionStats
+{
+    unsigned int occluders = 0;       // boxes rasterized (boxes crossing the near plane are skipped)
+    unsigned int tested = 0;
+    unsigned int outsideFrustum = 0;
+    unsigned int occluded = 0;
+    double rasterMs = 0.0;
+    double pyramidMs = 0.0;
+    double testMs = 0.0;
+    double occludedScreenArea = 0.0;  // screen rectangles of the occluded boxes, in screens (1 = the whole viewport)
+};
+
+// software occlusion culling: a few large occluders are rasterized on the CPU into a small depth
+// buffer (SIMD, 4 pixels per step), a pyramid of the farthest depth per 2x2 texels is built on
+// top, and a box is occluded when its nearest point is behind the farthest occluder depth over
+// its screen rectangle. The pyramid level is picked so the rectangle covers at most 2x2 texels,
+// so a test is a handful of reads whatever the box's size.
+// Depth is window depth, 0 near to 1 far; a pixel nothing covered is 1
+class OcclusionBuffer
+{
+private:
+    std::vector<std::vector<float>> m_levels; // level 0 is the depth buffer
+    std::vector<unsigned int> m_widths;
+    std::vector<unsigned int> m_heights;
+    glm::mat4 m_viewProjection{1.0f};
+    OcclusionStats m_stats;
+
+    void RasterizeTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2);
+
+public:
+    // width is rounded up to a multiple of 4, the SIMD step
+    OcclusionBuffer(unsigned int width = 256, unsigned int height = 144);
+
+    // clears the depth and the stats for a new frame seen through viewProjection
+    void Begin(const glm::mat4& viewProjection);
+    // the box [min, max] in model's space, all 12 triangles
+    void AddOccluder(const glm::mat4& model, const glm::vec3& min, const glm::vec3& max);
+    // after the last occluder, before any test
+    void BuildPyramid();
+
+    // screenArea gets the box's clamped screen rectangle in screens
+    OcclusionResult Test(const glm::mat4& model, const glm::vec3& min, const glm::vec3& max, float* screenArea = nullptr) const;
+    // count boxes sharing one local [min, max], split over jobs when given. Updates the stats
+    void TestBoxes(const glm::mat4* models, unsigned int count, const glm::vec3& min, const glm::vec3& max, OcclusionResult* results,
+                   JobSystem* jobs = nullptr);
+
+    inline unsigned int GetWidth() const { return m_widths[0]; }
+    inline unsigned int GetHeight() const { return m_heights[0]; }
+    inline unsigned int GetLevelCount() const { return unsigned(m_levels.size()); }
+    inline const float* GetDepth(unsigned int level = 0) const { return m_levels[level].data(); }
+    inline const OcclusionStats& GetStats() const { return m_stats; }
+
+    // "SSE2", "NEON" or "scalar", what the rasterizer runs on
+    static const char* GetSimdName();
+};
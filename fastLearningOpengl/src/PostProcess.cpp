@@ -0,0 +1,324 @@
+#include "PostProcess.h"
+#include "Renderer.h"
+#include "RenderTargetPool.h"
+#include "ShaderLibrary.h"
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct PassInfo
+    {
+        const char* define;
+        bool neighbours; // samples around its pixel, its input has to be a texture
+    };
+    // as PostPass
+    const PassInfo PASSES[PostProcess::PassCount] = {
+        {"TONEMAP", false},
+        {"FXAA", true},
+        {"COLOR_GRADE", false},
+    };
+
+    constexpr GLenum SCENE_FORMAT = GL_RGBA16F;
+
+    unsigned int Bit(PostPass pass)
+    {
+        return 1u << unsigned(pass);
+    }
+
+    FramebufferSpec TransientSpec(unsigned int width, unsigned int height, GLenum format)
+    {
+        FramebufferSpec spec;
+        spec.width = width;
+        spec.height = height;
+        spec.colorFormat = format;
+        spec.depthFormat = 0;
+        return spec;
+    }
+}
+
+PostProcess::PostProcess()
+{
+    SetAntialiasing(m_antialiasing);
+}
+
+PostProcess::~PostProcess()
+{
+    for (FrameQueries& queries : m_queries) {
+        if (queries.sceneStart) {
+            glCall(glDeleteQueries(1, &queries.sceneStart));
+            glCall(glDeleteQueries(1, &queries.postStart));
+            glCall(glDeleteQueries(1, &queries.postEnd));
+        }
+    }
+}
+
+void PostProcess::SetAntialiasing(Antialiasing antialiasing)
+{
+    m_antialiasing = antialiasing;
+    m_enabled[unsigned(PostPass::Fxaa)] = antialiasing == Antialiasing::Fxaa;
+}
+
+const char* PostProcess::GetAntialiasingName(Antialiasing antialiasing)
+{
+    switch (antialiasing) {
+    case Antialiasing::None:   return "Off";
+    case Antialiasing::Msaa4x: return "MSAA 4x";
+    case Antialiasing::Fxaa:   return "FXAA";
+    }
+    return "";
+}
+
+Shader& PostProcess::GetVariant(unsigned int mask)
+{
+    if (!m_variants[mask]) {
+        std::vector<std::string> defines;
+        for (unsigned int pass = 0; pass < PassCount; pass++) {
+            if (mask & (1u << pass))
+                defines.push_back(PASSES[pass].define);
+        }
+        m_variants[mask] = Shaders::Get().Get("res/Shaders/PostProcess.shader", defines);
+    }
+    return *m_variants[mask];
+}
+
+void PostProcess::SetUniforms(Shader& shader, unsigned int mask) const
+{
+    if (mask & Bit(PostPass::Tonemap))
+        shader.SetUniform1f("u_Exposure", m_exposure);
+    if (mask & Bit(PostPass::ColorGrade)) {
+        shader.SetUniform1f("u_Contrast", m_contrast);
+        shader.SetUniform1f("u_Saturation", m_saturation);
+        shader.SetUniform3f("u_Tint", m_tint[0], m_tint[1], m_tint[2]);
+    }
+}
+
+void PostProcess::ReadQueries(FrameQueries& queries)
+{
+    GLuint64 sceneStart = 0, postStart = 0, postEnd = 0;
+    glCall(glGetQueryObjectui64v(queries.sceneStart, GL_QUERY_RESULT, &sceneStart));
+    glCall(glGetQueryObjectui64v(queries.postStart, GL_QUERY_RESULT, &postStart));
+    glCall(glGetQueryObjectui64v(queries.postEnd, GL_QUERY_RESULT, &postEnd));
+    m_stats.sceneGpuMs = double(postStart - sceneStart) / 1e6;
+    m_stats.postGpuMs = double(postEnd - postStart) / 1e6;
+    queries.pending = false;
+}
+
+void PostProcess::BeginScene(int windowWidth, int windowHeight, float scale)
+{
+    m_windowWidth = std::max(windowWidth, 1);
+    m_windowHeight = std::max(windowHeight, 1);
+    const unsigned int samples = m_antialiasing == Antialiasing::Msaa4x ? MsaaSamples : 1;
+    if (!m_scene || m_scene->GetSamples() != samples) {
+        FramebufferSpec spec;
+        spec.width = unsigned(m_windowWidth);
+        spec.height = unsigned(m_windowHeight);
+        spec.samples = samples;
+        spec.colorFormat = SCENE_FORMAT;
+        m_scene = std::make_unique<Framebuffer>(spec);
+    } else {
+        m_scene->Resize(unsigned(m_windowWidth), unsigned(m_windowHeight));
+    }
+    m_stats.width = std::max(1u, unsigned(std::lround(m_windowWidth * scale)));
+    m_stats.height = std::max(1u, unsigned(std::lround(m_windowHeight * scale)));
+    m_stats.sceneBytes = m_scene->GetMemoryBytes();
+
+    // the results of QueryFrames frames ago are in by now
+    FrameQueries& queries = m_queries[m_frame % QueryFrames];
+    if (!queries.sceneStart) {
+        glCall(glGenQueries(1, &queries.sceneStart));
+        glCall(glGenQueries(1, &queries.postStart));
+        glCall(glGenQueries(1, &queries.postEnd));
+    }
+    if (queries.pending)
+        ReadQueries(queries);
+    glCall(glQueryCounter(queries.sceneStart, GL_TIMESTAMP));
+
+    m_scene->Bind();
+    glCall(glViewport(0, 0, GLsizei(m_stats.width), GLsizei(m_stats.height)));
+    // the whole target, the part outside the viewport is never read
+    glCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+}
+
+void PostProcess::EndScene(const Renderer& renderer)
+{
+    FrameQueries& queries = m_queries[m_frame % QueryFrames];
+    glCall(glQueryCounter(queries.postStart, GL_TIMESTAMP));
+
+    // the enabled passes, fused: a pass that only reads its own pixel joins the draw before it
+    unsigned int groups[PassCount] = {};
+    unsigned int groupCount = 0;
+    m_stats.passes = 0;
+    for (unsigned int pass = 0; pass < PassCount; pass++) {
+        if (!m_enabled[pass])
+            continue;
+        m_stats.passes++;
+        if (groupCount == 0 || PASSES[pass].neighbours)
+            groups[groupCount++] = 0;
+        groups[groupCount - 1] |= 1u << pass;
+    }
+
+    const unsigned int width = m_stats.width, height = m_stats.height;
+    const unsigned int targetWidth = m_scene->GetWidth(), targetHeight = m_scene->GetHeight();
+    RenderTargetPool& pool = RenderTargets::Get();
+    m_stats.draws = 0;
+    if (groupCount == 0 && width == targetWidth && height == targetHeight && m_scene->GetSamples() == 1) {
+        // nothing to run, one blit into the window. Not for MSAA: resolving RGBA16F samples into the
+        // RGBA8 window is GL_INVALID_OPERATION, that goes through a resolved target and the copy pass
+        m_scene->ResolveToDefault(width, height);
+        Framebuffer::BindDefault(m_windowWidth, m_windowHeight);
+    } else {
+        if (groupCount == 0)
+            groups[groupCount++] = 0; // the plain copy, it upscales
+        // a multisampled target can't be sampled
+        const Framebuffer* source = m_scene.get();
+        const Framebuffer* transient = nullptr;
+        if (m_scene->GetSamples() > 1) {
+            Framebuffer& resolved = pool.Acquire(TransientSpec(targetWidth, targetHeight, SCENE_FORMAT));
+            m_scene->ResolveTo(resolved, width, height);
+            source = transient = &resolved;
+        }
+
+        glCall(GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST));
+        glCall(GLboolean blend = glIsEnabled(GL_BLEND));
+        glCall(glDisable(GL_DEPTH_TEST));
+        glCall(glDisable(GL_BLEND));
+        glCall(glActiveTexture(GL_TEXTURE0));
+
+        GLenum format = SCENE_FORMAT;
+        for (unsigned int group = 0; group < groupCount; group++) {
+            // after the tonemap everything is in [0, 1], 8 bits do
+            if (groups[group] & Bit(PostPass::Tonemap))
+                format = GL_RGBA8;
+            Framebuffer* target = nullptr;
+            if (group + 1 == groupCount) {
+                Framebuffer::BindDefault(m_windowWidth, m_windowHeight);
+            } else {
+                target = &pool.Acquire(TransientSpec(targetWidth, targetHeight, format));
+                target->Bind();
+                glCall(glViewport(0, 0, GLsizei(width), GLsizei(height)));
+            }
+
+            Shader& shader = GetVariant(groups[group]);
+            shader.Bind();
+            shader.SetUniform1i("u_Source", 0);
+            shader.SetUniform4f("u_UvRect", float(width) / targetWidth, float(height) / targetHeight,
+                                (width - 0.5f) / targetWidth, (height - 0.5f) / targetHeight);
+            SetUniforms(shader, groups[group]);
+            glCall(glBindTexture(GL_TEXTURE_2D, source->GetColorTexture()));
+            renderer.DrawFullscreen(shader);
+            m_stats.draws++;
+
+            // read, its memory can go to the next target
+            if (transient)
+                pool.Release(*transient);
+            source = transient = target;
+        }
+        glCall(glBindTexture(GL_TEXTURE_2D, 0));
+
+        if (depthTest) {
+            glCall(glEnable(GL_DEPTH_TEST));
+        }
+        if (blend) {
+            glCall(glEnable(GL_BLEND));
+        }
+    }
+    m_stats.transientBytes = pool.GetStats().peakInUseBytes;
+
+    glCall(glQueryCounter(queries.postEnd, GL_TIMESTAMP));
+    queries.pending = true;
+    m_frame++;
+    UpdateComparison();
+}
+
+void PostProcess::StartComparison()
+{
+    if (m_comparing)
+        return;
+    m_comparing = true;
+    m_compareIndex = 0;
+    m_compareFrames = 0;
+    m_compareRestore = m_antialiasing;
+    m_compareResults[0] = m_compareResults[1] = AntialiasingResult();
+    SetAntialiasing(Antialiasing::Msaa4x);
+}
+
+void PostProcess::UpdateComparison()
+{
+    if (!m_comparing || ++m_compareFrames <= CompareSettleFrames)
+        return;
+    AntialiasingResult& result = m_compareResults[m_compareIndex];
+    result.sceneGpuMs += m_stats.sceneGpuMs;
+    result.postGpuMs += m_stats.postGpuMs;
+    result.memoryBytes = std::max(result.memoryBytes, m_stats.sceneBytes + m_stats.transientBytes);
+    if (m_compareFrames < CompareSettleFrames + CompareMeasureFrames)
+        return;
+
+    result.sceneGpuMs /= CompareMeasureFrames;
+    result.postGpuMs /= CompareMeasureFrames;
+    result.measured = true;
+    std::cout << "Info (POST PROCESS): " << GetAntialiasingName(m_antialiasing) << " at " << m_stats.width << "x" << m_stats.height
+              << ": scene " << result.sceneGpuMs << " ms, post " << result.postGpuMs << " ms, "
+              << result.memoryBytes / (1024.0 * 1024.0) << " MB of targets" << std::endl;
+    if (++m_compareIndex < 2) {
+        m_compareFrames = 0;
+        SetAntialiasing(Antialiasing::Fxaa);
+    } else {
+        m_comparing = false;
+        SetAntialiasing(m_compareRestore);
+    }
+}
+
+void PostProcess::DrawImGui()
+{
+    if (!m_comparing) {
+        const Antialiasing antialiasingModes[] = {Antialiasing::None, Antialiasing::Msaa4x, Antialiasing::Fxaa};
+        if (ImGui::BeginCombo("Antialiasing", GetAntialiasingName(m_antialiasing))) {
+            for (Antialiasing mode : antialiasingModes) {
+                if (ImGui::Selectable(GetAntialiasingName(mode), mode == m_antialiasing))
+                    SetAntialiasing(mode);
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Compare"))
+            StartComparison();
+    } else {
+        ImGui::Text("Comparing antialiasing: %s", GetAntialiasingName(m_antialiasing));
+    }
+    bool tonemap = IsEnabled(PostPass::Tonemap);
+    if (ImGui::Checkbox("Tonemap", &tonemap))
+        SetEnabled(PostPass::Tonemap, tonemap);
+    if (tonemap) {
+        float exposure = GetExposure();
+        if (ImGui::SliderFloat("Exposure", &exposure, 0.1f, 8.0f, "%.2f", ImGuiSliderFlags_Logarithmic))
+            SetExposure(exposure);
+    }
+    bool colorGrade = IsEnabled(PostPass::ColorGrade);
+    if (ImGui::Checkbox("Color grading", &colorGrade))
+        SetEnabled(PostPass::ColorGrade, colorGrade);
+    if (colorGrade) {
+        float contrast = GetContrast(), saturation = GetSaturation();
+        float tint[3] = {GetTint()[0], GetTint()[1], GetTint()[2]};
+        if (ImGui::SliderFloat("Contrast", &contrast, 0.5f, 2.0f))
+            SetContrast(contrast);
+        if (ImGui::SliderFloat("Saturation", &saturation, 0.0f, 2.0f))
+            SetSaturation(saturation);
+        if (ImGui::ColorEdit3("Tint", tint))
+            SetTint(tint[0], tint[1], tint[2]);
+    }
+    ImGui::Text("Post: %u passes in %u draws, scene %ux%u; GPU %.2f ms scene, %.2f ms post", m_stats.passes, m_stats.draws,
+                m_stats.width, m_stats.height, m_stats.sceneGpuMs, m_stats.postGpuMs);
+    ImGui::Text("Targets: scene %.1f MB, transient %.1f MB (%.1f MB without the pool)", m_stats.sceneBytes / (1024.0 * 1024.0),
+                m_stats.transientBytes / (1024.0 * 1024.0), RenderTargets::Get().GetStats().unpooledBytes / (1024.0 * 1024.0));
+    for (unsigned int i = 0; i < 2; i++) {
+        if (m_compareResults[i].measured)
+            ImGui::Text("%s: %.2f ms scene, %.2f ms post, %.1f MB of targets", i == 0 ? "MSAA 4x" : "FXAA", m_compareResults[i].sceneGpuMs,
+                        m_compareResults[i].postGpuMs, m_compareResults[i].memoryBytes / (1024.0 * 1024.0));
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <glad/glad.h>
+#include "Framebuffer.h"
+
+class Renderer;
+class Shader;
+
+enum class Antialiasing
+{
+    None,
+    Msaa4x, // the scene target has 4 samples, resolved before the passes
+    Fxaa    // a single sampled scene, the FXAA pass smooths the edges afterwards
+};
+
+// in chain order
+enum class PostPass
+{
+    Tonemap,
+    Fxaa,       // enabled by Antialiasing::Fxaa
+    ColorGrade,
+    Count
+};
+
+struct PostProcessStats
+{
+    unsigned int passes = 0;         // enabled this frame
+    unsigned int draws = 0;          // full screen draws they took after fusing, blits not counted
+    unsigned int width = 0;          // the scene's resolution
+    unsigned int height = 0;
+    std::size_t sceneBytes = 0;      // the scene target, all its samples
+    std::size_t transientBytes = 0;  // the pool's peak in use this frame: resolve and intermediate targets
+    double sceneGpuMs = 0.0;         // from BeginScene to EndScene, a few frames old
+    double postGpuMs = 0.0;          // EndScene: resolve, passes, upscale
+};
+
+// the numbers of one antialiasing mode over a comparison run
+struct AntialiasingResult
+{
+    bool measured = false;
+    double sceneGpuMs = 0.0;
+    double postGpuMs = 0.0;
+    std::size_t memoryBytes = 0;     // scene target and transients
+};
+
+// the scene goes into an offscreen HDR (RGBA16F) target instead of the window, EndScene runs the
+// enabled passes over it into the window. Consecutive passes that only look at their own pixel are
+// fused into the shader of the pass before them; a pass that samples neighbours (FXAA) needs its input
+// in a texture and starts a new draw. Each draw is one variant of res/Shaders/PostProcess.shader.
+// Intermediate targets come from RenderTargets, a disabled pass costs no draw and no target.
+// The scene can be rendered at a fraction of the window's size, the last draw stretches it
+class PostProcess
+{
+public:
+    static constexpr unsigned int MsaaSamples = 4;
+    static constexpr unsigned int PassCount = unsigned(PostPass::Count);
+
+private:
+    static constexpr unsigned int QueryFrames = 3;
+    static constexpr unsigned int CompareSettleFrames = 8;   // queries lag and the targets get reallocated
+    static constexpr unsigned int CompareMeasureFrames = 120;
+    struct FrameQueries
+    {
+        unsigned int sceneStart = 0;
+        unsigned int postStart = 0;
+        unsigned int postEnd = 0;
+        bool pending = false;
+    };
+
+    std::unique_ptr<Framebuffer> m_scene;
+    Antialiasing m_antialiasing = Antialiasing::Msaa4x;
+    bool m_enabled[PassCount] = {};
+    std::shared_ptr<Shader> m_variants[1u << PassCount]; // by the mask of fused passes, fetched on first use
+    float m_exposure = 1.0f;
+    float m_contrast = 1.0f;
+    float m_saturation = 1.0f;
+    float m_tint[3] = {1.0f, 1.0f, 1.0f};
+    int m_windowWidth = 0;
+    int m_windowHeight = 0;
+    FrameQueries m_queries[QueryFrames];
+    std::uint64_t m_frame = 0;
+    PostProcessStats m_stats;
+
+    // MSAA 4x, then FXAA, CompareMeasureFrames each after settling; the mode before comes back after
+    bool m_comparing = false;
+    unsigned int m_compareIndex = 0;
+    unsigned int m_compareFrames = 0;
+    Antialiasing m_compareRestore = Antialiasing::Msaa4x;
+    AntialiasingResult m_compareResults[2];
+
+    Shader& GetVariant(unsigned int mask);
+    void SetUniforms(Shader& shader, unsigned int mask) const;
+    void ReadQueries(FrameQueries& queries);
+    void UpdateComparison();
+
+public:
+    PostProcess();
+    ~PostProcess();
+    PostProcess(const PostProcess&) = delete;
+    PostProcess& operator=(const PostProcess&) = delete;
+
+    // binds the scene target and clears it, the tests render as if it were the window. A scale below
+    // 1 renders into that part of it
+    void BeginScene(int windowWidth, int windowHeight, float scale = 1.0f);
+    // runs the passes into the window's framebuffer, which stays bound
+    void EndScene(const Renderer& renderer);
+
+    void SetAntialiasing(Antialiasing antialiasing);
+    inline Antialiasing GetAntialiasing() const { return m_antialiasing; }
+    static const char* GetAntialiasingName(Antialiasing antialiasing);
+    // FXAA follows SetAntialiasing, the others are free
+    inline void SetEnabled(PostPass pass, bool enabled) { if (pass != PostPass::Fxaa) m_enabled[unsigned(pass)] = enabled; }
+    inline bool IsEnabled(PostPass pass) const { return m_enabled[unsigned(pass)]; }
+
+    inline void SetExposure(float exposure) { m_exposure = exposure; }
+    inline void SetContrast(float contrast) { m_contrast = contrast; }
+    inline void SetSaturation(float saturation) { m_saturation = saturation; }
+    inline void SetTint(float r, float g, float b) { m_tint[0] = r; m_tint[1] = g; m_tint[2] = b; }
+    inline float GetExposure() const { return m_exposure; }
+    inline float GetContrast() const { return m_contrast; }
+    inline float GetSaturation() const { return m_saturation; }
+    inline const float* GetTint() const { return m_tint; }
+
+    // measures MSAA 4x and FXAA on whatever renders meanwhile
+    void StartComparison();
+    inline bool IsComparing() const { return m_comparing; }
+    // [0] MSAA 4x, [1] FXAA
+    inline const AntialiasingResult* GetComparison() const { return m_compareResults; }
+    inline const PostProcessStats& GetStats() const { return m_stats; }
+
+    // its settings and stats, drawn into the application's Settings window
+    void DrawImGui();
+};
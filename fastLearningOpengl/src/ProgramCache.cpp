@@ -0,0 +1,235 @@
+#include "ProgramCache.h"
+#include "Renderer.h"
+#include "Shader.h"
+#include "GLFW/glfw3.h" // glfwGetProcAddress, for the ARB entry points glad doesn't load on a 3.3 context
+
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    const char* CACHE_DIRECTORY = "shadercache";
+    constexpr std::uint32_t CACHE_MAGIC = 0x42505347; // "GSPB"
+    constexpr std::uint32_t CACHE_VERSION = 1;
+
+    struct CacheHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t sourceHash;
+        std::uint64_t driverHash;
+        std::uint32_t format;   // the binary format glGetProgramBinary reported
+        std::uint32_t size;     // bytes of binary after the header
+    };
+
+    enum class Support
+    {
+        Unknown,
+        Available,
+        Unavailable
+    };
+
+    Support s_support = Support::Unknown;
+    std::atomic<bool> s_enabled{true}; // read by the shader compiler thread too
+    std::uint64_t s_driverHash = 0;
+    ProgramCacheStats s_stats;
+
+    // FNV-1a, 64 bit
+    std::uint64_t Hash(const void* data, std::size_t size, std::uint64_t hash = 0xcbf29ce484222325ull)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    std::uint64_t HashString(const char* text, std::uint64_t hash)
+    {
+        // the terminator goes in too, so "ab" + "c" and "a" + "bc" differ
+        return text ? Hash(text, std::strlen(text) + 1, hash) : Hash("", 1, hash);
+    }
+
+    std::uint64_t HashSource(const ShaderProgramSource& source)
+    {
+        // every stage, a geometry or compute edit has to miss the cache as well
+        std::uint64_t hash = HashString(source.VertexSource.c_str(), 0xcbf29ce484222325ull);
+        hash = HashString(source.FragmentSource.c_str(), hash);
+        hash = HashString(source.GeometrySource.c_str(), hash);
+        return HashString(source.ComputeSource.c_str(), hash);
+    }
+
+    std::string CachePath(const std::string& cacheName)
+    {
+        // res/Shaders/Basic.shader -> shadercache/res_Shaders_Basic_shader.bin
+        std::string name = cacheName;
+        for (char& c : name) {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-')
+                c = '_';
+        }
+        return std::string(CACHE_DIRECTORY) + "/" + name + ".bin";
+    }
+
+    Support DetectSupport()
+    {
+        // glad only loads these for a 4.1+ context, on 3.3 they come from the extension
+        if (!glad_glGetProgramBinary && glHasExtension("GL_ARB_get_program_binary")) {
+            glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)glfwGetProcAddress("glGetProgramBinary");
+            glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)glfwGetProcAddress("glProgramBinary");
+            glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)glfwGetProcAddress("glProgramParameteri");
+        }
+        if (!glad_glGetProgramBinary || !glad_glProgramBinary || !glad_glProgramParameteri) {
+            std::cout << "Info (SHADER CACHE): program binaries not supported, shaders are compiled from source" << std::endl;
+            return Support::Unavailable;
+        }
+        GLint formats = 0;
+        glCall(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats));
+        if (formats == 0) {
+            std::cout << "Info (SHADER CACHE): driver offers no program binary formats, shaders are compiled from source" << std::endl;
+            return Support::Unavailable;
+        }
+
+        // a driver update may change the binary format without telling, so the driver is part of the key
+        glCall(const GLubyte* vendor = glGetString(GL_VENDOR));
+        glCall(const GLubyte* renderer = glGetString(GL_RENDERER));
+        glCall(const GLubyte* version = glGetString(GL_VERSION));
+        s_driverHash = HashString(reinterpret_cast<const char*>(vendor), 0xcbf29ce484222325ull);
+        s_driverHash = HashString(reinterpret_cast<const char*>(renderer), s_driverHash);
+        s_driverHash = HashString(reinterpret_cast<const char*>(version), s_driverHash);
+        return Support::Available;
+    }
+}
+
+namespace ProgramCache
+{
+    bool IsAvailable()
+    {
+        if (s_support == Support::Unknown)
+            s_support = DetectSupport();
+        return s_support == Support::Available;
+    }
+
+    void SetEnabled(bool enabled)
+    {
+        s_enabled = enabled;
+    }
+
+    bool IsEnabled()
+    {
+        return s_enabled && IsAvailable();
+    }
+
+    unsigned int Load(const std::string& cacheName, const ShaderProgramSource& source)
+    {
+        if (!IsEnabled())
+            return 0;
+        std::ifstream file(CachePath(cacheName), std::ios::binary);
+        if (!file)
+            return 0;
+
+        CacheHeader header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != CACHE_MAGIC ||
+            header.version != CACHE_VERSION || header.sourceHash != HashSource(source) || header.driverHash != s_driverHash) {
+            s_stats.rejected++;
+            return 0;
+        }
+        // a truncated or corrupt file can claim any size, don't allocate more than is actually there
+        const std::streamoff headerEnd = file.tellg();
+        file.seekg(0, std::ios::end);
+        const std::streamoff remaining = file.tellg() - headerEnd;
+        file.seekg(headerEnd);
+        if (header.size == 0 || std::streamoff(header.size) > remaining) {
+            s_stats.rejected++;
+            return 0;
+        }
+        std::vector<char> binary(header.size);
+        if (!file.read(binary.data(), std::streamsize(binary.size()))) {
+            s_stats.rejected++;
+            return 0;
+        }
+
+        glCall(unsigned int program = glCreateProgram());
+        // the driver may still refuse the binary, that is an expected outcome here and not a GL bug,
+        // so glProgramBinary and the link status query don't go through glCall
+        glClearError();
+        glProgramBinary(program, header.format, binary.data(), GLsizei(binary.size()));
+        GLint linked = GL_FALSE;
+        if (glGetError() == GL_NO_ERROR)
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE) {
+            glClearError();
+            glCall(glDeleteProgram(program));
+            s_stats.rejected++;
+            return 0;
+        }
+        return program;
+    }
+
+    void PrepareProgram(unsigned int program)
+    {
+        if (IsEnabled()) {
+            glCall(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        }
+    }
+
+    void Store(const std::string& cacheName, const ShaderProgramSource& source, unsigned int program)
+    {
+        if (!IsEnabled() || !program)
+            return;
+        GLint linked = GL_FALSE, length = 0;
+        glCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+        glCall(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+        if (linked != GL_TRUE || length <= 0)
+            return;
+
+        std::vector<char> binary(std::size_t(length), 0);
+        GLenum format = 0;
+        GLsizei written = 0;
+        glCall(glGetProgramBinary(program, length, &written, &format, binary.data()));
+
+        std::error_code error;
+        std::filesystem::create_directories(CACHE_DIRECTORY, error);
+        std::ofstream file(CachePath(cacheName), std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cout << "Error (SHADER CACHE): can't write " << CachePath(cacheName) << std::endl;
+            return;
+        }
+        CacheHeader header = {CACHE_MAGIC, CACHE_VERSION, HashSource(source), s_driverHash, format, std::uint32_t(written)};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), written);
+    }
+
+    void Clear()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(CACHE_DIRECTORY, error);
+    }
+
+    void RecordLoad(bool fromCache, double ms)
+    {
+        if (fromCache) {
+            s_stats.warmLoads++;
+            s_stats.warmMs += ms;
+        } else {
+            s_stats.coldLoads++;
+            s_stats.coldMs += ms;
+        }
+    }
+
+    const ProgramCacheStats& GetStats()
+    {
+        return s_stats;
+    }
+
+    const char* GetDirectory()
+    {
+        return CACHE_DIRECTORY;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+struct ShaderProgramSource;
+
+struct ProgramCacheStats
+{
+    unsigned int warmLoads = 0; // programs that came from the cache
+    unsigned int coldLoads = 0; // programs compiled and linked from source
+    double warmMs = 0.0;
+    double coldMs = 0.0;
+    unsigned int rejected = 0;  // cache files that didn't match the source or the driver
+};
+
+// linked programs saved with glGetProgramBinary and restored with glProgramBinary, so a shader
+// whose source didn't change skips compiling and linking. A cache file is only used when the source
+// hash and the driver (vendor, renderer, version) match what it was written with, anything else
+// falls back to compiling from source and overwrites it.
+// needs GL 4.1 or ARB_get_program_binary plus at least one binary format, otherwise it stays off
+namespace ProgramCache
+{
+    bool IsAvailable();
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+
+    // cacheName identifies the program (shader path plus defines). The program from the cache, 0 if there is no usable entry
+    unsigned int Load(const std::string& cacheName, const ShaderProgramSource& source);
+    // call on a new program before linking it, some drivers only keep the binary when asked to
+    void PrepareProgram(unsigned int program);
+    void Store(const std::string& cacheName, const ShaderProgramSource& source, unsigned int program);
+    // deletes every cache file, the next loads are cold again
+    void Clear();
+
+    void RecordLoad(bool fromCache, double ms);
+    const ProgramCacheStats& GetStats();
+    const char* GetDirectory();
+}
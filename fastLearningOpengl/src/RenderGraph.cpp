@@ -0,0 +1,437 @@
+#include "RenderGraph.h"
+#include "Renderer.h"
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    constexpr unsigned int NO_PASS = ~0u;
+    constexpr unsigned int STATE_FIELDS = 5; // in RenderGraphState
+
+    RenderGraphState QueryState()
+    {
+        RenderGraphState state;
+        GLboolean depthWrite = GL_TRUE, colorWrite[4] = {GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE};
+        GLint depthFunc = GL_LESS;
+        glCall(state.depthTest = glIsEnabled(GL_DEPTH_TEST));
+        glCall(glGetBooleanv(GL_DEPTH_WRITEMASK, &depthWrite));
+        glCall(glGetIntegerv(GL_DEPTH_FUNC, &depthFunc));
+        glCall(state.blend = glIsEnabled(GL_BLEND));
+        glCall(glGetBooleanv(GL_COLOR_WRITEMASK, colorWrite));
+        state.depthWrite = depthWrite;
+        state.depthFunc = GLenum(depthFunc);
+        state.colorWrite = colorWrite[0];
+        return state;
+    }
+
+    // only the calls for what differs, returns how many it made
+    unsigned int ApplyState(RenderGraphState& current, const RenderGraphState& wanted)
+    {
+        unsigned int changes = 0;
+        if (current.depthTest != wanted.depthTest) {
+            if (wanted.depthTest) {
+                glCall(glEnable(GL_DEPTH_TEST));
+            } else {
+                glCall(glDisable(GL_DEPTH_TEST));
+            }
+            changes++;
+        }
+        if (current.depthWrite != wanted.depthWrite) {
+            glCall(glDepthMask(wanted.depthWrite ? GL_TRUE : GL_FALSE));
+            changes++;
+        }
+        if (current.depthFunc != wanted.depthFunc) {
+            glCall(glDepthFunc(wanted.depthFunc));
+            changes++;
+        }
+        if (current.blend != wanted.blend) {
+            if (wanted.blend) {
+                glCall(glEnable(GL_BLEND));
+            } else {
+                glCall(glDisable(GL_BLEND));
+            }
+            changes++;
+        }
+        if (current.colorWrite != wanted.colorWrite) {
+            const GLboolean mask = wanted.colorWrite ? GL_TRUE : GL_FALSE;
+            glCall(glColorMask(mask, mask, mask, mask));
+            changes++;
+        }
+        current = wanted;
+        return changes;
+    }
+}
+
+unsigned int RenderGraphContext::GetTexture(RenderGraphResource resource) const
+{
+    const Framebuffer* framebuffer = m_graph.GetResource(resource).framebuffer;
+    return framebuffer ? framebuffer->GetColorTexture() : 0;
+}
+
+const Framebuffer* RenderGraphContext::GetFramebuffer(RenderGraphResource resource) const
+{
+    return m_graph.GetResource(resource).framebuffer;
+}
+
+unsigned int RenderGraphContext::GetWidth(RenderGraphResource resource) const
+{
+    return m_graph.GetResource(resource).spec.width;
+}
+
+unsigned int RenderGraphContext::GetHeight(RenderGraphResource resource) const
+{
+    return m_graph.GetResource(resource).spec.height;
+}
+
+void RenderGraphContext::BindTexture(RenderGraphResource resource, unsigned int unit) const
+{
+    glCall(glActiveTexture(GL_TEXTURE0 + unit));
+    glCall(glBindTexture(GL_TEXTURE_2D, GetTexture(resource)));
+}
+
+RenderGraphResource RenderGraph::Builder::Read(RenderGraphResource resource)
+{
+    assert(resource < m_graph.m_versions.size());
+    m_graph.m_passes[m_pass].reads.push_back(resource);
+    return resource;
+}
+
+RenderGraphResource RenderGraph::Builder::Write(RenderGraphResource resource, LoadOp color, LoadOp depth)
+{
+    Pass& pass = m_graph.m_passes[m_pass];
+    assert(resource < m_graph.m_versions.size() && pass.write == InvalidResource); // one target per pass
+    pass.writeFrom = resource;
+    pass.write = m_graph.AddVersion(m_graph.m_versions[resource].resource, m_pass);
+    pass.colorLoad = color;
+    pass.depthLoad = depth;
+    return pass.write;
+}
+
+void RenderGraph::Builder::SetState(const RenderGraphState& state)
+{
+    m_graph.m_passes[m_pass].hasState = true;
+    m_graph.m_passes[m_pass].state = state;
+}
+
+void RenderGraph::Builder::SetSideEffect()
+{
+    m_graph.m_passes[m_pass].sideEffect = true;
+}
+
+void RenderGraph::Reset()
+{
+    m_resources.clear();
+    m_versions.clear();
+    m_passes.clear();
+    m_order.clear();
+    m_compiled = false;
+    m_stats = RenderGraphStats();
+}
+
+RenderGraphResource RenderGraph::AddVersion(unsigned int resource, unsigned int producer)
+{
+    m_versions.push_back({resource, producer});
+    return RenderGraphResource(m_versions.size() - 1);
+}
+
+RenderGraphResource RenderGraph::Create(const std::string& name, const FramebufferSpec& spec, const float clearColor[4])
+{
+    Resource resource;
+    resource.name = name;
+    resource.spec = spec;
+    if (clearColor)
+        std::copy(clearColor, clearColor + 4, resource.clearColor);
+    m_resources.push_back(std::move(resource));
+    return AddVersion(unsigned(m_resources.size() - 1), NO_PASS);
+}
+
+RenderGraphResource RenderGraph::Import(const std::string& name, const Framebuffer& framebuffer, const float clearColor[4])
+{
+    Resource resource;
+    resource.name = name;
+    resource.spec = framebuffer.GetSpec();
+    resource.imported = true;
+    resource.importedID = framebuffer.GetRendererID();
+    resource.framebuffer = &framebuffer;
+    if (clearColor)
+        std::copy(clearColor, clearColor + 4, resource.clearColor);
+    m_resources.push_back(std::move(resource));
+    return AddVersion(unsigned(m_resources.size() - 1), NO_PASS);
+}
+
+RenderGraphResource RenderGraph::ImportBound(const std::string& name)
+{
+    GLint framebuffer = 0, viewport[4] = {0, 0, 0, 0};
+    glCall(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer));
+    glCall(glGetIntegerv(GL_VIEWPORT, viewport));
+    Resource resource;
+    resource.name = name;
+    resource.spec.width = unsigned(viewport[2]);
+    resource.spec.height = unsigned(viewport[3]);
+    resource.imported = true;
+    resource.importedID = unsigned(framebuffer);
+    glCall(glGetFloatv(GL_COLOR_CLEAR_VALUE, resource.clearColor));
+    m_resources.push_back(std::move(resource));
+    return AddVersion(unsigned(m_resources.size() - 1), NO_PASS);
+}
+
+void RenderGraph::Cull()
+{
+    // alive: what an imported target or a side effect needs, walking back from those passes
+    std::vector<unsigned int> stack;
+    for (unsigned int index = 0; index < m_passes.size(); index++) {
+        Pass& pass = m_passes[index];
+        pass.culled = !(pass.sideEffect || (pass.write != InvalidResource && GetResource(pass.write).imported));
+        if (!pass.culled)
+            stack.push_back(index);
+    }
+    auto keep = [&](RenderGraphResource version) {
+        unsigned int producer = m_versions[version].producer;
+        if (producer != NO_PASS && m_passes[producer].culled) {
+            m_passes[producer].culled = false;
+            stack.push_back(producer);
+        }
+    };
+    while (!stack.empty()) {
+        const Pass& pass = m_passes[stack.back()];
+        stack.pop_back();
+        for (RenderGraphResource read : pass.reads)
+            keep(read);
+        // a Load builds on the contents before, a Clear or DontCare doesn't need them
+        if (pass.write != InvalidResource) {
+            const Resource& target = GetResource(pass.write);
+            const bool hasDepth = target.spec.depthFormat != 0 || (target.imported && !target.framebuffer);
+            if (pass.colorLoad == LoadOp::Load || (hasDepth && pass.depthLoad == LoadOp::Load))
+                keep(pass.writeFrom);
+        }
+    }
+}
+
+void RenderGraph::Sort()
+{
+    // edges: the writer of a version before its readers, and the readers of a version before the
+    // pass that writes the next one over it
+    const unsigned int count = unsigned(m_passes.size());
+    std::vector<std::vector<unsigned int>> successors(count);
+    std::vector<unsigned int> predecessors(count, 0);
+    auto edge = [&](unsigned int from, unsigned int to) {
+        if (from == NO_PASS || from == to || m_passes[from].culled)
+            return;
+        successors[from].push_back(to);
+        predecessors[to]++;
+    };
+    for (unsigned int index = 0; index < count; index++) {
+        const Pass& pass = m_passes[index];
+        if (pass.culled)
+            continue;
+        for (RenderGraphResource read : pass.reads)
+            edge(m_versions[read].producer, index);
+        if (pass.write == InvalidResource)
+            continue;
+        edge(m_versions[pass.writeFrom].producer, index);
+        for (unsigned int reader = 0; reader < count; reader++) {
+            const std::vector<RenderGraphResource>& reads = m_passes[reader].reads;
+            if (!m_passes[reader].culled && std::find(reads.begin(), reads.end(), pass.writeFrom) != reads.end())
+                edge(reader, index);
+        }
+    }
+
+    // Kahn's, among the ready passes the one declared first goes: without constraints the order is the declared one
+    m_order.clear();
+    std::vector<bool> done(count, false);
+    for (;;) {
+        unsigned int next = NO_PASS;
+        for (unsigned int index = 0; index < count && next == NO_PASS; index++) {
+            if (!m_passes[index].culled && !done[index] && predecessors[index] == 0)
+                next = index;
+        }
+        if (next == NO_PASS)
+            break;
+        done[next] = true;
+        m_order.push_back(next);
+        for (unsigned int successor : successors[next])
+            predecessors[successor]--;
+    }
+    if (m_order.size() != count - m_stats.culled) {
+        std::cout << "Error (RENDER GRAPH): the passes depend on each other in a cycle, running them as declared" << std::endl;
+        m_order.clear();
+        for (unsigned int index = 0; index < count; index++) {
+            if (!m_passes[index].culled)
+                m_order.push_back(index);
+        }
+    }
+}
+
+void RenderGraph::Compile()
+{
+    auto start = Clock::now();
+    m_stats = RenderGraphStats();
+    m_stats.passes = unsigned(m_passes.size());
+
+    Cull();
+    for (const Pass& pass : m_passes)
+        m_stats.culled += pass.culled ? 1 : 0;
+    Sort();
+
+    // lifetimes, in execution order
+    for (Resource& resource : m_resources) {
+        resource.firstPass = NO_PASS;
+        resource.lastPass = 0;
+    }
+    for (unsigned int position = 0; position < m_order.size(); position++) {
+        const Pass& pass = m_passes[m_order[position]];
+        auto use = [&](RenderGraphResource version) {
+            Resource& resource = m_resources[m_versions[version].resource];
+            resource.firstPass = std::min(resource.firstPass, position);
+            resource.lastPass = std::max(resource.lastPass, position);
+        };
+        for (RenderGraphResource read : pass.reads)
+            use(read);
+        if (pass.write != InvalidResource)
+            use(pass.write);
+    }
+    for (const Resource& resource : m_resources) {
+        if (!resource.imported && resource.firstPass != NO_PASS) {
+            m_stats.transients++;
+            m_stats.naiveBytes += Framebuffer::GetMemoryBytes(resource.spec);
+        }
+    }
+    m_compiled = true;
+    m_stats.compileMs = MillisecondsSince(start);
+}
+
+void RenderGraph::Execute()
+{
+    if (!m_compiled)
+        Compile();
+    auto start = Clock::now();
+    RenderTargetPool& pool = RenderTargets::Get();
+
+    // put back at the end
+    GLint previousFramebuffer = 0, previousReadFramebuffer = 0, previousViewport[4] = {0, 0, 0, 0};
+    GLfloat previousClearColor[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glCall(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer));
+    glCall(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFramebuffer));
+    glCall(glGetIntegerv(GL_VIEWPORT, previousViewport));
+    glCall(glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColor));
+    const RenderGraphState previousState = QueryState();
+    RenderGraphState current = previousState;
+    unsigned int boundFramebuffer = unsigned(previousFramebuffer);
+    float clearColor[4];
+    std::copy(previousClearColor, previousClearColor + 4, clearColor);
+
+    for (Resource& resource : m_resources) {
+        if (!resource.imported)
+            resource.framebuffer = nullptr;
+        resource.color = resource.depth = resource.imported ? Contents::Written : Contents::Undefined;
+    }
+    std::vector<const Framebuffer*> physical;
+    m_stats.aliasedBytes = 0;
+    m_stats.clearsRequested = m_stats.clearsSkipped = m_stats.clearsInserted = 0;
+    m_stats.stateChanges = m_stats.stateSets = m_stats.framebufferBinds = 0;
+
+    const RenderGraphContext context(*this);
+    for (unsigned int position = 0; position < m_order.size(); position++) {
+        Pass& pass = m_passes[m_order[position]];
+        // transients whose lifetime starts here, they may get the memory of ones that ended before
+        for (Resource& resource : m_resources) {
+            if (resource.imported || resource.firstPass != position)
+                continue;
+            resource.framebuffer = &pool.Acquire(resource.spec);
+            if (std::find(physical.begin(), physical.end(), resource.framebuffer) == physical.end()) {
+                physical.push_back(resource.framebuffer);
+                m_stats.aliasedBytes += resource.framebuffer->GetMemoryBytes();
+            }
+        }
+
+        Resource* target = pass.write != InvalidResource ? &m_resources[m_versions[pass.write].resource] : nullptr;
+        if (target) {
+            const unsigned int id = target->imported ? target->importedID : target->framebuffer->GetRendererID();
+            if (id != boundFramebuffer) {
+                glCall(glBindFramebuffer(GL_FRAMEBUFFER, id));
+                glCall(glViewport(0, 0, GLsizei(target->spec.width), GLsizei(target->spec.height)));
+                boundFramebuffer = id;
+                m_stats.framebufferBinds++;
+            }
+
+            // only what isn't in the wanted state already: a Clear right after a clear (nothing drew in
+            // between) goes, a Load of contents nobody made gets one
+            GLbitfield clear = 0;
+            auto decide = [&](LoadOp load, Contents contents, GLbitfield bit) {
+                if (load == LoadOp::Clear) {
+                    m_stats.clearsRequested++;
+                    if (contents == Contents::Cleared)
+                        m_stats.clearsSkipped++;
+                    else
+                        clear |= bit;
+                } else if (load == LoadOp::Load && contents == Contents::Undefined) {
+                    m_stats.clearsInserted++;
+                    clear |= bit;
+                }
+            };
+            const bool hasColor = target->spec.colorFormat != 0;
+            const bool hasDepth = target->spec.depthFormat != 0 || (target->imported && !target->framebuffer);
+            if (hasColor)
+                decide(pass.colorLoad, target->color, GL_COLOR_BUFFER_BIT);
+            if (hasDepth)
+                decide(pass.depthLoad, target->depth, GL_DEPTH_BUFFER_BIT);
+            if (clear) {
+                // a masked attachment isn't cleared either
+                RenderGraphState clearState = current;
+                clearState.colorWrite = clearState.colorWrite || (clear & GL_COLOR_BUFFER_BIT);
+                clearState.depthWrite = clearState.depthWrite || (clear & GL_DEPTH_BUFFER_BIT);
+                m_stats.stateChanges += ApplyState(current, clearState);
+                if ((clear & GL_COLOR_BUFFER_BIT) && !std::equal(clearColor, clearColor + 4, target->clearColor)) {
+                    std::copy(target->clearColor, target->clearColor + 4, clearColor);
+                    glCall(glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]));
+                }
+                glCall(glClear(clear));
+                if (clear & GL_COLOR_BUFFER_BIT)
+                    target->color = Contents::Cleared;
+                if (clear & GL_DEPTH_BUFFER_BIT)
+                    target->depth = Contents::Cleared;
+            }
+        }
+
+        if (pass.hasState) {
+            m_stats.stateSets += STATE_FIELDS;
+            m_stats.stateChanges += ApplyState(current, pass.state);
+        }
+        if (pass.execute)
+            pass.execute(context);
+        if (!pass.hasState)
+            current = QueryState(); // the pass set whatever it wanted itself
+
+        if (target) {
+            if (current.colorWrite)
+                target->color = Contents::Written;
+            if (current.depthTest && current.depthWrite)
+                target->depth = Contents::Written;
+        }
+
+        // and the ones whose lifetime ends here, their memory is free for the next
+        for (Resource& resource : m_resources) {
+            if (!resource.imported && resource.framebuffer && resource.lastPass == position)
+                pool.Release(*resource.framebuffer);
+        }
+    }
+
+    ApplyState(current, previousState);
+    glCall(glClearColor(previousClearColor[0], previousClearColor[1], previousClearColor[2], previousClearColor[3]));
+    // the passes bound GL_FRAMEBUFFER, which moves the read binding along with the draw one
+    glCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GLuint(previousFramebuffer)));
+    glCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, GLuint(previousReadFramebuffer)));
+    glCall(glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]));
+    m_stats.executeMs = MillisecondsSince(start);
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <glad/glad.h>
+#include "Framebuffer.h"
+
+// a version of a render target: Write hands out the next one, a Read names the version it wants
+using RenderGraphResource = unsigned int;
+
+// what a pass wants in the target before it draws
+enum class LoadOp
+{
+    Load,     // the previous contents (cleared first if there are none yet)
+    Clear,    // the resource's clear value
+    DontCare  // the pass covers every pixel, nothing has to be there
+};
+
+// the fixed function state a pass draws with. Execute only changes what differs from the pass before
+struct RenderGraphState
+{
+    bool depthTest = false;
+    bool depthWrite = true;
+    GLenum depthFunc = GL_LESS;
+    bool blend = false;
+    bool colorWrite = true;
+};
+
+struct RenderGraphStats
+{
+    unsigned int passes = 0;          // declared
+    unsigned int culled = 0;          // nothing used what they wrote
+    unsigned int transients = 0;      // render targets the graph created, culled ones not counted
+    std::size_t naiveBytes = 0;       // every transient in its own target
+    std::size_t aliasedBytes = 0;     // the distinct targets they got: lifetimes that don't overlap share one
+    unsigned int clearsRequested = 0; // attachments passes asked to have cleared
+    unsigned int clearsSkipped = 0;   // already in the cleared state, nothing drew since
+    unsigned int clearsInserted = 0;  // Load of a transient nothing wrote yet
+    unsigned int stateChanges = 0;    // glEnable / glDepthMask / ... calls made
+    unsigned int stateSets = 0;       // the calls if every pass set its whole state
+    unsigned int framebufferBinds = 0;
+    double compileMs = 0.0;
+    double executeMs = 0.0;
+};
+
+class RenderGraph;
+
+// what a pass's execute callback gets: the physical targets behind the resources it declared
+class RenderGraphContext
+{
+private:
+    const RenderGraph& m_graph;
+
+public:
+    explicit RenderGraphContext(const RenderGraph& graph) : m_graph(graph) {}
+
+    // the color texture of a single sampled target, 0 for the framebuffer that was bound on import
+    unsigned int GetTexture(RenderGraphResource resource) const;
+    // nullptr for the bound framebuffer
+    const Framebuffer* GetFramebuffer(RenderGraphResource resource) const;
+    unsigned int GetWidth(RenderGraphResource resource) const;
+    unsigned int GetHeight(RenderGraphResource resource) const;
+    // binds the color texture to a texture unit
+    void BindTexture(RenderGraphResource resource, unsigned int unit) const;
+};
+
+// passes declare the render targets they read and write, the graph works out the rest: the order
+// (writers before their readers), which passes can go (nothing reads what they wrote and they don't
+// write an imported target), the transient targets' lifetimes (they come from RenderTargets in
+// execution order, so targets whose lifetimes don't overlap share memory), the clears that are
+// actually needed and the state changes between passes. Build, Compile and Execute every frame:
+//
+//     graph.Reset();
+//     RenderGraphResource output = graph.ImportBound("output");
+//     RenderGraphResource color = graph.Create("color", spec);
+//     graph.AddPass("draw", [&](RenderGraph::Builder& builder) { color = builder.Write(color, LoadOp::Clear); },
+//                   [=](const RenderGraphContext& context) { ... });
+//     graph.AddPass("copy", [&](RenderGraph::Builder& builder) { builder.Read(color); output = builder.Write(output, LoadOp::DontCare); },
+//                   [=](const RenderGraphContext& context) { context.BindTexture(color, 0); ... });
+//     graph.Compile();
+//     graph.Execute();
+class RenderGraph
+{
+public:
+    static constexpr RenderGraphResource InvalidResource = ~0u;
+    using ExecuteFunction = std::function<void(const RenderGraphContext&)>;
+
+    class Builder
+    {
+    private:
+        RenderGraph& m_graph;
+        unsigned int m_pass;
+
+    public:
+        Builder(RenderGraph& graph, unsigned int pass) : m_graph(graph), m_pass(pass) {}
+
+        // the pass samples that version
+        RenderGraphResource Read(RenderGraphResource resource);
+        // the pass draws into the target (one per pass), returns the version it leaves behind
+        RenderGraphResource Write(RenderGraphResource resource, LoadOp color, LoadOp depth = LoadOp::Load);
+        void SetState(const RenderGraphState& state);
+        // never culled, for passes whose effect isn't a target (queries, buffer writes)
+        void SetSideEffect();
+    };
+
+private:
+    friend class RenderGraphContext;
+
+    enum class Contents
+    {
+        Undefined, // a transient nothing wrote yet
+        Cleared,
+        Written
+    };
+    struct Resource
+    {
+        std::string name;
+        FramebufferSpec spec;
+        float clearColor[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        bool imported = false;
+        unsigned int importedID = 0;               // imported: the framebuffer (0 is the window)
+        const Framebuffer* framebuffer = nullptr;  // imported from a Framebuffer, or the transient's physical target
+        unsigned int firstPass = ~0u;              // in execution order, transients only
+        unsigned int lastPass = 0;
+        Contents color = Contents::Undefined;
+        Contents depth = Contents::Undefined;
+    };
+    struct Version
+    {
+        unsigned int resource;
+        unsigned int producer; // the pass that wrote it, ~0u for the first version
+    };
+    struct Pass
+    {
+        std::string name;
+        std::vector<RenderGraphResource> reads;
+        RenderGraphResource write = InvalidResource;     // the version written
+        RenderGraphResource writeFrom = InvalidResource; // and the one it replaced
+        LoadOp colorLoad = LoadOp::Load;
+        LoadOp depthLoad = LoadOp::Load;
+        bool hasState = false;
+        RenderGraphState state;
+        bool sideEffect = false;
+        bool culled = false;
+        ExecuteFunction execute;
+    };
+
+    std::vector<Resource> m_resources;
+    std::vector<Version> m_versions;
+    std::vector<Pass> m_passes;
+    std::vector<unsigned int> m_order; // the passes that run, in order
+    bool m_compiled = false;
+    RenderGraphStats m_stats;
+
+    RenderGraphResource AddVersion(unsigned int resource, unsigned int producer);
+    const Resource& GetResource(RenderGraphResource resource) const { return m_resources[m_versions[resource].resource]; }
+    void Cull();
+    void Sort();
+
+public:
+    // drops every pass and resource, keeps the memory for the next frame's
+    void Reset();
+
+    // a transient target, alive from its first to its last use in the frame
+    RenderGraphResource Create(const std::string& name, const FramebufferSpec& spec, const float clearColor[4] = nullptr);
+    // a target that outlives the frame, a pass that writes it is never culled
+    RenderGraphResource Import(const std::string& name, const Framebuffer& framebuffer, const float clearColor[4] = nullptr);
+    // whatever framebuffer is bound now with the viewport's size, the clear value is the current one.
+    // How a test gets at the target the application gave it
+    RenderGraphResource ImportBound(const std::string& name);
+
+    template <typename Setup>
+    void AddPass(const std::string& name, Setup&& setup, ExecuteFunction execute)
+    {
+        m_passes.emplace_back();
+        m_passes.back().name = name;
+        m_passes.back().execute = std::move(execute);
+        Builder builder(*this, unsigned(m_passes.size() - 1));
+        setup(builder);
+        m_compiled = false;
+    }
+
+    // culls, orders, and works out the transients' lifetimes
+    void Compile();
+    // runs the passes. The transients are acquired from and released to RenderTargets on the way,
+    // the GL state and framebuffer binding of before are back afterwards
+    void Execute();
+
+    // the spec of a resource, for an imported bound framebuffer its size
+    inline const FramebufferSpec& GetSpec(RenderGraphResource resource) const { return GetResource(resource).spec; }
+    inline unsigned int GetPassCount() const { return unsigned(m_passes.size()); }
+    inline const std::string& GetPassName(unsigned int pass) const { return m_passes[pass].name; }
+    inline bool IsCulled(unsigned int pass) const { return m_passes[pass].culled; }
+    inline const std::vector<unsigned int>& GetOrder() const { return m_order; }
+    inline const RenderGraphStats& GetStats() const { return m_stats; }
+};
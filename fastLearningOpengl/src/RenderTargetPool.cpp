@@ -0,0 +1,78 @@
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    bool SameSpec(const FramebufferSpec& a, const FramebufferSpec& b)
+    {
+        return a.width == b.width && a.height == b.height && a.samples == b.samples && a.colorFormat == b.colorFormat &&
+               a.depthFormat == b.depthFormat && a.sampleableDepth == b.sampleableDepth;
+    }
+}
+
+void RenderTargetPool::BeginFrame()
+{
+    m_frame++;
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+                                   [&](const Entry& entry) { return !entry.inUse && entry.lastFrame + m_keepFrames < m_frame; }),
+                    m_entries.end());
+
+    m_stats = RenderTargetPoolStats();
+    m_stats.peakInUseBytes = m_inUseBytes; // anything kept across frames
+    for (Entry& entry : m_entries) {
+        entry.usedThisFrame = false;
+        m_stats.allocatedBytes += entry.target->GetMemoryBytes();
+    }
+    m_stats.targets = unsigned(m_entries.size());
+}
+
+Framebuffer& RenderTargetPool::Acquire(const FramebufferSpec& spec)
+{
+    m_stats.acquires++;
+    m_stats.unpooledBytes += Framebuffer::GetMemoryBytes(spec);
+
+    auto free = std::find_if(m_entries.begin(), m_entries.end(),
+                             [&](const Entry& entry) { return !entry.inUse && SameSpec(entry.target->GetSpec(), spec); });
+    if (free == m_entries.end()) {
+        Entry entry;
+        entry.target = std::make_unique<Framebuffer>(spec);
+        m_stats.allocatedBytes += entry.target->GetMemoryBytes();
+        m_stats.targets++;
+        m_entries.push_back(std::move(entry));
+        free = m_entries.end() - 1;
+    } else if (free->usedThisFrame) {
+        m_stats.reuses++;
+    }
+    free->inUse = true;
+    free->usedThisFrame = true;
+    free->lastFrame = m_frame;
+    m_inUseBytes += free->target->GetMemoryBytes();
+    m_stats.peakInUseBytes = std::max(m_stats.peakInUseBytes, m_inUseBytes);
+    return *free->target;
+}
+
+void RenderTargetPool::Release(const Framebuffer& target)
+{
+    auto entry = std::find_if(m_entries.begin(), m_entries.end(), [&](const Entry& e) { return e.target.get() == &target; });
+    assert(entry != m_entries.end() && entry->inUse);
+    entry->inUse = false;
+    m_inUseBytes -= target.GetMemoryBytes();
+}
+
+void RenderTargetPool::Release()
+{
+    m_entries.clear();
+    m_inUseBytes = 0;
+    m_stats = RenderTargetPoolStats();
+}
+
+namespace RenderTargets
+{
+    RenderTargetPool& Get()
+    {
+        static RenderTargetPool s_pool;
+        return s_pool;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Framebuffer.h"
+
+struct RenderTargetPoolStats
+{
+    unsigned int targets = 0;          // alive, in use or not
+    std::size_t allocatedBytes = 0;    // all of them
+    unsigned int acquires = 0;         // this frame
+    unsigned int reuses = 0;           // acquires this frame that got a target released earlier in the frame
+    std::size_t peakInUseBytes = 0;    // this frame, what the pool had to hold at the worst moment
+    std::size_t unpooledBytes = 0;     // this frame, if every acquire had its own target
+};
+
+// transient render targets, alive from Acquire to Release within a frame. A released target goes to
+// the next Acquire with the same spec, so targets whose lifetimes don't overlap share the memory.
+// Targets nobody acquired for a few frames are deleted (after a resize the old size goes away)
+class RenderTargetPool
+{
+private:
+    struct Entry
+    {
+        std::unique_ptr<Framebuffer> target;
+        bool inUse = false;
+        bool usedThisFrame = false;
+        std::uint64_t lastFrame = 0;
+    };
+
+    std::vector<Entry> m_entries;
+    std::uint64_t m_frame = 0;
+    unsigned int m_keepFrames = 3;
+    std::size_t m_inUseBytes = 0;
+    RenderTargetPoolStats m_stats;
+
+public:
+    RenderTargetPool() = default;
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    // once per frame, before any Acquire: evicts the targets that went unused
+    void BeginFrame();
+    // a target of that spec, its contents are undefined. Stays valid until Release
+    Framebuffer& Acquire(const FramebufferSpec& spec);
+    void Release(const Framebuffer& target);
+    // deletes every target, call before the GL context goes away
+    void Release();
+
+    inline const RenderTargetPoolStats& GetStats() const { return m_stats; }
+};
+
+// the application wide pool, BeginFrame runs at the top of every frame
+namespace RenderTargets
+{
+    RenderTargetPool& Get();
+}
@@ -1,6 +1,12 @@
 #include "Renderer.h"
+#include <cstring>
 #include <iostream>
 
+namespace
+{
+    unsigned int s_fullscreenVao = 0; // a core profile draw needs some vertex array bound
+}
+
 void glClearError(){
     while(glGetError()!= GL_NO_ERROR);
 }
@@ -14,14 +20,73 @@ bool glLogCall(){
     return true;
 }
 
+bool glHasExtension(const char* name){
+    GLint count = 0;
+    glCall(glGetIntegerv(GL_NUM_EXTENSIONS, &count));
+    for (GLint i = 0; i < count; i++) {
+        glCall(const GLubyte* extension = glGetStringi(GL_EXTENSIONS, GLuint(i)));
+        if (extension && std::strcmp(reinterpret_cast<const char*>(extension), name) == 0)
+            return true;
+    }
+    return false;
+}
+
 
 void Renderer::Clear() const{
     glCall(glClear(GL_COLOR_BUFFER_BIT));
 }
 void Renderer::Draw(const VertexArray& va, const ElementIndexBuffer& ib, const Shader& shader) const{
+            // a shader still compiling without a fallback has nothing to draw with yet
+            if (!shader.GetActiveProgram())
+                return;
 
             shader.Bind();
             va.Bind();
             ib.Bind();
             glCall(glDrawElements(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr));
-}
\ No newline at end of file
+}
+void Renderer::Draw(const VertexArray& va, const ElementIndexBuffer& ib, const Shader& shader, unsigned int indexCount, unsigned int firstIndex) const{
+            if (!shader.GetActiveProgram())
+                return;
+
+            shader.Bind();
+            va.Bind();
+            ib.Bind();
+            glCall(glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (const void*)(firstIndex * sizeof(unsigned int))));
+}
+void Renderer::Draw(const VertexArray& va, const ElementIndexBuffer& ib, const Shader& shader, unsigned int indexCount, unsigned int firstIndex, int baseVertex) const{
+            if (!shader.GetActiveProgram())
+                return;
+
+            shader.Bind();
+            va.Bind();
+            ib.Bind();
+            glCall(glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (const void*)(firstIndex * sizeof(unsigned int)), baseVertex));
+}
+void Renderer::DrawInstanced(const VertexArray& va, const ElementIndexBuffer& ib, const Shader& shader, unsigned int instanceCount) const{
+            if (!shader.GetActiveProgram())
+                return;
+
+            shader.Bind();
+            va.Bind();
+            ib.Bind();
+            glCall(glDrawElementsInstanced(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr, instanceCount));
+}
+void Renderer::DrawFullscreen(const Shader& shader) const{
+            if (!shader.GetActiveProgram())
+                return;
+
+            if (!s_fullscreenVao) {
+                glCall(glGenVertexArrays(1, &s_fullscreenVao));
+            }
+            shader.Bind();
+            glCall(glBindVertexArray(s_fullscreenVao));
+            glCall(glDrawArrays(GL_TRIANGLES, 0, 3));
+}
+
+void Renderer::ReleaseShared(){
+    if (s_fullscreenVao) {
+        glCall(glDeleteVertexArrays(1, &s_fullscreenVao));
+        s_fullscreenVao = 0;
+    }
+}
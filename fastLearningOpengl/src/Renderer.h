@@ -15,10 +15,23 @@
 
 void glClearError();
 bool glLogCall();
+// whether the current context lists the extension, e.g. "GL_ARB_get_program_binary"
+bool glHasExtension(const char* name);
 
 class Renderer
 {
 public:
     void Clear() const;
     void Draw(const VertexArray& va, const ElementIndexBuffer& ib, const Shader& shader) const;
+    // draws indexCount indices starting at firstIndex, e.g. one LOD of a mesh
+    void Draw(const VertexArray& va, const ElementIndexBuffer& ib, const Shader& shader, unsigned int indexCount, unsigned int firstIndex) const;
+    // indices are relative to baseVertex, so meshes sharing one vertex buffer keep their own indices (see MeshPool)
+    void Draw(const VertexArray& va, const ElementIndexBuffer& ib, const Shader& shader, unsigned int indexCount, unsigned int firstIndex, int baseVertex) const;
+    // the whole index buffer instanceCount times, per instance attributes come from the vertex array
+    void DrawInstanced(const VertexArray& va, const ElementIndexBuffer& ib, const Shader& shader, unsigned int instanceCount) const;
+    // one triangle over the whole viewport, no vertex buffer: the vertex shader makes it from gl_VertexID
+    // (res/Shaders/include/Fullscreen.glsl)
+    void DrawFullscreen(const Shader& shader) const;
+    // deletes the empty vertex array DrawFullscreen binds, before the context goes away
+    static void ReleaseShared();
 };
\ No newline at end of file
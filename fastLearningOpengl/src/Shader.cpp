@@ -1,55 +1,167 @@
 #include "Shader.h"
 #include "Renderer.h"
+#include "ProgramCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderPreprocessor.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
-#include <fstream>
 #include <string>
-#include <sstream>
-
 
+// glad stops at 4.1, compute shaders are 4.3
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
 
+namespace
+{
+    const char* StageName(unsigned int type)
+    {
+        switch (type) {
+        case GL_VERTEX_SHADER:   return "vertex";
+        case GL_FRAGMENT_SHADER: return "fragment";
+        case GL_GEOMETRY_SHADER: return "geometry";
+        case GL_COMPUTE_SHADER:  return "compute";
+        }
+        return "unknown";
+    }
+}
 
-Shader::Shader(const std::string& filepath)
-    : m_FilePath(filepath), m_RendererID(0)
+Shader::Shader(const std::string& filepath, const std::vector<std::string>& defines, bool async)
+    : m_FilePath(filepath), m_Defines(defines), m_RendererID(0)
 {
-    ShaderProgramSource source = ParseShader(filepath);
+    // expanded once per file, every define set only adds its #defines
+    std::shared_ptr<const PreprocessedShader> preprocessed = ShaderPreprocessor::Load(filepath);
+    ShaderProgramSource source = ShaderPreprocessor::Specialize(*preprocessed, filepath, defines);
+    m_Files = preprocessed->files;
     std::cout << "Vertex" << std::endl;
     std::cout << source.VertexSource << std::endl;
     std::cout << "Fragment" << std::endl;
     std::cout << source.FragmentSource << std::endl;
 
-    m_RendererID = CreateShader(source.VertexSource, source.FragmentSource);
+    m_LoadStart = std::chrono::steady_clock::now();
+    // every define set is its own program, so its own cache entry
+    m_CacheName = filepath;
+    for (const std::string& define : defines)
+        m_CacheName += "_" + define;
+    m_RendererID = ProgramCache::Load(m_CacheName, source);
+    m_FromCache = m_RendererID != 0;
+    if (!m_FromCache) {
+        if (async) {
+            m_Pending = ShaderCompiler::Submit(source.VertexSource, source.FragmentSource);
+            m_PendingSource = std::move(source);
+            std::cout << "Shader " << filepath << " submitted (" << ShaderCompiler::GetModeName() << ")" << std::endl;
+            return;
+        }
+        m_RendererID = CreateShader(source.VertexSource, source.FragmentSource);
+        if (!m_RendererID) {
+            std::cout << "Error (SHADER): " << filepath << " failed, nothing to draw with" << std::endl;
+            return;
+        }
+        ProgramCache::Store(m_CacheName, source, m_RendererID);
+    }
+    FinishLoad();
 }
 
 Shader::~Shader()
 {
-    glCall(glDeleteProgram(m_RendererID));
+    if (m_Pending)
+        ShaderCompiler::Cancel(*m_Pending);
+    if (m_Reload)
+        ShaderCompiler::Cancel(*m_Reload);
+    if (m_RendererID) {
+        glCall(glDeleteProgram(m_RendererID));
+    }
 }
 
+void Shader::FinishLoad() const
+{
+    // for an async compile this is submit to first poll that saw it done
+    m_LoadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_LoadStart).count();
+    ProgramCache::RecordLoad(m_FromCache, m_LoadMs);
+    std::cout << "Shader " << m_FilePath << (m_FromCache ? " loaded from cache in " : " compiled in ") << m_LoadMs << " ms" << std::endl;
+}
 
-ShaderProgramSource Shader::ParseShader(const std::string& filepath){
-    std::fstream stream(filepath);
-    std::string line;
-    
-    enum class ShaderType{
-        NONE = -1, VERTEX = 0, FRAGMENT = 1};
-    ShaderType type = ShaderType::NONE;
-
-    std::stringstream ss[2];
-
-    while (getline(stream, line)){
-        if (line.find("#shader") != std::string::npos){
-            if (line.find("vertex") != std::string::npos){
-                type = ShaderType::VERTEX;
-            } else if (line.find("fragment") != std::string::npos){
-                type = ShaderType::FRAGMENT;
-            }
+bool Shader::IsReady() const
+{
+    if (m_Pending && ShaderCompiler::Poll(*m_Pending, m_RendererID)) {
+        m_Pending.reset();
+        if (m_RendererID) {
+            // what was set while the fallback drew, sampler units and projections set once included
+            ApplyUniforms(m_RendererID);
+            ProgramCache::Store(m_CacheName, m_PendingSource, m_RendererID);
+            FinishLoad();
         } else {
-            if(type != ShaderType::NONE){
-                ss[(int)type] << line << '\n';};
+            std::cout << "Error (SHADER): " << m_FilePath << " failed, staying on the fallback" << std::endl;
         }
-    };
-    return {ss[0].str(), ss[1].str()};
-};
+        m_PendingSource = {};
+    }
+    return !m_Pending && m_RendererID != 0;
+}
+
+bool Shader::DependsOn(const std::vector<std::string>& files) const
+{
+    for (const std::string& file : files) {
+        if (std::find(m_Files.begin(), m_Files.end(), file) != m_Files.end())
+            return true;
+    }
+    return false;
+}
+
+void Shader::Reload()
+{
+    std::shared_ptr<const PreprocessedShader> preprocessed = ShaderPreprocessor::Load(m_FilePath);
+    if (!preprocessed->valid) {
+        std::cout << "Error (SHADER): can't reload " << m_FilePath << ", keeping the current program" << std::endl;
+        return;
+    }
+    m_Files = preprocessed->files; // an edit may have added or dropped includes
+    ShaderProgramSource source = ShaderPreprocessor::Specialize(*preprocessed, m_FilePath, m_Defines);
+
+    // a shader still on its first compile just starts that over, nothing is in use yet
+    std::shared_ptr<PendingProgram>& pending = m_Pending ? m_Pending : m_Reload;
+    if (pending)
+        ShaderCompiler::Cancel(*pending);
+    pending = ShaderCompiler::Submit(source.VertexSource, source.FragmentSource);
+    m_PendingSource = std::move(source);
+    m_LoadStart = std::chrono::steady_clock::now();
+    m_FromCache = false;
+    std::cout << "Shader " << m_FilePath << " changed, recompiling" << std::endl;
+}
+
+bool Shader::PollReload()
+{
+    unsigned int program = 0;
+    if (!m_Reload || !ShaderCompiler::Poll(*m_Reload, program))
+        return false;
+    m_Reload.reset();
+    if (!program) {
+        std::cout << "Error (SHADER): " << m_FilePath << " failed to reload, keeping the current program" << std::endl;
+        m_PendingSource = {};
+        return false;
+    }
+
+    // before the old program goes, it may be the one bound and that binding is restored
+    ApplyUniforms(program);
+    // the old program is released by GL once nothing has it bound any more
+    glCall(glDeleteProgram(m_RendererID));
+    m_RendererID = program;
+    m_UniformLocationCache.clear();
+    m_UniformCacheProgram = 0;
+    ProgramCache::Store(m_CacheName, m_PendingSource, m_RendererID);
+    m_PendingSource = {};
+    FinishLoad();
+    return true;
+}
+
+unsigned int Shader::GetActiveProgram() const
+{
+    if (IsReady())
+        return m_RendererID;
+    return m_Fallback ? m_Fallback->GetActiveProgram() : 0;
+}
+
 
 unsigned int Shader::CompileShader(unsigned int type, const std::string& source){
     glCall(unsigned int id = glCreateShader(type));
@@ -59,7 +171,7 @@ unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
 
     int result;
     glCall(glGetShaderiv(id, GL_COMPILE_STATUS, &result));
-    std::cout << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader compile status: " << result << std::endl;
+    std::cout << StageName(type) << " shader compile status: " << result << std::endl;
 
 
     if(result == GL_FALSE){
@@ -67,7 +179,7 @@ unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
         glCall(glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length));
         char* message = (char*)alloca(length * sizeof(char));
         glCall(glGetShaderInfoLog(id, length, &length, message));
-        std::cout << "Failed to compile " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader!" << std::endl;
+        std::cout << "Failed to compile " << StageName(type) << " shader!" << std::endl;
         std::cout << message << std::endl;
         glCall(glDeleteShader(id));
         return 0;
@@ -77,17 +189,38 @@ unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
 
 unsigned int Shader::CreateShader(const std::string& vertexShader, const std::string& fragmentShader){
     // taking in the actual source code of these shaders as strings.
+    // 0 if a stage doesn't compile or the link fails, a reload then keeps the program it has
 
-    unsigned int program = glCreateProgram();
     unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
     unsigned int fs = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
+    if (!vs || !fs) {
+        if (vs) {
+            glCall(glDeleteShader(vs));
+        }
+        if (fs) {
+            glCall(glDeleteShader(fs));
+        }
+        return 0;
+    }
+    glCall(unsigned int program = glCreateProgram());
     glCall(glAttachShader(program, vs));
     glCall(glAttachShader(program, fs));
+    ProgramCache::PrepareProgram(program);
     glCall(glLinkProgram(program));
-    glCall(glValidateProgram(program));
     glCall(glDeleteShader(vs));
     glCall(glDeleteShader(fs));
 
+    GLint linked = GL_FALSE;
+    glCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+    if (linked != GL_TRUE) {
+        GLint length = 0;
+        glCall(glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length));
+        std::vector<char> message(std::size_t(length) + 1, '\0');
+        glCall(glGetProgramInfoLog(program, length, nullptr, message.data()));
+        std::cout << "Error (SHADER): link failed" << std::endl << message.data() << std::endl;
+        glCall(glDeleteProgram(program));
+        return 0;
+    }
     return program;
 
 };
@@ -95,7 +228,7 @@ unsigned int Shader::CreateShader(const std::string& vertexShader, const std::st
 
 void Shader::Bind() const
 {
-    glCall(glUseProgram(m_RendererID));
+    glCall(glUseProgram(GetActiveProgram()));
 }
 
 void Shader::Unbind() const
@@ -105,37 +238,105 @@ void Shader::Unbind() const
 
 void Shader::SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3)
 {
+    UniformValue& value = RememberUniform(name, UniformType::Float4);
+    value.floats[0] = v0;
+    value.floats[1] = v1;
+    value.floats[2] = v2;
+    value.floats[3] = v3;
     glCall(glUniform4f(GetUniformLocation(name), v0, v1, v2, v3));
 }
 
 void Shader::SetUniform1i(const std::string& name, int value)
 {
+    RememberUniform(name, UniformType::Int).ints.assign(1, value);
     glCall(glUniform1i(GetUniformLocation(name), value));
 }
 void Shader::SetUniform1f(const std::string& name, float value)
 {
+    RememberUniform(name, UniformType::Float).floats[0] = value;
     glCall(glUniform1f(GetUniformLocation(name), value));
 }
+void Shader::SetUniform2f(const std::string& name, float v0, float v1)
+{
+    UniformValue& value = RememberUniform(name, UniformType::Float2);
+    value.floats[0] = v0;
+    value.floats[1] = v1;
+    glCall(glUniform2f(GetUniformLocation(name), v0, v1));
+}
+
+void Shader::SetUniform3f(const std::string& name, float v0, float v1, float v2)
+{
+    UniformValue& value = RememberUniform(name, UniformType::Float3);
+    value.floats[0] = v0;
+    value.floats[1] = v1;
+    value.floats[2] = v2;
+    glCall(glUniform3f(GetUniformLocation(name), v0, v1, v2));
+}
 
 // if math library is row major, then GL_TRUE, if column major, then GL_FALSE
 void Shader::SetUniformMat4f(const std::string& name, const glm::mat4& matrix)
 {
+    std::memcpy(RememberUniform(name, UniformType::Mat4).floats, &matrix[0][0], sizeof(float) * 16);
     glCall(glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &matrix[0][0]));
 }
 
 void Shader::SetUniformVec1i(const std::string& name,const std::vector<int>& vector)
 {
+    RememberUniform(name, UniformType::IntArray).ints = vector;
     glCall(glUniform1iv(GetUniformLocation(name), GLsizei(vector.size()), &vector[0]));
 }
 
+void Shader::SetUniform1iv(const std::string& name, const int* values, int count)
+{
+    RememberUniform(name, UniformType::IntArray).ints.assign(values, values + count);
+    glCall(glUniform1iv(GetUniformLocation(name), count, values));
+}
+
+Shader::UniformValue& Shader::RememberUniform(const std::string& name, UniformType type)
+{
+    // the map only grows the first time a name is set, later sets overwrite in place
+    UniformValue& value = m_UniformValues[name];
+    value.type = type;
+    return value;
+}
+
+void Shader::ApplyUniforms(unsigned int program) const
+{
+    GLint previous = 0;
+    glCall(glGetIntegerv(GL_CURRENT_PROGRAM, &previous));
+    glCall(glUseProgram(program));
+    for (const auto& [name, value] : m_UniformValues) {
+        glCall(int location = glGetUniformLocation(program, name.c_str()));
+        if (location == -1)
+            continue; // the edit removed it, or the compiler found it unused now
+        switch (value.type) {
+        case UniformType::Int:      glCall(glUniform1i(location, value.ints[0])); break;
+        case UniformType::Float:    glCall(glUniform1f(location, value.floats[0])); break;
+        case UniformType::Float2:   glCall(glUniform2fv(location, 1, value.floats)); break;
+        case UniformType::Float3:   glCall(glUniform3fv(location, 1, value.floats)); break;
+        case UniformType::Float4:   glCall(glUniform4fv(location, 1, value.floats)); break;
+        case UniformType::Mat4:     glCall(glUniformMatrix4fv(location, 1, GL_FALSE, value.floats)); break;
+        case UniformType::IntArray: glCall(glUniform1iv(location, GLsizei(value.ints.size()), value.ints.data())); break;
+        }
+    }
+    glCall(glUseProgram(GLuint(previous)));
+}
+
 
 int Shader::GetUniformLocation(const std::string& name)
 {
+    // the fallback and the real program lay out their uniforms differently
+    const unsigned int program = GetActiveProgram();
+    if (program != m_UniformCacheProgram) {
+        m_UniformLocationCache.clear();
+        m_UniformCacheProgram = program;
+    }
     if (m_UniformLocationCache.find(name) != m_UniformLocationCache.end()) return m_UniformLocationCache[name];
         // if uniform doesn't exist, create it
 
-        glCall(int location = glGetUniformLocation(m_RendererID, name.c_str()));
-        if (location == -1) {
+        glCall(int location = glGetUniformLocation(program, name.c_str()));
+        // a fallback only has the transform uniforms, the rest missing there is expected
+        if (location == -1 && program == m_RendererID) {
             std::cout << "Warning: uniform '" << name << "' doesn't exist!" << std::endl;
         }
             m_UniformLocationCache[name] = location;
@@ -1,4 +1,6 @@
 #pragma once
+#include <chrono>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -6,9 +8,13 @@
 #include "glm/gtc/matrix_transform.hpp"
 // #include "glm/gtc/type_ptr.hpp"
 
+struct PendingProgram;
+
 struct ShaderProgramSource{
     std::string VertexSource;
     std::string FragmentSource;
+    std::string GeometrySource; // empty unless the file has a "#shader geometry" stage
+    std::string ComputeSource;  // "#shader compute", linked on its own
 };
 
 
@@ -17,31 +23,86 @@ class Shader
 private:
     /* data */
     std::string m_FilePath;
-    unsigned int m_RendererID;
-    // caching system for uniforms
+    std::string m_CacheName;
+    std::vector<std::string> m_Defines;
+    std::vector<std::string> m_Files; // the shader file and its includes
+    // an async compile is finished lazily by whoever asks first (Bind included), so these change behind const
+    mutable unsigned int m_RendererID;
+    mutable std::shared_ptr<PendingProgram> m_Pending;
+    std::shared_ptr<PendingProgram> m_Reload; // a changed source compiling while the current program stays in use
+    mutable ShaderProgramSource m_PendingSource; // kept for ProgramCache::Store once the program is linked
+    mutable double m_LoadMs = 0.0;
+    std::chrono::steady_clock::time_point m_LoadStart;
+    std::shared_ptr<Shader> m_Fallback;
+    // caching system for uniforms, for whichever program is active
     std::unordered_map<std::string, int> m_UniformLocationCache;
+    unsigned int m_UniformCacheProgram = 0;
+    // the last value set for each uniform, a reloaded program starts with all of them at their defaults
+    enum class UniformType { Int, Float, Float2, Float3, Float4, Mat4, IntArray };
+    struct UniformValue
+    {
+        UniformType type;
+        float floats[16];
+        std::vector<int> ints; // Int and IntArray
+    };
+    std::unordered_map<std::string, UniformValue> m_UniformValues;
+    bool m_FromCache = false; // the program binary came from ProgramCache instead of being compiled
 
 public:
-    Shader(const std::string& filepath);
+    // the file goes through ShaderPreprocessor (#include, #pragma keywords), defines are inserted as
+    // "#define <define>" right after the #version line of both stages.
+    // async hands the compile to ShaderCompiler and returns right away, until it's done the shader
+    // binds its fallback (see SetFallback)
+    Shader(const std::string& filepath, const std::vector<std::string>& defines = {}, bool async = false);
     ~Shader();
 
     void Bind() const;
     void Unbind() const;
 
+    // false while the async compile is running, and for good if it failed. When the program takes over
+    // from the fallback it gets the last value set for every uniform, like after PollReload
+    bool IsReady() const;
+    inline bool IsPending() const { return m_Pending != nullptr; }
+    // what Bind and the uniform setters use until this shader is ready. It should take the same vertex
+    // inputs and transform uniforms, see res/Shaders/Fallback.shader
+    inline void SetFallback(std::shared_ptr<Shader> fallback) { m_Fallback = std::move(fallback); }
+    // this program, the fallback's while compiling, 0 if there is neither
+    unsigned int GetActiveProgram() const;
+
+    // whether the shader or one of its includes is in files
+    bool DependsOn(const std::vector<std::string>& files) const;
+    // recompiles from the files on disk in the background, the current program stays in use until
+    // PollReload swaps the new one in. A source that fails to compile keeps the current program
+    void Reload();
+    // true once, when a reload finished and the program was replaced. Uniform locations are looked up
+    // again and every uniform gets the last value set through the setters below, so values set once
+    // (sampler units, constant colors) survive. Whatever was bound stays bound
+    bool PollReload();
+    inline bool IsReloading() const { return m_Reload != nullptr; }
+
+    inline double GetLoadMs() const { return m_LoadMs; }
+    inline bool IsFromCache() const { return m_FromCache; }
+
 
     // Set uniforms
     void SetUniform1i(const std::string& name, int value);
     void SetUniform1f(const std::string& name, float value);
+    void SetUniform2f(const std::string& name, float v0, float v1);
+    void SetUniform3f(const std::string& name, float v0, float v1, float v2);
     void SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3);
     void SetUniformMat4f(const std::string& name, const glm::mat4& matrix);
     void SetUniformVec1i(const std::string &name, const std::vector<int> &vector);
+    void SetUniform1iv(const std::string& name, const int* values, int count);
 
 private:
     int GetUniformLocation(const std::string& name);
-    
-    ShaderProgramSource ParseShader(const std::string& filepath);
-    unsigned int CompileShader(unsigned int type, const std::string& source);
-    unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader);
+    UniformValue& RememberUniform(const std::string& name, UniformType type);
+    void ApplyUniforms(unsigned int program) const;
+    void FinishLoad() const;
 
+public:
+    // compile and link right here, the caller waits. ShaderCompiler's thread uses these too
+    static unsigned int CompileShader(unsigned int type, const std::string& source);
+    static unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader);
 };
 
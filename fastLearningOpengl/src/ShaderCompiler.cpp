@@ -0,0 +1,262 @@
+#include "ShaderCompiler.h"
+#include "Renderer.h"
+#include "ProgramCache.h"
+#include "Shader.h"
+#include "GLFW/glfw3.h" // hidden window for the compiler thread, glfwGetProcAddress for the extension
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// glad is generated without extensions, the KHR and ARB versions share the enum
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace
+{
+    typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+    ShaderCompiler::Mode s_mode = ShaderCompiler::Mode::Synchronous;
+    GLFWwindow* s_workerWindow = nullptr;
+    std::thread s_worker;
+    std::mutex s_mutex;
+    std::condition_variable s_wake;
+    std::deque<std::shared_ptr<PendingProgram>> s_queue;
+    bool s_stopping = false;
+
+    void PrintShaderLog(unsigned int shader, const char* stage)
+    {
+        GLint compiled = GL_FALSE, length = 0;
+        glCall(glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled));
+        if (compiled == GL_TRUE)
+            return;
+        glCall(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length));
+        std::vector<char> message(std::size_t(length) + 1, '\0');
+        glCall(glGetShaderInfoLog(shader, length, nullptr, message.data()));
+        std::cout << "Failed to compile " << stage << " shader!" << std::endl;
+        std::cout << message.data() << std::endl;
+    }
+
+    // the link status of a finished program. A program that failed is deleted and 0 comes back
+    unsigned int TakeLinked(unsigned int program)
+    {
+        GLint linked = GL_FALSE;
+        glCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+        if (linked == GL_TRUE)
+            return program;
+        GLint length = 0;
+        glCall(glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length));
+        std::vector<char> message(std::size_t(length) + 1, '\0');
+        glCall(glGetProgramInfoLog(program, length, nullptr, message.data()));
+        std::cout << "Error (SHADER COMPILER): program failed to link" << std::endl;
+        std::cout << message.data() << std::endl;
+        glCall(glDeleteProgram(program));
+        return 0;
+    }
+
+    // parallel extension: nothing here waits, the driver compiles while the caller carries on.
+    // Asking for a status before GL_COMPLETION_STATUS_KHR says so would block again
+    void StartCompile(PendingProgram& pending)
+    {
+        const char* vertexSource = pending.vertexSource.c_str();
+        const char* fragmentSource = pending.fragmentSource.c_str();
+        glCall(pending.vertexShader = glCreateShader(GL_VERTEX_SHADER));
+        glCall(glShaderSource(pending.vertexShader, 1, &vertexSource, nullptr));
+        glCall(glCompileShader(pending.vertexShader));
+        glCall(pending.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER));
+        glCall(glShaderSource(pending.fragmentShader, 1, &fragmentSource, nullptr));
+        glCall(glCompileShader(pending.fragmentShader));
+
+        glCall(pending.program = glCreateProgram());
+        glCall(glAttachShader(pending.program, pending.vertexShader));
+        glCall(glAttachShader(pending.program, pending.fragmentShader));
+        ProgramCache::PrepareProgram(pending.program);
+        glCall(glLinkProgram(pending.program));
+        pending.state = PendingProgram::State::Compiling;
+    }
+
+    void DeleteStages(PendingProgram& pending)
+    {
+        if (pending.vertexShader) {
+            glCall(glDeleteShader(pending.vertexShader));
+        }
+        if (pending.fragmentShader) {
+            glCall(glDeleteShader(pending.fragmentShader));
+        }
+        pending.vertexShader = pending.fragmentShader = 0;
+    }
+
+    void WorkerMain()
+    {
+        glfwMakeContextCurrent(s_workerWindow);
+        for (;;) {
+            std::shared_ptr<PendingProgram> pending;
+            {
+                std::unique_lock<std::mutex> lock(s_mutex);
+                s_wake.wait(lock, [] { return s_stopping || !s_queue.empty(); });
+                if (s_stopping)
+                    break;
+                pending = std::move(s_queue.front());
+                s_queue.pop_front();
+            }
+            PendingProgram::State expected = PendingProgram::State::Queued;
+            if (!pending->state.compare_exchange_strong(expected, PendingProgram::State::Compiling))
+                continue; // cancelled while it was queued
+
+            unsigned int program = Shader::CreateShader(pending->vertexSource, pending->fragmentSource);
+            // the main context may only use the program once this context's commands are done,
+            // the fence tells it when, the flush makes sure the fence gets there at all
+            glCall(GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+            glCall(glFlush());
+            pending->program = program;
+            pending->fence = fence;
+            expected = PendingProgram::State::Compiling;
+            if (!pending->state.compare_exchange_strong(expected, PendingProgram::State::Done)) {
+                glCall(glDeleteSync(fence));
+                glCall(glDeleteProgram(program));
+            }
+        }
+        glfwMakeContextCurrent(nullptr);
+    }
+}
+
+namespace ShaderCompiler
+{
+    void Initialize(GLFWwindow* mainWindow)
+    {
+        // the worker thread reads the cache settings, detect them here before it exists
+        ProgramCache::IsAvailable();
+
+        if (glHasExtension("GL_KHR_parallel_shader_compile") || glHasExtension("GL_ARB_parallel_shader_compile")) {
+            auto maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+            if (!maxThreads)
+                maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+            // 0xFFFFFFFF leaves the thread count to the driver
+            if (maxThreads)
+                maxThreads(0xFFFFFFFFu);
+            s_mode = Mode::ParallelExtension;
+        } else {
+            // same context hints as the main window, which are still set
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            s_workerWindow = glfwCreateWindow(1, 1, "shader compiler", nullptr, mainWindow);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+            if (s_workerWindow) {
+                s_stopping = false;
+                s_worker = std::thread(WorkerMain);
+                s_mode = Mode::SharedContextThread;
+            } else {
+                s_mode = Mode::Synchronous;
+            }
+        }
+        std::cout << "Info (SHADER COMPILER): " << GetModeName() << std::endl;
+    }
+
+    void Shutdown()
+    {
+        if (s_worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(s_mutex);
+                s_stopping = true;
+            }
+            s_wake.notify_one();
+            s_worker.join();
+            s_queue.clear();
+        }
+        if (s_workerWindow) {
+            glfwDestroyWindow(s_workerWindow);
+            s_workerWindow = nullptr;
+        }
+        s_mode = Mode::Synchronous;
+    }
+
+    Mode GetMode()
+    {
+        return s_mode;
+    }
+
+    const char* GetModeName()
+    {
+        switch (s_mode) {
+        case Mode::ParallelExtension:
+            return "parallel shader compile extension";
+        case Mode::SharedContextThread:
+            return "compiler thread with a shared context";
+        default:
+            return "synchronous";
+        }
+    }
+
+    std::shared_ptr<PendingProgram> Submit(const std::string& vertexSource, const std::string& fragmentSource)
+    {
+        auto pending = std::make_shared<PendingProgram>();
+        pending->vertexSource = vertexSource;
+        pending->fragmentSource = fragmentSource;
+        switch (s_mode) {
+        case Mode::ParallelExtension:
+            StartCompile(*pending);
+            break;
+        case Mode::SharedContextThread:
+            {
+                std::lock_guard<std::mutex> lock(s_mutex);
+                s_queue.push_back(pending);
+            }
+            s_wake.notify_one();
+            break;
+        default:
+            pending->program = Shader::CreateShader(vertexSource, fragmentSource);
+            pending->state = PendingProgram::State::Done;
+            break;
+        }
+        return pending;
+    }
+
+    bool Poll(PendingProgram& pending, unsigned int& program)
+    {
+        if (pending.vertexShader) {
+            GLint complete = GL_FALSE;
+            glCall(glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &complete));
+            if (complete != GL_TRUE)
+                return false;
+            PrintShaderLog(pending.vertexShader, "vertex");
+            PrintShaderLog(pending.fragmentShader, "fragment");
+            DeleteStages(pending);
+            pending.state = PendingProgram::State::Done;
+        }
+        if (pending.state.load() != PendingProgram::State::Done)
+            return false;
+        if (pending.fence) {
+            glCall(GLenum status = glClientWaitSync(pending.fence, 0, 0));
+            if (status == GL_TIMEOUT_EXPIRED)
+                return false;
+            glCall(glDeleteSync(pending.fence));
+            pending.fence = nullptr;
+        }
+        program = pending.program ? TakeLinked(pending.program) : 0;
+        pending.program = 0;
+        return true;
+    }
+
+    void Cancel(PendingProgram& pending)
+    {
+        PendingProgram::State expected = PendingProgram::State::Queued;
+        if (pending.state.compare_exchange_strong(expected, PendingProgram::State::Cancelled))
+            return;
+        if (expected == PendingProgram::State::Compiling && pending.vertexShader == 0 &&
+            pending.state.compare_exchange_strong(expected, PendingProgram::State::Cancelled))
+            return; // the compiler thread deletes it when it's done
+        // done, or compiling inside the driver: the program is ours to delete
+        DeleteStages(pending);
+        if (pending.fence) {
+            glCall(glDeleteSync(pending.fence));
+            pending.fence = nullptr;
+        }
+        if (pending.program) {
+            glCall(glDeleteProgram(pending.program));
+            pending.program = 0;
+        }
+    }
+}
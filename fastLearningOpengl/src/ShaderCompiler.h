@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <glad/glad.h>
+
+struct GLFWwindow;
+
+// a program that was submitted and may still be compiling. Shader owns it until Poll says it's done
+struct PendingProgram
+{
+    enum class State
+    {
+        Queued,     // waiting for the compiler thread
+        Compiling,
+        Done,       // program (and fence, on the thread) are set
+        Cancelled   // the shader went away first, whoever finishes it deletes the program
+    };
+
+    std::string vertexSource;
+    std::string fragmentSource;
+    std::atomic<State> state{State::Queued};
+    unsigned int program = 0;
+    unsigned int vertexShader = 0;   // parallel extension only, kept until the link finished
+    unsigned int fragmentShader = 0;
+    GLsync fence = nullptr;          // compiler thread only, signals the program is visible to the main context
+};
+
+// compiles and links programs without stalling the caller, so many shaders submitted at once
+// overlap instead of running one after another. Uses KHR/ARB_parallel_shader_compile when the driver
+// has it (the driver compiles on its own threads, GL_COMPLETION_STATUS_KHR is polled), otherwise a
+// worker thread with a hidden window whose context shares objects with the main one, and if that
+// can't be created either it compiles right away on submit
+namespace ShaderCompiler
+{
+    enum class Mode
+    {
+        Synchronous,
+        ParallelExtension,
+        SharedContextThread
+    };
+
+    // call once on the GL thread after glad is loaded
+    void Initialize(GLFWwindow* mainWindow);
+    // stops the worker, call after the last shader is gone and before the main window is destroyed
+    void Shutdown();
+    Mode GetMode();
+    const char* GetModeName();
+
+    std::shared_ptr<PendingProgram> Submit(const std::string& vertexSource, const std::string& fragmentSource);
+    // true once the program is finished, then program is the linked program or 0 if it failed (the log is printed)
+    bool Poll(PendingProgram& pending, unsigned int& program);
+    // for a shader deleted before its program was taken, the program is deleted whenever it finishes
+    void Cancel(PendingProgram& pending);
+}
@@ -0,0 +1,174 @@
+#include "ShaderLibrary.h"
+
+#include <cassert>
+#include <filesystem>
+#include <iostream>
+
+ShaderLibrary::~ShaderLibrary()
+{
+    // whatever is still referenced here outlived the library, deleting it would pull the program
+    // out from under its users (and the GL context may be gone by now)
+    m_destroying = true;
+    for (auto& entry : m_entries) {
+        if (!entry.second.handle.expired())
+            entry.second.shader.release();
+    }
+}
+
+std::string ShaderLibrary::MakeKey(const std::string& path, const std::vector<std::string>& defines)
+{
+    std::string key = path;
+    for (const std::string& define : defines) {
+        key += '|';
+        key += define;
+    }
+    return key;
+}
+
+std::shared_ptr<Shader> ShaderLibrary::Get(const std::string& path, const std::vector<std::string>& defines)
+{
+    return Acquire(path, defines, nullptr);
+}
+
+std::shared_ptr<Shader> ShaderLibrary::GetAsync(const std::string& path, const std::vector<std::string>& defines,
+                                                const std::vector<std::string>& fallbackDefines)
+{
+    return Acquire(path, defines, &fallbackDefines);
+}
+
+std::shared_ptr<Shader> ShaderLibrary::Acquire(const std::string& path, const std::vector<std::string>& defines,
+                                               const std::vector<std::string>* fallbackDefines)
+{
+    const std::string key = MakeKey(path, defines);
+    Entry& entry = m_entries[key];
+    if (std::shared_ptr<Shader> live = entry.handle.lock()) {
+        m_stats.hits++;
+        return live;
+    }
+
+    if (entry.shader) {
+        m_stats.hits++;
+    } else {
+        m_stats.misses++;
+        if (fallbackDefines) {
+            // the fallback is tiny and compiled right away, so there is always something to draw with
+            std::shared_ptr<Shader> fallback = Get(FallbackPath, *fallbackDefines);
+            entry.shader = std::make_unique<Shader>(path, defines, true);
+            entry.shader->SetFallback(std::move(fallback));
+        } else {
+            entry.shader = std::make_unique<Shader>(path, defines);
+        }
+    }
+    if (entry.inLru) {
+        m_lru.erase(entry.lruPosition);
+        entry.inLru = false;
+    }
+
+    // the deleter hands the program back to the library instead of deleting it
+    std::shared_ptr<Shader> handle(entry.shader.get(), [this, key](Shader*) { Release(key); });
+    entry.handle = handle;
+    return handle;
+}
+
+void ShaderLibrary::Release(const std::string& key)
+{
+    // an async shader dropping its fallback while the map itself is being torn down
+    if (m_destroying)
+        return;
+    auto found = m_entries.find(key);
+    assert(found != m_entries.end());
+    Entry& entry = found->second;
+    m_lru.push_front(key);
+    entry.lruPosition = m_lru.begin();
+    entry.inLru = true;
+    Evict(m_cacheCapacity);
+}
+
+void ShaderLibrary::Evict(std::size_t keep)
+{
+    while (m_lru.size() > keep) {
+        auto found = m_entries.find(m_lru.back());
+        std::unique_ptr<Shader> shader = std::move(found->second.shader);
+        m_entries.erase(found);
+        m_lru.pop_back();
+        m_stats.evictions++;
+        // deleted after the bookkeeping, an async shader lets go of its fallback and that comes back through Release
+        shader.reset();
+    }
+}
+
+void ShaderLibrary::EnableHotReload(const std::string& directory, const std::string& sourceDirectory)
+{
+    m_directory = std::filesystem::path(directory).lexically_normal().generic_string();
+    m_sourceDirectory = sourceDirectory.empty() ? std::string() : std::filesystem::path(sourceDirectory).lexically_normal().generic_string();
+    m_watcher = std::make_unique<ShaderWatcher>(m_sourceDirectory.empty() ? m_directory : m_sourceDirectory);
+}
+
+std::vector<std::string> ShaderLibrary::CopyFromSource(const std::vector<std::string>& changed) const
+{
+    // the programs know their files by the path they were loaded from, so that's what's reported back
+    std::vector<std::string> copied;
+    for (const std::string& file : changed) {
+        std::filesystem::path target = std::filesystem::path(m_directory) / std::filesystem::path(file).lexically_relative(m_sourceDirectory);
+        std::error_code error;
+        std::filesystem::create_directories(target.parent_path(), error);
+        std::filesystem::copy_file(file, target, std::filesystem::copy_options::overwrite_existing, error);
+        if (error) {
+            std::cout << "Error (SHADER): can't copy " << file << " to " << target.generic_string() << ": " << error.message() << std::endl;
+            continue;
+        }
+        copied.push_back(target.lexically_normal().generic_string());
+    }
+    return copied;
+}
+
+void ShaderLibrary::Update()
+{
+    if (m_watcher) {
+        std::vector<std::string> changed = m_watcher->Poll();
+        if (!changed.empty() && !m_sourceDirectory.empty())
+            changed = CopyFromSource(changed);
+        if (!changed.empty()) {
+            for (auto& entry : m_entries) {
+                if (entry.second.shader && entry.second.shader->DependsOn(changed)) {
+                    entry.second.shader->Reload();
+                    m_reloading = true;
+                }
+            }
+        }
+    }
+    if (!m_reloading)
+        return;
+    m_reloading = false;
+    for (auto& entry : m_entries) {
+        Shader* shader = entry.second.shader.get();
+        if (shader && shader->PollReload())
+            m_stats.reloads++;
+        m_reloading = m_reloading || (shader && shader->IsReloading());
+    }
+}
+
+void ShaderLibrary::SetCacheCapacity(std::size_t capacity)
+{
+    m_cacheCapacity = capacity;
+    Evict(m_cacheCapacity);
+}
+
+void ShaderLibrary::Clear()
+{
+    Evict(0);
+}
+
+std::size_t ShaderLibrary::GetLiveCount() const
+{
+    return m_entries.size() - m_lru.size();
+}
+
+namespace Shaders
+{
+    ShaderLibrary& Get()
+    {
+        static ShaderLibrary s_library;
+        return s_library;
+    }
+}
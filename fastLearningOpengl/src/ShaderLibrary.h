@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Shader.h"
+#include "ShaderWatcher.h"
+
+struct ShaderLibraryStats
+{
+    unsigned int hits = 0;      // Get answered with a program that was already linked
+    unsigned int misses = 0;    // Get had to load the shader
+    unsigned int evictions = 0; // released programs dropped from the LRU
+    unsigned int reloads = 0;   // programs replaced after their files changed
+};
+
+// one program per path + defines, shared by every test that asks for it. Handles are shared_ptrs;
+// once the last one is gone the program is not deleted but parked in a small LRU, so switching
+// back to a test costs no compile at all. Only the LRU's oldest entries are actually deleted
+class ShaderLibrary
+{
+public:
+    static constexpr std::size_t DefaultCacheCapacity = 16;
+    static constexpr const char* FallbackPath = "res/Shaders/Fallback.shader";
+
+private:
+    struct Entry
+    {
+        std::unique_ptr<Shader> shader;
+        std::weak_ptr<Shader> handle;           // expired while nobody uses the program
+        std::list<std::string>::iterator lruPosition;
+        bool inLru = false;
+    };
+
+    std::unordered_map<std::string, Entry> m_entries;
+    std::list<std::string> m_lru; // released programs, most recently released first
+    std::size_t m_cacheCapacity = DefaultCacheCapacity;
+    ShaderLibraryStats m_stats;
+    bool m_destroying = false;
+    std::unique_ptr<ShaderWatcher> m_watcher;
+    std::string m_directory;       // where the shaders are loaded from
+    std::string m_sourceDirectory; // watched instead when set, its writes are copied into m_directory
+    bool m_reloading = false; // some shader has a reload in flight
+
+    static std::string MakeKey(const std::string& path, const std::vector<std::string>& defines);
+    std::shared_ptr<Shader> Acquire(const std::string& path, const std::vector<std::string>& defines, const std::vector<std::string>* fallbackDefines);
+    void Release(const std::string& key);
+    void Evict(std::size_t keep);
+    std::vector<std::string> CopyFromSource(const std::vector<std::string>& changed) const;
+
+public:
+    ShaderLibrary() = default;
+    ~ShaderLibrary();
+    ShaderLibrary(const ShaderLibrary&) = delete;
+    ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+    // defines are injected as "#define <define>" after #version, "NAME" or "NAME VALUE"
+    std::shared_ptr<Shader> Get(const std::string& path, const std::vector<std::string>& defines = {});
+    // like Get, but a shader that isn't loaded yet is compiled by ShaderCompiler in the background and
+    // draws with FallbackPath (built with fallbackDefines, e.g. "FALLBACK_MVP") until it's ready.
+    // A later Get for the same shader returns the same, possibly still compiling, one
+    std::shared_ptr<Shader> GetAsync(const std::string& path, const std::vector<std::string>& defines = {},
+                                     const std::vector<std::string>& fallbackDefines = {});
+
+    // watches directory, a written file recompiles every program built from it (in use or released).
+    // With a sourceDirectory, that is watched instead and each written file is copied over its
+    // counterpart in directory first: the app runs on a copy of res, the edits happen in the source tree
+    void EnableHotReload(const std::string& directory, const std::string& sourceDirectory = {});
+    inline bool IsHotReloading() const { return m_watcher && m_watcher->IsWatching(); }
+    // once per frame: picks up file changes and swaps in the programs that finished recompiling
+    void Update();
+
+    // how many released programs are kept around
+    void SetCacheCapacity(std::size_t capacity);
+    // deletes every released program. Call before the GL context goes away
+    void Clear();
+
+    std::size_t GetLiveCount() const;
+    inline std::size_t GetCachedCount() const { return m_lru.size(); }
+    inline std::size_t GetCacheCapacity() const { return m_cacheCapacity; }
+    inline const ShaderLibraryStats& GetStats() const { return m_stats; }
+};
+
+// the application wide library, created on first use (on the GL thread)
+namespace Shaders
+{
+    ShaderLibrary& Get();
+}
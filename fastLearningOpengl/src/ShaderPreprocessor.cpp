@@ -0,0 +1,320 @@
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#ifdef _WIN32
+    #include <fstream>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // read only view of a whole file. Mapped where there is mmap, read in one go otherwise
+    class MappedFile
+    {
+    private:
+        const char* m_data = nullptr;
+        std::size_t m_size = 0;
+        bool m_valid = false;
+#ifdef _WIN32
+        std::vector<char> m_buffer;
+#endif
+
+    public:
+        explicit MappedFile(const std::string& path)
+        {
+#ifdef _WIN32
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file)
+                return;
+            m_buffer.resize(std::size_t(file.tellg()));
+            file.seekg(0);
+            m_valid = bool(file.read(m_buffer.data(), std::streamsize(m_buffer.size())));
+            m_data = m_buffer.data();
+            m_size = m_buffer.size();
+#else
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return;
+            struct stat info;
+            if (fstat(fd, &info) == 0) {
+                m_size = std::size_t(info.st_size);
+                m_valid = true;
+                if (m_size > 0) {
+                    void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (mapped == MAP_FAILED) {
+                        m_valid = false;
+                        m_size = 0;
+                    } else {
+                        m_data = static_cast<const char*>(mapped);
+                    }
+                }
+            }
+            close(fd); // the mapping stays valid without the descriptor
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifndef _WIN32
+            if (m_data)
+                munmap(const_cast<char*>(m_data), m_size);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        inline const char* GetData() const { return m_data; }
+        inline std::size_t GetSize() const { return m_size; }
+        inline bool IsValid() const { return m_valid; }
+    };
+
+    struct CacheEntry
+    {
+        std::shared_ptr<const PreprocessedShader> shader;
+        std::vector<std::filesystem::file_time_type> writeTimes; // one per shader->files
+    };
+
+    std::mutex s_mutex;
+    std::unordered_map<std::string, CacheEntry> s_cache;
+    ShaderPreprocessorStats s_stats;
+
+    constexpr unsigned int MAX_INCLUDE_DEPTH = 16;
+
+    struct Expansion
+    {
+        PreprocessedShader& result;
+        std::string* stage = nullptr;          // where the lines go, nothing before the first #shader
+        std::vector<unsigned int> stageFiles; // files already in this stage, each is pasted once
+    };
+
+    std::string_view TrimLeft(std::string_view text)
+    {
+        std::size_t first = text.find_first_not_of(" \t");
+        return first == std::string_view::npos ? std::string_view() : text.substr(first);
+    }
+
+    // the directive name if the line is "#name ...", rest gets what follows it
+    std::string_view Directive(std::string_view line, std::string_view& rest)
+    {
+        line = TrimLeft(line);
+        if (line.empty() || line[0] != '#')
+            return {};
+        line = TrimLeft(line.substr(1));
+        std::size_t nameEnd = std::min(line.find_first_of(" \t\r"), line.size());
+        rest = TrimLeft(line.substr(nameEnd));
+        return line.substr(0, nameEnd);
+    }
+
+    unsigned int FileIndex(PreprocessedShader& result, const std::string& path)
+    {
+        auto found = std::find(result.files.begin(), result.files.end(), path);
+        if (found != result.files.end())
+            return unsigned(found - result.files.begin());
+        result.files.push_back(path);
+        return unsigned(result.files.size() - 1);
+    }
+
+    void AppendLine(std::string& out, unsigned int line, unsigned int fileIndex)
+    {
+        out += "#line ";
+        out += std::to_string(line);
+        out += ' ';
+        out += std::to_string(fileIndex);
+        out += '\n';
+    }
+
+    bool ExpandFile(Expansion& expansion, unsigned int fileIndex, unsigned int depth)
+    {
+        // copied, files may grow while the includes are expanded
+        const std::string path = expansion.result.files[fileIndex];
+        MappedFile file(path);
+        if (!file.IsValid()) {
+            std::cout << "Error (SHADER): can't read " << path << std::endl;
+            return false;
+        }
+
+        const char* cursor = file.GetData();
+        const char* end = cursor + file.GetSize();
+        const char* run = cursor; // start of the lines not copied yet, they go out in one append
+        auto flush = [&](const char* upTo) {
+            if (expansion.stage && upTo > run)
+                expansion.stage->append(run, std::size_t(upTo - run));
+        };
+
+        bool ok = true;
+        unsigned int line = 1;
+        for (; cursor < end; line++) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', std::size_t(end - cursor)));
+            const char* next = lineEnd ? lineEnd + 1 : end;
+            std::string_view rest;
+            std::string_view directive = Directive(std::string_view(cursor, std::size_t((lineEnd ? lineEnd : end) - cursor)), rest);
+
+            if (directive == "shader") {
+                flush(cursor);
+                if (depth > 0) {
+                    std::cout << "Error (SHADER): " << path << ":" << line << " #shader inside an include" << std::endl;
+                    ok = false;
+                } else if (rest.substr(0, 6) == "vertex") {
+                    expansion.stage = &expansion.result.source.VertexSource;
+                } else if (rest.substr(0, 8) == "fragment") {
+                    expansion.stage = &expansion.result.source.FragmentSource;
+                } else if (rest.substr(0, 8) == "geometry") {
+                    expansion.stage = &expansion.result.source.GeometrySource;
+                } else if (rest.substr(0, 7) == "compute") {
+                    expansion.stage = &expansion.result.source.ComputeSource;
+                }
+                expansion.stageFiles.assign(1, fileIndex);
+                run = next;
+            } else if (directive == "version" && expansion.stage) {
+                // numbering continues from the file's own lines, the #line can't go before #version
+                flush(next);
+                if (!lineEnd)
+                    *expansion.stage += '\n';
+                AppendLine(*expansion.stage, line + 1, fileIndex);
+                run = next;
+            } else if (directive == "include" && expansion.stage) {
+                flush(cursor);
+                run = next;
+                std::size_t open = rest.find('"');
+                std::size_t close = open == std::string_view::npos ? open : rest.find('"', open + 1);
+                if (close == std::string_view::npos) {
+                    std::cout << "Error (SHADER): " << path << ":" << line << " #include needs a \"file\"" << std::endl;
+                    ok = false;
+                    continue;
+                }
+                std::filesystem::path target = std::filesystem::path(path).parent_path() / std::string(rest.substr(open + 1, close - open - 1));
+                unsigned int includeIndex = FileIndex(expansion.result, target.lexically_normal().generic_string());
+                auto& stageFiles = expansion.stageFiles;
+                if (std::find(stageFiles.begin(), stageFiles.end(), includeIndex) == stageFiles.end()) {
+                    if (depth + 1 >= MAX_INCLUDE_DEPTH) {
+                        std::cout << "Error (SHADER): " << path << ":" << line << " includes nest too deep" << std::endl;
+                        ok = false;
+                        continue;
+                    }
+                    stageFiles.push_back(includeIndex);
+                    AppendLine(*expansion.stage, 1, includeIndex);
+                    ok = ExpandFile(expansion, includeIndex, depth + 1) && ok;
+                    if (!expansion.stage->empty() && expansion.stage->back() != '\n')
+                        *expansion.stage += '\n';
+                }
+                AppendLine(*expansion.stage, line + 1, fileIndex);
+            } else if (directive == "pragma" && rest.substr(0, 8) == "keywords") {
+                flush(cursor);
+                // the compiler never sees it, an empty line keeps the numbering
+                if (expansion.stage)
+                    *expansion.stage += '\n';
+                run = next;
+                std::string_view words = rest.substr(8);
+                while (!(words = TrimLeft(words)).empty()) {
+                    std::size_t wordEnd = std::min(words.find_first_of(" \t\r"), words.size());
+                    expansion.result.keywords.emplace_back(words.substr(0, wordEnd));
+                    words = words.substr(wordEnd);
+                }
+            }
+            cursor = next;
+        }
+        flush(end);
+        return ok;
+    }
+
+    std::shared_ptr<const PreprocessedShader> Expand(const std::string& path)
+    {
+        auto shader = std::make_shared<PreprocessedShader>();
+        shader->files.push_back(path);
+        Expansion expansion{*shader};
+        shader->valid = ExpandFile(expansion, 0, 0);
+        return shader;
+    }
+
+    std::vector<std::filesystem::file_time_type> WriteTimes(const std::vector<std::string>& files)
+    {
+        std::vector<std::filesystem::file_time_type> times;
+        times.reserve(files.size());
+        for (const std::string& file : files) {
+            std::error_code error;
+            times.push_back(std::filesystem::last_write_time(file, error)); // a missing file compares as changed once it appears
+        }
+        return times;
+    }
+}
+
+namespace ShaderPreprocessor
+{
+    std::shared_ptr<const PreprocessedShader> Load(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        auto found = s_cache.find(path);
+        if (found != s_cache.end() && WriteTimes(found->second.shader->files) == found->second.writeTimes) {
+            s_stats.hits++;
+            return found->second.shader;
+        }
+
+        auto start = Clock::now();
+        std::shared_ptr<const PreprocessedShader> shader = Expand(path);
+        s_stats.misses++;
+        s_stats.expandMs += MillisecondsSince(start);
+        // a broken shader isn't kept, the next load tries again
+        if (shader->valid)
+            s_cache[path] = {shader, WriteTimes(shader->files)};
+        else
+            s_cache.erase(path);
+        return shader;
+    }
+
+    ShaderProgramSource Specialize(const PreprocessedShader& shader, const std::string& path, const std::vector<std::string>& defines)
+    {
+        ShaderProgramSource source = shader.source;
+        if (defines.empty())
+            return source;
+
+        std::string lines;
+        for (const std::string& define : defines) {
+            std::string name = define.substr(0, define.find(' '));
+            if (!shader.keywords.empty() && std::find(shader.keywords.begin(), shader.keywords.end(), name) == shader.keywords.end())
+                std::cout << "Warning (SHADER): " << path << " has no keyword " << name << std::endl;
+            lines += "#define " + define + "\n";
+        }
+        // GLSL wants #version first, so the defines go right after it
+        for (std::string* stage : {&source.VertexSource, &source.FragmentSource, &source.GeometrySource, &source.ComputeSource}) {
+            if (stage->empty())
+                continue; // a stage the file doesn't have stays missing
+            std::size_t version = stage->find("#version");
+            std::size_t insertAt = version == std::string::npos ? 0 : stage->find('\n', version);
+            insertAt = insertAt == std::string::npos ? stage->size() : insertAt + (version == std::string::npos ? 0 : 1);
+            stage->insert(insertAt, lines);
+        }
+        return source;
+    }
+
+    void ClearCache()
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_cache.clear();
+    }
+
+    ShaderPreprocessorStats GetStats()
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        return s_stats;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Shader.h"
+
+// a .shader file with its includes expanded, the same for every define set
+struct PreprocessedShader
+{
+    ShaderProgramSource source;
+    std::vector<std::string> keywords; // declared with "#pragma keywords A B C", the defines it's meant to be built with
+    std::vector<std::string> files;    // the shader first, then its includes. A "#line n i" in the source refers to files[i]
+    bool valid = true;                 // false if the shader or an include couldn't be read
+};
+
+struct ShaderPreprocessorStats
+{
+    unsigned int hits = 0;   // Load answered from the cache
+    unsigned int misses = 0; // files that had to be expanded
+    double expandMs = 0.0;   // spent expanding, all misses together
+};
+
+// expands .shader files: "#shader vertex" / "#shader fragment" (and "geometry", "compute") split the stages, "#include "file""
+// pastes a file (relative to the one including it, each file once per stage) and "#pragma keywords"
+// lists the permutations. Variants are the same expansion with different defines, so a shader is
+// expanded once and every variant only injects its defines (see Specialize).
+// Files are memory-mapped and scanned once, lines are never copied on their own
+namespace ShaderPreprocessor
+{
+    // the expanded shader, from the cache unless one of its files changed on disk since
+    std::shared_ptr<const PreprocessedShader> Load(const std::string& path);
+    // the stages with "#define <define>" after #version, "NAME" or "NAME VALUE".
+    // Warns about names that aren't among the shader's keywords, if it declares any
+    ShaderProgramSource Specialize(const PreprocessedShader& shader, const std::string& path, const std::vector<std::string>& defines);
+
+    void ClearCache();
+    ShaderPreprocessorStats GetStats();
+}
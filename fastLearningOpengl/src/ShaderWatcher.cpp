@@ -0,0 +1,148 @@
+#include "ShaderWatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+    #include <cerrno>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    std::string Normalized(const std::filesystem::path& path)
+    {
+        return path.lexically_normal().generic_string();
+    }
+}
+
+#ifdef __linux__
+
+ShaderWatcher::ShaderWatcher(const std::string& directory)
+    : m_directory(directory)
+{
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        std::cout << "Error (SHADER WATCHER): inotify unavailable, no hot reload" << std::endl;
+        return;
+    }
+    // inotify isn't recursive, every directory gets its own watch. Editors either write in place
+    // (close after write) or write a temporary and rename it over the file (moved to)
+    std::error_code error;
+    std::vector<std::string> directories = {Normalized(directory)};
+    for (std::filesystem::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (it->is_directory())
+            directories.push_back(Normalized(it->path()));
+    }
+    for (const std::string& watched : directories) {
+        int wd = inotify_add_watch(m_fd, watched.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd >= 0)
+            m_watches.emplace_back(wd, watched);
+    }
+    if (m_watches.empty()) {
+        std::cout << "Error (SHADER WATCHER): can't watch " << directory << std::endl;
+        close(m_fd);
+        m_fd = -1;
+        return;
+    }
+    std::cout << "Info (SHADER WATCHER): watching " << m_watches.size() << " directories under " << directory << std::endl;
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+    if (m_fd >= 0)
+        close(m_fd); // drops the watches too
+}
+
+bool ShaderWatcher::IsWatching() const
+{
+    return m_fd >= 0;
+}
+
+const std::vector<std::string>& ShaderWatcher::Poll()
+{
+    m_changed.clear();
+    if (m_fd < 0)
+        return m_changed;
+
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t length = read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break; // EAGAIN, nothing (more) happened
+        for (char* cursor = buffer; cursor < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+            cursor += sizeof(inotify_event) + event->len;
+            if (event->len == 0 || (event->mask & IN_ISDIR))
+                continue;
+            auto watch = std::find_if(m_watches.begin(), m_watches.end(), [&](const auto& w) { return w.first == event->wd; });
+            if (watch == m_watches.end())
+                continue;
+            std::string path = Normalized(std::filesystem::path(watch->second) / event->name);
+            if (std::find(m_changed.begin(), m_changed.end(), path) == m_changed.end())
+                m_changed.push_back(std::move(path));
+        }
+    }
+    return m_changed;
+}
+
+#else
+
+namespace
+{
+    double Seconds()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+ShaderWatcher::ShaderWatcher(const std::string& directory)
+    : m_directory(directory)
+{
+    Scan(false);
+    m_lastScan = Seconds();
+}
+
+ShaderWatcher::~ShaderWatcher() = default;
+
+bool ShaderWatcher::IsWatching() const
+{
+    return std::filesystem::is_directory(m_directory);
+}
+
+void ShaderWatcher::Scan(bool report)
+{
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator it(m_directory, error), end; !error && it != end; it.increment(error)) {
+        if (!it->is_regular_file())
+            continue;
+        std::string path = Normalized(it->path());
+        long long time = (long long)it->last_write_time(error).time_since_epoch().count();
+        auto known = std::find_if(m_writeTimes.begin(), m_writeTimes.end(), [&](const auto& entry) { return entry.first == path; });
+        if (known == m_writeTimes.end()) {
+            m_writeTimes.emplace_back(path, time);
+            if (report)
+                m_changed.push_back(path);
+        } else if (known->second != time) {
+            known->second = time;
+            if (report)
+                m_changed.push_back(path);
+        }
+    }
+}
+
+const std::vector<std::string>& ShaderWatcher::Poll()
+{
+    m_changed.clear();
+    double now = Seconds();
+    if (now - m_lastScan >= 0.5) {
+        m_lastScan = now;
+        Scan(true);
+    }
+    return m_changed;
+}
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// reports files written under a directory (and its subdirectories). On Linux that's inotify, so a
+// frame where nothing changed costs one non-blocking read. Elsewhere the write times are compared
+// twice a second
+class ShaderWatcher
+{
+private:
+    std::string m_directory;
+    std::vector<std::string> m_changed;
+#ifdef __linux__
+    int m_fd = -1;
+    std::vector<std::pair<int, std::string>> m_watches; // watch descriptor, directory it's for
+#else
+    std::vector<std::pair<std::string, long long>> m_writeTimes;
+    double m_lastScan = 0.0;
+    void Scan(bool report);
+#endif
+
+public:
+    explicit ShaderWatcher(const std::string& directory);
+    ~ShaderWatcher();
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    // false if the directory couldn't be watched, Poll then never reports anything
+    bool IsWatching() const;
+    // the files written since the last call, each once, as "directory/sub/file"
+    const std::vector<std::string>& Poll();
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// bounded queue for exactly one producer thread and one consumer thread, which may be the same one.
+// No locks: each side writes only its own index and reads the other's, the release / acquire pair
+// publishes the item. Full is full, TryPush fails instead of waiting
+template<typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "the capacity has to be a power of two");
+
+private:
+    alignas(64) std::atomic<std::size_t> m_head{0}; // next to pop, written by the consumer
+    alignas(64) std::atomic<std::size_t> m_tail{0}; // next to push, written by the producer
+    alignas(64) T m_items[Capacity];
+
+public:
+    // producer only
+    bool TryPush(const T& item)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        m_items[tail & (Capacity - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only
+    bool TryPop(T& item)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        item = m_items[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // exact only when called from one of the two sides with the other idle
+    std::size_t Size() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+    static constexpr std::size_t GetCapacity() { return Capacity; }
+};
@@ -1,12 +1,13 @@
 #include "Texture.h"
+#include "UploadQueue.h"
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_FAILURE_USERMSG
 #include "stb_image/stb_image.h"
 #include <iostream>
 
 
-Texture::Texture(const std::string& path) 
-: textureID(0), m_FilePath(path), m_LocalBuffer(nullptr), m_Width(0), m_Height(0), m_BPP(0) 
+Texture::Texture(const std::string& path, UploadQueue* uploads)
+: textureID(0), m_FilePath(path), m_LocalBuffer(nullptr), m_Width(0), m_Height(0), m_BPP(0), m_Uploads(uploads)
 {
     stbi_set_flip_vertically_on_load(1);
 
@@ -21,7 +22,13 @@ Texture::Texture(const std::string& path)
 
 
         
-    glCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_LocalBuffer));
+    if (m_Uploads && m_LocalBuffer) {
+        // storage only, the queue copies the pixels (it keeps its own copy of them)
+        glCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+        m_Uploads->EnqueueTexture(textureID, unsigned(m_Width), unsigned(m_Height), m_LocalBuffer);
+    } else {
+        glCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_LocalBuffer));
+    }
     
 
     // maybe not needed (if we want to sample this data again.. ?)
@@ -35,6 +42,8 @@ Texture::Texture(const std::string& path)
 
 
 Texture::~Texture() {
+    if (m_Uploads)
+        m_Uploads->Cancel(textureID, true);
 
     glCall(glDeleteTextures(1, &textureID));
 }
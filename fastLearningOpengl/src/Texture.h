@@ -2,6 +2,8 @@
 
 #include "Renderer.h"
 
+class UploadQueue;
+
 class Texture
 {
 
@@ -10,8 +12,11 @@ class Texture
         std::string m_FilePath;
         unsigned char* m_LocalBuffer;
         int m_Width, m_Height, m_BPP;
+        UploadQueue* m_Uploads;
     public:
-        Texture(const std::string& path);
+        // with uploads the pixels go through that queue instead of being copied right here,
+        // the texture is blank until the queue got to it
+        Texture(const std::string& path, UploadQueue* uploads = nullptr);
         ~Texture();
 
         void Bind(unsigned int slot = 0) const;
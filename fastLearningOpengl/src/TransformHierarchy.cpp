@@ -0,0 +1,182 @@
+#include "TransformHierarchy.h"
+#include "JobSystem.h"
+
+#include <cassert>
+
+unsigned int TransformHierarchy::AddNode(int parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    assert(parent < int(m_parents.size()) && "parents have to be added before their children");
+    unsigned int node = GetNodeCount();
+    m_parents.push_back(parent);
+    m_depths.push_back(parent == NoParent ? 0 : m_depths[parent] + 1);
+    m_local.Add(position, rotation, scale);
+    m_localMatrices.emplace_back(1.0f);
+    m_worldMatrices.emplace_back(1.0f);
+    m_localBounds.push_back({glm::vec3(0.0f), glm::vec3(0.0f)});
+    m_worldBounds.push_back({glm::vec3(0.0f), glm::vec3(0.0f)});
+    m_dirty.push_back(0);
+    MarkDirty(node);
+    return node;
+}
+
+void TransformHierarchy::Reserve(unsigned int count)
+{
+    m_parents.reserve(count);
+    m_depths.reserve(count);
+    m_localMatrices.reserve(count);
+    m_worldMatrices.reserve(count);
+    m_localBounds.reserve(count);
+    m_worldBounds.reserve(count);
+    m_dirty.reserve(count);
+    m_changedNodes.reserve(count);
+}
+
+void TransformHierarchy::Truncate(unsigned int nodeCount)
+{
+    if (nodeCount >= GetNodeCount())
+        return;
+    m_parents.resize(nodeCount);
+    m_depths.resize(nodeCount);
+    m_local.Resize(nodeCount);
+    m_localMatrices.resize(nodeCount);
+    m_worldMatrices.resize(nodeCount);
+    m_localBounds.resize(nodeCount);
+    m_worldBounds.resize(nodeCount);
+    m_dirty.resize(nodeCount);
+}
+
+void TransformHierarchy::MarkDirty(unsigned int node)
+{
+    m_dirty[node] |= LocalDirty;
+    // checked first so setters running on several threads don't all write the same cache line
+    if (!m_anyDirty.load(std::memory_order_relaxed))
+        m_anyDirty.store(true, std::memory_order_relaxed);
+}
+
+void TransformHierarchy::SetLocalPosition(unsigned int node, const glm::vec3& position)
+{
+    if (m_local.positionX[node] == position.x && m_local.positionY[node] == position.y && m_local.positionZ[node] == position.z)
+        return;
+    m_local.SetPosition(node, position);
+    MarkDirty(node);
+}
+
+void TransformHierarchy::SetLocalRotation(unsigned int node, const glm::quat& rotation)
+{
+    if (m_local.rotationX[node] == rotation.x && m_local.rotationY[node] == rotation.y &&
+        m_local.rotationZ[node] == rotation.z && m_local.rotationW[node] == rotation.w)
+        return;
+    m_local.SetRotation(node, rotation);
+    MarkDirty(node);
+}
+
+void TransformHierarchy::SetLocalScale(unsigned int node, const glm::vec3& scale)
+{
+    if (m_local.scaleX[node] == scale.x && m_local.scaleY[node] == scale.y && m_local.scaleZ[node] == scale.z)
+        return;
+    m_local.scaleX[node] = scale.x;
+    m_local.scaleY[node] = scale.y;
+    m_local.scaleZ[node] = scale.z;
+    MarkDirty(node);
+}
+
+void TransformHierarchy::SetLocalBounds(unsigned int node, const glm::vec3& min, const glm::vec3& max)
+{
+    if (m_localBounds[node].min == min && m_localBounds[node].max == max)
+        return;
+    m_localBounds[node] = {min, max};
+    // the world box has to follow, the matrices stay valid but recomputing the node is the simple way
+    MarkDirty(node);
+}
+
+static WorldBounds TransformBounds(const glm::mat4& matrix, const WorldBounds& local)
+{
+    // Arvo: the extent of the transformed box is |M| * extent
+    glm::vec3 center = (local.min + local.max) * 0.5f;
+    glm::vec3 extent = (local.max - local.min) * 0.5f;
+    glm::vec3 worldCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+    glm::vec3 worldExtent = glm::abs(glm::vec3(matrix[0])) * extent.x + glm::abs(glm::vec3(matrix[1])) * extent.y +
+                            glm::abs(glm::vec3(matrix[2])) * extent.z;
+    return {worldCenter - worldExtent, worldCenter + worldExtent};
+}
+
+void TransformHierarchy::Update(JobSystem* jobs)
+{
+    const unsigned int count = GetNodeCount();
+    m_stats = TransformUpdateStats();
+    m_stats.nodeCount = count;
+    m_changedNodes.clear();
+    m_changeRanges.clear();
+    if (!m_anyDirty.load(std::memory_order_relaxed))
+        return;
+
+    // local matrices of runs of changed nodes, 4 at a time with SIMD
+    std::atomic<unsigned int> localsComputed{0};
+    auto computeLocals = [&](std::size_t begin, std::size_t end) {
+        const glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+        unsigned int computed = 0;
+        for (std::size_t node = begin; node < end;) {
+            if (!(m_dirty[node] & LocalDirty)) {
+                node++;
+                continue;
+            }
+            std::size_t runEnd = node + 1;
+            while (runEnd < end && (m_dirty[runEnd] & LocalDirty))
+                runEnd++;
+            Transforms::ComputeMatrices(m_local, node, runEnd, identity, &m_localMatrices[node][0][0]);
+            computed += unsigned(runEnd - node);
+            node = runEnd;
+        }
+        localsComputed.fetch_add(computed, std::memory_order_relaxed);
+    };
+    if (jobs)
+        jobs->ParallelFor(count, 16384, computeLocals);
+    else
+        computeLocals(0, count);
+    m_stats.localsComputed = localsComputed.load(std::memory_order_relaxed);
+
+    // flags and change lists: parents come first, so a moved parent has flagged its children before we get to them
+    for (auto& level : m_changedByDepth)
+        level.clear();
+    for (unsigned int node = 0; node < count; node++) {
+        const int parent = m_parents[node];
+        if (parent != NoParent && (m_dirty[parent] & WorldDirty))
+            m_dirty[node] |= WorldDirty;
+        if (m_dirty[node] & LocalDirty)
+            m_dirty[node] |= WorldDirty;
+        if (!(m_dirty[node] & WorldDirty))
+            continue;
+
+        if (m_depths[node] >= m_changedByDepth.size())
+            m_changedByDepth.resize(m_depths[node] + 1);
+        m_changedByDepth[m_depths[node]].push_back(node);
+        m_changedNodes.push_back(node);
+        if (!m_changeRanges.empty() && node - (m_changeRanges.back().first + m_changeRanges.back().count) <= m_mergeGap)
+            m_changeRanges.back().count = node - m_changeRanges.back().first + 1;
+        else
+            m_changeRanges.push_back({node, 1});
+    }
+    m_stats.worldsComputed = unsigned(m_changedNodes.size());
+
+    // world matrices and bounds, the nodes of one level are independent of each other
+    for (const auto& level : m_changedByDepth) {
+        auto computeWorlds = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                const unsigned int node = level[i];
+                const int parent = m_parents[node];
+                m_worldMatrices[node] = parent == NoParent ? m_localMatrices[node] : m_worldMatrices[parent] * m_localMatrices[node];
+                m_worldBounds[node] = TransformBounds(m_worldMatrices[node], m_localBounds[node]);
+            }
+        };
+        if (jobs)
+            jobs->ParallelFor(level.size(), 16384, computeWorlds);
+        else
+            computeWorlds(0, level.size());
+    }
+
+    // the flags of a parent are read by its children in the flag pass, so clear them afterwards
+    for (unsigned int node : m_changedNodes)
+        m_dirty[node] = 0;
+    m_anyDirty.store(false, std::memory_order_relaxed);
+    m_stats.changeRanges = unsigned(m_changeRanges.size());
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "Transforms.h"
+
+class JobSystem;
+
+struct WorldBounds
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// consecutive nodes whose world matrix changed in the last Update
+struct TransformChangeRange
+{
+    unsigned int first;
+    unsigned int count;
+};
+
+struct TransformUpdateStats
+{
+    unsigned int nodeCount = 0;
+    unsigned int localsComputed = 0; // local TRS -> matrix
+    unsigned int worldsComputed = 0; // parent world * local, including children of moved nodes
+    unsigned int changeRanges = 0;
+};
+
+// flat transform hierarchy: nodes live in contiguous arrays in topological order (a parent always
+// has a lower index than its children), so one forward pass over the arrays updates everything.
+// setters only flag a node, Update recomputes the flagged nodes and everything below them and
+// leaves the rest alone. The changed nodes come out as sorted index ranges, meant for uploading
+// just those parts of an instance buffer.
+// the setters may be called from several threads at once as long as each node has one writer
+class TransformHierarchy
+{
+public:
+    static constexpr int NoParent = -1;
+
+private:
+    enum DirtyFlags : std::uint8_t
+    {
+        LocalDirty = 1, // TRS changed, the local matrix has to be rebuilt
+        WorldDirty = 2, // the world matrix has to be rebuilt (set for the whole subtree in Update)
+    };
+
+    std::vector<int> m_parents;
+    std::vector<unsigned int> m_depths; // 0 for roots
+    TransformSoA m_local;
+    std::vector<glm::mat4> m_localMatrices;
+    std::vector<glm::mat4> m_worldMatrices;
+    std::vector<WorldBounds> m_localBounds;
+    std::vector<WorldBounds> m_worldBounds;
+    std::vector<std::uint8_t> m_dirty;
+    std::atomic<bool> m_anyDirty{false};
+
+    std::vector<unsigned int> m_changedNodes;
+    std::vector<std::vector<unsigned int>> m_changedByDepth; // a level only needs the levels above it, so each is one parallel pass
+    std::vector<TransformChangeRange> m_changeRanges;
+    unsigned int m_mergeGap = 4;
+    TransformUpdateStats m_stats;
+
+    void MarkDirty(unsigned int node);
+
+public:
+    // parent has to exist already, which keeps the arrays topologically sorted
+    unsigned int AddNode(int parent, const glm::vec3& position, const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                         const glm::vec3& scale = glm::vec3(1.0f));
+    void Reserve(unsigned int count);
+    // drops the nodes from nodeCount on, children come after their parents so no node is left orphaned
+    void Truncate(unsigned int nodeCount);
+
+    // no-ops when the value didn't change, so they are fine to call every frame with the UI values
+    void SetLocalPosition(unsigned int node, const glm::vec3& position);
+    void SetLocalRotation(unsigned int node, const glm::quat& rotation);
+    void SetLocalScale(unsigned int node, const glm::vec3& scale);
+    // object space box, the world box is this box transformed by the world matrix
+    void SetLocalBounds(unsigned int node, const glm::vec3& min, const glm::vec3& max);
+
+    // ranges closer than mergeGap nodes are merged, one bigger upload beats several small ones
+    inline void SetMergeGap(unsigned int nodes) { m_mergeGap = nodes; }
+
+    // jobs, when given, computes the matrices in parallel (world matrices one tree level after the other)
+    void Update(JobSystem* jobs = nullptr);
+
+    inline unsigned int GetNodeCount() const { return unsigned(m_parents.size()); }
+    inline int GetParent(unsigned int node) const { return m_parents[node]; }
+    inline const glm::mat4& GetWorldMatrix(unsigned int node) const { return m_worldMatrices[node]; }
+    inline const glm::mat4* GetWorldMatrices() const { return m_worldMatrices.data(); }
+    inline const WorldBounds& GetWorldBounds(unsigned int node) const { return m_worldBounds[node]; }
+
+    // results of the last Update, sorted by node index
+    inline const std::vector<unsigned int>& GetChangedNodes() const { return m_changedNodes; }
+    inline const std::vector<TransformChangeRange>& GetChangeRanges() const { return m_changeRanges; }
+    inline const TransformUpdateStats& GetStats() const { return m_stats; }
+};
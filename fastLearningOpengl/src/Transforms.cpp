@@ -0,0 +1,172 @@
+#include "Transforms.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define TRANSFORMS_SSE2
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define TRANSFORMS_NEON
+#endif
+
+void TransformSoA::Resize(std::size_t count)
+{
+    for (std::vector<float>* component : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ})
+        component->resize(count, 0.0f);
+    rotationW.resize(count, 1.0f);
+    for (std::vector<float>* component : {&scaleX, &scaleY, &scaleZ})
+        component->resize(count, 1.0f);
+}
+
+std::size_t TransformSoA::Add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    std::size_t index = GetCount();
+    Resize(index + 1);
+    Set(index, position, rotation, scale);
+    return index;
+}
+
+void TransformSoA::Set(std::size_t index, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    SetPosition(index, position);
+    SetRotation(index, rotation);
+    scaleX[index] = scale.x;
+    scaleY[index] = scale.y;
+    scaleZ[index] = scale.z;
+}
+
+void TransformSoA::SetPosition(std::size_t index, const glm::vec3& position)
+{
+    positionX[index] = position.x;
+    positionY[index] = position.y;
+    positionZ[index] = position.z;
+}
+
+void TransformSoA::SetRotation(std::size_t index, const glm::quat& rotation)
+{
+    rotationX[index] = rotation.x;
+    rotationY[index] = rotation.y;
+    rotationZ[index] = rotation.z;
+    rotationW[index] = rotation.w;
+}
+
+namespace
+{
+    // the matrix math written once against a 4 lane float type, instantiated for SIMD and scalar
+#if defined(TRANSFORMS_SSE2)
+    struct Lanes
+    {
+        __m128 v;
+        static Lanes Load(const float* p) { return {_mm_loadu_ps(p)}; }
+        static Lanes Broadcast(float x) { return {_mm_set1_ps(x)}; }
+        friend Lanes operator+(Lanes a, Lanes b) { return {_mm_add_ps(a.v, b.v)}; }
+        friend Lanes operator-(Lanes a, Lanes b) { return {_mm_sub_ps(a.v, b.v)}; }
+        friend Lanes operator*(Lanes a, Lanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+    };
+
+    // a..d hold one matrix column of 4 objects (component j of object k in lane k of the j-th),
+    // transposed so every object's column can be stored in one go
+    inline void StoreColumn(float* out, std::size_t column, Lanes a, Lanes b, Lanes c, Lanes d)
+    {
+        _MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v);
+        _mm_storeu_ps(out + column * 4, a.v);
+        _mm_storeu_ps(out + 16 + column * 4, b.v);
+        _mm_storeu_ps(out + 32 + column * 4, c.v);
+        _mm_storeu_ps(out + 48 + column * 4, d.v);
+    }
+#elif defined(TRANSFORMS_NEON)
+    struct Lanes
+    {
+        float32x4_t v;
+        static Lanes Load(const float* p) { return {vld1q_f32(p)}; }
+        static Lanes Broadcast(float x) { return {vdupq_n_f32(x)}; }
+        friend Lanes operator+(Lanes a, Lanes b) { return {vaddq_f32(a.v, b.v)}; }
+        friend Lanes operator-(Lanes a, Lanes b) { return {vsubq_f32(a.v, b.v)}; }
+        friend Lanes operator*(Lanes a, Lanes b) { return {vmulq_f32(a.v, b.v)}; }
+    };
+
+    inline void StoreColumn(float* out, std::size_t column, Lanes a, Lanes b, Lanes c, Lanes d)
+    {
+        float32x4x2_t ac = vzipq_f32(a.v, c.v); // a0 c0 a1 c1 | a2 c2 a3 c3
+        float32x4x2_t bd = vzipq_f32(b.v, d.v); // b0 d0 b1 d1 | b2 d2 b3 d3
+        float32x4x2_t low = vzipq_f32(ac.val[0], bd.val[0]);  // a0 b0 c0 d0 | a1 b1 c1 d1
+        float32x4x2_t high = vzipq_f32(ac.val[1], bd.val[1]); // a2 b2 c2 d2 | a3 b3 c3 d3
+        vst1q_f32(out + column * 4, low.val[0]);
+        vst1q_f32(out + 16 + column * 4, low.val[1]);
+        vst1q_f32(out + 32 + column * 4, high.val[0]);
+        vst1q_f32(out + 48 + column * 4, high.val[1]);
+    }
+#endif
+
+    struct Scalar
+    {
+        float v;
+        static Scalar Load(const float* p) { return {*p}; }
+        static Scalar Broadcast(float x) { return {x}; }
+        friend Scalar operator+(Scalar a, Scalar b) { return {a.v + b.v}; }
+        friend Scalar operator-(Scalar a, Scalar b) { return {a.v - b.v}; }
+        friend Scalar operator*(Scalar a, Scalar b) { return {a.v * b.v}; }
+    };
+
+    inline void StoreColumn(float* out, std::size_t column, Scalar a, Scalar b, Scalar c, Scalar d)
+    {
+        out[column * 4 + 0] = a.v;
+        out[column * 4 + 1] = b.v;
+        out[column * 4 + 2] = c.v;
+        out[column * 4 + 3] = d.v;
+    }
+
+    // the objects starting at i (4 for Lanes, 1 for Scalar), written to out
+    template<typename T>
+    inline void ComputeGroup(const TransformSoA& t, std::size_t i, const glm::quat& spin, float* out)
+    {
+        // r = spin * q
+        const T sx = T::Broadcast(spin.x), sy = T::Broadcast(spin.y), sz = T::Broadcast(spin.z), sw = T::Broadcast(spin.w);
+        const T qx = T::Load(&t.rotationX[i]), qy = T::Load(&t.rotationY[i]), qz = T::Load(&t.rotationZ[i]), qw = T::Load(&t.rotationW[i]);
+        const T x = sw * qx + sx * qw + sy * qz - sz * qy;
+        const T y = sw * qy - sx * qz + sy * qw + sz * qx;
+        const T z = sw * qz + sx * qy - sy * qx + sz * qw;
+        const T w = sw * qw - sx * qx - sy * qy - sz * qz;
+
+        // rotation matrix of r (see glm::mat3_cast), every column scaled by its scale component
+        const T one = T::Broadcast(1.0f), two = T::Broadcast(2.0f), zero = T::Broadcast(0.0f);
+        const T xx = x * x, yy = y * y, zz = z * z;
+        const T xy = x * y, xz = x * z, yz = y * z;
+        const T wx = w * x, wy = w * y, wz = w * z;
+        const T scaleX = T::Load(&t.scaleX[i]), scaleY = T::Load(&t.scaleY[i]), scaleZ = T::Load(&t.scaleZ[i]);
+
+        StoreColumn(out, 0, (one - two * (yy + zz)) * scaleX, two * (xy + wz) * scaleX, two * (xz - wy) * scaleX, zero);
+        StoreColumn(out, 1, two * (xy - wz) * scaleY, (one - two * (xx + zz)) * scaleY, two * (yz + wx) * scaleY, zero);
+        StoreColumn(out, 2, two * (xz + wy) * scaleZ, two * (yz - wx) * scaleZ, (one - two * (xx + yy)) * scaleZ, zero);
+        StoreColumn(out, 3, T::Load(&t.positionX[i]), T::Load(&t.positionY[i]), T::Load(&t.positionZ[i]), one);
+    }
+}
+
+namespace Transforms
+{
+    const char* GetSimdName()
+    {
+#if defined(TRANSFORMS_SSE2)
+        return "SSE2";
+#elif defined(TRANSFORMS_NEON)
+        return "NEON";
+#else
+        return "scalar";
+#endif
+    }
+
+    void ComputeMatrices(const TransformSoA& transforms, std::size_t begin, std::size_t end, const glm::quat& spin, float* out)
+    {
+        std::size_t i = begin;
+#if defined(TRANSFORMS_SSE2) || defined(TRANSFORMS_NEON)
+        for (; i + 4 <= end; i += 4)
+            ComputeGroup<Lanes>(transforms, i, spin, out + (i - begin) * 16);
+#endif
+        ComputeMatricesScalar(transforms, i, end, spin, out + (i - begin) * 16);
+    }
+
+    void ComputeMatricesScalar(const TransformSoA& transforms, std::size_t begin, std::size_t end, const glm::quat& spin, float* out)
+    {
+        for (std::size_t i = begin; i < end; i++)
+            ComputeGroup<Scalar>(transforms, i, spin, out + (i - begin) * 16);
+    }
+}
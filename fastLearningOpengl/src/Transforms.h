@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+// object transforms as structure of arrays: one array per component, so the matrix code
+// loads the same component of 4 objects into one SIMD register
+class TransformSoA
+{
+public:
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW; // unit quaternions
+    std::vector<float> scaleX, scaleY, scaleZ;
+
+    void Resize(std::size_t count);
+    std::size_t Add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+    void Set(std::size_t index, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+    void SetPosition(std::size_t index, const glm::vec3& position);
+    void SetRotation(std::size_t index, const glm::quat& rotation);
+
+    inline std::size_t GetCount() const { return positionX.size(); }
+};
+
+namespace Transforms
+{
+    // "SSE2", "NEON" or "scalar"
+    const char* GetSimdName();
+
+    // out + 16 * (i - begin) receives translate(position) * mat4_cast(spin * rotation) * scale(scale) of object i,
+    // column major like glm::mat4. out doesn't have to be aligned, it can point into a mapped instance buffer.
+    // spin is applied to every object on top of its own rotation (identity when not needed)
+    void ComputeMatrices(const TransformSoA& transforms, std::size_t begin, std::size_t end, const glm::quat& spin, float* out);
+
+    // same without SIMD, also handles the objects left over after the last group of 4
+    void ComputeMatricesScalar(const TransformSoA& transforms, std::size_t begin, std::size_t end, const glm::quat& spin, float* out);
+}
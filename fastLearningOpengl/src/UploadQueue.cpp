@@ -0,0 +1,277 @@
+#include "UploadQueue.h"
+#include "Renderer.h"
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    constexpr std::size_t RING_ALIGNMENT = 16;
+    constexpr std::size_t TEXEL_BYTES = 4; // RGBA8
+
+    std::size_t AlignUp(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+UploadQueue::UploadQueue(std::size_t ringSize)
+    : m_ringSize(ringSize)
+{
+}
+
+bool UploadQueue::Coalesce(const Upload& upload)
+{
+    const std::size_t end = upload.offset + upload.data.size();
+    for (auto it = m_queue.begin(); it != m_queue.end();) {
+        if (it->object != upload.object || it->texture != upload.texture) {
+            ++it;
+            continue;
+        }
+        const std::size_t queuedEnd = it->offset + it->data.size();
+        // the new data covers everything still queued for that range, the old copy is pointless
+        if (upload.texture || (upload.offset <= it->offset && end >= queuedEnd)) {
+            it = m_queue.erase(it);
+            m_stats.coalesced++;
+            continue;
+        }
+        // continues it, one copy instead of two. Not if a later upload overlaps the new range: that one
+        // lands after it, the merged data would land before and be overwritten by the older bytes
+        if (queuedEnd == upload.offset && it->priority == upload.priority &&
+            std::none_of(std::next(it), m_queue.end(), [&](const Upload& later) {
+                return later.object == upload.object && !later.texture && later.offset < end &&
+                       later.offset + later.data.size() > upload.offset;
+            })) {
+            it->data.insert(it->data.end(), upload.data.begin(), upload.data.end());
+            m_stats.coalesced++;
+            return true;
+        }
+        // a partial overlap has to land after it: same priority, and the queue is FIFO within one
+        if (upload.offset < queuedEnd && end > it->offset && it->priority < upload.priority)
+            it->priority = upload.priority;
+        ++it;
+    }
+    return false;
+}
+
+void UploadQueue::EnqueueBuffer(unsigned int buffer, std::size_t offset, const void* data, std::size_t size, UploadPriority priority)
+{
+    if (size == 0)
+        return;
+    Upload upload{false, buffer, offset, 0, priority, {}};
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    upload.data.assign(bytes, bytes + size);
+    m_submittedBytes += size;
+    if (!Coalesce(upload))
+        m_queue.push_back(std::move(upload));
+}
+
+void UploadQueue::EnqueueTexture(unsigned int texture, unsigned int width, unsigned int height, const void* pixels, UploadPriority priority)
+{
+    const std::size_t size = std::size_t(width) * height * TEXEL_BYTES;
+    if (size == 0)
+        return;
+    Upload upload{true, texture, 0, width, priority, {}};
+    const unsigned char* bytes = static_cast<const unsigned char*>(pixels);
+    upload.data.assign(bytes, bytes + size);
+    m_submittedBytes += size;
+    Coalesce(upload);
+    m_queue.push_back(std::move(upload));
+}
+
+void UploadQueue::RetireRingFrames()
+{
+    while (!m_ringFrames.empty()) {
+        glCall(GLenum status = glClientWaitSync(m_ringFrames.front().fence, 0, 0));
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        glCall(glDeleteSync(m_ringFrames.front().fence));
+        m_ringUsed -= m_ringFrames.front().bytes;
+        m_ringFrames.pop_front();
+    }
+}
+
+bool UploadQueue::AllocateRing(std::size_t size, std::size_t& offset, std::size_t& frameBytes)
+{
+    std::size_t start = AlignUp(m_ringHead, RING_ALIGNMENT);
+    const bool wrap = start + size > m_ringSize;
+    if (wrap)
+        start = 0; // the tail of the ring is skipped, it counts as used until this frame retires
+    std::size_t taken = (wrap ? m_ringSize - m_ringHead : start - m_ringHead) + size;
+    if (m_ringUsed + taken > m_ringSize)
+        return false;
+    m_ringUsed += taken;
+    frameBytes += taken;
+    m_ringHead = start + size;
+    offset = start;
+    return true;
+}
+
+std::size_t UploadQueue::CopyChunk(Upload& upload, std::size_t budget, std::size_t& frameBytes)
+{
+    // no chunk takes more than a quarter of the ring, so a few frames can be in flight
+    const std::size_t maxChunk = std::min(budget, m_ringSize / 4);
+    std::size_t size = std::min(upload.data.size() - upload.done, maxChunk);
+    std::size_t rowBytes = std::size_t(upload.width) * TEXEL_BYTES;
+    if (upload.texture) {
+        // whole rows, at least one even if it's over the budget
+        size = std::max(size / rowBytes, std::size_t(1)) * rowBytes;
+        assert(rowBytes <= m_ringSize / 4);
+    }
+
+    std::size_t ringOffset = 0;
+    if (!AllocateRing(size, ringOffset, frameBytes))
+        return 0;
+
+    glCall(glBindBuffer(GL_COPY_READ_BUFFER, m_ring));
+    // unsynchronized is safe, the fences keep the GPU's part of the ring out of reach
+    glCall(void* staging = glMapBufferRange(GL_COPY_READ_BUFFER, GLintptr(ringOffset), GLsizeiptr(size),
+                                            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+    std::memcpy(staging, upload.data.data() + upload.done, size);
+    glCall(glUnmapBuffer(GL_COPY_READ_BUFFER));
+
+    if (upload.texture) {
+        GLint previous = 0;
+        glCall(glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous));
+        glCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_ring));
+        glCall(glBindTexture(GL_TEXTURE_2D, upload.object));
+        glCall(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, GLint(upload.done / rowBytes), GLsizei(upload.width), GLsizei(size / rowBytes),
+                               GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(ringOffset)));
+        glCall(glBindTexture(GL_TEXTURE_2D, GLuint(previous)));
+        glCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    } else {
+        // the copy target binding is left alone by everything else, so no vertex array is disturbed
+        glCall(glBindBuffer(GL_COPY_WRITE_BUFFER, upload.object));
+        glCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(ringOffset),
+                                   GLintptr(upload.offset + upload.done), GLsizeiptr(size)));
+    }
+    upload.done += size;
+    return size;
+}
+
+bool UploadQueue::MustWait(const Upload& upload) const
+{
+    const std::size_t begin = upload.offset + upload.done, end = upload.offset + upload.data.size();
+    return std::any_of(m_unfinished.begin(), m_unfinished.end(), [&](const Pending& pending) {
+        return pending.object == upload.object && pending.texture == upload.texture && (upload.texture || (pending.begin < end && pending.end > begin));
+    });
+}
+
+void UploadQueue::Execute()
+{
+    auto start = Clock::now();
+    if (m_ring == 0 && !m_queue.empty()) {
+        glCall(glGenBuffers(1, &m_ring));
+        glCall(glBindBuffer(GL_COPY_READ_BUFFER, m_ring));
+        glCall(glBufferData(GL_COPY_READ_BUFFER, GLsizeiptr(m_ringSize), nullptr, GL_STREAM_DRAW));
+    }
+    RetireRingFrames();
+
+    std::size_t frameBytes = 0, ringBytes = 0;
+    bool stopped = false;
+    // a chunked upload's rest goes next frame. A later one overlapping that rest has to wait too, or
+    // the older bytes would land on top of it
+    m_unfinished.clear();
+    for (int priority = int(UploadPriority::High); priority >= int(UploadPriority::Low) && !stopped; priority--) {
+        for (auto it = m_queue.begin(); it != m_queue.end() && !stopped;) {
+            if (it->priority != UploadPriority(priority)) {
+                ++it;
+                continue;
+            }
+            if (MustWait(*it)) {
+                m_unfinished.push_back({it->object, it->texture, it->offset + it->done, it->offset + it->data.size()});
+                ++it;
+                continue;
+            }
+            std::size_t copied = CopyChunk(*it, m_byteBudget - frameBytes, ringBytes);
+            if (copied == 0) {
+                m_stats.ringFull++;
+                stopped = true;
+                break;
+            }
+            frameBytes += copied;
+            if (it->done == it->data.size()) {
+                it = m_queue.erase(it);
+            } else {
+                m_unfinished.push_back({it->object, it->texture, it->offset + it->done, it->offset + it->data.size()});
+                ++it;
+            }
+            stopped = frameBytes >= m_byteBudget || MillisecondsSince(start) >= m_timeBudgetMs;
+        }
+    }
+    if (ringBytes > 0) {
+        glCall(GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        m_ringFrames.push_back({fence, ringBytes});
+    }
+
+    m_stats.frameMs = MillisecondsSince(start);
+    m_stats.frameBytes = frameBytes;
+    m_stats.submittedBytes = m_submittedBytes;
+    m_submittedBytes = 0;
+    m_stats.queuedUploads = m_queue.size();
+    m_stats.queuedBytes = 0;
+    for (const Upload& upload : m_queue)
+        m_stats.queuedBytes += upload.data.size() - upload.done;
+    // tiny frames measure mostly overhead, they'd make the estimate useless
+    if (frameBytes >= 64 * 1024) {
+        double bytesPerMs = double(frameBytes) / std::max(m_stats.frameMs, 0.001);
+        m_bytesPerMs = m_bytesPerMs == 0.0 ? bytesPerMs : m_bytesPerMs * 0.9 + bytesPerMs * 0.1;
+    }
+    m_stats.peakMs = std::max(m_stats.peakMs, m_stats.frameMs);
+    if (m_bytesPerMs > 0.0)
+        m_stats.unbudgetedPeakMs = std::max(m_stats.unbudgetedPeakMs, double(m_stats.submittedBytes) / m_bytesPerMs);
+}
+
+void UploadQueue::Cancel(unsigned int object, bool texture)
+{
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(),
+                                 [&](const Upload& upload) { return upload.object == object && upload.texture == texture; }),
+                  m_queue.end());
+}
+
+void UploadQueue::Release()
+{
+    m_queue.clear();
+    for (const RingFrame& frame : m_ringFrames) {
+        glCall(glDeleteSync(frame.fence));
+    }
+    m_ringFrames.clear();
+    m_ringUsed = m_ringHead = 0;
+    if (m_ring) {
+        glCall(glDeleteBuffers(1, &m_ring));
+        m_ring = 0;
+    }
+}
+
+void UploadQueue::DrawImGui()
+{
+    ImGui::Text("Uploads: %zu queued (%zu KB), %zu KB in %.2f ms this frame, %u coalesced", m_stats.queuedUploads,
+                m_stats.queuedBytes / 1024, m_stats.frameBytes / 1024, m_stats.frameMs, m_stats.coalesced);
+    ImGui::Text("Upload peak: %.2f ms per frame, %.2f ms without the budget (estimated), ring full %u times", m_stats.peakMs,
+                m_stats.unbudgetedPeakMs, m_stats.ringFull);
+    int budgetKb = int(m_byteBudget / 1024);
+    if (ImGui::SliderInt("Upload budget (KB)", &budgetKb, 64, 16384, "%d", ImGuiSliderFlags_Logarithmic))
+        m_byteBudget = std::size_t(budgetKb) * 1024;
+    float budgetMs = float(m_timeBudgetMs);
+    if (ImGui::SliderFloat("Upload budget (ms)", &budgetMs, 0.1f, 8.0f))
+        m_timeBudgetMs = budgetMs;
+}
+
+namespace Uploads
+{
+    UploadQueue& Get()
+    {
+        static UploadQueue s_queue;
+        return s_queue;
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <glad/glad.h>
+
+enum class UploadPriority
+{
+    Low,    // streaming in content nobody waits for
+    Normal,
+    High    // needed for this frame's draws, goes first
+};
+
+struct UploadStats
+{
+    std::size_t queuedUploads = 0; // after this frame's Execute
+    std::size_t queuedBytes = 0;
+    std::size_t frameBytes = 0;    // copied this frame
+    double frameMs = 0.0;
+    std::size_t submittedBytes = 0; // enqueued since the previous Execute
+    unsigned int coalesced = 0;     // uploads merged into or replaced by a later one, all time
+    unsigned int ringFull = 0;      // frames that stopped early because the staging ring was still in use
+    double peakMs = 0.0;            // the worst frame so far
+    double unbudgetedPeakMs = 0.0;  // the worst frame if everything had been uploaded the frame it was enqueued (estimated)
+};
+
+// buffer and texture uploads queued during the frame and copied in Execute, within a byte and a time
+// budget. Data goes through a ring of staging memory (a pixel unpack / copy source buffer), so the
+// copies into the destination happen on the GPU and the CPU only pays for the memcpy.
+// Bigger uploads are split into chunks that spread over several frames, a new upload of a range that
+// is still queued replaces it, and one that continues a queued range is appended to it
+class UploadQueue
+{
+public:
+    static constexpr std::size_t DefaultRingSize = 16 * 1024 * 1024;
+
+private:
+    struct Upload
+    {
+        bool texture;
+        unsigned int object;        // buffer or texture id
+        std::size_t offset;         // bytes into the buffer, 0 for a texture
+        unsigned int width = 0;     // textures: RGBA8 rows of width texels, chunks are whole rows
+        UploadPriority priority;
+        std::vector<unsigned char> data;
+        std::size_t done = 0;       // bytes already copied
+    };
+    struct RingFrame
+    {
+        GLsync fence;
+        std::size_t bytes;          // ring bytes the frame used, wrap-around waste included
+    };
+
+    struct Pending
+    {
+        unsigned int object;
+        bool texture;
+        std::size_t begin, end;     // bytes still to copy
+    };
+
+    std::deque<Upload> m_queue;
+    std::vector<Pending> m_unfinished;  // in Execute: uploads left partly or wholly uncopied, later overlapping ones wait for them
+    unsigned int m_ring = 0;
+    std::size_t m_ringSize;
+    std::size_t m_ringHead = 0;
+    std::size_t m_ringUsed = 0;
+    std::deque<RingFrame> m_ringFrames; // not yet retired, oldest first
+    std::size_t m_submittedBytes = 0;
+    std::size_t m_byteBudget = 4 * 1024 * 1024;
+    double m_timeBudgetMs = 2.0;
+    double m_bytesPerMs = 0.0;          // measured, for the unbudgeted estimate
+    UploadStats m_stats;
+
+    bool Coalesce(const Upload& upload);
+    // whether an upload left unfinished earlier this Execute overlaps what's left of this one
+    bool MustWait(const Upload& upload) const;
+    void RetireRingFrames();
+    // offset in the ring for size bytes, false if it's still in use by the GPU
+    bool AllocateRing(std::size_t size, std::size_t& offset, std::size_t& frameBytes);
+    std::size_t CopyChunk(Upload& upload, std::size_t budget, std::size_t& frameBytes);
+
+public:
+    explicit UploadQueue(std::size_t ringSize = DefaultRingSize);
+    ~UploadQueue() = default;
+    UploadQueue(const UploadQueue&) = delete;
+    UploadQueue& operator=(const UploadQueue&) = delete;
+
+    // size bytes at offset of buffer. The data is copied, it may go away right after
+    void EnqueueBuffer(unsigned int buffer, std::size_t offset, const void* data, std::size_t size, UploadPriority priority = UploadPriority::Normal);
+    // the whole of an RGBA8 texture whose storage already exists (glTexImage2D with no data)
+    void EnqueueTexture(unsigned int texture, unsigned int width, unsigned int height, const void* pixels, UploadPriority priority = UploadPriority::Normal);
+
+    // once per frame before drawing: copies in priority order until a budget is used up
+    void Execute();
+    // uploads of a destination that is deleted have to go first
+    void Cancel(unsigned int object, bool texture);
+    // drops the queue and deletes the staging ring. Call before the GL context goes away
+    void Release();
+
+    inline void SetByteBudget(std::size_t bytes) { m_byteBudget = bytes; }
+    inline void SetTimeBudget(double ms) { m_timeBudgetMs = ms; }
+    inline std::size_t GetByteBudget() const { return m_byteBudget; }
+    inline double GetTimeBudget() const { return m_timeBudgetMs; }
+    inline bool IsIdle() const { return m_queue.empty(); }
+    inline const UploadStats& GetStats() const { return m_stats; }
+
+    // its settings and stats, drawn into the application's Settings window
+    void DrawImGui();
+};
+
+// the application wide queue, created on first use (on the GL thread), Execute runs every frame
+namespace Uploads
+{
+    UploadQueue& Get();
+}
@@ -1,6 +1,7 @@
 #include "VertexArray.h"
 #include "Renderer.h"
 #include "VertexBufferLayout.h"
+#include <cstdint>
 
 VertexArray::VertexArray() {
 
@@ -22,10 +23,15 @@ void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& la
     unsigned int offset = 0;
     for (unsigned int i = 0; i < elements.size(); i++) {
         const auto& element = elements[i];
-        glCall(glEnableVertexAttribArray(i));
-        glCall(glVertexAttribPointer(i, element.count, element.type, element.normalized, layout.GetStride(), (const void*)offset));
+        const unsigned int index = m_AttributeCount + i;
+        glCall(glEnableVertexAttribArray(index));
+        glCall(glVertexAttribPointer(index, element.count, element.type, element.normalized, layout.GetStride(), (const void*)(uintptr_t)offset));
+        if (element.divisor) {
+            glCall(glVertexAttribDivisor(index, element.divisor));
+        }
         offset += element.count * GetSizeOfType(element.type);
     }
+    m_AttributeCount += unsigned(elements.size());
 }
 
 void VertexArray::Bind() const {
@@ -7,6 +7,7 @@ class VertexBufferLayout; // forward declaration to avoid circular dependency
 class VertexArray{
 private:
     unsigned int m_RendererID;
+    unsigned int m_AttributeCount = 0; // attributes of earlier AddBuffer calls, the next buffer continues after them
 public:
     VertexArray();
     ~VertexArray();
@@ -14,6 +15,7 @@ public:
     void Bind() const;
     void Unbind() const;
 
+    // can be called once per buffer, e.g. per vertex data first and a per instance buffer after it
     void AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& vbl);
 
 };
\ No newline at end of file
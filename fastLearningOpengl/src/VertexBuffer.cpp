@@ -1,11 +1,13 @@
 #include "VertexBuffer.h"
 #include "Renderer.h"
+#include <iostream>
 
-VertexBuffer::VertexBuffer(const void* dataptr, unsigned int size)
+VertexBuffer::VertexBuffer(const void* dataptr, unsigned int size, bool streaming)
+    : m_Size(size)
 {
     glCall(glGenBuffers(1, &m_RendererID));
     glCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
-    glCall(glBufferData(GL_ARRAY_BUFFER, size, dataptr, GL_STATIC_DRAW));
+    glCall(glBufferData(GL_ARRAY_BUFFER, size, dataptr, streaming ? GL_STREAM_DRAW : GL_STATIC_DRAW));
 
 }
 
@@ -24,8 +26,26 @@ void VertexBuffer::Unbind() const
     glCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
 }
 
-void VertexBuffer::BufferSubData(void* data, unsigned int size)
+void VertexBuffer::BufferSubData(const void* data, unsigned int size, unsigned int offset)
 {
+    assert(offset + size <= m_Size);
     glCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
-    glCall(glBufferSubData(GL_ARRAY_BUFFER, 0, size, data));
-}
\ No newline at end of file
+    glCall(glBufferSubData(GL_ARRAY_BUFFER, offset, size, data));
+}
+
+void* VertexBuffer::Map(unsigned int offset, unsigned int size, bool orphan)
+{
+    assert(offset + size <= m_Size);
+    GLbitfield access = GL_MAP_WRITE_BIT | (orphan ? GL_MAP_INVALIDATE_BUFFER_BIT : GL_MAP_INVALIDATE_RANGE_BIT);
+    glCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+    glCall(void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, access));
+    return ptr;
+}
+
+void VertexBuffer::Unmap()
+{
+    glCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+    glCall(GLboolean intact = glUnmapBuffer(GL_ARRAY_BUFFER));
+    if (!intact)
+        std::cout << "Error (BUFFER): vertex buffer contents were lost while mapped" << std::endl;
+}
@@ -4,12 +4,21 @@ class VertexBuffer{
     private:
         unsigned int m_RendererID; // vertex buffer id cuz opengl need some numeric id to keep track of every object we create | UNIQUE that identifies the object
                                    // internal renderer ID
+        unsigned int m_Size;
     public:
-        VertexBuffer(const void* dataptr, unsigned int size); // constructor
+        VertexBuffer(const void* dataptr, unsigned int size, bool streaming = false); // constructor, streaming = rewritten every frame
         ~VertexBuffer(); // destructor
         void Bind() const; // bind the vertex buffer
         void Unbind() const; // unbind the vertex buffer
-        void BufferSubData(void* data, unsigned int size); // set the data of the vertex buffer
+        void BufferSubData(const void* data, unsigned int size, unsigned int offset = 0); // set the data of the vertex buffer (from offset bytes on)
+
+        // maps [offset, offset + size) for writing only. orphan hands the old storage back to the driver first,
+        // so the GPU can keep reading last frame's vertices while the new ones are written (no sync stall)
+        void* Map(unsigned int offset, unsigned int size, bool orphan = true);
+        void Unmap();
+
+        inline unsigned int GetSize() const { return m_Size; }
+        inline unsigned int GetRendererID() const { return m_RendererID; }
 
 
 };
\ No newline at end of file
@@ -24,6 +24,7 @@ struct VertexBufferElement
 	unsigned int type;
 	unsigned int count;
 	unsigned char normalized;
+	unsigned int divisor; // 0 per vertex, 1 per instance
 };
 
 class VertexBufferLayout
@@ -34,17 +35,18 @@ class VertexBufferLayout
 public:
 	VertexBufferLayout() {}
 
-	template<class T> void Push(unsigned int count); // { static_assert(false); } -> disable cuz gcc and Clang triggers static_assert
+	// divisor 1 makes the attribute advance once per instance instead of once per vertex
+	template<class T> void Push(unsigned int count, unsigned int divisor = 0); // { static_assert(false); } -> disable cuz gcc and Clang triggers static_assert
 
 	const std::vector<VertexBufferElement> &GetElements() const& { return m_elements; }
 	unsigned int GetStride() const { return m_stride; }
 
 };
 
-template<> inline void VertexBufferLayout::Push<float>(unsigned int count) {
-     m_elements.push_back({ GL_FLOAT, count, GL_FALSE });  m_stride += GetSizeOfType(GL_FLOAT) * count; }
-template<> inline void VertexBufferLayout::Push<unsigned int>(unsigned int count) {
-     m_elements.push_back({ GL_UNSIGNED_INT, count, GL_FALSE }); m_stride += GetSizeOfType(GL_UNSIGNED_INT) * count; }
-template<> inline void VertexBufferLayout::Push<unsigned char>(unsigned int count) {
-     m_elements.push_back({ GL_UNSIGNED_BYTE, count, GL_TRUE }); m_stride += GetSizeOfType(GL_UNSIGNED_BYTE) * count; }
+template<> inline void VertexBufferLayout::Push<float>(unsigned int count, unsigned int divisor) {
+     m_elements.push_back({ GL_FLOAT, count, GL_FALSE, divisor });  m_stride += GetSizeOfType(GL_FLOAT) * count; }
+template<> inline void VertexBufferLayout::Push<unsigned int>(unsigned int count, unsigned int divisor) {
+     m_elements.push_back({ GL_UNSIGNED_INT, count, GL_FALSE, divisor }); m_stride += GetSizeOfType(GL_UNSIGNED_INT) * count; }
+template<> inline void VertexBufferLayout::Push<unsigned char>(unsigned int count, unsigned int divisor) {
+     m_elements.push_back({ GL_UNSIGNED_BYTE, count, GL_TRUE, divisor }); m_stride += GetSizeOfType(GL_UNSIGNED_BYTE) * count; }
 
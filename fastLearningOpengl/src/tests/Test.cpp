@@ -1,5 +1,6 @@
 #include "Test.h"
 #include "imgui.h"
+#include <chrono>
 
 
 namespace test{
@@ -16,9 +17,13 @@ namespace test{
         {
             if (ImGui::Button(test.first.c_str()))
             {
+                auto start = std::chrono::steady_clock::now();
                 m_CurrentTest = test.second();
+                m_LastSwitchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
             } 
         }
+        if (m_LastSwitchMs > 0.0)
+            ImGui::Text("Last test switch: %.2f ms", m_LastSwitchMs);
     };
 
 }
\ No newline at end of file
@@ -4,14 +4,21 @@
 #include <functional>
 #include <iostream>
 
+struct InputEvent;
+
 namespace test{
     class Test{
         public:
             Test(){};
             virtual ~Test(){};
+            // simulation, called at the fixed rate of Time::Get(): zero, one or several times a frame
+            virtual void OnFixedUpdate(float step) {};
+            // once per frame before OnRender, deltaTime is the frame's
             virtual void OnUpdate(float deltaTime) {};
             virtual void OnRender() {};
             virtual void OnImGuiRender() {};
+            // every input event of the frame, in order, before OnFixedUpdate and OnUpdate
+            virtual void OnEvent(const InputEvent& event) {};
     };
     class TestMenu : public Test{
         public:
@@ -28,6 +35,7 @@ namespace test{
 
         private:
             Test*& m_CurrentTest; // menu's going to change the current active test
+            double m_LastSwitchMs = 0.0; // constructing the last opened test, shaders included
             std::vector<std::pair<std::string, std::function<Test*()>>> m_Tests;
     };
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "TestBatching.h"
+#include "ShaderLibrary.h"
+#include "UploadQueue.h"
 
 #include "Renderer.h"
 #include "VertexBufferLayout.h"
@@ -74,13 +76,13 @@ Batching::Batching()
     m_indexBuffer = std::make_unique<ElementIndexBuffer>(batched_indices.data(), 
                                                          unsigned(batched_indices.size()));
 
-    m_shader = std::make_unique<Shader>("res/Shaders/BatchColor.shader"); // Ensure this shader exists and is compatible
-    m_texture0 = std::make_unique<Texture>("res/Textures/cute.png");   // Ensure this texture exists
+    m_shader = Shaders::Get().Get("res/Shaders/BatchColor.shader"); // Ensure this shader exists and is compatible
+    m_texture0 = std::make_unique<Texture>("res/Textures/cute.png", &Uploads::Get());   // Ensure this texture exists
 
     m_shader->Bind();
     m_texture0->Bind(0); // Bind texture to slot 0
     //m_shader->SetUniform1i("u_Texture", 0); // Tell shader to use texture slot 0
-    m_texture1 = std::make_unique<Texture>("res/Textures/ChernoLogo.png"); // Ensure this texture exists
+    m_texture1 = std::make_unique<Texture>("res/Textures/ChernoLogo.png", &Uploads::Get()); // Ensure this texture exists
     m_texture1->Bind(1); // Bind texture to slot 1
 
 
@@ -109,7 +111,8 @@ void Batching::OnRender()
     glm::mat4 model = glm::translate(glm::mat4(1.0f), m_translation);
     glm::mat4 mvp = m_proj * m_view * model;
     m_shader->SetUniformMat4f("u_MVP", mvp);
-    m_shader->SetUniformVec1i("u_Textures", std::vector<int>{0, 1}); // Set texture IDs for the shader
+    const int textureSlots[] = {0, 1};
+    m_shader->SetUniform1iv("u_Textures", textureSlots, 2); // Set texture IDs for the shader
 
     m_renderer.Draw(*m_vao, *m_indexBuffer, *m_shader);
 }
@@ -33,7 +33,7 @@ private:
     std::unique_ptr<VertexArray> m_vao;
     std::unique_ptr<ElementIndexBuffer> m_indexBuffer;
     std::unique_ptr<VertexBuffer> m_vertexBuffer;
-    std::unique_ptr<Shader> m_shader;
+    std::shared_ptr<Shader> m_shader;
     std::unique_ptr<Texture> m_texture0;
     std::unique_ptr<Texture> m_texture1;
 
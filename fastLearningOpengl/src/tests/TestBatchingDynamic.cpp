@@ -1,13 +1,15 @@
 #include "TestBatchingDynamic.h"
+#include "ShaderLibrary.h"
+#include "UploadQueue.h"
 
 #include "Renderer.h"
-#include "VertexBufferLayout.h"
 #include "imgui/imgui.h"
 #include "Texture.h"
+#include "JobSystem.h"
 
-#include <tuple>
-#include <vector>
-#include <algorithm> // For std::transform if needed, or manual loop for clarity
+#include <algorithm>
+#include <random>
+#include <thread>
 
 namespace test
 {
@@ -18,34 +20,18 @@ BatchingDynamic::BatchingDynamic()
       m_view(glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, 0))),
       m_translation(200.0f, 150.0f, 0.0f)
 {
+    // vertex buffer (streamed), layout and the static quad indices all live in the batch builder
+    m_batch = std::make_unique<BatchBuilder>(MaxSprites);
 
-    m_vao = std::make_unique<VertexArray>();
-    m_vao->Bind();
-
-    constexpr auto magic_count = 1000u; // magic number for the allocated number of vertices!
-
-    m_vertexBuffer = std::make_unique<VertexBuffer>(nullptr, sizeof(BatchingDynamic::Vertex) * magic_count);
-    m_vertexBuffer->Bind();
-
-
-    VertexBufferLayout layout;
-    layout.Push<float>(std::tuple_size_v<decltype(Vertex::position)>); // 3 floats for position (x, y, z)
-    layout.Push<float>(std::tuple_size_v<decltype(Vertex::texCoords)>); // 2 floats for texture coordinates (u, v)
-    layout.Push<float>(std::tuple_size_v<decltype(Vertex::color)>); // 4 floats for color (r, g, b, a)
-    layout.Push<float>(1); // texture id
-
-    m_vao->AddBuffer(*m_vertexBuffer, layout); 
-
-    
-    m_shader = std::make_unique<Shader>("res/Shaders/BatchColor.shader"); 
+    m_shader = Shaders::Get().Get("res/Shaders/BatchColor.shader"); 
     m_shader->Bind();
-    m_texture0 = std::make_unique<Texture>("res/Textures/cute.png");
+    m_texture0 = std::make_unique<Texture>("res/Textures/cute.png", &Uploads::Get());
     m_texture0->Bind(0); // Bind texture to slot 0
     //m_shader->SetUniform1i("u_Texture", 0); // Tell shader to use texture slot 0
-    m_texture1 = std::make_unique<Texture>("res/Textures/ChernoLogo.png"); 
+    m_texture1 = std::make_unique<Texture>("res/Textures/ChernoLogo.png", &Uploads::Get()); 
     m_texture1->Bind(1); 
 
-
+    ScatterSprites();
 }
 
 BatchingDynamic::~BatchingDynamic()
@@ -53,29 +39,76 @@ BatchingDynamic::~BatchingDynamic()
     // Unique_ptrs will handle deletion
 }
 
-void BatchingDynamic::OnUpdate([[maybe_unused]] float deltaTime)
+void BatchingDynamic::ScatterSprites()
 {
-    // No per-frame updates needed for this simple example beyond ImGui interaction
-        // bam i used it 
-    auto q0 = CreateQuad(m_quad0position[0], m_quad0position[1], 50.0f, 0.0f);
-    auto q1 = CreateQuad(m_quad1position[0], m_quad1position[1], 50.0f, 1.0f);
-    // maybe ill update this to be dynamic later
-
-    std::vector<Vertex> batched_pos(q0.size() + q1.size()); // Reserve space for the combined vertices
-    memcpy(batched_pos.data()/*            */, q0.data(), q0.size() * sizeof(Vertex));
-    memcpy(batched_pos.data() + q0.size(), q1.data(), q1.size() * sizeof(Vertex));
-
-    std::vector<unsigned int>quad0_indices = {0, 1, 2, 2, 3, 0};
-    std::vector<unsigned int>quad1_indices = {0, 1, 2, 2, 3, 0};
-
+    m_sprites.resize(MaxSprites);
+    m_spinSpeeds.resize(MaxSprites);
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (unsigned int i = 0; i < MaxSprites; i++) {
+        Sprite& sprite = m_sprites[i];
+        sprite.position[0] = unit(random) * 960.0f - m_translation.x;
+        sprite.position[1] = unit(random) * 540.0f - m_translation.y;
+        sprite.size = 6.0f + unit(random) * 18.0f;
+        sprite.rotation = unit(random) * 6.2831853f;
+        sprite.color[0] = sprite.color[1] = sprite.color[2] = sprite.color[3] = 1.0f;
+        sprite.textureID = float(i & 1);
+        m_spinSpeeds[i] = (unit(random) - 0.5f) * 4.0f;
+    }
+
+    // the two original quads, 50x50 with the slider at their lower left corner
+    for (unsigned int i = 0; i < 2; i++) {
+        m_sprites[i].size = 50.0f;
+        m_sprites[i].rotation = 0.0f;
+        m_sprites[i].textureID = float(i);
+        m_spinSpeeds[i] = 0.0f;
+    }
+}
 
-    std::vector<unsigned int> batched_indices(quad0_indices);
-    std::transform(quad1_indices.begin(), quad1_indices.end(), std::back_inserter(batched_indices),
-                   [&](const auto &val){return val + q0.size();});
-                   //[offset = quad1_indices.size()](unsigned int index) { return index + offset; });
+void BatchingDynamic::OnUpdate(float deltaTime)
+{
+    m_sprites[0].position[0] = m_quad0position[0] + 25.0f;
+    m_sprites[0].position[1] = m_quad0position[1] + 25.0f;
+    m_sprites[1].position[0] = m_quad1position[0] + 25.0f;
+    m_sprites[1].position[1] = m_quad1position[1] + 25.0f;
+
+    const unsigned int count = unsigned(m_spriteCount);
+    JobSystem* jobs = m_useJobs ? &Jobs::Get() : nullptr;
+    if (m_animate) {
+        Sprite* sprites = m_sprites.data();
+        const float* speeds = m_spinSpeeds.data();
+        auto spin = [=](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++)
+                sprites[i].rotation += speeds[i] * deltaTime;
+        };
+        if (jobs)
+            jobs->ParallelFor(count, 16384, spin);
+        else
+            spin(0, count);
+    }
+
+    // the batch translation moves everything, cull against the window in sprite space
+    glm::vec4 cullRect(-m_translation.x, -m_translation.y, 960.0f - m_translation.x, 540.0f - m_translation.y);
+    m_batch->Build(m_sprites.data(), count, cullRect, jobs);
+}
 
-    m_indexBuffer = std::make_unique<ElementIndexBuffer>(batched_indices.data(), unsigned(batched_indices.size()));
-    m_vertexBuffer->BufferSubData(batched_pos.data(), unsigned(batched_pos.size() * sizeof(Vertex)));
+void BatchingDynamic::RunThroughputBenchmark()
+{
+    // everything visible, so every sprite turns into a quad
+    const glm::vec4 everything(-1e9f, -1e9f, 1e9f, 1e9f);
+    constexpr int repeats = 10;
+
+    m_throughput.clear();
+    const unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads = 1; threads <= maxThreads; threads++) {
+        JobSystem jobs(threads - 1);
+        double best = 1e30;
+        for (int i = 0; i < repeats; i++) {
+            m_batch->Build(m_sprites.data(), MaxSprites, everything, &jobs);
+            best = std::min(best, m_batch->GetStats().totalMs);
+        }
+        m_throughput.push_back({threads, best, m_batch->GetQuadCount() / (best / 1000.0)});
+    }
 }
 
 void BatchingDynamic::OnRender()
@@ -90,12 +123,12 @@ void BatchingDynamic::OnRender()
     glm::mat4 model = glm::translate(glm::mat4(1.0f), m_translation);
     glm::mat4 mvp = m_proj * m_view * model;
     m_shader->SetUniformMat4f("u_MVP", mvp);
-    m_shader->SetUniformVec1i("u_Textures", std::vector<int>{0, 1}); // Set texture IDs for the shader
-    m_vao->Bind();
-    m_indexBuffer->Bind();
-    m_shader->Bind();
+    const int textureSlots[] = {0, 1};
+    m_shader->SetUniform1iv("u_Textures", textureSlots, 2); // Set texture IDs for the shader
 
-    m_renderer.Draw(*m_vao, *m_indexBuffer, *m_shader);
+    // the partitions are contiguous, so the whole batch is still a single draw
+    if (m_batch->GetQuadCount() > 0)
+        m_renderer.Draw(m_batch->GetVertexArray(), m_batch->GetIndexBuffer(), *m_shader, m_batch->GetIndexCount(), 0);
 }
 
 void BatchingDynamic::OnImGuiRender()
@@ -104,6 +137,36 @@ void BatchingDynamic::OnImGuiRender()
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
     ImGui::SliderFloat2("Quad 1 'C'", m_quad0position, 0.0f, 960.0f);
 	ImGui::SliderFloat2("Quad 2 'H'", m_quad1position, 0.0f, 960.0f);
+
+    ImGui::Separator();
+    ImGui::SliderInt("Sprites", &m_spriteCount, 2, int(MaxSprites));
+    ImGui::Checkbox("Animate", &m_animate);
+    ImGui::SameLine();
+    ImGui::Checkbox("Build on the job system", &m_useJobs);
+    const BatchBuildStats& stats = m_batch->GetStats();
+    ImGui::Text("%u quads after culling, %u partitions", stats.quadCount, stats.partitionCount);
+    ImGui::Text("Build %.3f ms (cull + prefix sum %.3f ms, vertices %.3f ms)", stats.totalMs, stats.countMs, stats.writeMs);
+
+    if (ImGui::Button("Run throughput benchmark"))
+        RunThroughputBenchmark();
+    ImGui::SameLine();
+    ImGui::Text("%u sprites, best of 10", MaxSprites);
+    if (!m_throughput.empty() && ImGui::BeginTable("throughput", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("threads");
+        ImGui::TableSetupColumn("build ms");
+        ImGui::TableSetupColumn("Mquads/s (speedup)");
+        ImGui::TableHeadersRow();
+        for (const ThroughputResult& result : m_throughput) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", result.threads);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", result.buildMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f (%.2fx)", result.quadsPerSecond / 1e6, result.quadsPerSecond / m_throughput.front().quadsPerSecond);
+        }
+        ImGui::EndTable();
+    }
 }
 
-} // namespace test
\ No newline at end of file
+} // namespace test
@@ -4,12 +4,10 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include <memory>
-// #include <vector> // Not strictly needed in the header if only used in .cpp
+#include <vector>
 
 // Include necessary headers directly
-#include "VertexArray.h"
-#include "ElementIndexBuffer.h"
-#include "VertexBuffer.h"
+#include "BatchBuilder.h"
 #include "Shader.h"
 #include "Texture.h"
 #include "Renderer.h" // Renderer is used as a member
@@ -27,33 +25,22 @@ public:
     void OnRender() override;
     void OnImGuiRender() override;
 
-        
-    struct Vertex
-    {
-        std::array<float, 3> position {0.0f, 0.0f, 0.0f}; // X, Y, Z
-        std::array<float, 2> texCoords{0.0f, 0.0f}; // U, V
-        std::array<float, 4> color {0.0f, 0.0f, 0.0f, 0.0f}; // R, G, B, A
-        float textureID; // Texture ID
-    };
+    // sprites 0 and 1 are the two slider controlled quads, the rest are generated for load
+    static constexpr unsigned int MaxSprites = 1u << 18;
 
-    // im too lazy to change this
-    static std::array<Vertex, 4> CreateQuad(float x, float y, float size, float textureID)
-    {   
-        size = 50.0f; // TODO: remove this
-        // legend : x, y, z, u, v, r, g, b, a, ID
-        Vertex v0 = {{x, y, 0.0f}, {0.0f, 0.0f}, {1.0f, 1.0f, 1.0f, 1.0f}, textureID};
-        Vertex v1 = {{x + size, y, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f, 1.0f, 1.0f}, textureID};
-        Vertex v2 = {{x + size, y + size, 0.0f}, {1.0f, 1.0f}, {1.0f, 1.0f, 1.0f, 1.0f}, textureID};
-        Vertex v3 = {{x, y + size, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f, 1.0f, 1.0f}, textureID};
-        return {v0, v1, v2, v3};
+private:
+    struct ThroughputResult
+    {
+        unsigned int threads;
+        double buildMs;
+        double quadsPerSecond;
     };
 
+    void ScatterSprites();
+    void RunThroughputBenchmark();
 
-private:
-    std::unique_ptr<VertexArray> m_vao;
-    std::unique_ptr<ElementIndexBuffer> m_indexBuffer;
-    std::unique_ptr<VertexBuffer> m_vertexBuffer;
-    std::unique_ptr<Shader> m_shader;
+    std::unique_ptr<BatchBuilder> m_batch;
+    std::shared_ptr<Shader> m_shader;
     std::unique_ptr<Texture> m_texture0;
     std::unique_ptr<Texture> m_texture1;
 
@@ -64,6 +51,13 @@ private:
     Renderer m_renderer; // Renderer member
     float m_quad0position[2] = {100.0f, 50.0f};
     float m_quad1position[2] = {350.0f, 50.0f};
+
+    std::vector<Sprite> m_sprites;
+    std::vector<float> m_spinSpeeds;
+    int m_spriteCount = 2;
+    bool m_animate = true;
+    bool m_useJobs = true;
+    std::vector<ThroughputResult> m_throughput;
 };
 
 } // namespace test
\ No newline at end of file
@@ -1,11 +1,14 @@
 #include "TestBatchingDynamic3D.h"
+#include "ShaderLibrary.h"
+#include "UploadQueue.h"
 
 #include "Renderer.h"
 #include "VertexBufferLayout.h"
 #include "imgui/imgui.h"
 #include "Texture.h"
+#include "Allocators.h"
 #include "glm/gtc/matrix_transform.hpp" // For glm::lookAt and glm::perspective
-#include "GLFW/glfw3.h" // For glfwGetTime
+#include "FrameClock.h"
 #include <tuple>
 #include <vector>
 #include <algorithm> 
@@ -60,28 +63,64 @@ BatchingDynamic3D::BatchingDynamic3D()
 
     m_vao->AddBuffer(*m_vertexBuffer, layout); 
 
+    // the cube topology never changes (size and color only touch the vertices), so the indices are uploaded once
+    unsigned int single_cube_indices[36];
+    for (unsigned int i = 0; i < 6; ++i) { // For each of the 6 faces
+        single_cube_indices[i * 6 + 0] = i * 4 + 0;
+        single_cube_indices[i * 6 + 1] = i * 4 + 1;
+        single_cube_indices[i * 6 + 2] = i * 4 + 2;
+        single_cube_indices[i * 6 + 3] = i * 4 + 2;
+        single_cube_indices[i * 6 + 4] = i * 4 + 3;
+        single_cube_indices[i * 6 + 5] = i * 4 + 0;
+    }
+    m_indexBuffer = std::make_unique<ElementIndexBuffer>(single_cube_indices, 36);
+
+    // the prepass reads 12 bytes a vertex instead of 40, the same positions as m_vertexBuffer
+    m_depthVao = std::make_unique<VertexArray>();
+    m_positionBuffer = std::make_unique<VertexBuffer>(nullptr, unsigned(sizeof(glm::vec3) * 24));
+    VertexBufferLayout positionLayout;
+    positionLayout.Push<float>(3);
+    m_depthVao->AddBuffer(*m_positionBuffer, positionLayout);
+    m_depthVao->Unbind();
+
     
-    m_shader = std::make_unique<Shader>("res/Shaders/BatchColor3D.shader"); 
+    m_shader = Shaders::Get().Get("res/Shaders/BatchColor3D.shader"); 
+    m_depthShader = Shaders::Get().Get("res/Shaders/BatchColor3D.shader", {"DEPTH_ONLY"});
     m_shader->Bind();
-    m_texture0 = std::make_unique<Texture>("res/Textures/cute.png");
+    m_texture0 = std::make_unique<Texture>("res/Textures/cute.png", &Uploads::Get());
     m_texture0->Bind(0); // Bind texture to slot 0
     // m_shader->SetUniform1i("u_Texture", 0); // Tell shader to use texture slot 0 OLD UNUSED
-    m_texture1 = std::make_unique<Texture>("res/Textures/ChernoLogo.png"); 
+    m_texture1 = std::make_unique<Texture>("res/Textures/ChernoLogo.png", &Uploads::Get()); 
     m_texture1->Bind(1); 
 }
 
 BatchingDynamic3D::~BatchingDynamic3D()
 {
     // Unique_ptrs will handle deletion
+    for (FrameQueries& frame : m_queries) {
+        if (frame.samples) {
+            glCall(glDeleteQueries(1, &frame.samples));
+            glCall(glDeleteQueries(1, &frame.time));
+        }
+    }
     glCall(glDisable(GL_DEPTH_TEST)); // Disable depth test when this test is exited
 }
 
-void BatchingDynamic3D::OnUpdate([[maybe_unused]] float deltaTime)
+void BatchingDynamic3D::SetDepthLayers(int layers)
 {
-    std::vector<Vertex> batched_pos;
-    std::vector<unsigned int> batched_indices;
-    unsigned int current_offset = 0;
+    m_depthLayers = layers;
+    m_cubeOffsets.resize(9); // the hand placed ones
+    // 5 x 5 cubes a layer, overlapping on screen from most directions of the orbit
+    for (int layer = 0; layer < layers; layer++) {
+        for (int y = -2; y <= 2; y++) {
+            for (int x = -2; x <= 2; x++)
+                m_cubeOffsets.emplace_back(float(x) * 1.1f, float(y) * 1.1f, -2.0f - float(layer) * 1.1f);
+        }
+    }
+}
 
+void BatchingDynamic3D::OnUpdate([[maybe_unused]] float deltaTime)
+{
     // Create the 6 faces for a single cube template (centered at origin conceptually for CreateQuad)
     // The actual positioning will be handled by the model matrix in OnRender
     auto q_front  = CreateQuad(glm::vec3(0.0f), m_cubeSize, CubeFace::Front, 0, m_cubeColor);
@@ -91,7 +130,8 @@ void BatchingDynamic3D::OnUpdate([[maybe_unused]] float deltaTime)
     auto q_top    = CreateQuad(glm::vec3(0.0f), m_cubeSize, CubeFace::Top, 0, m_cubeColor);
     auto q_bottom = CreateQuad(glm::vec3(0.0f), m_cubeSize, CubeFace::Bottom, 0, m_cubeColor);
 
-    std::vector<Vertex> single_cube_vertices;
+    // frame arena: no heap allocation, released by the main loop after the frame
+    auto single_cube_vertices = MakeFrameVector<Vertex>(24);
     single_cube_vertices.insert(single_cube_vertices.end(), q_front.begin(), q_front.end());
     single_cube_vertices.insert(single_cube_vertices.end(), q_back.begin(), q_back.end());
     single_cube_vertices.insert(single_cube_vertices.end(), q_left.begin(), q_left.end());
@@ -99,21 +139,14 @@ void BatchingDynamic3D::OnUpdate([[maybe_unused]] float deltaTime)
     single_cube_vertices.insert(single_cube_vertices.end(), q_top.begin(), q_top.end());
     single_cube_vertices.insert(single_cube_vertices.end(), q_bottom.begin(), q_bottom.end());
 
-    std::vector<unsigned int> single_cube_indices;
-    for (size_t i = 0; i < 6; ++i) { // For each of the 6 faces
-        single_cube_indices.push_back(i * 4 + 0);
-        single_cube_indices.push_back(i * 4 + 1);
-        single_cube_indices.push_back(i * 4 + 2);
-        single_cube_indices.push_back(i * 4 + 2);
-        single_cube_indices.push_back(i * 4 + 3);
-        single_cube_indices.push_back(i * 4 + 0);
-    }
-
     // For this approach, we only need to buffer one cube's geometry
     // The different positions will be handled by transforming and drawing multiple times in OnRender
     m_vertexBuffer->BufferSubData(single_cube_vertices.data(), unsigned(single_cube_vertices.size() * sizeof(Vertex)));
-    m_indexBuffer = std::make_unique<ElementIndexBuffer>(single_cube_indices.data(), unsigned(single_cube_indices.size()));
 
+    auto positions = MakeFrameVector<glm::vec3>(single_cube_vertices.size());
+    for (const Vertex& vertex : single_cube_vertices)
+        positions.emplace_back(vertex.position[0], vertex.position[1], vertex.position[2]);
+    m_positionBuffer->BufferSubData(positions.data(), unsigned(positions.size() * sizeof(glm::vec3)));
 }
 
 void BatchingDynamic3D::OnRender()
@@ -127,7 +160,7 @@ void BatchingDynamic3D::OnRender()
 
     // Set up the view matrix to orbit m_cubeCenter
     float orbitRadius = 800.0f; // Radius of the camera's orbit around m_cubeCenter
-    float time = static_cast<float>(glfwGetTime());
+    float time = static_cast<float>(Time::Get().GetRenderTime());
     float camX = m_cubeCenter.x + static_cast<float>(sin(time) * orbitRadius);
     float camY = m_cubeCenter.y + 200.0f; // Position camera above the center Y
     float camZ = m_cubeCenter.z + static_cast<float>(cos(time) * orbitRadius);
@@ -136,30 +169,82 @@ void BatchingDynamic3D::OnRender()
                          m_cubeCenter,                  // Look at the base center of the cubes
                          glm::vec3(0.0f, 1.0f, 0.0f));  // Up vector
 
+    // every cube shares the spin, only the position differs
+    const glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), time * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
+    const glm::vec3 cameraPos(camX, camY, camZ);
+    const glm::vec3 cameraFront = glm::normalize(m_cubeCenter - cameraPos);
+    m_draws.clear();
+    for (const auto& offset : m_cubeOffsets)
+    {
+        glm::vec3 currentCubeActualCenter = m_cubeCenter + offset * m_cubeSize; // Scale offset by cube size
+        glm::mat4 translateToFinalPosition = glm::translate(glm::mat4(1.0f), currentCubeActualCenter);
+        glm::mat4 modelMatrixForThisInstance = translateToFinalPosition * rotation; // Since template is at origin, no initial translateToOrigin needed if CreateQuad makes it so.
+
+        // 4. Finally, apply the global m_translation (batch translation)
+        m_model = glm::translate(glm::mat4(1.0f), m_translation) * modelMatrixForThisInstance;
+        m_draws.push_back({m_model, glm::dot(glm::vec3(m_model[3]) - cameraPos, cameraFront)});
+    }
+    if (m_drawOrder == DrawOrder::FrontToBack)
+        std::sort(m_draws.begin(), m_draws.end(), [](const CubeDraw& a, const CubeDraw& b) { return a.distance < b.distance; });
+    else if (m_drawOrder == DrawOrder::BackToFront)
+        std::sort(m_draws.begin(), m_draws.end(), [](const CubeDraw& a, const CubeDraw& b) { return a.distance > b.distance; });
+
+    // the results of the frame before last are in by now
+    FrameQueries& queries = m_queries[m_frame++ % 2];
+    if (!queries.samples) {
+        glCall(glGenQueries(1, &queries.samples));
+        glCall(glGenQueries(1, &queries.time));
+    }
+    if (queries.pending) {
+        GLuint samples = 0;
+        GLuint64 nanoseconds = 0;
+        glCall(glGetQueryObjectuiv(queries.samples, GL_QUERY_RESULT, &samples));
+        glCall(glGetQueryObjectui64v(queries.time, GL_QUERY_RESULT, &nanoseconds));
+        m_samplesShaded = samples;
+        m_gpuMs = double(nanoseconds) / 1e6;
+    }
+    glCall(glBeginQuery(GL_TIME_ELAPSED, queries.time));
+
+    // no prepass until both programs are ready: the GL_EQUAL pass would have no depth to match, or the
+    // fallback would draw it with a different vertex transform and its depth wouldn't match exactly
+    const bool depthPrepass = m_depthPrepass && m_depthShader->IsReady() && m_shader->IsReady();
+    if (depthPrepass) {
+        glCall(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+        m_depthShader->Bind();
+        m_depthShader->SetUniformMat4f("view", m_view);
+        m_depthShader->SetUniformMat4f("projection", m_proj);
+        DrawCubes(*m_depthShader, *m_depthVao);
+        glCall(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+        // the depth is final, only the nearest surface of every pixel passes
+        glCall(glDepthMask(GL_FALSE));
+        glCall(glDepthFunc(GL_EQUAL));
+    }
+
     m_shader->Bind();
     m_shader->SetUniformMat4f("view", m_view);
     m_shader->SetUniformMat4f("projection", m_proj);
-    m_shader->SetUniformVec1i("u_Textures", std::vector<int>{0, 1}); // Set texture IDs for the shader
-    
-    m_vao->Bind();
-    if (m_indexBuffer) // Check if index buffer is valid before drawing
-    {
-        m_indexBuffer->Bind();
-
-        for (const auto& offset : m_cubeOffsets)
-        {
-            glm::vec3 currentCubeActualCenter = m_cubeCenter + offset * m_cubeSize; // Scale offset by cube size
-            float time = (float)glfwGetTime();
-            glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), time * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
-            glm::mat4 translateToFinalPosition = glm::translate(glm::mat4(1.0f), currentCubeActualCenter);
-            glm::mat4 modelMatrixForThisInstance = translateToFinalPosition * rotation; // Since template is at origin, no initial translateToOrigin needed if CreateQuad makes it so.
-
-            // 4. Finally, apply the global m_translation (batch translation)
-            m_model = glm::translate(glm::mat4(1.0f), m_translation) * modelMatrixForThisInstance;
-            
-            m_shader->SetUniformMat4f("model", m_model);
-            m_renderer.Draw(*m_vao, *m_indexBuffer, *m_shader);
-        }
+    const int textureSlots[] = {0, 1};
+    m_shader->SetUniform1iv("u_Textures", textureSlots, 2); // Set texture IDs for the shader
+    if (m_heavyShading)
+        m_shader->SetUniform1i("u_ShadingLoops", m_shadingLoops);
+
+    glCall(glBeginQuery(GL_SAMPLES_PASSED, queries.samples));
+    DrawCubes(*m_shader, *m_vao);
+    glCall(glEndQuery(GL_SAMPLES_PASSED));
+    glCall(glEndQuery(GL_TIME_ELAPSED));
+    queries.pending = true;
+
+    if (depthPrepass) {
+        glCall(glDepthMask(GL_TRUE));
+        glCall(glDepthFunc(GL_LESS));
+    }
+}
+
+void BatchingDynamic3D::DrawCubes(Shader& shader, const VertexArray& va)
+{
+    for (const CubeDraw& draw : m_draws) {
+        shader.SetUniformMat4f("model", draw.model);
+        m_renderer.Draw(va, *m_indexBuffer, shader);
     }
 }
 
@@ -169,6 +254,29 @@ void BatchingDynamic3D::OnImGuiRender()
     ImGui::SliderFloat("Cube Size", &m_cubeSize, 10.0f, 500.0f);
     ImGui::ColorEdit4("Cube Color", m_cubeColor.data());
     ImGui::SliderFloat3("Batch Translation", &m_translation.x, -500.0f, 500.0f); 
+
+    if (ImGui::SliderInt("Depth layers", &m_depthLayers, 0, 32))
+        SetDepthLayers(m_depthLayers);
+    ImGui::Checkbox("Depth prepass", &m_depthPrepass);
+    const char* orders[] = {"Submission order", "Front to back", "Back to front"};
+    int order = int(m_drawOrder);
+    if (ImGui::Combo("Draw order", &order, orders, 3))
+        m_drawOrder = DrawOrder(order);
+    if (ImGui::Checkbox("Heavy shading", &m_heavyShading)) {
+        if (m_heavyShading)
+            m_shader = Shaders::Get().Get("res/Shaders/BatchColor3D.shader", {"HEAVY_SHADING"});
+        else
+            m_shader = Shaders::Get().Get("res/Shaders/BatchColor3D.shader");
+    }
+    if (m_heavyShading)
+        ImGui::SliderInt("Shading loops", &m_shadingLoops, 1, 1024, "%d", ImGuiSliderFlags_Logarithmic);
+
+    // with the prepass this is the visible pixels, without it every fragment that passed the depth test
+    GLint viewport[4] = {0, 0, 1, 1};
+    glCall(glGetIntegerv(GL_VIEWPORT, viewport));
+    const double pixels = std::max(1.0, double(viewport[2]) * double(viewport[3]));
+    ImGui::Text("%zu cubes: %u fragments shaded (%.2f per pixel), GPU %.3f ms", m_draws.size(), m_samplesShaded,
+                double(m_samplesShaded) / pixels, m_gpuMs);
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 }
 
@@ -92,11 +92,28 @@ public:
     };
 
 
+    // opaque draws, sorted by distance from the camera unless Submission
+    enum class DrawOrder
+    {
+        Submission,  // m_cubeOffsets order
+        FrontToBack, // early depth test rejects most hidden fragments before they're shaded
+        BackToFront  // the worst case, every layer is shaded over the last
+    };
+
 private:
+    struct CubeDraw
+    {
+        glm::mat4 model;
+        float distance; // along the view direction
+    };
+
+    void SetDepthLayers(int layers);
+    void DrawCubes(Shader& shader, const VertexArray& va);
+
     std::unique_ptr<VertexArray> m_vao;
     std::unique_ptr<ElementIndexBuffer> m_indexBuffer;
     std::unique_ptr<VertexBuffer> m_vertexBuffer;
-    std::unique_ptr<Shader> m_shader;
+    std::shared_ptr<Shader> m_shader;
     std::unique_ptr<Texture> m_texture0;
     std::unique_ptr<Texture> m_texture1;
 
@@ -112,6 +129,30 @@ private:
     float m_cubeSize;
     std::array<float, 4> m_cubeColor;
     std::vector<glm::vec3> m_cubeOffsets; // Stores offsets from m_cubeCenter for multiple cube instances
+    int m_depthLayers = 0;                // grids of cubes behind the hand placed ones, to make the scene fragment bound
+    std::vector<CubeDraw> m_draws;        // this frame's cubes in draw order
+
+    // depth prepass: positions only (their own tightly packed stream) with color writes off, then
+    // the shading pass tests GL_EQUAL without writing depth, so every pixel is shaded exactly once
+    bool m_depthPrepass = false;
+    DrawOrder m_drawOrder = DrawOrder::FrontToBack;
+    bool m_heavyShading = false;
+    int m_shadingLoops = 64;
+    std::shared_ptr<Shader> m_depthShader;
+    std::unique_ptr<VertexBuffer> m_positionBuffer;
+    std::unique_ptr<VertexArray> m_depthVao;
+
+    // fragments shaded and GPU time of the frame, read two frames later so nothing waits
+    struct FrameQueries
+    {
+        unsigned int samples = 0;
+        unsigned int time = 0;
+        bool pending = false;
+    };
+    FrameQueries m_queries[2];
+    unsigned int m_frame = 0;
+    unsigned int m_samplesShaded = 0;
+    double m_gpuMs = 0.0;
 };
 
 } // namespace test
\ No newline at end of file
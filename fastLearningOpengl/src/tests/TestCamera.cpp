@@ -1,11 +1,19 @@
 #include "TestCamera.h"
+#include "ShaderLibrary.h"
+#include "UploadQueue.h"
 
 #include "Renderer.h"
 #include "VertexBufferLayout.h"
 #include "imgui/imgui.h"
 #include "Texture.h"
+#include "Allocators.h"
+#include "JobSystem.h"
 #include "glm/gtc/matrix_transform.hpp" // For glm::lookAt and glm::perspective
-#include "GLFW/glfw3.h" // For glfwGetTime and key codes
+#include "FrameClock.h"
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <numeric>
 #include <tuple>
 #include <vector>
 #include <algorithm> 
@@ -22,6 +30,46 @@ const float SPEED       =  250.0f; // Adjusted speed
 const float SENSITIVITY =  0.1f; // Ill implement this later
 const float ZOOM        =  45.0f;
 
+const char* LOD_MESH_OBJ  = "res/Models/torus.obj";
+const char* LOD_MESH_PATH = "res/Models/torus.mesh";
+
+// the hand placed cubes, in cube sizes from the base center
+const glm::vec3 CUBE_OFFSETS[] = {
+    glm::vec3( 0.0f, 0.0f, 0.0f),
+    glm::vec3( 2.0f, 5.0f, -15.0f),
+    glm::vec3(-1.5f, -2.2f, -2.5f),
+    glm::vec3(-3.8f, -2.0f, -12.3f),
+    glm::vec3( 2.4f, -0.4f, -3.5f),
+    glm::vec3(-1.7f, 3.0f, -7.5f),
+    glm::vec3( 1.3f, -2.0f, -2.5f),
+    glm::vec3( 1.5f, 2.0f, -2.5f),
+    glm::vec3( 1.5f, 0.2f, -1.5f)
+};
+
+static glm::quat EulerRotation(const glm::vec3& degrees)
+{
+    // same order as rotating about x, then y, then z with glm::rotate
+    return glm::angleAxis(glm::radians(degrees.x), glm::vec3(1.0f, 0.0f, 0.0f)) *
+           glm::angleAxis(glm::radians(degrees.y), glm::vec3(0.0f, 1.0f, 0.0f)) *
+           glm::angleAxis(glm::radians(degrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
+// past the hand placed ones cubes go on a 100 x 100 x 100 grid behind them
+// the cube vertices go from -size / 2 to size / 2 around the origin
+static glm::vec4 CubeBoundingSphere(float cubeSize)
+{
+    return glm::vec4(0.0f, 0.0f, 0.0f, cubeSize * 0.5f * 1.7320508f);
+}
+
+static glm::vec3 CubeOffset(unsigned int i)
+{
+    constexpr unsigned int handPlaced = sizeof(CUBE_OFFSETS) / sizeof(CUBE_OFFSETS[0]);
+    if (i < handPlaced)
+        return CUBE_OFFSETS[i];
+    unsigned int j = i - handPlaced;
+    return glm::vec3(float(j % 100) * 1.5f - 75.0f, 10.0f - float((j / 100) % 100) * 1.5f, -20.0f - float(j / 10000) * 1.5f);
+}
+
 TestCameraSuite::TestCameraSuite()
     : m_proj(glm::perspective(glm::radians(ZOOM), 960.0f / 540.0f, 0.1f, 1500.0f)),
       m_translation(0.0f, 0.0f, 0.0f),
@@ -29,17 +77,6 @@ TestCameraSuite::TestCameraSuite()
       m_cubeCenter(480.0f, 400.0f, 0.0f),
       m_cubeSize(50.0f), // Smaller default cube size
       m_cubeColor{1.0f, 1.0f, 1.0f, 1.0f},
-      m_cubeOffsets({
-        glm::vec3( 0.0f, 0.0f, 0.0f),
-        glm::vec3( 2.0f, 5.0f, -15.0f),
-        glm::vec3(-1.5f, -2.2f, -2.5f),
-        glm::vec3(-3.8f, -2.0f, -12.3f),
-        glm::vec3( 2.4f, -0.4f, -3.5f),
-        glm::vec3(-1.7f, 3.0f, -7.5f),
-        glm::vec3( 1.3f, -2.0f, -2.5f),
-        glm::vec3( 1.5f, 2.0f, -2.5f),
-        glm::vec3( 1.5f, 0.2f, -1.5f)
-      }),
       m_cameraPos(glm::vec3(480.0f, 270.0f, 700.0f)), // Initial position
       m_cameraFront(glm::vec3(0.0f, 0.0f, -1.0f)),
       m_cameraUp(glm::vec3(0.0f, 1.0f, 0.0f)),
@@ -62,47 +99,118 @@ TestCameraSuite::TestCameraSuite()
 
     m_vao->AddBuffer(*m_vertexBuffer, layout); 
 
-    m_shader = std::make_unique<Shader>("res/Shaders/BatchColor3D.shader"); 
+    // per instance model matrix, a mat4 attribute is four vec4s (locations 4 to 7)
+    m_instanceBuffer = std::make_unique<VertexBuffer>(nullptr, unsigned(sizeof(glm::mat4) * MaxCubes), true);
+    VertexBufferLayout instanceLayout;
+    for (int column = 0; column < 4; column++)
+        instanceLayout.Push<float>(4, 1);
+    m_vao->AddBuffer(*m_instanceBuffer, instanceLayout);
+
+    // the actual positions and rotations are written by the cube placement system
+    m_batchNode = m_hierarchy.AddNode(TransformHierarchy::NoParent, glm::vec3(0.0f));
+    m_firstCubeNode = m_hierarchy.GetNodeCount();
+
+    // the pools are created here on the main thread, the systems only look them up from the workers
+    m_registry.GetPool<CubePlacement>();
+    m_registry.GetPool<CubeNode>();
+    m_systems.Add("cube placement", SystemScheduler::Components<CubePlacement>(), SystemScheduler::Components<CubeNode>(),
+                  [this](Registry& registry, JobSystem& jobs) {
+        const float cubeSize = m_cubeSize;
+        const glm::quat spin = m_spin;
+        registry.GetView<CubePlacement, CubeNode>().ParallelEach(jobs, 4096,
+            [this, cubeSize, spin](Entity, const CubePlacement& placement, const CubeNode& cube) {
+            // Scale offset by cube size, the batch translation comes from the parent node
+            m_hierarchy.SetLocalPosition(cube.node, placement.offset * cubeSize);
+            m_hierarchy.SetLocalRotation(cube.node, spin * placement.rotation);
+            m_hierarchy.SetLocalBounds(cube.node, glm::vec3(-cubeSize * 0.5f), glm::vec3(cubeSize * 0.5f));
+        });
+    });
+    // CubeNode stands for the transforms behind it here
+    m_systems.Add("transform hierarchy", {}, SystemScheduler::Components<CubeNode>(), [this](Registry&, JobSystem& jobs) {
+        m_hierarchy.Update(&jobs);
+    });
+
+    // the cube topology never changes (size and color only touch the vertices), so the indices are uploaded once
+    unsigned int single_cube_indices[36];
+    for (unsigned int i = 0; i < 6; ++i) { // For each of the 6 faces
+        single_cube_indices[i * 6 + 0] = i * 4 + 0;
+        single_cube_indices[i * 6 + 1] = i * 4 + 1;
+        single_cube_indices[i * 6 + 2] = i * 4 + 2;
+        single_cube_indices[i * 6 + 3] = i * 4 + 2;
+        single_cube_indices[i * 6 + 4] = i * 4 + 3;
+        single_cube_indices[i * 6 + 5] = i * 4 + 0;
+    }
+    m_indexBuffer = std::make_unique<ElementIndexBuffer>(single_cube_indices, 36);
+
+    m_shader = Shaders::Get().Get("res/Shaders/BatchColor3D.shader", {"INSTANCED"});
     m_shader->Bind();
-    m_texture0 = std::make_unique<Texture>("res/Textures/cute.png");
+    m_texture0 = std::make_unique<Texture>("res/Textures/cute.png", &Uploads::Get());
     m_texture0->Bind(0); // Bind texture to slot 0
-    m_texture1 = std::make_unique<Texture>("res/Textures/ChernoLogo.png"); 
+    m_texture1 = std::make_unique<Texture>("res/Textures/ChernoLogo.png", &Uploads::Get()); 
     m_texture1->Bind(1); 
 
-    // Initialize individual rotation offsets with random values
-    m_individualCubeRotationOffsets.resize(m_cubeOffsets.size());
-    for (size_t i = 0; i < m_individualCubeRotationOffsets.size(); ++i) {
-        m_individualCubeRotationOffsets[i] = glm::vec3(
-            static_cast<float>(rand() % 360 - 180), // Random angle between -180 and 180
-            static_cast<float>(rand() % 360 - 180),
-            static_cast<float>(rand() % 360 - 180)
-        );
-    }
+    SetCubeCount(unsigned(m_cubeCount));
 
     UpdateCameraVectors(); // Initialize camera vectors
+
+    m_meshShader = Shaders::Get().Get("res/Shaders/Mesh.shader");
+    m_meshShaderIndirect = Shaders::Get().Get("res/Shaders/Mesh.shader", {"INDIRECT"});
+    if (MeshImporter::IsUpToDate(LOD_MESH_OBJ, LOD_MESH_PATH)) {
+        m_lodMesh = std::make_unique<Mesh>(LOD_MESH_PATH);
+        m_lodSelector.SetMesh(*m_lodMesh);
+    } else {
+        m_lodMeshImport = MeshImporter::ImportAsync(LOD_MESH_OBJ, LOD_MESH_PATH); // LODs are generated offline on a worker
+    }
 }
 
 TestCameraSuite::~TestCameraSuite()
 {
     // Unique_ptrs will handle deletion
+    Uploads::Get().Cancel(m_instanceBuffer->GetRendererID(), false); // the buffer goes with this test
+    if (m_samplesQuery) {
+        glCall(glDeleteQueries(1, &m_samplesQuery));
+    }
     glCall(glDisable(GL_DEPTH_TEST)); // Disable depth test when this test is exited
 }
 
-void TestCameraSuite::ProcessKeyboard(int key, float deltaTime)
+void TestCameraSuite::SetCubeCount(unsigned int count)
 {
-    float velocity = SPEED * deltaTime;
-    if (key == GLFW_KEY_W)
-        m_cameraPos += m_cameraFront * velocity;
-    if (key == GLFW_KEY_S)
-        m_cameraPos -= m_cameraFront * velocity;
-    if (key == GLFW_KEY_A)
-        m_cameraPos -= glm::normalize(glm::cross(m_cameraFront, m_cameraUp)) * velocity;
-    if (key == GLFW_KEY_D)
-        m_cameraPos += glm::normalize(glm::cross(m_cameraFront, m_cameraUp)) * velocity;
-    if (key == GLFW_KEY_SPACE) // Example: Move up
-        m_cameraPos += m_cameraUp * velocity;
-    if (key == GLFW_KEY_LEFT_SHIFT) // Example: Move down
-        m_cameraPos -= m_cameraUp * velocity;
+    // add and remove at the end only, that keeps cube i at node m_firstCubeNode + i and the component
+    // arrays in the same order as the nodes
+    while (m_cubes.size() > count) {
+        m_registry.Destroy(m_cubes.back());
+        m_cubes.pop_back();
+    }
+    m_hierarchy.Truncate(m_firstCubeNode + unsigned(m_cubes.size()));
+
+    m_registry.Reserve(count);
+    m_hierarchy.Reserve(m_firstCubeNode + count);
+    while (m_cubes.size() < count) {
+        Entity cube = m_registry.Create();
+        glm::vec3 rotationDegrees(
+            static_cast<float>(rand() % 360 - 180), // Random angle between -180 and 180
+            static_cast<float>(rand() % 360 - 180),
+            static_cast<float>(rand() % 360 - 180));
+        m_registry.Emplace<CubePlacement>(cube, CubeOffset(unsigned(m_cubes.size())), rotationDegrees, EulerRotation(rotationDegrees));
+        m_registry.Emplace<CubeNode>(cube, m_hierarchy.AddNode(int(m_batchNode), glm::vec3(0.0f)));
+        m_cubes.push_back(cube);
+    }
+}
+
+void TestCameraSuite::OnEvent(const InputEvent& event)
+{
+    if (event.type != InputEventType::Key || event.repeat)
+        return;
+    if (event.action < InputAction::MoveForward || event.action > InputAction::MoveDown)
+        return;
+    const std::size_t action = std::size_t(event.action);
+    if (event.pressed) {
+        if (m_heldSinceNs[action] == 0)
+            m_heldSinceNs[action] = event.timeNs;
+    } else if (m_heldSinceNs[action] != 0) {
+        m_heldSeconds[action] += float(double(event.timeNs - m_heldSinceNs[action]) * 1e-9);
+        m_heldSinceNs[action] = 0;
+    }
 }
 
 void TestCameraSuite::UpdateCameraVectors()
@@ -115,10 +223,43 @@ void TestCameraSuite::UpdateCameraVectors()
     m_cameraFront = glm::normalize(front);
 }
 
+void TestCameraSuite::OnFixedUpdate(float step)
+{
+    m_previousSpinAngle = m_spinAngle;
+    if (m_spinCubes)
+        m_spinAngle += step * glm::radians(50.0f);
+}
+
 void TestCameraSuite::OnUpdate([[maybe_unused]] float deltaTime)
 {
-    std::vector<Vertex> batched_pos;
-    std::vector<unsigned int> batched_indices;
+    // keys still down count up to this frame's dispatch, then start over from there
+    const std::int64_t now = Input::Get().GetDispatchNs();
+    const glm::vec3 right = glm::normalize(glm::cross(m_cameraFront, m_cameraUp));
+    for (std::size_t action = std::size_t(InputAction::MoveForward); action <= std::size_t(InputAction::MoveDown); action++) {
+        if (m_heldSinceNs[action] != 0) {
+            m_heldSeconds[action] += float(double(std::max<std::int64_t>(now - m_heldSinceNs[action], 0)) * 1e-9);
+            m_heldSinceNs[action] = now;
+        }
+        float distance = SPEED * m_heldSeconds[action];
+        m_heldSeconds[action] = 0.0f;
+        switch (InputAction(action)) {
+        case InputAction::MoveForward: m_cameraPos += m_cameraFront * distance; break;
+        case InputAction::MoveBack:    m_cameraPos -= m_cameraFront * distance; break;
+        case InputAction::MoveLeft:    m_cameraPos -= right * distance; break;
+        case InputAction::MoveRight:   m_cameraPos += right * distance; break;
+        case InputAction::MoveUp:      m_cameraPos += m_cameraUp * distance; break;
+        case InputAction::MoveDown:    m_cameraPos -= m_cameraUp * distance; break;
+        default: break;
+        }
+    }
+
+    if (m_lodMeshImport.valid() && m_lodMeshImport.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        m_lodMeshImportStats = m_lodMeshImport.get();
+        if (m_lodMeshImportStats.success) {
+            m_lodMesh = std::make_unique<Mesh>(LOD_MESH_PATH);
+            m_lodSelector.SetMesh(*m_lodMesh);
+        }
+    }
 
     // Create the 6 faces for a single cube template (centered at origin conceptually for CreateQuad)
     // The actual positioning will be handled by the model matrix in OnRender
@@ -129,7 +270,8 @@ void TestCameraSuite::OnUpdate([[maybe_unused]] float deltaTime)
     auto q_top    = CreateQuad(glm::vec3(0.0f), m_cubeSize, CubeFace::Top, 0, m_cubeColor);
     auto q_bottom = CreateQuad(glm::vec3(0.0f), m_cubeSize, CubeFace::Bottom, 0, m_cubeColor);
 
-    std::vector<Vertex> single_cube_vertices;
+    // frame arena: no heap allocation, released by the main loop after the frame
+    auto single_cube_vertices = MakeFrameVector<Vertex>(24);
     single_cube_vertices.insert(single_cube_vertices.end(), q_front.begin(), q_front.end());
     single_cube_vertices.insert(single_cube_vertices.end(), q_back.begin(), q_back.end());
     single_cube_vertices.insert(single_cube_vertices.end(), q_left.begin(), q_left.end());
@@ -137,20 +279,9 @@ void TestCameraSuite::OnUpdate([[maybe_unused]] float deltaTime)
     single_cube_vertices.insert(single_cube_vertices.end(), q_top.begin(), q_top.end());
     single_cube_vertices.insert(single_cube_vertices.end(), q_bottom.begin(), q_bottom.end());
 
-    std::vector<unsigned int> single_cube_indices;
-    for (size_t i = 0; i < 6; ++i) { // For each of the 6 faces
-        single_cube_indices.push_back(i * 4 + 0);
-        single_cube_indices.push_back(i * 4 + 1);
-        single_cube_indices.push_back(i * 4 + 2);
-        single_cube_indices.push_back(i * 4 + 2);
-        single_cube_indices.push_back(i * 4 + 3);
-        single_cube_indices.push_back(i * 4 + 0);
-    }
-
     // For this approach, we only need to buffer one cube's geometry
-    // The different positions will be handled by transforming and drawing multiple times in OnRender
+    // The different positions are handled by the per instance model matrices in OnRender
     m_vertexBuffer->BufferSubData(single_cube_vertices.data(), unsigned(single_cube_vertices.size() * sizeof(Vertex)));
-    m_indexBuffer = std::make_unique<ElementIndexBuffer>(single_cube_indices.data(), unsigned(single_cube_indices.size()));
 
 }
 
@@ -160,42 +291,294 @@ void TestCameraSuite::OnRender()
     glCall(glClearColor(0.1f, 0.1f, 0.1f, 1.0f));
     glCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT)); // Clear depth buffer as well
 
+    m_view = glm::lookAt(m_cameraPos, m_cameraPos + m_cameraFront, m_cameraUp); // Camera position and orientation
+    UpdateTransforms();
+
+    if (m_drawLodMesh && m_lodMesh && m_lodMesh->IsValid()) {
+        RenderLodMeshes();
+        return;
+    }
+
     m_texture0->Bind(0);
     m_texture1->Bind(1);
 
-    m_view = glm::lookAt(m_cameraPos, m_cameraPos + m_cameraFront, m_cameraUp); // Camera position and orientation
-
     m_shader->Bind();
     m_shader->SetUniformMat4f("view", m_view);
     m_shader->SetUniformMat4f("projection", m_proj);
-    m_shader->SetUniformVec1i("u_Textures", std::vector<int>{0, 1}); // Set texture IDs for the shader
-    
-    m_vao->Bind();
-    if (m_indexBuffer) // Check if index buffer is valid before drawing
+    if (m_texturedCubes) {
+        const int textureSlots[] = {0, 1};
+        m_shader->SetUniform1iv("u_Textures", textureSlots, 2); // Set texture IDs for the shader
+    }
+
+    if (m_occlusionCulling) {
+        unsigned int visible = CullOccluded();
+        if (m_measureOverdraw)
+            MeasureOverdraw(visible);
+        if (visible > 0)
+            m_renderer.DrawInstanced(*m_occlusionVao, *m_indexBuffer, *m_shader, visible);
+        return;
+    }
+
+    if (m_gpuCulling) {
+        if (!m_culler) {
+            m_culler = std::make_unique<GpuCuller>(MaxCubes);
+            m_culledVao = CreateCubeVertexArray(m_culler->GetVisibleBuffer());
+        }
+        if (m_culler->IsValid()) {
+            m_cullViewProjection = m_proj * m_view;
+            m_culler->Cull(*m_instanceBuffer, unsigned(m_cubes.size()), m_cullViewProjection, CubeBoundingSphere(m_cubeSize),
+                           m_indexBuffer->GetCount());
+            m_culler->Draw(m_renderer, *m_culledVao, *m_indexBuffer, *m_shader);
+            return;
+        }
+    }
+
+    // the instance buffer already holds every model matrix, all cubes are one draw
+    m_renderer.DrawInstanced(*m_vao, *m_indexBuffer, *m_shader, unsigned(m_cubes.size()));
+}
+
+std::unique_ptr<VertexArray> TestCameraSuite::CreateCubeVertexArray(const VertexBuffer& instances) const
+{
+    auto vao = std::make_unique<VertexArray>();
+    VertexBufferLayout layout;
+    layout.Push<float>(3);
+    layout.Push<float>(2);
+    layout.Push<float>(4);
+    layout.Push<float>(1);
+    vao->AddBuffer(*m_vertexBuffer, layout);
+    VertexBufferLayout instanceLayout;
+    for (int column = 0; column < 4; column++)
+        instanceLayout.Push<float>(4, 1);
+    vao->AddBuffer(instances, instanceLayout);
+    vao->Unbind();
+    return vao;
+}
+
+unsigned int TestCameraSuite::CullOccluded()
+{
+    auto start = std::chrono::steady_clock::now();
+    if (!m_occlusionInstances) {
+        m_occlusionInstances = std::make_unique<VertexBuffer>(nullptr, unsigned(sizeof(glm::mat4) * MaxCubes), true);
+        m_occlusionVao = CreateCubeVertexArray(*m_occlusionInstances);
+    }
+    // the hierarchy's matrices, not the instance buffer's: with queued uploads those may be a frame behind
+    const glm::mat4* world = m_hierarchy.GetWorldMatrices() + m_firstCubeNode;
+    const unsigned int count = unsigned(m_cubes.size());
+    const glm::mat4 viewProjection = m_proj * m_view;
+    const glm::vec3 halfSize(m_cubeSize * 0.5f);
+
+    // all cubes are the same size, the closest ones on screen cover the most. One reaching behind the
+    // near plane isn't rasterized, so it's no candidate
+    m_occluderScores.resize(count);
+    Jobs::Get().ParallelFor(count, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            glm::vec4 clip = viewProjection * world[i][3];
+            bool onScreen = clip.w > m_cubeSize && std::fabs(clip.x) < clip.w && std::fabs(clip.y) < clip.w;
+            m_occluderScores[i] = onScreen ? 1.0f / clip.w : 0.0f;
+        }
+    });
+    m_occluders.resize(count);
+    std::iota(m_occluders.begin(), m_occluders.end(), 0u);
+    const unsigned int candidates = std::min(count, unsigned(m_occluderCount));
+    std::nth_element(m_occluders.begin(), m_occluders.begin() + candidates, m_occluders.end(),
+                     [&](unsigned int a, unsigned int b) { return m_occluderScores[a] > m_occluderScores[b]; });
+
+    m_occlusion.Begin(viewProjection);
+    for (unsigned int k = 0; k < candidates; k++) {
+        if (m_occluderScores[m_occluders[k]] > 0.0f)
+            m_occlusion.AddOccluder(world[m_occluders[k]], -halfSize, halfSize);
+    }
+    m_occlusion.BuildPyramid();
+    m_occlusionResults.resize(count);
+    m_occlusion.TestBoxes(world, count, -halfSize, halfSize, m_occlusionResults.data(), &Jobs::Get());
+
+    m_occlusionVisible.clear();
+    for (unsigned int i = 0; i < count; i++) {
+        if (m_occlusionResults[i] == OcclusionResult::Visible)
+            m_occlusionVisible.push_back(world[i]);
+    }
+    if (!m_occlusionVisible.empty())
+        m_occlusionInstances->BufferSubData(m_occlusionVisible.data(), unsigned(m_occlusionVisible.size() * sizeof(glm::mat4)));
+    m_occlusionMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return unsigned(m_occlusionVisible.size());
+}
+
+void TestCameraSuite::MeasureOverdraw(unsigned int visibleCount)
+{
+    m_measureOverdraw = false;
+    if (!m_samplesQuery) {
+        glCall(glGenQueries(1, &m_samplesQuery));
+    }
+    // samples that pass the depth test are the fragments shaded; waiting for the result stalls, it's a one off
+    auto samplesDrawn = [&](const VertexArray& va, unsigned int instances) {
+        glCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+        glCall(glBeginQuery(GL_SAMPLES_PASSED, m_samplesQuery));
+        if (instances > 0)
+            m_renderer.DrawInstanced(va, *m_indexBuffer, *m_shader, instances);
+        glCall(glEndQuery(GL_SAMPLES_PASSED));
+        GLuint samples = 0;
+        glCall(glGetQueryObjectuiv(m_samplesQuery, GL_QUERY_RESULT, &samples));
+        return double(samples);
+    };
+    const double all = samplesDrawn(*m_vao, unsigned(m_cubes.size()));
+    const double culled = samplesDrawn(*m_occlusionVao, visibleCount);
+    glCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+    GLint viewport[4] = {0, 0, 1, 1};
+    glCall(glGetIntegerv(GL_VIEWPORT, viewport));
+    const double pixels = std::max(1.0, double(viewport[2]) * double(viewport[3]));
+    char text[192];
+    snprintf(text, sizeof(text), "Samples shaded: %.0f all cubes, %.0f culled, %.1f%% saved (%.2f -> %.2f per pixel)", all, culled,
+             all > 0.0 ? 100.0 * (all - culled) / all : 0.0, all / pixels, culled / pixels);
+    m_overdrawReport = text;
+}
+
+void TestCameraSuite::ValidateCulling()
+{
+    // the CPU gets the matrices the GPU culled, not the hierarchy's, which may be ahead of a queued upload
+    std::vector<glm::mat4> instances(m_culler->GetStats().tested);
+    glCall(glBindBuffer(GL_COPY_READ_BUFFER, m_instanceBuffer->GetRendererID()));
+    glCall(glGetBufferSubData(GL_COPY_READ_BUFFER, 0, GLsizeiptr(instances.size() * sizeof(glm::mat4)), instances.data()));
+
+    std::vector<glm::mat4> gpu, cpu;
+    m_culler->ReadVisible(gpu);
+    GpuCuller::CullOnCpu(instances.data(), unsigned(instances.size()), m_cullViewProjection, CubeBoundingSphere(m_cubeSize), &cpu);
+
+    // the GPU packs in any order, compare as sets
+    auto less = [](const glm::mat4& a, const glm::mat4& b) { return std::memcmp(&a, &b, sizeof(glm::mat4)) < 0; };
+    std::sort(gpu.begin(), gpu.end(), less);
+    std::sort(cpu.begin(), cpu.end(), less);
+    std::vector<glm::mat4> differing;
+    std::set_symmetric_difference(gpu.begin(), gpu.end(), cpu.begin(), cpu.end(), std::back_inserter(differing), less);
+
+    char text[160];
+    snprintf(text, sizeof(text), "%s: GPU %zu visible, CPU %zu, %zu differ%s", m_culler->GetModeName(), gpu.size(), cpu.size(),
+             differing.size(), differing.empty() ? " (match)" : " (spheres on a plane, rounding)");
+    m_cullValidation = text;
+}
+
+void TestCameraSuite::ValidateUploadOrdering()
+{
+    struct Write
     {
-        m_indexBuffer->Bind();
+        std::size_t offset, size;
+        unsigned char fill;
+    };
+    // the writes in order through a queue of their own, then the buffer read back against what the last
+    // write of each byte put there. Returns the bytes that differ, ~0u if the queue didn't drain
+    auto run = [](std::size_t bufferSize, std::initializer_list<Write> writes) {
+        VertexBuffer scratch(nullptr, unsigned(bufferSize));
+        UploadQueue queue(64 * 1024); // chunks of at most 16 KB
+        queue.SetByteBudget(1024 * 1024);
+        std::vector<unsigned char> expected(bufferSize, 0);
+        for (const Write& write : writes) {
+            std::vector<unsigned char> data(write.size, write.fill);
+            queue.EnqueueBuffer(scratch.GetRendererID(), write.offset, data.data(), data.size());
+            std::fill(expected.begin() + long(write.offset), expected.begin() + long(write.offset + write.size), write.fill);
+        }
+        for (int frame = 0; frame < 100 && !queue.IsIdle(); frame++) {
+            queue.Execute();
+            glCall(glFinish()); // the ring frames retire right away
+        }
+        const bool drained = queue.IsIdle();
+
+        std::vector<unsigned char> contents(bufferSize);
+        glCall(glBindBuffer(GL_COPY_READ_BUFFER, scratch.GetRendererID()));
+        glCall(glGetBufferSubData(GL_COPY_READ_BUFFER, 0, GLsizeiptr(contents.size()), contents.data()));
+        queue.Release();
+        unsigned int wrong = 0;
+        for (std::size_t i = 0; i < bufferSize; i++)
+            wrong += contents[i] != expected[i];
+        return drained ? wrong : ~0u;
+    };
+
+    // A [0, 100), then B [50, 150), then C [100, 200) continuing A: C may not be appended to A, it would
+    // be copied before B and B's older bytes would end up in [100, 150)
+    const unsigned int coalesced = run(200, {{0, 100, 'A'}, {50, 100, 'B'}, {100, 100, 'C'}});
+    // D [0, 48 KB) goes in 16 KB chunks over three frames, E [20 KB, 24 KB) is queued after it: E may not
+    // be copied while D's rest over it is still to come
+    const unsigned int chunked = run(48 * 1024, {{0, 48 * 1024, 'D'}, {20 * 1024, 4 * 1024, 'E'}});
+
+    char text[160];
+    snprintf(text, sizeof(text), "Upload ordering: %s; coalesced %u bytes wrong, chunked %u bytes wrong",
+             coalesced == 0 && chunked == 0 ? "PASS" : "FAIL", coalesced, chunked);
+    m_uploadValidation = text;
+}
 
-        for (size_t i = 0; i < m_cubeOffsets.size(); ++i)
-        {
-            const auto& offset = m_cubeOffsets[i];
-            const auto& rotationOffset = m_individualCubeRotationOffsets[i]; // Get individual rotation
-
-            glm::vec3 currentCubeActualCenter = m_cubeCenter + offset * m_cubeSize; // Scale offset by cube size
-            float time = (float)glfwGetTime();
-            glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), time * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
-            rotation = glm::rotate(rotation, glm::radians(rotationOffset.x), glm::vec3(1.0f, 0.0f, 0.0f));
-            rotation = glm::rotate(rotation, glm::radians(rotationOffset.y), glm::vec3(0.0f, 1.0f, 0.0f));
-            rotation = glm::rotate(rotation, glm::radians(rotationOffset.z), glm::vec3(0.0f, 0.0f, 1.0f));
-            glm::mat4 translateToFinalPosition = glm::translate(glm::mat4(1.0f), currentCubeActualCenter);
-            glm::mat4 modelMatrixForThisInstance = translateToFinalPosition * rotation; // Since template is at origin, no initial translateToOrigin needed if CreateQuad makes it so
-
-            // 4. Finally, apply the global m_translation (batch translation)
-            m_model = glm::translate(glm::mat4(1.0f), m_translation) * modelMatrixForThisInstance;
-            
-            m_shader->SetUniformMat4f("model", m_model);
-            m_renderer.Draw(*m_vao, *m_indexBuffer, *m_shader);
+void TestCameraSuite::UpdateTransforms()
+{
+    const float spinAngle = glm::mix(m_previousSpinAngle, m_spinAngle, Time::Get().GetAlpha());
+    m_spin = glm::angleAxis(spinAngle, glm::normalize(glm::vec3(0.5f, 1.0f, 0.0f)));
+
+    m_hierarchy.SetLocalPosition(m_batchNode, m_translation + m_cubeCenter);
+    m_systems.Run(m_registry, Jobs::Get());
+
+    // upload only the changed ranges, the batch node itself has no instance
+    auto uploadStart = std::chrono::steady_clock::now();
+    m_uploadedBytes = 0;
+    const glm::mat4* world = m_hierarchy.GetWorldMatrices();
+    const unsigned int cubeEnd = m_firstCubeNode + unsigned(m_cubes.size());
+    for (const TransformChangeRange& range : m_hierarchy.GetChangeRanges()) {
+        unsigned int first = std::max(range.first, m_firstCubeNode);
+        unsigned int last = std::min(range.first + range.count, cubeEnd);
+        if (first >= last)
+            continue;
+        unsigned int size = unsigned((last - first) * sizeof(glm::mat4));
+        unsigned int offset = unsigned((first - m_firstCubeNode) * sizeof(glm::mat4));
+        if (m_queuedUploads)
+            Uploads::Get().EnqueueBuffer(m_instanceBuffer->GetRendererID(), offset, &world[first], size, UploadPriority::High);
+        else
+            m_instanceBuffer->BufferSubData(&world[first], size, offset);
+        m_uploadedBytes += size;
+    }
+    m_uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+}
+
+void TestCameraSuite::RenderLodMeshes()
+{
+    // fit the mesh into the space of one cube
+    float meshScale = m_cubeSize / (2.0f * m_lodMesh->GetBoundingRadius());
+    glm::vec3 meshCenter = (m_lodMesh->GetBoundsMin() + m_lodMesh->GetBoundsMax()) * 0.5f;
+    glm::mat4 meshToCube = glm::scale(glm::mat4(1.0f), glm::vec3(meshScale)) * glm::translate(glm::mat4(1.0f), -meshCenter);
+
+    m_objectCenters.resize(m_cubes.size());
+    m_objectScales.resize(m_cubes.size());
+    for (size_t i = 0; i < m_cubes.size(); ++i) {
+        const WorldBounds& bounds = m_hierarchy.GetWorldBounds(m_firstCubeNode + unsigned(i));
+        m_objectCenters[i] = (bounds.min + bounds.max) * 0.5f;
+        m_objectScales[i] = meshScale;
+    }
+
+    const float pixelsPerUnit = 540.0f / (2.0f * tan(glm::radians(ZOOM) * 0.5f));
+    m_lodSelector.Select(m_objectCenters.data(), m_objectScales.data(), unsigned(m_objectCenters.size()), m_cameraPos,
+                         pixelsPerUnit, m_lodThresholdPixels, m_lodHysteresis);
+
+    Shader& shader = m_indirectLodDraws ? *m_meshShaderIndirect : *m_meshShader;
+    shader.Bind();
+    shader.SetUniformMat4f("view", m_view);
+    shader.SetUniformMat4f("projection", m_proj);
+    shader.SetUniform3f("u_LightDir", -0.4f, -0.6f, -0.7f);
+    const glm::vec4 color(m_cubeColor[0], m_cubeColor[1], m_cubeColor[2], m_cubeColor[3]);
+    if (!m_indirectLodDraws)
+        shader.SetUniform4f("u_Color", color.r, color.g, color.b, color.a);
+
+    // one index range per LOD, all objects of that LOD back to back
+    m_lodDrawList.Clear();
+    for (unsigned int lod = 0; lod < m_lodSelector.GetLodCount(); lod++) {
+        const MeshLod& range = m_lodMesh->GetLod(lod);
+        const unsigned int* objects = m_lodSelector.GetObjects(lod);
+        for (unsigned int k = 0; k < m_lodSelector.GetObjectCount(lod); k++) {
+            m_model = m_hierarchy.GetWorldMatrix(m_firstCubeNode + objects[k]) * meshToCube;
+            if (m_indirectLodDraws) {
+                m_lodDrawList.Add(range.indexCount, range.indexOffset, 0, m_model, color);
+                continue;
+            }
+            shader.SetUniformMat4f("model", m_model);
+            m_renderer.Draw(m_lodMesh->GetVertexArray(), m_lodMesh->GetIndexBuffer(), shader, range.indexCount, range.indexOffset);
         }
     }
+    if (m_indirectLodDraws)
+        m_lodDrawList.Draw(m_lodMesh->GetVertexArray(), m_lodMesh->GetIndexBuffer(), shader);
 }
 
 void TestCameraSuite::OnImGuiRender()
@@ -205,19 +588,101 @@ void TestCameraSuite::OnImGuiRender()
     ImGui::ColorEdit4("Cube Color", m_cubeColor.data());
     ImGui::SliderFloat3("Batch Translation", &m_translation.x, -500.0f, 500.0f); 
 
+    if (ImGui::SliderInt("Cubes", &m_cubeCount, 1, int(MaxCubes), "%d", ImGuiSliderFlags_Logarithmic))
+        SetCubeCount(unsigned(m_cubeCount));
+
     // Add ImGui controls for individual cube rotations
     if (ImGui::TreeNode("Individual Cube Rotations"))
     {
-        for (size_t i = 0; i < m_individualCubeRotationOffsets.size(); ++i)
+        for (size_t i = 0; i < std::min<size_t>(m_cubes.size(), 16); ++i)
         {
             ImGui::PushID(static_cast<int>(i));
-            std::string label = "Cube " + std::to_string(i) + " Rotation";
-            ImGui::SliderFloat3(label.c_str(), &m_individualCubeRotationOffsets[i].x, -180.0f, 180.0f);
+            char label[48];
+            snprintf(label, sizeof(label), "Cube %zu Rotation", i);
+            CubePlacement& placement = m_registry.Get<CubePlacement>(m_cubes[i]);
+            if (ImGui::SliderFloat3(label, &placement.rotationDegrees.x, -180.0f, 180.0f))
+                placement.rotation = EulerRotation(placement.rotationDegrees);
             ImGui::PopID();
         }
         ImGui::TreePop();
     }
 
+    ImGui::Checkbox("Spin cubes", &m_spinCubes);
+    ImGui::Checkbox("Occlusion culling (CPU)", &m_occlusionCulling);
+    if (m_occlusionCulling) {
+        ImGui::SliderInt("Occluders", &m_occluderCount, 0, 1024);
+        const OcclusionStats& occlusion = m_occlusion.GetStats();
+        const double tested = std::max(1.0, double(occlusion.tested));
+        ImGui::Text("%u occluders into %ux%u (%s): raster %.3f ms, pyramid %.3f ms, tests %.3f ms, pass %.3f ms", occlusion.occluders,
+                    m_occlusion.GetWidth(), m_occlusion.GetHeight(), OcclusionBuffer::GetSimdName(), occlusion.rasterMs,
+                    occlusion.pyramidMs, occlusion.testMs, m_occlusionMs);
+        ImGui::Text("%u cubes: %.1f%% occluded, %.1f%% outside the frustum, %zu drawn", occlusion.tested,
+                    100.0 * occlusion.occluded / tested, 100.0 * occlusion.outsideFrustum / tested, m_occlusionVisible.size());
+        // the rectangles overlap each other and the occluders, an upper bound on the fragments skipped
+        ImGui::Text("Occluded screen area %.2f screens (~%.0f fragments skipped at 960x540)", occlusion.occludedScreenArea,
+                    occlusion.occludedScreenArea * 960.0 * 540.0);
+        if (ImGui::Button("Measure overdraw"))
+            m_measureOverdraw = true;
+        if (!m_overdrawReport.empty())
+            ImGui::Text("%s", m_overdrawReport.c_str());
+    }
+    ImGui::Checkbox("GPU frustum culling", &m_gpuCulling);
+    if (m_gpuCulling && m_culler && m_culler->IsValid()) {
+        const GpuCullStats& cull = m_culler->GetStats();
+        ImGui::Text("%s: %u / %u cubes visible, cull pass %.3f ms (GPU)", m_culler->GetModeName(), cull.visible, cull.tested, cull.gpuMs);
+        if (ImGui::Button("Validate against the CPU"))
+            ValidateCulling();
+        if (!m_cullValidation.empty())
+            ImGui::Text("%s", m_cullValidation.c_str());
+    }
+    // with many cubes spinning the queue spreads the matrices over frames, cubes may lag a frame or two
+    ImGui::Checkbox("Budgeted instance uploads", &m_queuedUploads);
+    ImGui::SameLine();
+    if (ImGui::Button("Validate upload ordering"))
+        ValidateUploadOrdering();
+    if (!m_uploadValidation.empty())
+        ImGui::Text("%s", m_uploadValidation.c_str());
+    // a separate program without the texture lookups, built the first time it's asked for
+    if (ImGui::Checkbox("Textured cubes", &m_texturedCubes)) {
+        if (m_texturedCubes)
+            m_shader = Shaders::Get().Get("res/Shaders/BatchColor3D.shader", {"INSTANCED"});
+        else
+            m_shader = Shaders::Get().Get("res/Shaders/BatchColor3D.shader", {"INSTANCED", "NO_TEXTURE"});
+    }
+    const TransformUpdateStats& transformStats = m_hierarchy.GetStats();
+    ImGui::Text("Transforms: %u of %u nodes recomputed, %u ranges (%u bytes) uploaded", transformStats.worldsComputed,
+                transformStats.nodeCount, transformStats.changeRanges, m_uploadedBytes);
+    ImGui::Text("CPU per frame: systems %.3f ms (%u stages, %u threads), upload %.3f ms", m_systems.GetLastMs(),
+                m_systems.GetStageCount(), Jobs::Get().GetThreadCount(), m_uploadMs);
+    for (const SystemScheduler::System& system : m_systems.GetSystems())
+        ImGui::BulletText("%s: %.3f ms", system.name.c_str(), system.lastMs);
+
+    if (ImGui::TreeNode("Level of Detail"))
+    {
+        if (m_lodMesh && m_lodMesh->IsValid()) {
+            ImGui::Checkbox("Draw LOD mesh instead of cubes", &m_drawLodMesh);
+            ImGui::Checkbox("Indirect draw list", &m_indirectLodDraws);
+            if (m_drawLodMesh && m_indirectLodDraws)
+                ImGui::Text("%zu draws in one list, %s (upload %.3f ms, submit %.3f ms)", m_lodDrawList.GetDrawCount(),
+                            IndirectDraw::GetModeName(), m_lodDrawList.GetUploadMs(), m_lodDrawList.GetSubmitMs());
+            ImGui::SliderFloat("Max pixel error", &m_lodThresholdPixels, 0.1f, 20.0f);
+            ImGui::SliderFloat("Hysteresis", &m_lodHysteresis, 0.0f, 0.5f);
+            const LodSelectionStats& stats = m_lodSelector.GetStats();
+            for (unsigned int lod = 0; lod < m_lodSelector.GetLodCount(); lod++)
+                ImGui::Text("LOD %u: %u tris, error %.4f, %u objects", lod, m_lodMesh->GetTriangleCount(lod),
+                            m_lodMesh->GetLod(lod).error, stats.objectsPerLod[lod]);
+            ImGui::Text("Triangles drawn %u / %u (saved %u per frame)", stats.trianglesDrawn, stats.trianglesFull,
+                        stats.trianglesFull - stats.trianglesDrawn);
+        } else if (m_lodMesh) {
+            ImGui::Text("%s can't be loaded, see the console", LOD_MESH_PATH);
+        } else if (m_lodMeshImport.valid()) {
+            ImGui::Text("importing %s...", LOD_MESH_OBJ);
+        } else {
+            ImGui::Text("import of %s failed, see the console", LOD_MESH_OBJ);
+        }
+        ImGui::TreePop();
+    }
+
     // Add ImGui controls for camera parameters (for debugging purposes)
     ImGui::Text("Camera Position: (%.2f, %.2f, %.2f)", m_cameraPos.x, m_cameraPos.y, m_cameraPos.z);
     ImGui::Text("Camera Front: (%.2f, %.2f, %.2f)", m_cameraFront.x, m_cameraFront.y, m_cameraFront.z);
@@ -3,6 +3,7 @@
 #include "Test.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include <future>
 #include <memory>
 #include "VertexArray.h"
 #include "ElementIndexBuffer.h"
@@ -10,6 +11,15 @@
 #include "Shader.h"
 #include "Texture.h"
 #include "Renderer.h"
+#include "Mesh.h"
+#include "MeshImporter.h"
+#include "LodSelector.h"
+#include "IndirectDraw.h"
+#include "GpuCuller.h"
+#include "OcclusionBuffer.h"
+#include "TransformHierarchy.h"
+#include "Ecs.h"
+#include "Input.h"
 #include "TestBatchingDynamic3D.h" // Include TestBatchingDynamic3D.h for CubeFace enum
 
 namespace test
@@ -21,12 +31,12 @@ public:
     TestCameraSuite();
     ~TestCameraSuite() override;
 
+    void OnFixedUpdate(float step) override;
     void OnUpdate(float deltaTime) override;
     void OnRender() override; // Correct signature to match Test::OnRender()
     void OnImGuiRender() override;
+    void OnEvent(const InputEvent& event) override;
 
-    // New methods to handle camera movement
-    void ProcessKeyboard(int key, float deltaTime);
     void UpdateCameraVectors(); // Recalculates front vector from Euler angles if needed, or other logic
 
     struct Vertex
@@ -91,11 +101,39 @@ public:
     };
 
 
+    static constexpr unsigned int MaxCubes = 1000000;
+
+    // components of a cube entity
+    struct CubePlacement
+    {
+        glm::vec3 offset;          // from the base center, in cube sizes
+        glm::vec3 rotationDegrees; // about x, then y, then z
+        glm::quat rotation;        // rotationDegrees as a quaternion, rebuilt when the UI changes them
+    };
+
+    struct CubeNode
+    {
+        unsigned int node; // its transform in m_hierarchy
+    };
+
 private:
+    void SetCubeCount(unsigned int count);
+    void UpdateTransforms(); // runs the systems, then only the changed matrices are uploaded
+    void RenderLodMeshes();
+    void ValidateCulling(); // the GPU's last visible set against GpuCuller::CullOnCpu on the same matrices
+    // overlapping and continuing buffer uploads through a queue of its own, read back and checked byte by byte
+    void ValidateUploadOrdering();
+    // the cube vertices with per instance matrices from instances
+    std::unique_ptr<VertexArray> CreateCubeVertexArray(const VertexBuffer& instances) const;
+    unsigned int CullOccluded(); // packs the cubes the occluders don't hide into m_occlusionInstances, returns how many
+    void MeasureOverdraw(unsigned int visibleCount);
+
     std::unique_ptr<VertexArray> m_vao;
     std::unique_ptr<ElementIndexBuffer> m_indexBuffer;
     std::unique_ptr<VertexBuffer> m_vertexBuffer;
-    std::unique_ptr<Shader> m_shader;
+    std::unique_ptr<VertexBuffer> m_instanceBuffer; // one model matrix per cube
+    std::shared_ptr<Shader> m_shader;
+    bool m_texturedCubes = true; // off switches to the NO_TEXTURE variant of the shader
     std::unique_ptr<Texture> m_texture0;
     std::unique_ptr<Texture> m_texture1;
 
@@ -110,8 +148,49 @@ private:
     glm::vec3 m_cubeCenter; // Base center for all cubes
     float m_cubeSize;
     std::array<float, 4> m_cubeColor;
-    std::vector<glm::vec3> m_cubeOffsets;
-    std::vector<glm::vec3> m_individualCubeRotationOffsets; // Added for individual rotational offsets
+
+    // every cube is an entity, cube i is m_cubes[i] and draws as instance i
+    Registry m_registry;
+    SystemScheduler m_systems;
+    std::vector<Entity> m_cubes;
+    int m_cubeCount = 9;
+    double m_uploadMs = 0.0;
+
+    // batch node (m_translation + m_cubeCenter) with the cubes below it. Nodes that didn't move
+    // since the last frame are neither recomputed nor uploaded again
+    TransformHierarchy m_hierarchy;
+    unsigned int m_batchNode;
+    unsigned int m_firstCubeNode; // cubes are added and removed at the end, so cube i is always node m_firstCubeNode + i
+    bool m_spinCubes = true;
+    float m_spinAngle = 0.0f;         // at the last fixed step
+    float m_previousSpinAngle = 0.0f; // the step before, the cubes are drawn in between
+    glm::quat m_spin; // the rotation over time every cube shares
+    unsigned int m_uploadedBytes = 0;
+    bool m_queuedUploads = false; // instance ranges go through the upload queue's budget instead of straight to the buffer
+
+    // frustum culling of the cube instances on the GPU, created the first time it's switched on
+    bool m_gpuCulling = false;
+    std::unique_ptr<GpuCuller> m_culler;
+    std::unique_ptr<VertexArray> m_culledVao; // the cube vertices with the culler's packed matrices as instances
+    glm::mat4 m_cullViewProjection{1.0f};
+    std::string m_cullValidation;
+    std::string m_uploadValidation;
+
+    // occlusion culling on the CPU: the cubes biggest on screen are rasterized into m_occlusion, the
+    // others are tested against its depth pyramid and only the unoccluded ones are uploaded and drawn
+    bool m_occlusionCulling = false;
+    int m_occluderCount = 64;
+    OcclusionBuffer m_occlusion;
+    std::vector<float> m_occluderScores;       // per cube, bigger is closer, 0 for unusable
+    std::vector<unsigned int> m_occluders;     // cube indices, the best m_occluderCount first
+    std::vector<OcclusionResult> m_occlusionResults;
+    std::vector<glm::mat4> m_occlusionVisible;
+    std::unique_ptr<VertexBuffer> m_occlusionInstances;
+    std::unique_ptr<VertexArray> m_occlusionVao;
+    double m_occlusionMs = 0.0;                // the whole pass, occluder selection and packing included
+    bool m_measureOverdraw = false;            // next frame counts the samples drawn with and without the culling
+    unsigned int m_samplesQuery = 0;
+    std::string m_overdrawReport;
 
     // Camera properties
     glm::vec3 m_cameraPos = {0.0f, 0.0f, 0.0f};
@@ -119,7 +198,26 @@ private:
     glm::vec3 m_cameraUp = {0.0f, 1.0f, 0.0f}; // Default up direction
     float m_yaw;    // Euler angle: yaw
     float m_pitch;  // Euler angle: pitch
+    // per movement action, seconds held since the last OnUpdate and since when it's held (0 if not),
+    // from the events' own times: a tap between two frames still moves exactly as long as it lasted
+    std::array<float, std::size_t(InputAction::Count)> m_heldSeconds{};
+    std::array<std::int64_t, std::size_t(InputAction::Count)> m_heldSinceNs{};
     // Note: Roll is not implemented for simplicity
+
+    // LOD mesh mode: every cube is replaced by an imported mesh drawn at the LOD the selector picks
+    bool m_drawLodMesh = false;
+    float m_lodThresholdPixels = 1.0f;
+    float m_lodHysteresis = 0.15f;
+    std::future<MeshImportStats> m_lodMeshImport;
+    MeshImportStats m_lodMeshImportStats; // of the last import, once it's done
+    std::unique_ptr<Mesh> m_lodMesh;
+    std::shared_ptr<Shader> m_meshShader;
+    std::shared_ptr<Shader> m_meshShaderIndirect;
+    bool m_indirectLodDraws = true; // every object of every LOD in one indirect list instead of a draw each
+    IndirectDrawList m_lodDrawList;
+    LodSelector m_lodSelector;
+    std::vector<glm::vec3> m_objectCenters; // world space, rebuilt every frame for the selector
+    std::vector<float> m_objectScales;
 };
 
 } // namespace test
\ No newline at end of file
@@ -0,0 +1,374 @@
+#include "TestJobSystem.h"
+
+#include "imgui/imgui.h"
+#include "stb_image/stb_image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+
+namespace test
+{
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    constexpr std::size_t BenchmarkQuads = 250000;
+    constexpr std::size_t BenchmarkSpheres = 1000000;
+    constexpr std::size_t BenchmarkDecodes = 32;
+    constexpr int BenchmarkRepeats = 5;
+
+    float Hash(std::uint32_t x)
+    {
+        x ^= x >> 16; x *= 0x7feb352dU;
+        x ^= x >> 15; x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return float(x & 0xFFFFFF) / float(0x1000000);
+    }
+
+    // a rotated, tinted sprite per index, the same math the batching tests do per quad
+    void GenerateQuads(std::size_t begin, std::size_t end, float time, TestJobSystem::QuadVertex* out)
+    {
+        static const float corners[4][2] = {{-0.5f, -0.5f}, {0.5f, -0.5f}, {0.5f, 0.5f}, {-0.5f, 0.5f}};
+        for (std::size_t i = begin; i < end; i++) {
+            float x = Hash(std::uint32_t(i * 3)) * 960.0f;
+            float y = Hash(std::uint32_t(i * 3 + 1)) * 540.0f;
+            float angle = time + Hash(std::uint32_t(i * 3 + 2)) * 6.2831853f;
+            float c = std::cos(angle) * 8.0f, s = std::sin(angle) * 8.0f;
+            for (int corner = 0; corner < 4; corner++) {
+                TestJobSystem::QuadVertex& v = out[i * 4 + corner];
+                v.position[0] = x + corners[corner][0] * c - corners[corner][1] * s;
+                v.position[1] = y + corners[corner][0] * s + corners[corner][1] * c;
+                v.texCoords[0] = corners[corner][0] + 0.5f;
+                v.texCoords[1] = corners[corner][1] + 0.5f;
+                v.color[0] = 0.5f + 0.5f * std::sin(angle);
+                v.color[1] = 0.5f + 0.5f * std::cos(angle);
+                v.color[2] = 1.0f;
+                v.color[3] = 1.0f;
+            }
+        }
+    }
+
+    struct Sphere
+    {
+        float center[3];
+        float radius;
+    };
+
+    // frustum of a 60 degree camera at the origin looking down -z, planes point inwards
+    const float s_frustum[6][4] = {
+        { 0.866f, 0.0f, -0.5f, 0.0f}, {-0.866f, 0.0f, -0.5f, 0.0f},
+        { 0.0f, 0.866f, -0.5f, 0.0f}, { 0.0f, -0.866f, -0.5f, 0.0f},
+        { 0.0f, 0.0f, -1.0f, -0.1f},  { 0.0f, 0.0f, 1.0f, 500.0f}};
+
+    std::size_t CullSpheres(std::size_t begin, std::size_t end, const Sphere* spheres, std::uint8_t* visible)
+    {
+        std::size_t visibleCount = 0;
+        for (std::size_t i = begin; i < end; i++) {
+            const Sphere& sphere = spheres[i];
+            bool inside = true;
+            for (const auto& plane : s_frustum) {
+                float distance = plane[0] * sphere.center[0] + plane[1] * sphere.center[1] + plane[2] * sphere.center[2] + plane[3];
+                inside &= distance > -sphere.radius;
+            }
+            visible[i] = inside;
+            visibleCount += inside;
+        }
+        return visibleCount;
+    }
+
+    template<typename Function>
+    double BestOf(int repeats, const Function& function)
+    {
+        double best = 1e30;
+        for (int i = 0; i < repeats; i++) {
+            auto start = Clock::now();
+            function();
+            best = std::min(best, MillisecondsSince(start));
+        }
+        return best;
+    }
+
+    // --- self tests, each returns true on success ---
+
+    bool TestParallelForCoverage(JobSystem& jobs)
+    {
+        constexpr std::size_t count = 1000003;
+        std::vector<std::atomic<std::uint8_t>> visits(count);
+        for (auto& visit : visits)
+            visit.store(0, std::memory_order_relaxed);
+        std::atomic<std::uint64_t> sum{0};
+        jobs.ParallelFor(count, 0, [&](std::size_t begin, std::size_t end) {
+            std::uint64_t partial = 0;
+            for (std::size_t i = begin; i < end; i++) {
+                visits[i].fetch_add(1, std::memory_order_relaxed);
+                partial += i;
+            }
+            sum.fetch_add(partial, std::memory_order_relaxed);
+        });
+        for (const auto& visit : visits)
+            if (visit.load(std::memory_order_relaxed) != 1)
+                return false;
+        return sum.load() == std::uint64_t(count) * (count - 1) / 2;
+    }
+
+    bool TestDependencyChain(JobSystem& jobs)
+    {
+        constexpr int length = 200;
+        std::atomic<int> step{0};
+        std::atomic<int> outOfOrder{0};
+        Job* chain[length];
+        for (int i = 0; i < length; i++) {
+            chain[i] = jobs.Create([&step, &outOfOrder, i] {
+                if (step.load() != i)
+                    outOfOrder.fetch_add(1);
+                step.store(i + 1);
+            });
+            if (i > 0)
+                jobs.AddDependency(chain[i], chain[i - 1]);
+        }
+        // started back to front, so every job but the first waits for its dependency
+        JobCounter counter;
+        for (int i = length - 1; i >= 0; i--)
+            jobs.Run(chain[i], &counter);
+        jobs.Wait(counter);
+        return outOfOrder.load() == 0 && step.load() == length;
+    }
+
+    bool TestDiamondDependencies(JobSystem& jobs)
+    {
+        bool passed = true;
+        for (int iteration = 0; iteration < 500 && passed; iteration++) {
+            std::atomic<int> done{0};
+            std::atomic<bool> ok{true};
+            Job* top = jobs.Create([&] { done.fetch_or(1); });
+            Job* left = jobs.Create([&] { if (!(done.load() & 1)) ok = false; done.fetch_or(2); });
+            Job* right = jobs.Create([&] { if (!(done.load() & 1)) ok = false; done.fetch_or(4); });
+            Job* bottom = jobs.Create([&] { if (done.load() != 7) ok = false; done.fetch_or(8); });
+            jobs.AddDependency(left, top);
+            jobs.AddDependency(right, top);
+            jobs.AddDependency(bottom, left);
+            jobs.AddDependency(bottom, right);
+            JobCounter counter;
+            jobs.Run(bottom, &counter);
+            jobs.Run(left, &counter);
+            jobs.Run(right, &counter);
+            jobs.Run(top, &counter);
+            jobs.Wait(counter);
+            passed = ok.load() && done.load() == 15;
+        }
+        return passed;
+    }
+
+    bool TestNestedParallelFor(JobSystem& jobs)
+    {
+        std::atomic<std::uint64_t> total{0};
+        jobs.ParallelFor(64, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t outer = begin; outer < end; outer++) {
+                // waiting inside a job runs other jobs instead of blocking the worker
+                jobs.ParallelFor(10000, 100, [&](std::size_t innerBegin, std::size_t innerEnd) {
+                    total.fetch_add(innerEnd - innerBegin, std::memory_order_relaxed);
+                });
+            }
+        });
+        return total.load() == 64u * 10000u;
+    }
+
+    bool TestJobRingWrap(JobSystem& jobs)
+    {
+        // more jobs in flight than the ring and the deque hold
+        const int count = int(JobSystem::MaxJobsPerThread) * 5;
+        std::atomic<int> executed{0};
+        JobCounter counter;
+        for (int i = 0; i < count; i++)
+            jobs.Run([&executed] { executed.fetch_add(1, std::memory_order_relaxed); }, &counter);
+        jobs.Wait(counter);
+        return executed.load() == count;
+    }
+
+    bool TestManySmallWaits(JobSystem& jobs)
+    {
+        // short bursts with idle time between them, exercises workers going to sleep and waking up
+        std::atomic<int> executed{0};
+        for (int burst = 0; burst < 2000; burst++) {
+            JobCounter counter;
+            for (int i = 0; i < 4; i++)
+                jobs.Run([&executed] { executed.fetch_add(1, std::memory_order_relaxed); }, &counter);
+            jobs.Wait(counter);
+            if (burst % 200 == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return executed.load() == 2000 * 4;
+    }
+}
+
+TestJobSystem::TestJobSystem()
+{
+    for (const char* path : {"res/Textures/cute.png", "res/Textures/ChernoLogo.png"}) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cout << "Error (JOBS): could not open " << path << std::endl;
+            continue;
+        }
+        m_encodedImages.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+}
+
+TestJobSystem::~TestJobSystem()
+{
+}
+
+void TestJobSystem::OnUpdate(float deltaTime)
+{
+    if (!m_generateEveryFrame)
+        return;
+
+    std::size_t quads = std::size_t(m_quadsPerFrame);
+    m_vertices.resize(quads * 4);
+    QuadVertex* out = m_vertices.data();
+    float time = float(ImGui::GetTime());
+
+    auto start = Clock::now();
+    if (m_useJobs)
+        Jobs::Get().ParallelFor(quads, 2048, [=](std::size_t begin, std::size_t end) { GenerateQuads(begin, end, time, out); });
+    else
+        GenerateQuads(0, quads, time, out);
+    m_frameGenerateMs = MillisecondsSince(start);
+}
+
+void TestJobSystem::RunSelfTests()
+{
+    struct Suite
+    {
+        const char* name;
+        bool (*function)(JobSystem&);
+    };
+    const Suite suites[] = {
+        {"parallel_for visits every index once", &TestParallelForCoverage},
+        {"dependency chain runs in order", &TestDependencyChain},
+        {"diamond dependencies", &TestDiamondDependencies},
+        {"nested parallel_for", &TestNestedParallelFor},
+        {"job ring and deque wrap around", &TestJobRingWrap},
+        {"workers sleep and wake up", &TestManySmallWaits},
+    };
+
+    m_selfTests.clear();
+    JobSystem& jobs = Jobs::Get();
+    for (const Suite& suite : suites) {
+        auto start = Clock::now();
+        bool passed = suite.function(jobs);
+        m_selfTests.push_back({suite.name, passed, MillisecondsSince(start)});
+        if (!passed)
+            std::cout << "Error (JOBS): self test failed: " << suite.name << std::endl;
+    }
+}
+
+void TestJobSystem::RunScalingBenchmark()
+{
+    std::vector<QuadVertex> vertices(BenchmarkQuads * 4);
+    std::vector<Sphere> spheres(BenchmarkSpheres);
+    std::vector<std::uint8_t> visible(BenchmarkSpheres);
+    for (std::size_t i = 0; i < BenchmarkSpheres; i++) {
+        spheres[i].center[0] = (Hash(std::uint32_t(i * 4)) - 0.5f) * 1000.0f;
+        spheres[i].center[1] = (Hash(std::uint32_t(i * 4 + 1)) - 0.5f) * 1000.0f;
+        spheres[i].center[2] = -Hash(std::uint32_t(i * 4 + 2)) * 600.0f;
+        spheres[i].radius = 0.5f + Hash(std::uint32_t(i * 4 + 3)) * 4.0f;
+    }
+
+    m_scaling.clear();
+    const unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads = 1; threads <= maxThreads; threads++) {
+        JobSystem jobs(threads - 1);
+        ScalingResult result = {threads, 0.0, 0.0, 0.0};
+
+        result.vertexMs = BestOf(BenchmarkRepeats, [&] {
+            QuadVertex* out = vertices.data();
+            jobs.ParallelFor(BenchmarkQuads, 2048, [=](std::size_t begin, std::size_t end) { GenerateQuads(begin, end, 1.0f, out); });
+        });
+
+        result.cullMs = BestOf(BenchmarkRepeats, [&] {
+            std::atomic<std::size_t> visibleCount{0};
+            jobs.ParallelFor(BenchmarkSpheres, 8192, [&](std::size_t begin, std::size_t end) {
+                visibleCount.fetch_add(CullSpheres(begin, end, spheres.data(), visible.data()), std::memory_order_relaxed);
+            });
+        });
+
+        if (!m_encodedImages.empty()) {
+            result.decodeMs = BestOf(BenchmarkRepeats, [&] {
+                jobs.ParallelFor(BenchmarkDecodes, 1, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t i = begin; i < end; i++) {
+                        const std::vector<unsigned char>& file = m_encodedImages[i % m_encodedImages.size()];
+                        int width, height, channels;
+                        stbi_uc* pixels = stbi_load_from_memory(file.data(), int(file.size()), &width, &height, &channels, 4);
+                        stbi_image_free(pixels);
+                    }
+                });
+            });
+        }
+        m_scaling.push_back(result);
+    }
+}
+
+void TestJobSystem::OnImGuiRender()
+{
+    JobSystem& jobs = Jobs::Get();
+    ImGui::Text("Job system: main thread + %u workers", jobs.GetWorkerCount());
+
+    if (ImGui::Button("Run self tests"))
+        RunSelfTests();
+    for (const SelfTestResult& result : m_selfTests)
+        ImGui::TextColored(result.passed ? ImVec4(0.4f, 1.0f, 0.4f, 1.0f) : ImVec4(1.0f, 0.3f, 0.3f, 1.0f),
+                           "%s %s (%.2f ms)", result.passed ? "PASS" : "FAIL", result.name, result.timeMs);
+
+    ImGui::Separator();
+    if (ImGui::Button("Run scaling benchmark"))
+        RunScalingBenchmark();
+    ImGui::SameLine();
+    ImGui::Text("%zu quads, %zu spheres, %zu PNG decodes, best of %d", BenchmarkQuads, BenchmarkSpheres,
+                BenchmarkDecodes, BenchmarkRepeats);
+    if (!m_scaling.empty() && ImGui::BeginTable("scaling", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("threads");
+        ImGui::TableSetupColumn("vertices ms (speedup)");
+        ImGui::TableSetupColumn("culling ms (speedup)");
+        ImGui::TableSetupColumn("decode ms (speedup)");
+        ImGui::TableHeadersRow();
+        const ScalingResult& single = m_scaling.front();
+        for (const ScalingResult& result : m_scaling) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", result.threads);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f (%.2fx)", result.vertexMs, single.vertexMs / result.vertexMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f (%.2fx)", result.cullMs, single.cullMs / result.cullMs);
+            ImGui::TableNextColumn();
+            if (result.decodeMs > 0.0)
+                ImGui::Text("%.2f (%.2fx)", result.decodeMs, single.decodeMs / result.decodeMs);
+            else
+                ImGui::Text("-");
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Separator();
+    ImGui::Checkbox("Generate quads in OnUpdate", &m_generateEveryFrame);
+    ImGui::SameLine();
+    ImGui::Checkbox("Use jobs", &m_useJobs);
+    ImGui::SliderInt("Quads per frame", &m_quadsPerFrame, 1000, 1000000);
+    if (m_generateEveryFrame)
+        ImGui::Text("Vertex generation: %.3f ms", m_frameGenerateMs);
+
+    ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+}
+
+} // namespace test
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Test.h"
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+
+namespace test
+{
+
+// self tests and scaling benchmarks for the job system. The benchmarks are the kind of work
+// tests do in OnUpdate: quad vertex generation, sphere/frustum culling and PNG decoding
+class TestJobSystem : public Test
+{
+public:
+    TestJobSystem();
+    ~TestJobSystem() override;
+
+    void OnUpdate(float deltaTime) override;
+    void OnImGuiRender() override;
+
+    struct QuadVertex
+    {
+        float position[2];
+        float texCoords[2];
+        float color[4];
+    };
+
+private:
+    struct SelfTestResult
+    {
+        const char* name;
+        bool passed;
+        double timeMs;
+    };
+
+    struct ScalingResult
+    {
+        unsigned int threads;
+        double vertexMs;
+        double cullMs;
+        double decodeMs;
+    };
+
+    void RunSelfTests();
+    void RunScalingBenchmark();
+
+    std::vector<SelfTestResult> m_selfTests;
+    std::vector<ScalingResult> m_scaling;
+
+    // per frame workload through the application's job system
+    bool m_generateEveryFrame = false;
+    bool m_useJobs = true;
+    int m_quadsPerFrame = 100000;
+    double m_frameGenerateMs = 0.0;
+    std::vector<QuadVertex> m_vertices;
+
+    std::vector<std::vector<unsigned char>> m_encodedImages; // PNG files for the decode benchmark
+};
+
+} // namespace test
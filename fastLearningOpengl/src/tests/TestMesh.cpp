@@ -0,0 +1,126 @@
+#include "TestMesh.h"
+#include "ShaderLibrary.h"
+#include "FrameClock.h"
+
+#include "MeshOptimizer.h"
+#include "imgui/imgui.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+namespace test
+{
+
+TestMesh::TestMesh()
+    : m_proj(glm::perspective(glm::radians(45.0f), 960.0f / 540.0f, 0.1f, 100.0f)),
+      m_view(glm::lookAt(glm::vec3(0.0f, 1.5f, 4.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)))
+{
+    m_shader = Shaders::Get().Get("res/Shaders/Mesh.shader");
+
+    for (const char* name : {"torus", "icosphere"}) {
+        Model model;
+        model.objPath = std::string("res/Models/") + name + ".obj";
+        model.meshPath = std::string("res/Models/") + name + ".mesh";
+        m_models.push_back(std::move(model));
+    }
+
+    // every stale model is imported on its own worker thread
+    for (auto& model : m_models) {
+        if (MeshImporter::IsUpToDate(model.objPath, model.meshPath))
+            model.mesh = std::make_unique<Mesh>(model.meshPath);
+        else
+            StartImport(model);
+    }
+}
+
+TestMesh::~TestMesh()
+{
+    // std::future destructors block until the workers finish
+    glCall(glDisable(GL_DEPTH_TEST));
+}
+
+void TestMesh::StartImport(Model& model)
+{
+    model.mesh.reset();
+    model.pendingImport = MeshImporter::ImportAsync(model.objPath, model.meshPath);
+}
+
+void TestMesh::OnFixedUpdate(float step)
+{
+    m_previousRotation = m_rotation;
+    m_rotation += step * 30.0f;
+}
+
+void TestMesh::OnUpdate([[maybe_unused]] float deltaTime)
+{
+    // uploads have to happen on the GL thread, so finished imports are picked up here
+    for (auto& model : m_models) {
+        if (!model.pendingImport.valid())
+            continue;
+        if (model.pendingImport.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            continue;
+        model.stats = model.pendingImport.get();
+        if (model.stats.success)
+            model.mesh = std::make_unique<Mesh>(model.meshPath);
+    }
+}
+
+void TestMesh::OnRender()
+{
+    glCall(glEnable(GL_DEPTH_TEST));
+    glCall(glClearColor(0.1f, 0.1f, 0.1f, 1.0f));
+    glCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+    const Model& model = m_models[m_selectedModel];
+    if (!model.mesh || !model.mesh->IsValid())
+        return;
+
+    glm::vec3 center = (model.mesh->GetBoundsMin() + model.mesh->GetBoundsMax()) * 0.5f;
+    float extent = glm::length(model.mesh->GetBoundsMax() - model.mesh->GetBoundsMin());
+    glm::mat4 transform = glm::rotate(glm::mat4(1.0f), glm::radians(glm::mix(m_previousRotation, m_rotation, Time::Get().GetAlpha())),
+                                      glm::vec3(0.3f, 1.0f, 0.0f));
+    transform = glm::scale(transform, glm::vec3(2.5f / extent));
+    transform = glm::translate(transform, -center);
+
+    m_shader->Bind();
+    m_shader->SetUniformMat4f("model", transform);
+    m_shader->SetUniformMat4f("view", m_view);
+    m_shader->SetUniformMat4f("projection", m_proj);
+    m_shader->SetUniform4f("u_Color", m_color[0], m_color[1], m_color[2], m_color[3]);
+    m_shader->SetUniform3f("u_LightDir", -0.4f, -0.6f, -0.7f);
+    m_renderer.Draw(model.mesh->GetVertexArray(), model.mesh->GetIndexBuffer(), *m_shader);
+}
+
+void TestMesh::OnImGuiRender()
+{
+    for (int i = 0; i < int(m_models.size()); i++) {
+        const Model& model = m_models[i];
+        ImGui::PushID(i);
+        ImGui::RadioButton(model.objPath.c_str(), &m_selectedModel, i);
+        ImGui::Indent();
+        if (model.pendingImport.valid()) {
+            ImGui::Text("importing on a worker thread...");
+        } else {
+            if (model.stats.success) {
+                ImGui::Text("import %.2f ms, optimize %.2f ms, write %.2f ms",
+                            model.stats.importTimeMs, model.stats.optimizeTimeMs, model.stats.writeTimeMs);
+                ImGui::Text("ACMR (cache %u) %.3f -> %.3f", MeshOptimizer::VertexCacheSize,
+                            model.stats.acmrBefore, model.stats.acmrAfter);
+                ImGui::Text("%u LODs generated in %.2f ms", model.stats.lodCount, model.stats.lodTimeMs);
+            } else if (model.stats.sourcePath.empty()) {
+                ImGui::Text("binary mesh was up to date, import skipped");
+            } else {
+                ImGui::Text("import failed, see the console");
+            }
+            if (model.mesh && model.mesh->IsValid())
+                ImGui::Text("%u vertices, %u triangles, mmap load %.3f ms",
+                            model.mesh->GetVertexCount(), model.mesh->GetTriangleCount(), model.mesh->GetLoadTimeMs());
+            if (ImGui::Button("Re-import"))
+                StartImport(m_models[i]);
+        }
+        ImGui::Unindent();
+        ImGui::PopID();
+    }
+    ImGui::ColorEdit4("Mesh Color", m_color);
+    ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+}
+
+} // namespace test
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Test.h"
+#include "glm/glm.hpp"
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+#include "MeshImporter.h"
+#include "Shader.h"
+#include "Renderer.h"
+
+namespace test
+{
+
+class TestMesh : public Test
+{
+public:
+    TestMesh();
+    ~TestMesh() override;
+
+    void OnFixedUpdate(float step) override;
+    void OnUpdate(float deltaTime) override;
+    void OnRender() override;
+    void OnImGuiRender() override;
+
+private:
+    struct Model
+    {
+        std::string objPath;
+        std::string meshPath;
+        std::future<MeshImportStats> pendingImport; // valid while a worker is importing
+        MeshImportStats stats;
+        std::unique_ptr<Mesh> mesh;
+    };
+
+    void StartImport(Model& model);
+
+    std::vector<Model> m_models;
+    int m_selectedModel = 0;
+
+    std::shared_ptr<Shader> m_shader;
+    Renderer m_renderer;
+
+    glm::mat4 m_proj;
+    glm::mat4 m_view;
+    float m_rotation = 0.0f;         // degrees at the last fixed step
+    float m_previousRotation = 0.0f; // and at the one before, rendering interpolates between them
+    float m_color[4] = {0.9f, 0.6f, 0.3f, 1.0f};
+};
+
+} // namespace test
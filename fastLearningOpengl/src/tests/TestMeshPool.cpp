@@ -0,0 +1,276 @@
+#include "TestMeshPool.h"
+#include "ShaderLibrary.h"
+#include "FrameClock.h"
+
+#include "VertexBufferLayout.h"
+#include "imgui/imgui.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <chrono>
+#include <cmath>
+
+namespace test
+{
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    constexpr int GridColumns = 64;
+    constexpr float GridSpacing = 1.5f;
+    constexpr int BenchmarkRepeats = 8;
+
+    const char* s_drawPathNames[] = {"Buffers per mesh", "Shared pool, draw per mesh", "Shared pool, indirect list"};
+
+    // a closed prism around the y axis, flat shaded: sides, then both caps as fans
+    void BuildPrism(unsigned int segments, float radius, float height, std::vector<MeshVertex>& vertices, std::vector<unsigned int>& indices)
+    {
+        const float tau = 6.28318530718f;
+        for (unsigned int i = 0; i < segments; i++) {
+            float a0 = tau * float(i) / float(segments), a1 = tau * float(i + 1) / float(segments);
+            float mid = (a0 + a1) * 0.5f;
+            glm::vec3 normal(std::cos(mid), 0.0f, std::sin(mid));
+            unsigned int base = unsigned(vertices.size());
+            for (float angle : {a0, a1}) {
+                float x = std::cos(angle) * radius, z = std::sin(angle) * radius;
+                vertices.push_back({{x, 0.0f, z}, {normal.x, 0.0f, normal.z}, {angle / tau, 0.0f}});
+                vertices.push_back({{x, height, z}, {normal.x, 0.0f, normal.z}, {angle / tau, 1.0f}});
+            }
+            indices.insert(indices.end(), {base, base + 1, base + 3, base, base + 3, base + 2});
+        }
+        for (float y : {0.0f, height}) {
+            float ny = y == 0.0f ? -1.0f : 1.0f;
+            unsigned int center = unsigned(vertices.size());
+            vertices.push_back({{0.0f, y, 0.0f}, {0.0f, ny, 0.0f}, {0.5f, 0.5f}});
+            for (unsigned int i = 0; i < segments; i++) {
+                float angle = tau * float(i) / float(segments);
+                vertices.push_back({{std::cos(angle) * radius, y, std::sin(angle) * radius}, {0.0f, ny, 0.0f},
+                                    {0.5f + std::cos(angle) * 0.5f, 0.5f + std::sin(angle) * 0.5f}});
+            }
+            for (unsigned int i = 0; i < segments; i++) {
+                unsigned int a = center + 1 + i, b = center + 1 + (i + 1) % segments;
+                if (ny > 0.0f)
+                    indices.insert(indices.end(), {center, b, a});
+                else
+                    indices.insert(indices.end(), {center, a, b});
+            }
+        }
+    }
+}
+
+TestMeshPool::TestMeshPool()
+    : m_proj(glm::perspective(glm::radians(45.0f), 960.0f / 540.0f, 0.1f, 500.0f)),
+      m_view(glm::lookAt(glm::vec3(0.0f, 60.0f, 70.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)))
+{
+    m_shader = Shaders::Get().Get("res/Shaders/Mesh.shader");
+    m_indirectShader = Shaders::Get().Get("res/Shaders/Mesh.shader", {"INDIRECT"});
+
+    // 3 to 24 sides: 14 to 146 vertices, so the pool sees blocks of many different sizes
+    for (unsigned int segments = 3; segments <= 24; segments++) {
+        Shape shape;
+        BuildPrism(segments, 0.5f, 0.4f + 0.05f * float(segments), shape.vertices, shape.indices);
+        m_shapes.push_back(std::move(shape));
+    }
+    m_slots.resize(MaxMeshes);
+    SetMeshCount(m_meshCount);
+}
+
+TestMeshPool::~TestMeshPool()
+{
+    glCall(glDisable(GL_DEPTH_TEST));
+}
+
+void TestMeshPool::Fill(int index)
+{
+    Slot& slot = m_slots[index];
+    if (slot.vao)
+        return;
+    const Shape& shape = m_shapes[index % m_shapes.size()];
+    slot.handle = m_pool.Add(shape.vertices.data(), unsigned(shape.vertices.size()), shape.indices.data(), unsigned(shape.indices.size()));
+
+    slot.vao = std::make_unique<VertexArray>();
+    slot.vertexBuffer = std::make_unique<VertexBuffer>(shape.vertices.data(), unsigned(shape.vertices.size() * sizeof(MeshVertex)));
+    VertexBufferLayout layout;
+    layout.Push<float>(3); // position
+    layout.Push<float>(3); // normal
+    layout.Push<float>(2); // texture coordinates
+    slot.vao->AddBuffer(*slot.vertexBuffer, layout);
+    slot.indexBuffer = std::make_unique<ElementIndexBuffer>(shape.indices.data(), unsigned(shape.indices.size()));
+    slot.vao->Unbind();
+}
+
+void TestMeshPool::Empty(int index)
+{
+    Slot& slot = m_slots[index];
+    if (!slot.vao)
+        return;
+    m_pool.Remove(slot.handle);
+    slot.handle = MeshPool::InvalidHandle;
+    slot.vao.reset();
+    slot.vertexBuffer.reset();
+    slot.indexBuffer.reset();
+}
+
+void TestMeshPool::SetMeshCount(int count)
+{
+    for (int i = 0; i < MaxMeshes; i++) {
+        if (i < count)
+            Fill(i);
+        else
+            Empty(i);
+    }
+}
+
+void TestMeshPool::OnFixedUpdate(float step)
+{
+    m_previousRotation = m_rotation;
+    m_rotation += step * 45.0f;
+}
+
+void TestMeshPool::DrawMeshes(DrawPath path, int count)
+{
+    Shader& shader = path == DrawPath::Indirect ? *m_indirectShader : *m_shader;
+    shader.Bind();
+    shader.SetUniformMat4f("view", m_view);
+    shader.SetUniformMat4f("projection", m_proj);
+    shader.SetUniform3f("u_LightDir", -0.4f, -0.6f, -0.7f);
+
+    const int rows = (m_meshCount + GridColumns - 1) / GridColumns;
+    const float rotation = glm::mix(m_previousRotation, m_rotation, Time::Get().GetAlpha());
+    m_drawList.Clear();
+    for (int i = 0; i < count; i++) {
+        const Slot& slot = m_slots[i];
+        if (!slot.vao)
+            continue;
+        glm::vec3 position((float(i % GridColumns) - GridColumns * 0.5f) * GridSpacing, 0.0f,
+                           (float(i / GridColumns) - rows * 0.5f) * GridSpacing);
+        glm::mat4 model = glm::rotate(glm::translate(glm::mat4(1.0f), position), glm::radians(rotation + float(i) * 7.0f),
+                                      glm::vec3(0.0f, 1.0f, 0.0f));
+        float shade = float(i % m_shapes.size()) / float(m_shapes.size());
+        glm::vec4 color(0.4f + 0.6f * shade, 0.7f, 1.0f - 0.6f * shade, 1.0f);
+
+        if (path == DrawPath::Indirect) {
+            m_drawList.Add(m_pool.GetIndexCount(slot.handle), m_pool.GetFirstIndex(slot.handle), m_pool.GetBaseVertex(slot.handle), model, color);
+            continue;
+        }
+        shader.SetUniformMat4f("model", model);
+        shader.SetUniform4f("u_Color", color.r, color.g, color.b, color.a);
+        if (path == DrawPath::SharedPool)
+            m_pool.Draw(m_renderer, slot.handle, shader);
+        else
+            m_renderer.Draw(*slot.vao, *slot.indexBuffer, shader);
+    }
+    if (path == DrawPath::Indirect)
+        m_drawList.Draw(m_pool.GetVertexArray(), m_pool.GetIndexBuffer(), shader);
+}
+
+void TestMeshPool::RunBenchmark()
+{
+    // glFinish on both ends, so the time covers what the driver and the GPU do with the calls too
+    m_benchmark.clear();
+    for (int meshes = 16; meshes <= m_meshCount; meshes *= 2) {
+        BenchmarkRow row{meshes, 0.0, 0.0};
+        for (DrawPath path : {DrawPath::SharedPool, DrawPath::Indirect}) {
+            glCall(glFinish());
+            auto start = Clock::now();
+            for (int repeat = 0; repeat < BenchmarkRepeats; repeat++)
+                DrawMeshes(path, meshes);
+            glCall(glFinish());
+            double ms = MillisecondsSince(start) / BenchmarkRepeats;
+            (path == DrawPath::Indirect ? row.indirectMs : row.loopMs) = ms;
+        }
+        m_benchmark.push_back(row);
+    }
+}
+
+void TestMeshPool::OnRender()
+{
+    glCall(glEnable(GL_DEPTH_TEST));
+    glCall(glClearColor(0.1f, 0.1f, 0.1f, 1.0f));
+    glCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+    if (m_benchmarkRequested) {
+        m_benchmarkRequested = false;
+        RunBenchmark();
+        glCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    }
+
+    auto start = Clock::now();
+    DrawMeshes(DrawPath(m_drawPath), m_meshCount);
+    m_drawMs = MillisecondsSince(start);
+}
+
+void TestMeshPool::OnImGuiRender()
+{
+    if (ImGui::SliderInt("Meshes", &m_meshCount, 1, MaxMeshes))
+        SetMeshCount(m_meshCount);
+    for (int path = 0; path < int(DrawPath::Count); path++)
+        ImGui::RadioButton(s_drawPathNames[path], &m_drawPath, path);
+    bool forceLoop = IndirectDraw::IsLoopForced();
+    if (ImGui::Checkbox("Indirect list as a draw loop (GL 3.3 path)", &forceLoop))
+        IndirectDraw::SetForceLoop(forceLoop);
+    if (ImGui::Button("Remove every other mesh")) {
+        for (int i = 1; i < m_meshCount; i += 2)
+            Empty(i);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Refill"))
+        SetMeshCount(m_meshCount);
+    ImGui::SameLine();
+    if (ImGui::Button("Defragment"))
+        m_pool.Defragment();
+
+    int live = 0;
+    for (int i = 0; i < m_meshCount; i++)
+        live += m_slots[i].vao ? 1 : 0;
+    if (m_drawPath == int(DrawPath::SeparateBuffers))
+        ImGui::Text("%d draws from %d vertex arrays, %d buffers", live, live, live * 2);
+    else if (m_drawPath == int(DrawPath::SharedPool))
+        ImGui::Text("%d draws from 1 vertex array, 2 buffers", live);
+    else
+        ImGui::Text("%d commands, %s (upload %.3f ms, submit %.3f ms)", live, IndirectDraw::GetModeName(),
+                    m_drawList.GetUploadMs(), m_drawList.GetSubmitMs());
+    ImGui::Text("draw submission %.3f ms (CPU)", m_drawMs);
+
+    MeshPoolStats stats = m_pool.GetStats();
+    ImGui::Text("pool: %u meshes, vertices %u / %u, indices %u / %u", stats.meshes, stats.verticesUsed, stats.vertexCapacity,
+                stats.indicesUsed, stats.indexCapacity);
+    ImGui::Text("fragmentation vertices %.2f, indices %.2f, %u free blocks", stats.vertexFragmentation, stats.indexFragmentation,
+                stats.freeBlocks);
+    ImGui::Text("grown %u times, defragmented %u times (last %.3f ms)", stats.grows, stats.defragmentations, stats.lastDefragmentMs);
+
+    if (ImGui::Button("Benchmark draw loop vs indirect"))
+        m_benchmarkRequested = true;
+    if (!m_benchmark.empty() && ImGui::BeginTable("indirect", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Meshes");
+        ImGui::TableSetupColumn("Draw loop ms");
+        ImGui::TableSetupColumn("Indirect ms");
+        ImGui::TableHeadersRow();
+        for (const BenchmarkRow& row : m_benchmark) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%d", row.meshes);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", row.loopMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", row.indirectMs);
+        }
+        ImGui::EndTable();
+        // the first count from which on the list stays ahead
+        int crossover = -1;
+        for (auto it = m_benchmark.rbegin(); it != m_benchmark.rend() && it->indirectMs < it->loopMs; ++it)
+            crossover = it->meshes;
+        if (crossover > 0)
+            ImGui::Text("indirect is faster from %d meshes on (%s)", crossover, IndirectDraw::GetModeName());
+        else
+            ImGui::Text("the draw loop was faster at every count (%s)", IndirectDraw::GetModeName());
+    }
+    ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+}
+
+} // namespace test
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Test.h"
+#include "glm/glm.hpp"
+#include <memory>
+#include <vector>
+#include "Mesh.h"
+#include "MeshPool.h"
+#include "IndirectDraw.h"
+#include "Shader.h"
+#include "Renderer.h"
+
+namespace test
+{
+
+// a grid of small prisms (a few dozen vertices each), drawn from a vertex array, vertex buffer and index
+// buffer per mesh, from one MeshPool with a draw per mesh, or from the pool with one indirect draw list.
+// Removing every other mesh fragments the pool
+class TestMeshPool : public Test
+{
+public:
+    TestMeshPool();
+    ~TestMeshPool() override;
+
+    void OnFixedUpdate(float step) override;
+    void OnRender() override;
+    void OnImGuiRender() override;
+
+    static constexpr int MaxMeshes = 4096;
+
+    enum class DrawPath
+    {
+        SeparateBuffers,
+        SharedPool,     // uniforms and a base vertex draw per mesh
+        Indirect,       // one IndirectDrawList for all of them
+        Count
+    };
+
+private:
+    struct Shape
+    {
+        std::vector<MeshVertex> vertices;
+        std::vector<unsigned int> indices;
+    };
+    // one grid cell, present in both representations so switching costs nothing
+    struct Slot
+    {
+        MeshPool::Handle handle = MeshPool::InvalidHandle;
+        std::unique_ptr<VertexArray> vao;
+        std::unique_ptr<VertexBuffer> vertexBuffer;
+        std::unique_ptr<ElementIndexBuffer> indexBuffer;
+    };
+
+    void Fill(int index);
+    void Empty(int index);
+    void SetMeshCount(int count);
+    void DrawMeshes(DrawPath path, int count);
+    void RunBenchmark();
+
+    std::vector<Shape> m_shapes;
+    std::vector<Slot> m_slots;
+    MeshPool m_pool;
+    std::shared_ptr<Shader> m_shader;
+    std::shared_ptr<Shader> m_indirectShader;
+    IndirectDrawList m_drawList;
+    Renderer m_renderer;
+
+    glm::mat4 m_proj;
+    glm::mat4 m_view;
+    float m_rotation = 0.0f;         // degrees at the last fixed step
+    float m_previousRotation = 0.0f;
+
+    int m_meshCount = 1024;
+    int m_drawPath = int(DrawPath::Indirect);
+    double m_drawMs = 0.0;
+
+    // per draw loop against the indirect list at growing mesh counts, wall time with glFinish around it
+    struct BenchmarkRow
+    {
+        int meshes;
+        double loopMs;
+        double indirectMs;
+    };
+    std::vector<BenchmarkRow> m_benchmark;
+    bool m_benchmarkRequested = false;
+};
+
+} // namespace test
@@ -0,0 +1,255 @@
+#include "TestRenderGraph.h"
+#include "ShaderLibrary.h"
+#include "FrameClock.h"
+
+#include "Mesh.h"
+#include "VertexBufferLayout.h"
+#include "imgui/imgui.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace test
+{
+
+namespace
+{
+    constexpr int MaxCubes = 64;
+
+    // a unit cube, flat shaded: 4 vertices per face
+    void BuildCube(std::vector<MeshVertex>& vertices, std::vector<unsigned int>& indices)
+    {
+        const glm::vec3 normals[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+        for (const glm::vec3& normal : normals) {
+            // two axes across the face, their cross product is the normal so the winding is counter clockwise
+            glm::vec3 u = glm::abs(normal.y) > 0.5f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+            glm::vec3 v = glm::cross(normal, u);
+            unsigned int base = unsigned(vertices.size());
+            const float corners[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+            for (const auto& corner : corners) {
+                glm::vec3 p = (normal + u * corner[0] + v * corner[1]) * 0.5f;
+                vertices.push_back({{p.x, p.y, p.z}, {normal.x, normal.y, normal.z}, {corner[0] * 0.5f + 0.5f, corner[1] * 0.5f + 0.5f}});
+            }
+            indices.insert(indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+        }
+    }
+}
+
+TestRenderGraph::TestRenderGraph()
+    : m_proj(glm::perspective(glm::radians(45.0f), 960.0f / 540.0f, 0.1f, 100.0f)),
+      m_view(glm::lookAt(glm::vec3(0.0f, 4.0f, 9.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)))
+{
+    m_meshShader = Shaders::Get().Get("res/Shaders/Mesh.shader");
+    m_thresholdShader = Shaders::Get().Get("res/Shaders/Bloom.shader", {"THRESHOLD"});
+    m_blurShader = Shaders::Get().Get("res/Shaders/Bloom.shader", {"BLUR"});
+    m_luminanceShader = Shaders::Get().Get("res/Shaders/Bloom.shader", {"LUMINANCE"});
+    m_compositeShaders[0] = Shaders::Get().Get("res/Shaders/Bloom.shader");
+    m_compositeShaders[1] = Shaders::Get().Get("res/Shaders/Bloom.shader", {"BLOOM"});
+    m_compositeShaders[2] = Shaders::Get().Get("res/Shaders/Bloom.shader", {"OVERLAY"});
+    m_compositeShaders[3] = Shaders::Get().Get("res/Shaders/Bloom.shader", {"BLOOM", "OVERLAY"});
+
+    std::vector<MeshVertex> vertices;
+    std::vector<unsigned int> indices;
+    BuildCube(vertices, indices);
+    m_vao = std::make_unique<VertexArray>();
+    m_vertexBuffer = std::make_unique<VertexBuffer>(vertices.data(), unsigned(vertices.size() * sizeof(MeshVertex)));
+    VertexBufferLayout layout;
+    layout.Push<float>(3); // position
+    layout.Push<float>(3); // normal
+    layout.Push<float>(2); // texture coordinates
+    m_vao->AddBuffer(*m_vertexBuffer, layout);
+    m_vao->Unbind();
+    m_indexBuffer = std::make_unique<ElementIndexBuffer>(indices.data(), unsigned(indices.size()));
+}
+
+void TestRenderGraph::OnFixedUpdate(float step)
+{
+    m_previousRotation = m_rotation;
+    m_rotation += step * 20.0f;
+}
+
+void TestRenderGraph::DrawCubes(Shader& shader, bool shaded)
+{
+    shader.Bind();
+    shader.SetUniformMat4f("view", m_view);
+    shader.SetUniformMat4f("projection", m_proj);
+    shader.SetUniform3f("u_LightDir", -0.4f, -0.6f, -0.7f);
+    const float rotation = glm::mix(m_previousRotation, m_rotation, Time::Get().GetAlpha());
+    for (int i = 0; i < m_cubeCount; i++) {
+        float angle = glm::radians(rotation + 360.0f * float(i) / float(m_cubeCount));
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(std::cos(angle) * 3.5f, 0.0f, std::sin(angle) * 3.5f));
+        model = glm::rotate(model, angle * 2.0f, glm::vec3(0.3f, 1.0f, 0.2f));
+        model = glm::scale(model, glm::vec3(0.7f));
+        shader.SetUniformMat4f("model", model);
+        if (shaded) {
+            // every fourth one glows, over 1 it's what the bloom picks up
+            const float glow = i % 4 == 0 ? m_glow : 1.0f;
+            glm::vec3 color = i % 4 == 0 ? glm::vec3(1.0f, 0.6f, 0.2f) : glm::vec3(0.3f, 0.5f, 0.8f);
+            shader.SetUniform4f("u_Color", color.r * glow, color.g * glow, color.b * glow, 1.0f);
+        }
+        m_renderer.Draw(*m_vao, *m_indexBuffer, shader);
+    }
+}
+
+void TestRenderGraph::DrawFullscreen(Shader& shader, const RenderGraphContext& context, RenderGraphResource source)
+{
+    context.BindTexture(source, 0);
+    shader.Bind();
+    shader.SetUniform1i("u_Source", 0);
+    m_renderer.DrawFullscreen(shader);
+}
+
+void TestRenderGraph::OnRender()
+{
+    // declared from scratch every frame, the graph works out what actually runs
+    m_graph.Reset();
+    RenderGraphResource output = m_graph.ImportBound("output");
+    const unsigned int width = std::max(1u, m_graph.GetSpec(output).width), height = std::max(1u, m_graph.GetSpec(output).height);
+    m_proj = glm::perspective(glm::radians(45.0f), float(width) / float(height), 0.1f, 100.0f);
+
+    FramebufferSpec sceneSpec;
+    sceneSpec.width = width;
+    sceneSpec.height = height;
+    sceneSpec.colorFormat = GL_RGBA16F;
+    FramebufferSpec halfSpec;
+    halfSpec.width = std::max(1u, width / 2);
+    halfSpec.height = std::max(1u, height / 2);
+    halfSpec.colorFormat = GL_RGBA16F;
+    halfSpec.depthFormat = 0;
+    const float sceneClear[4] = {0.02f, 0.02f, 0.03f, 1.0f};
+    RenderGraphResource scene = m_graph.Create("scene", sceneSpec, sceneClear);
+    RenderGraphResource bright = m_graph.Create("bright", halfSpec);
+    RenderGraphResource blurred = m_graph.Create("blurred across", halfSpec);
+    RenderGraphResource bloom = m_graph.Create("bloom", halfSpec);
+    RenderGraphResource luminance = m_graph.Create("luminance", halfSpec);
+
+    RenderGraphState fullscreen; // no depth, no blend
+
+    if (m_depthPrepass) {
+        m_graph.AddPass("depth prepass",
+                        [&](RenderGraph::Builder& builder) {
+                            // the color clear is asked for again by the opaque pass, the graph drops that one
+                            scene = builder.Write(scene, LoadOp::Clear, LoadOp::Clear);
+                            RenderGraphState state;
+                            state.depthTest = true;
+                            state.colorWrite = false;
+                            builder.SetState(state);
+                        },
+                        [this](const RenderGraphContext&) { DrawCubes(*m_meshShader, false); });
+    }
+    m_graph.AddPass("opaque",
+                    [&](RenderGraph::Builder& builder) {
+                        scene = builder.Write(scene, LoadOp::Clear, m_depthPrepass ? LoadOp::Load : LoadOp::Clear);
+                        RenderGraphState state;
+                        state.depthTest = true;
+                        state.depthWrite = !m_depthPrepass;
+                        state.depthFunc = m_depthPrepass ? GL_LEQUAL : GL_LESS;
+                        builder.SetState(state);
+                    },
+                    [this](const RenderGraphContext&) { DrawCubes(*m_meshShader, true); });
+
+    // always declared: without the composite reading them they're culled, and take no memory
+    m_graph.AddPass("bloom threshold",
+                    [&](RenderGraph::Builder& builder) {
+                        builder.Read(scene);
+                        bright = builder.Write(bright, LoadOp::DontCare);
+                        builder.SetState(fullscreen);
+                    },
+                    [this, scene](const RenderGraphContext& context) {
+                        m_thresholdShader->Bind();
+                        m_thresholdShader->SetUniform1f("u_Threshold", m_threshold);
+                        DrawFullscreen(*m_thresholdShader, context, scene);
+                    });
+    m_graph.AddPass("blur across",
+                    [&](RenderGraph::Builder& builder) {
+                        builder.Read(bright);
+                        blurred = builder.Write(blurred, LoadOp::DontCare);
+                        builder.SetState(fullscreen);
+                    },
+                    [this, bright](const RenderGraphContext& context) {
+                        m_blurShader->Bind();
+                        m_blurShader->SetUniform2f("u_Direction", 1.0f, 0.0f);
+                        DrawFullscreen(*m_blurShader, context, bright);
+                    });
+    // its target has the size and format of "bright", which is done by now: they share one
+    m_graph.AddPass("blur down",
+                    [&](RenderGraph::Builder& builder) {
+                        builder.Read(blurred);
+                        bloom = builder.Write(bloom, LoadOp::DontCare);
+                        builder.SetState(fullscreen);
+                    },
+                    [this, blurred](const RenderGraphContext& context) {
+                        m_blurShader->Bind();
+                        m_blurShader->SetUniform2f("u_Direction", 0.0f, 1.0f);
+                        DrawFullscreen(*m_blurShader, context, blurred);
+                    });
+    m_graph.AddPass("luminance view",
+                    [&](RenderGraph::Builder& builder) {
+                        builder.Read(scene);
+                        luminance = builder.Write(luminance, LoadOp::DontCare);
+                        builder.SetState(fullscreen);
+                    },
+                    [this, scene](const RenderGraphContext& context) { DrawFullscreen(*m_luminanceShader, context, scene); });
+
+    m_graph.AddPass("composite",
+                    [&](RenderGraph::Builder& builder) {
+                        builder.Read(scene);
+                        if (m_bloom)
+                            builder.Read(bloom);
+                        if (m_showLuminance)
+                            builder.Read(luminance);
+                        output = builder.Write(output, LoadOp::DontCare);
+                        builder.SetState(fullscreen);
+                    },
+                    [this, scene, bloom, luminance](const RenderGraphContext& context) {
+                        Shader& shader = *m_compositeShaders[(m_bloom ? 1 : 0) | (m_showLuminance ? 2 : 0)];
+                        shader.Bind();
+                        if (m_bloom) {
+                            context.BindTexture(bloom, 1);
+                            shader.SetUniform1i("u_Bloom", 1);
+                            shader.SetUniform1f("u_BloomStrength", m_bloomStrength);
+                        }
+                        if (m_showLuminance) {
+                            context.BindTexture(luminance, 2);
+                            shader.SetUniform1i("u_Overlay", 2);
+                        }
+                        DrawFullscreen(shader, context, scene);
+                    });
+
+    m_graph.Compile();
+    m_graph.Execute();
+}
+
+void TestRenderGraph::OnImGuiRender()
+{
+    ImGui::SliderInt("Cubes", &m_cubeCount, 1, MaxCubes);
+    ImGui::SliderFloat("Glow", &m_glow, 1.0f, 16.0f);
+    ImGui::Checkbox("Depth prepass", &m_depthPrepass);
+    ImGui::Checkbox("Bloom", &m_bloom);
+    if (m_bloom) {
+        ImGui::SliderFloat("Threshold", &m_threshold, 0.0f, 4.0f);
+        ImGui::SliderFloat("Bloom strength", &m_bloomStrength, 0.0f, 2.0f);
+    }
+    ImGui::Checkbox("Luminance view", &m_showLuminance);
+
+    ImGui::Separator();
+    const std::vector<unsigned int>& order = m_graph.GetOrder();
+    for (unsigned int pass = 0; pass < m_graph.GetPassCount(); pass++) {
+        if (m_graph.IsCulled(pass)) {
+            ImGui::TextDisabled("  %s (culled)", m_graph.GetPassName(pass).c_str());
+        } else {
+            auto position = std::find(order.begin(), order.end(), pass) - order.begin();
+            ImGui::Text("%d %s", int(position) + 1, m_graph.GetPassName(pass).c_str());
+        }
+    }
+    const RenderGraphStats& stats = m_graph.GetStats();
+    ImGui::Text("%u passes, %u culled; compile %.3f ms, execute %.3f ms (CPU)", stats.passes, stats.culled, stats.compileMs, stats.executeMs);
+    ImGui::Text("Transients: %u, %.2f MB aliased vs %.2f MB with a target each", stats.transients, stats.aliasedBytes / (1024.0 * 1024.0),
+                stats.naiveBytes / (1024.0 * 1024.0));
+    ImGui::Text("Clears: %u asked for, %u skipped, %u added", stats.clearsRequested, stats.clearsSkipped, stats.clearsInserted);
+    ImGui::Text("State: %u changes of %u sets, %u framebuffer binds", stats.stateChanges, stats.stateSets, stats.framebufferBinds);
+    ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+}
+
+} // namespace test
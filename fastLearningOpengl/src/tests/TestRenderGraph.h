@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Test.h"
+#include "glm/glm.hpp"
+#include <memory>
+#include "RenderGraph.h"
+#include "Shader.h"
+#include "Renderer.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+#include "ElementIndexBuffer.h"
+
+namespace test
+{
+
+// a ring of cubes, some of them glowing, rendered through a RenderGraph instead of a fixed sequence:
+// an optional depth prepass, the opaque pass into an HDR target, bloom (threshold, blur across, blur
+// down, at half size) and a luminance view, composited into the application's target. Every pass is
+// declared every frame, the graph culls what the composite doesn't read, and the bloom targets whose
+// lifetimes don't overlap share memory
+class TestRenderGraph : public Test
+{
+public:
+    TestRenderGraph();
+
+    void OnFixedUpdate(float step) override;
+    void OnRender() override;
+    void OnImGuiRender() override;
+
+private:
+    void DrawCubes(Shader& shader, bool shaded);
+    void DrawFullscreen(Shader& shader, const RenderGraphContext& context, RenderGraphResource source);
+
+    std::unique_ptr<VertexArray> m_vao;
+    std::unique_ptr<VertexBuffer> m_vertexBuffer;
+    std::unique_ptr<ElementIndexBuffer> m_indexBuffer;
+    std::shared_ptr<Shader> m_meshShader;
+    std::shared_ptr<Shader> m_thresholdShader;
+    std::shared_ptr<Shader> m_blurShader;
+    std::shared_ptr<Shader> m_luminanceShader;
+    std::shared_ptr<Shader> m_compositeShaders[4]; // by BLOOM | OVERLAY << 1
+    Renderer m_renderer;
+    RenderGraph m_graph;
+
+    glm::mat4 m_proj;
+    glm::mat4 m_view;
+    float m_rotation = 0.0f;
+    float m_previousRotation = 0.0f;
+    int m_cubeCount = 24;
+    float m_glow = 4.0f;           // the color of every fourth cube is multiplied by it
+    bool m_depthPrepass = false;
+    bool m_bloom = true;
+    bool m_showLuminance = false;
+    float m_threshold = 1.0f;
+    float m_bloomStrength = 0.6f;
+};
+
+} // namespace test
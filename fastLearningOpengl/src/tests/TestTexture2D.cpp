@@ -1,4 +1,6 @@
 #include "TestTexture2D.h"
+#include "ShaderLibrary.h"
+#include "UploadQueue.h"
 #include "Renderer.h"
 #include "imgui/imgui.h"
 #include "glm/glm.hpp"
@@ -37,9 +39,9 @@ namespace test{
 
     m_VAO->AddBuffer(*m_VBO, layout);
 
-    m_Shader = std::make_unique<Shader>("res/Shaders/BasicLegacy.shader");
+    m_Shader = Shaders::Get().Get("res/Shaders/BasicLegacy.shader");
     m_Shader->Bind();
-    m_Texture = std::make_unique<Texture>("res/Textures/cute.png");
+    m_Texture = std::make_unique<Texture>("res/Textures/cute.png", &Uploads::Get());
 
     m_Shader->SetUniform1i("ourTexture", 0); // slot 0 for the texture
 
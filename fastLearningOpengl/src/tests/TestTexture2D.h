@@ -22,7 +22,7 @@ namespace test{
         private:
             glm::vec3 m_TranslationA;
             glm::vec3 m_TranslationB;
-            std::unique_ptr<Shader> m_Shader;
+            std::shared_ptr<Shader> m_Shader;
             std::unique_ptr<VertexArray> m_VAO;
             std::unique_ptr<VertexBuffer> m_VBO;
             std::unique_ptr<ElementIndexBuffer> m_EBO;
@@ -0,0 +1,212 @@
+#include "TestTransforms.h"
+#include "ShaderLibrary.h"
+#include "UploadQueue.h"
+
+#include "VertexBufferLayout.h"
+#include "JobSystem.h"
+#include "TestCamera.h" // cube faces
+#include "imgui/imgui.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "FrameClock.h"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace test
+{
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    const char* s_methodNames[] = {"glm per object", "SoA scalar", "SoA SIMD", "SoA SIMD + jobs"};
+    const glm::vec3 s_spinAxis = glm::normalize(glm::vec3(0.5f, 1.0f, 0.0f));
+    constexpr float CubeSize = 1.0f;
+}
+
+TestTransforms::TestTransforms()
+    : m_proj(glm::perspective(glm::radians(45.0f), 960.0f / 540.0f, 0.1f, 1000.0f)),
+      m_view(glm::lookAt(glm::vec3(0.0f, 60.0f, 180.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)))
+{
+    m_vao = std::make_unique<VertexArray>();
+    m_vao->Bind();
+
+    // one cube, the same one TestCameraSuite draws
+    std::vector<TestCameraSuite::Vertex> cube;
+    for (CubeFace face : {CubeFace::Front, CubeFace::Back, CubeFace::Left, CubeFace::Right, CubeFace::Top, CubeFace::Bottom}) {
+        auto quad = TestCameraSuite::CreateQuad(glm::vec3(0.0f), CubeSize, face, float(int(face) & 1));
+        cube.insert(cube.end(), quad.begin(), quad.end());
+    }
+    m_vertexBuffer = std::make_unique<VertexBuffer>(cube.data(), unsigned(cube.size() * sizeof(TestCameraSuite::Vertex)));
+    VertexBufferLayout layout;
+    layout.Push<float>(3);
+    layout.Push<float>(2);
+    layout.Push<float>(4);
+    layout.Push<float>(1);
+    m_vao->AddBuffer(*m_vertexBuffer, layout);
+
+    m_instanceBuffer = std::make_unique<VertexBuffer>(nullptr, unsigned(MaxObjects * sizeof(glm::mat4)), true);
+    VertexBufferLayout instanceLayout;
+    for (int column = 0; column < 4; column++)
+        instanceLayout.Push<float>(4, 1);
+    m_vao->AddBuffer(*m_instanceBuffer, instanceLayout);
+
+    unsigned int indices[36];
+    for (unsigned int face = 0; face < 6; face++) {
+        const unsigned int pattern[6] = {0, 1, 2, 2, 3, 0};
+        for (unsigned int k = 0; k < 6; k++)
+            indices[face * 6 + k] = face * 4 + pattern[k];
+    }
+    m_indexBuffer = std::make_unique<ElementIndexBuffer>(indices, 36);
+
+    m_shader = Shaders::Get().Get("res/Shaders/BatchColor3D.shader", {"INSTANCED"});
+    m_texture0 = std::make_unique<Texture>("res/Textures/cute.png", &Uploads::Get());
+    m_texture1 = std::make_unique<Texture>("res/Textures/ChernoLogo.png", &Uploads::Get());
+
+    // objects on a disc, each with its own fixed orientation like the camera suite's cubes
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    m_positions.resize(MaxObjects);
+    m_eulerDegrees.resize(MaxObjects);
+    m_transforms.Resize(MaxObjects);
+    for (unsigned int i = 0; i < MaxObjects; i++) {
+        float radius = 150.0f * std::sqrt(unit(random));
+        float angle = unit(random) * 6.2831853f;
+        m_positions[i] = glm::vec3(radius * std::cos(angle), (unit(random) - 0.5f) * 20.0f, radius * std::sin(angle));
+        m_eulerDegrees[i] = glm::vec3(unit(random), unit(random), unit(random)) * 360.0f - 180.0f;
+
+        glm::quat rotation = glm::angleAxis(glm::radians(m_eulerDegrees[i].x), glm::vec3(1.0f, 0.0f, 0.0f)) *
+                             glm::angleAxis(glm::radians(m_eulerDegrees[i].y), glm::vec3(0.0f, 1.0f, 0.0f)) *
+                             glm::angleAxis(glm::radians(m_eulerDegrees[i].z), glm::vec3(0.0f, 0.0f, 1.0f));
+        m_transforms.Set(i, m_positions[i], rotation, glm::vec3(1.0f));
+    }
+}
+
+TestTransforms::~TestTransforms()
+{
+    glCall(glDisable(GL_DEPTH_TEST));
+}
+
+void TestTransforms::ComputeMatrices(Method method, unsigned int count, float time, float* out)
+{
+    const float spinAngle = time * glm::radians(50.0f);
+    const glm::quat spin = glm::angleAxis(spinAngle, s_spinAxis);
+
+    switch (method) {
+    case Method::Glm:
+        for (unsigned int i = 0; i < count; i++) {
+            const glm::vec3& euler = m_eulerDegrees[i];
+            glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), spinAngle, s_spinAxis);
+            rotation = glm::rotate(rotation, glm::radians(euler.x), glm::vec3(1.0f, 0.0f, 0.0f));
+            rotation = glm::rotate(rotation, glm::radians(euler.y), glm::vec3(0.0f, 1.0f, 0.0f));
+            rotation = glm::rotate(rotation, glm::radians(euler.z), glm::vec3(0.0f, 0.0f, 1.0f));
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), m_positions[i]) * rotation;
+            std::memcpy(out + i * 16, &model[0][0], sizeof(model));
+        }
+        break;
+    case Method::SoaScalar:
+        Transforms::ComputeMatricesScalar(m_transforms, 0, count, spin, out);
+        break;
+    case Method::SoaSimd:
+        Transforms::ComputeMatrices(m_transforms, 0, count, spin, out);
+        break;
+    case Method::SoaSimdJobs:
+        // chunks are multiples of 4 so only the last one has a scalar tail
+        Jobs::Get().ParallelFor((count + 3) / 4, 1024, [&](std::size_t begin, std::size_t end) {
+            std::size_t first = begin * 4, last = std::min<std::size_t>(end * 4, count);
+            Transforms::ComputeMatrices(m_transforms, first, last, spin, out + first * 16);
+        });
+        break;
+    case Method::Count:
+        break;
+    }
+}
+
+void TestTransforms::OnUpdate([[maybe_unused]] float deltaTime)
+{
+}
+
+void TestTransforms::OnRender()
+{
+    glCall(glEnable(GL_DEPTH_TEST));
+    glCall(glClearColor(0.1f, 0.1f, 0.1f, 1.0f));
+    glCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+    const unsigned int count = unsigned(m_objectCount);
+    auto start = Clock::now();
+    void* instances = m_instanceBuffer->Map(0, unsigned(count * sizeof(glm::mat4)));
+    if (!instances)
+        return;
+    ComputeMatrices(Method(m_method), count, float(Time::Get().GetRenderTime()), static_cast<float*>(instances));
+    m_instanceBuffer->Unmap();
+    m_updateMs = MillisecondsSince(start);
+
+    m_texture0->Bind(0);
+    m_texture1->Bind(1);
+    m_shader->Bind();
+    m_shader->SetUniformMat4f("view", m_view);
+    m_shader->SetUniformMat4f("projection", m_proj);
+    const int textureSlots[] = {0, 1};
+    m_shader->SetUniform1iv("u_Textures", textureSlots, 2);
+    m_renderer.DrawInstanced(*m_vao, *m_indexBuffer, *m_shader, count);
+}
+
+void TestTransforms::RunBenchmark()
+{
+    constexpr int repeats = 5;
+    const unsigned int count = MaxObjects;
+    m_benchmarkOutput.resize(std::size_t(count) * 16);
+    for (int method = 0; method < int(Method::Count); method++) {
+        double best = 1e30;
+        for (int i = 0; i < repeats; i++) {
+            auto start = Clock::now();
+            ComputeMatrices(Method(method), count, 1.0f + i, m_benchmarkOutput.data());
+            best = std::min(best, MillisecondsSince(start));
+        }
+        m_benchmark[method] = {best, count / (best / 1000.0)};
+    }
+    m_hasBenchmark = true;
+}
+
+void TestTransforms::OnImGuiRender()
+{
+    ImGui::SliderInt("Objects", &m_objectCount, 1000, int(MaxObjects));
+    ImGui::Combo("Method", &m_method, s_methodNames, int(Method::Count));
+    ImGui::Text("Matrices into the instance buffer: %.3f ms (%.1f M/s)", m_updateMs,
+                m_updateMs > 0.0 ? m_objectCount / (m_updateMs * 1000.0) : 0.0);
+    ImGui::Text("SIMD: %s, glm intrinsics (GLM_FORCE_INTRINSICS): %s", Transforms::GetSimdName(),
+                GLM_CONFIG_SIMD == GLM_ENABLE ? "on" : "off");
+
+    ImGui::Separator();
+    if (ImGui::Button("Run benchmark"))
+        RunBenchmark();
+    ImGui::SameLine();
+    ImGui::Text("%u matrices into memory, best of 5", MaxObjects);
+    if (m_hasBenchmark && ImGui::BeginTable("transforms", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("method");
+        ImGui::TableSetupColumn("ms");
+        ImGui::TableSetupColumn("M matrices/s (vs glm)");
+        ImGui::TableHeadersRow();
+        for (int method = 0; method < int(Method::Count); method++) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", s_methodNames[method]);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", m_benchmark[method].ms);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f (%.2fx)", m_benchmark[method].matricesPerSecond / 1e6,
+                        m_benchmark[method].matricesPerSecond / m_benchmark[int(Method::Glm)].matricesPerSecond);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+}
+
+} // namespace test
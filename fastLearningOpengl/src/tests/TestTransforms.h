@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Test.h"
+#include "glm/glm.hpp"
+#include <memory>
+#include <vector>
+#include "VertexArray.h"
+#include "ElementIndexBuffer.h"
+#include "VertexBuffer.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "Renderer.h"
+#include "Transforms.h"
+
+namespace test
+{
+
+// a field of spinning cubes whose model matrices are computed every frame straight into the
+// instance buffer. Compares the old per object glm path with the SoA/SIMD transform module
+class TestTransforms : public Test
+{
+public:
+    TestTransforms();
+    ~TestTransforms() override;
+
+    void OnUpdate(float deltaTime) override;
+    void OnRender() override;
+    void OnImGuiRender() override;
+
+    static constexpr unsigned int MaxObjects = 1000000;
+
+    enum class Method
+    {
+        Glm,          // translate * rotate * rotate * rotate * rotate per object, like TestCameraSuite did
+        SoaScalar,
+        SoaSimd,
+        SoaSimdJobs,  // SIMD split over the job system
+        Count
+    };
+
+private:
+    struct BenchmarkResult
+    {
+        double ms;
+        double matricesPerSecond;
+    };
+
+    void ComputeMatrices(Method method, unsigned int count, float time, float* out);
+    void RunBenchmark();
+
+    std::unique_ptr<VertexArray> m_vao;
+    std::unique_ptr<VertexBuffer> m_vertexBuffer;
+    std::unique_ptr<VertexBuffer> m_instanceBuffer;
+    std::unique_ptr<ElementIndexBuffer> m_indexBuffer;
+    std::shared_ptr<Shader> m_shader;
+    std::unique_ptr<Texture> m_texture0;
+    std::unique_ptr<Texture> m_texture1;
+    Renderer m_renderer;
+
+    glm::mat4 m_proj;
+    glm::mat4 m_view;
+
+    // the same objects twice: AoS euler angles for the glm path, SoA quaternions for the new one
+    std::vector<glm::vec3> m_positions;
+    std::vector<glm::vec3> m_eulerDegrees;
+    TransformSoA m_transforms;
+
+    int m_objectCount = 100000;
+    int m_method = int(Method::SoaSimd);
+    double m_updateMs = 0.0;
+    std::vector<float> m_benchmarkOutput;
+    BenchmarkResult m_benchmark[int(Method::Count)] = {};
+    bool m_hasBenchmark = false;
+};
+
+} // namespace test